@@ -27,11 +27,21 @@
 #include <common/include/rtos_utils.h>
 #include <common/include/rtos_err.h>
 #include "sl_wfx_host.h"
+#include "lwip/sys.h"
 #include "dhcp_server.h"
 #include "wifi_cli_lwip.h"
 #include "app_wifi_events.h"
+#include "scan_store.h"
+#include "wifi_roaming.h"
+#include "wifi_power_ctrl.h"
+#include "wifi_stats_sampler.h"
+#include "softap_clients.h"
+#include "wifi_conn_timing.h"
+#include "wifi_event_pool.h"
+#include "wifi_event_bus.h"
 #include "wifi_cli_params.h"
 #include "sl_wfx_sae.h"
+#include "ethernetif.h"
 
 // Event Task Configurations
 #define WFX_EVENTS_TASK_PRIO              21u
@@ -56,15 +66,8 @@ extern char event_log[];
 extern char softap_ssid[32 + 1];
 /* To know if the station's security mode is switched to WPA2 in WPA2/WPA3 transition mode */
 extern bool secur_mode_fallback;
-/* Store information used for the PMKSA caching feature */
-extern sae_pmksa_t sae_pmksa;
 
 OS_Q wifi_events;
-scan_result_list_t scan_list[SL_WFX_MAX_SCAN_RESULTS];
-uint8_t scan_count_web = 0;
-
-static uint8_t scan_count = 0;
-bool           scan_verbose   = true;
 static CPU_STK wfx_events_task_stk[WFX_EVENTS_TASK_STK_SIZE];
 static OS_TCB wfx_events_task_tcb;
 
@@ -173,9 +176,18 @@ sl_status_t sl_wfx_host_process_event(sl_wfx_generic_message_t *event_payload)
       }
       break;
     }
+    case SL_WFX_STARTUP_IND_ID:
+    {
+      /* Firmware (re)started: size the TX window from its input buffers */
+      sl_wfx_startup_ind_t *startup = (sl_wfx_startup_ind_t *)event_payload;
+      ethernetif_tx_start(startup->body.num_inp_ch_bufs);
+      break;
+    }
     /******** CONFIRMATION ********/
     case SL_WFX_SEND_FRAME_CNF_ID:
     {
+      sl_wfx_send_frame_cnf_t *send_frame_cnf = (sl_wfx_send_frame_cnf_t *)event_payload;
+      ethernetif_tx_frame_confirmed(send_frame_cnf->body.status);
       break;
     }
   }
@@ -188,29 +200,14 @@ sl_status_t sl_wfx_host_process_event(sl_wfx_generic_message_t *event_payload)
  *****************************************************************************/
 void sl_wfx_scan_result_callback(sl_wfx_scan_result_ind_t *scan_result)
 {
-  scan_count++;
-
-  if (scan_verbose) {
-    /*Report one AP information*/
-    printf(
-      "# %2d %2d  %03d %02X:%02X:%02X:%02X:%02X:%02X  %s\r\n",
-      scan_count,
-      scan_result->body.channel,
-      ((int16_t)(scan_result->body.rcpi - 220) / 2),
-      scan_result->body.mac[0], scan_result->body.mac[1],
-      scan_result->body.mac[2], scan_result->body.mac[3],
-      scan_result->body.mac[4], scan_result->body.mac[5],
-      scan_result->body.ssid_def.ssid);
-    printf("\r\n");
-  }
-
-  if (scan_count <= SL_WFX_MAX_SCAN_RESULTS) {
-    scan_list[scan_count - 1].ssid_def = scan_result->body.ssid_def;
-    scan_list[scan_count - 1].channel = scan_result->body.channel;
-    scan_list[scan_count - 1].security_mode = scan_result->body.security_mode;
-    scan_list[scan_count - 1].rcpi = scan_result->body.rcpi;
-    memcpy(scan_list[scan_count - 1].mac, scan_result->body.mac, 6);
-  }
+  scan_result_list_t result;
+
+  result.ssid_def = scan_result->body.ssid_def;
+  result.channel = scan_result->body.channel;
+  result.security_mode = scan_result->body.security_mode;
+  result.rcpi = scan_result->body.rcpi;
+  memcpy(result.mac, scan_result->body.mac, SL_WFX_BSSID_SIZE);
+  scan_store_update(&result, sys_now());
 }
 
 /**************************************************************************//**
@@ -218,51 +215,18 @@ void sl_wfx_scan_result_callback(sl_wfx_scan_result_ind_t *scan_result)
  *****************************************************************************/
 void sl_wfx_scan_complete_callback(sl_wfx_scan_complete_ind_t *scan_complete)
 {
-  void * buffer;
-  sl_status_t status;
-  RTOS_ERR err;
-
-  scan_count_web = scan_count;
-  scan_count = 0;
-
-  status = sl_wfx_host_allocate_buffer(&buffer,
-                                       SL_WFX_RX_FRAME_BUFFER,
-                                       scan_complete->header.length);
-  if (status == SL_STATUS_OK) {
-    memcpy(buffer, (void *)scan_complete, scan_complete->header.length);
-    OSQPost(&wifi_events,
-            buffer,
-            scan_complete->header.length,
-            OS_OPT_POST_FIFO,
-            &err);
-  }
+  wifi_event_pool_post(&wifi_events, scan_complete, scan_complete->header.length);
 }
 /**************************************************************************//**
  * Callback when station connects
  *****************************************************************************/
 void sl_wfx_connect_callback(sl_wfx_connect_ind_t *connect)
 {
-  void *buffer;
-  sl_status_t status;
-  RTOS_ERR err;
-
   switch (connect->body.status) {
     case WFM_STATUS_SUCCESS:
     {
       printf("Connected\r\n");
       sl_wfx_context->state |= SL_WFX_STA_INTERFACE_CONNECTED;
-
-      status = sl_wfx_host_allocate_buffer(&buffer,
-                                           SL_WFX_RX_FRAME_BUFFER,
-                                           connect->header.length);
-      if (status == SL_STATUS_OK) {
-        memcpy(buffer, (void *)connect, connect->header.length);
-        OSQPost(&wifi_events,
-                buffer,
-                connect->header.length,
-                OS_OPT_POST_FIFO,
-                &err);
-      }
       break;
     }
     case WFM_STATUS_NO_MATCHING_AP:
@@ -301,6 +265,10 @@ void sl_wfx_connect_callback(sl_wfx_connect_ind_t *connect)
       printf("%s\r\n", event_log);
     }
   }
+
+  /* Failures are forwarded too so that the connect command can fall back
+   * to another join path without waiting for its timeout */
+  wifi_event_pool_post(&wifi_events, connect, connect->header.length);
 }
 
 /**************************************************************************//**
@@ -308,10 +276,6 @@ void sl_wfx_connect_callback(sl_wfx_connect_ind_t *connect)
  *****************************************************************************/
 void sl_wfx_disconnect_callback(sl_wfx_disconnect_ind_t *disconnect)
 {
-  void *buffer;
-  sl_status_t status;
-  RTOS_ERR err;
-
   switch (disconnect->body.reason) {
     case WFM_DISCONNECTED_REASON_UNSPECIFIED:
       printf("The device disconnected because of an internal error\r\n");
@@ -332,17 +296,7 @@ void sl_wfx_disconnect_callback(sl_wfx_disconnect_ind_t *disconnect)
 
   sl_wfx_context->state &= ~SL_WFX_STA_INTERFACE_CONNECTED;
 
-  status = sl_wfx_host_allocate_buffer(&buffer,
-                                       SL_WFX_RX_FRAME_BUFFER,
-                                       disconnect->header.length);
-  if (status == SL_STATUS_OK) {
-    memcpy(buffer, (void *)disconnect, disconnect->header.length);
-    OSQPost(&wifi_events,
-            buffer,
-            disconnect->header.length,
-            OS_OPT_POST_FIFO,
-            &err);
-  }
+  wifi_event_pool_post(&wifi_events, disconnect, disconnect->header.length);
 }
 
 /**************************************************************************//**
@@ -350,26 +304,12 @@ void sl_wfx_disconnect_callback(sl_wfx_disconnect_ind_t *disconnect)
  *****************************************************************************/
 void sl_wfx_start_ap_callback(sl_wfx_start_ap_ind_t *start_ap)
 {
-  void *buffer;
-  sl_status_t status;
-  RTOS_ERR err;
-
   if (start_ap->body.status == 0) {
     printf("AP started\r\n");
     printf("Join the AP with SSID: %s\r\n", softap_ssid);
     sl_wfx_context->state |= SL_WFX_AP_INTERFACE_UP;
 
-    status = sl_wfx_host_allocate_buffer(&buffer,
-                                         SL_WFX_RX_FRAME_BUFFER,
-                                         start_ap->header.length);
-    if (status == SL_STATUS_OK) {
-      memcpy(buffer, (void *)start_ap, start_ap->header.length);
-      OSQPost(&wifi_events,
-              buffer,
-              start_ap->header.length,
-              OS_OPT_POST_FIFO,
-              &err);
-    }
+    wifi_event_pool_post(&wifi_events, start_ap, start_ap->header.length);
   } else {
     printf("AP start failed\r\n");
     strcpy(event_log, "AP start failed");
@@ -381,27 +321,19 @@ void sl_wfx_start_ap_callback(sl_wfx_start_ap_ind_t *start_ap)
  *****************************************************************************/
 void sl_wfx_stop_ap_callback(sl_wfx_stop_ap_ind_t *stop_ap)
 {
-  void *buffer;
-  sl_status_t status;
-  RTOS_ERR err;
-
   printf("SoftAP stopped\r\n");
   dhcpserver_clear_stored_mac();
+  softap_clients_clear();
   sl_wfx_context->state &= ~SL_WFX_AP_INTERFACE_UP;
 
-  status = sl_wfx_host_allocate_buffer(&buffer,
-                                       SL_WFX_RX_FRAME_BUFFER,
-                                       stop_ap->length);
-  if (status == SL_STATUS_OK) {
-    memcpy(buffer, (void *)stop_ap, stop_ap->length);
-    OSQPost(&wifi_events, buffer, stop_ap->length, OS_OPT_POST_FIFO, &err);
-  }
+  wifi_event_pool_post(&wifi_events, stop_ap, stop_ap->length);
 }
 /**************************************************************************//**
  * Callback for client connect to AP
  *****************************************************************************/
 void sl_wfx_ap_client_connected_callback(sl_wfx_ap_client_connected_ind_t *ap_client_connected)
 {
+  softap_clients_add(ap_client_connected->body.mac);
   printf("Client connected, MAC: %02X:%02X:%02X:%02X:%02X:%02X\r\n",
          ap_client_connected->body.mac[0],
          ap_client_connected->body.mac[1],
@@ -419,6 +351,7 @@ void sl_wfx_ap_client_rejected_callback(sl_wfx_ap_client_rejected_ind_t *ap_clie
   struct eth_addr mac_addr;
   memcpy(&mac_addr, ap_client_rejected->body.mac, SL_WFX_BSSID_SIZE);
   dhcpserver_remove_mac(&mac_addr);
+  softap_clients_remove(ap_client_rejected->body.mac);
   printf("Client rejected, reason: %d, MAC: %02X:%02X:%02X:%02X:%02X:%02X\r\n",
          ap_client_rejected->body.reason,
          ap_client_rejected->body.mac[0],
@@ -437,6 +370,7 @@ void sl_wfx_ap_client_disconnected_callback(sl_wfx_ap_client_disconnected_ind_t
   struct eth_addr mac_addr;
   memcpy(&mac_addr, ap_client_disconnected->body.mac, SL_WFX_BSSID_SIZE);
   dhcpserver_remove_mac(&mac_addr);
+  softap_clients_remove(ap_client_disconnected->body.mac);
   printf("Client disconnected, reason: %d, MAC: %02X:%02X:%02X:%02X:%02X:%02X\r\n",
          ap_client_disconnected->body.reason,
          ap_client_disconnected->body.mac[0],
@@ -452,23 +386,7 @@ void sl_wfx_ap_client_disconnected_callback(sl_wfx_ap_client_disconnected_ind_t
  *****************************************************************************/
 void sl_wfx_ext_auth_callback (sl_wfx_ext_auth_ind_t *ext_auth_indication) 
 {
-  void *buffer;
-  sl_status_t status;
-  RTOS_ERR err;
-
-  status = sl_wfx_host_allocate_buffer(&buffer,
-                                       SL_WFX_RX_FRAME_BUFFER,
-                                       ext_auth_indication->header.length);
-  if (status == SL_STATUS_OK) {
-    memcpy(buffer,
-           (void *)ext_auth_indication,
-           ext_auth_indication->header.length);
-    OSQPost(&wifi_events,
-            buffer,
-            ext_auth_indication->header.length,
-            OS_OPT_POST_FIFO,
-            &err);
-  }
+  wifi_event_pool_post(&wifi_events, ext_auth_indication, ext_auth_indication->header.length);
 }
 
 /**************************************************************************//**
@@ -484,10 +402,6 @@ void sl_wfx_generic_status_callback(sl_wfx_generic_ind_t* frame)
  *****************************************************************************/
 void sl_wfx_ps_mode_error_callback(sl_wfx_ps_mode_error_ind_t *ps_mode_error)
 {
-  void *buffer;
-  sl_status_t status;
-  RTOS_ERR err;
-
   switch (ps_mode_error->body.reason) 
   {
     case WFM_PS_MODE_ERROR_PSPOLL_TIMEOUT:
@@ -511,14 +425,6 @@ void sl_wfx_ps_mode_error_callback(sl_wfx_ps_mode_error_ind_t *ps_mode_error)
       break;
     }
   }
-
-  status = sl_wfx_host_allocate_buffer(&buffer,
-                                       SL_WFX_RX_FRAME_BUFFER,
-                                       ps_mode_error->header.length);
-  if (status == SL_STATUS_OK) {
-    memcpy(buffer, (void *)ps_mode_error, ps_mode_error->header.length);
-    OSQPost(&wifi_events, buffer, ps_mode_error->header.length, OS_OPT_POST_FIFO, &err);
-  }
 }
 
 /***************************************************************************//**
@@ -526,7 +432,7 @@ void sl_wfx_ps_mode_error_callback(sl_wfx_ps_mode_error_ind_t *ps_mode_error)
  ******************************************************************************/
 static void wfx_events_task(void *p_arg)
 {
-  int ret;
+  uint32_t timestamp;
   RTOS_ERR err;
   OS_MSG_SIZE msg_size;
   sl_wfx_generic_message_t *msg;
@@ -545,19 +451,38 @@ static void wfx_events_task(void *p_arg)
                                               &err);
 
     if (msg != NULL) {
-      ret = 0;
+      timestamp = wifi_event_pool_timestamp(msg);
       switch (msg->header.id) {
         case SL_WFX_CONNECT_IND_ID:
         {
+          connect_msg = (const sl_wfx_connect_ind_t *)msg;
+          if (connect_msg->body.status != WFM_STATUS_SUCCESS) {
+            wifi_event_bus_publish(WIFI_EVENT_CONNECT, connect_msg->body.status, timestamp);
+            break;
+          }
+          wifi_conn_timing_mark(WIFI_CONN_STAGE_CONNECTED);
           set_sta_link_up();
+          wifi_roaming_connected(connect_msg->body.mac,
+                                 connect_msg->body.channel,
+                                 connect_msg->body.beacon_interval,
+                                 connect_msg->body.dtim_period);
+          wifi_power_ctrl_connected(connect_msg->body.beacon_interval,
+                                    connect_msg->body.dtim_period);
+          if (wlan_tx_params.set) {
+            /* The firmware forgets the TX rate parameters across resets */
+            tx_rates_u tx_rates;
+            tx_rates.rate = wlan_tx_params.rates;
+            sl_wfx_set_tx_rate_parameters(tx_rates.bit_mask,
+                                          wlan_tx_params.rate_algo,
+                                          SL_WFX_STA_INTERFACE);
+          }
           /*
            * PMKSA caching
            */
-          connect_msg = (const sl_wfx_connect_ind_t *)msg;
           /* clear the PMK cached if the PMK is generated with the fallback AP */
-          if (secur_mode_fallback && !memcmp(sae_pmksa.bssid, connect_msg->body.mac, SL_WFX_BSSID_SIZE))
+          if (secur_mode_fallback)
           {
-            sl_wfx_sae_invalidate_pmksa();
+            sl_wfx_sae_invalidate_pmksa_bssid((const sl_wfx_mac_address_t *)connect_msg->body.mac);
           }
           /* cache the PMK to use in subsequent connections with the same AP */
           if ((wlan_security_wpa3_pmksa) && (caching_pmk)) {
@@ -574,19 +499,23 @@ static void wfx_events_task(void *p_arg)
             sl_wfx_enable_device_power_save();
           }
 #endif
-          ret = wifi_cli_resume(&g_cli_sem, SL_WFX_CONNECT_IND_ID);
+          wifi_event_bus_publish(WIFI_EVENT_CONNECT, WFM_STATUS_SUCCESS, timestamp);
           break;
         }
         case SL_WFX_DISCONNECT_IND_ID:
         {
           set_sta_link_down();
-          ret = wifi_cli_resume(&g_cli_sem, SL_WFX_DISCONNECT_IND_ID);
+          wifi_event_bus_publish(WIFI_EVENT_DISCONNECT,
+                                 ((const sl_wfx_disconnect_ind_t *)msg)->body.reason,
+                                 timestamp);
           break;
         }
         case SL_WFX_START_AP_IND_ID:
         {
           set_ap_link_up();
-          ret = wifi_cli_resume(&g_cli_sem, SL_WFX_START_AP_IND_ID);
+          wifi_event_bus_publish(WIFI_EVENT_START_AP,
+                                 ((const sl_wfx_start_ap_ind_t *)msg)->body.status,
+                                 timestamp);
 
 #ifdef SL_CATALOG_POWER_MANAGER_PRESENT
           // Power save always disabled when SoftAP mode enabled
@@ -598,7 +527,7 @@ static void wfx_events_task(void *p_arg)
         case SL_WFX_STOP_AP_IND_ID:
         {
           set_ap_link_down();
-          ret = wifi_cli_resume(&g_cli_sem, SL_WFX_STOP_AP_IND_ID);
+          wifi_event_bus_publish(WIFI_EVENT_STOP_AP, 0, timestamp);
 
 #ifdef SL_CATALOG_POWER_MANAGER_PRESENT
           if (wifi.state & SL_WFX_STA_INTERFACE_CONNECTED) {
@@ -613,7 +542,9 @@ static void wfx_events_task(void *p_arg)
         }
         case SL_WFX_SCAN_COMPLETE_IND_ID:
         {
-          ret = wifi_cli_resume(&g_cli_sem, SL_WFX_SCAN_COMPLETE_IND_ID);
+          wifi_event_bus_publish(WIFI_EVENT_SCAN_COMPLETE,
+                                 ((const sl_wfx_scan_complete_ind_t *)msg)->body.status,
+                                 timestamp);
           break;
         }
         case SL_WFX_EXT_AUTH_IND_ID:
@@ -621,17 +552,9 @@ static void wfx_events_task(void *p_arg)
           sl_wfx_sae_exchange((sl_wfx_ext_auth_ind_t *)msg, &caching_pmk);
           break;
         }
-        case SL_WFX_PS_MODE_ERROR_IND_ID:
-        {
-          break;
-        }
       }
-      /* Check the wifi_cli_resume() result */
-      if (ret < 0) {
-          LOG_DEBUG("wfx_events_task() failed to release CLI's semaphore");
-      }
-
-      sl_wfx_host_free_buffer(msg, SL_WFX_RX_FRAME_BUFFER);
+      /* Give the slot back to the bus task */
+      wifi_event_pool_release(msg);
     }
   }
 }
@@ -642,6 +565,7 @@ static void wfx_events_task(void *p_arg)
 void app_wifi_events_start(void)
 {
   RTOS_ERR err;
+  int ret;
 
 #ifdef SL_CATALOG_POWER_MANAGER_PRESENT
 #ifdef SL_CATALOG_WFX_BUS_SDIO_PRESENT
@@ -652,11 +576,30 @@ void app_wifi_events_start(void)
 #endif
 #endif
 
-  /* Initialize Wi-Fi CLI's binary semaphore */
-  wifi_cli_sem_init(&g_cli_sem, &err);
+  /* Initialize the store of the scanned access points */
+  scan_store_init();
+
+  /* Initialize the slots of the indications deferred to the events task */
+  wifi_event_pool_init();
+
+  /* Register the CLI to the Wi-Fi events bus */
+  wifi_event_bus_init();
+  ret = wifi_event_bus_subscribe(&g_cli_events, "cli events");
 
   /* Check error code. */
-  APP_RTOS_ASSERT_DBG((RTOS_ERR_CODE_GET(err) == RTOS_ERR_NONE), 1);
+  APP_RTOS_ASSERT_DBG((ret == 0), 1);
+
+  /* Create the roaming task, idle until enabled */
+  wifi_roaming_start();
+
+  /* Create the power-save controller task, idle until enabled */
+  wifi_power_ctrl_start();
+
+  /* Create the statistics sampler task, idle until enabled */
+  wifi_stats_sampler_start();
+
+  /* Create the SoftAP client table task */
+  softap_clients_start();
 
   /* Create wifi_events message queue */
   OSQCreate(&wifi_events, "wifi events", WFX_EVENTS_NB_MAX, &err);
@@ -29,10 +29,6 @@ extern sl_wfx_context_t   wifi;
 /* Wi-Fi event message queue */
 extern OS_Q               wifi_events;
 
-extern scan_result_list_t scan_list[];
-extern uint8_t scan_count_web;
-extern bool scan_verbose;
-
 #ifdef __cplusplus
 extern "C" {
 #endif
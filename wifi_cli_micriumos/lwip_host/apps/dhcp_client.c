@@ -18,135 +18,193 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  *****************************************************************************/
+#include <string.h>
 #include "lwip/netifapi.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "lwip/dhcp.h"
+#include "lwip/prot/dhcp.h"
 #include "wifi_cli_params.h"
-#include <kernel/include/os.h>
-#include <common/include/rtos_utils.h>
-#include <common/include/rtos_err.h>
-#include <common/source/kal/kal_priv.h>
+#include "wifi_conn_timing.h"
+#include "latency_trace.h"
+#include "wifi_event_bus.h"
+#include "dhcp_client.h"
 
-// DHCP client states
-#define DHCP_OFF                   (uint8_t) 0
-#define DHCP_START                 (uint8_t) 1
-#define DHCP_WAIT_ADDRESS          (uint8_t) 2
-#define DHCP_ADDRESS_ASSIGNED      (uint8_t) 3
-#define DHCP_TIMEOUT               (uint8_t) 4
-#define DHCP_LINK_DOWN             (uint8_t) 5
+/// Time without address before the static one is used (ms), about the
+/// 5 DISCOVER tries the previous polling client waited for.
+#define DHCP_CLIENT_TIMEOUT_MS     31000
 
-#define MAX_DHCP_TRIES  4
+/// Last lease, saved in NVM3 to skip DISCOVER/OFFER at the next connection.
+typedef struct {
+  char ssid[32 + 1];          ///< Network of the lease, empty if none
+  uint32_t ip;                ///< Addresses in network byte order
+  uint32_t netmask;
+  uint32_t gw;
+  uint32_t server;
+  uint32_t lease_time;        ///< Seconds
+} dhcp_client_lease_t;
 
-/// Current DHCP state machine state.
-static volatile uint8_t dhcp_state = DHCP_OFF;
+static dhcp_client_lease_t last_lease;
+static bool dhcp_client_initialized = false;
+/// The link is up and an address is requested.
+static bool dhcp_client_running = false;
+/// Time of the link up (ms).
+static uint32_t dhcp_client_start_ms = 0;
+/// The last lease is requested again (INIT-REBOOT).
+static bool dhcp_client_rebooting = false;
 
-#define DHCP_TASK_PRIO              22u
-#define DHCP_TASK_STK_SIZE         512u
+/***************************************************************************//**
+ * Use the static address after DHCP_CLIENT_TIMEOUT_MS without lease.
+ ******************************************************************************/
+static void dhcp_client_timeout(void *arg)
+{
+  struct netif *netif = (struct netif *)arg;
+  ip4_addr_t ipaddr;
+  ip4_addr_t netmask;
+  ip4_addr_t gw;
+
+  if (!dhcp_client_running || dhcp_supplied_address(netif)) {
+    return;
+  }
+  dhcp_client_running = false;
 
-/// DHCP client task stack
-static CPU_STK dhcp_task_stk[DHCP_TASK_STK_SIZE];
-/// DHCP client task TCB
-static OS_TCB dhcp_task_tcb;
+  // Stop DHCP
+  dhcp_stop(netif);
+
+  // Static address used
+  IP4_ADDR(&ipaddr, sta_ip_addr0, sta_ip_addr1, sta_ip_addr2, sta_ip_addr3);
+  IP4_ADDR(&netmask, sta_netmask_addr0, sta_netmask_addr1, sta_netmask_addr2, sta_netmask_addr3);
+  IP4_ADDR(&gw, sta_gw_addr0, sta_gw_addr1, sta_gw_addr2, sta_gw_addr3);
+  netif_set_addr(netif, &ipaddr, &netmask, &gw);
+  printf("DHCP timeout, static IP address used\r\n");
+  wifi_conn_timing_mark(WIFI_CONN_STAGE_DHCP_BOUND);
+  wifi_conn_timing_end();
+  wifi_event_bus_publish(WIFI_EVENT_IP_BOUND, 0, latency_trace_timestamp());
+}
 
 /***************************************************************************//**
- * Notify DHCP client task about the wifi status
- *
- * @param link_up link status
+ * Save the lease in NVM3 if it changed, the renewals of the same lease
+ * leaving the flash untouched.
  ******************************************************************************/
-void dhcpclient_set_link_state(int link_up)
+static void dhcp_client_save_lease(struct netif *netif)
 {
-  if (link_up) {
-    dhcp_state = DHCP_START;
-  } else {
-    /* Update DHCP state machine */
-    dhcp_state = DHCP_LINK_DOWN;
+  struct dhcp *dhcp = netif_dhcp_data(netif);
+  dhcp_client_lease_t lease;
+
+  memset(&lease, 0, sizeof(lease));
+  strncpy(lease.ssid, wlan_ssid, sizeof(lease.ssid) - 1);
+  lease.ip = ip4_addr_get_u32(&dhcp->offered_ip_addr);
+  lease.netmask = ip4_addr_get_u32(&dhcp->offered_sn_mask);
+  lease.gw = ip4_addr_get_u32(&dhcp->offered_gw_addr);
+  lease.server = ip4_addr_get_u32(ip_2_ip4(&dhcp->server_ip_addr));
+  lease.lease_time = dhcp->offered_t0_lease;
+
+  if (memcmp(&lease, &last_lease, sizeof(lease)) == 0) {
+    return;
+  }
+  last_lease = lease;
+  nvm3_writeData(nvm3_defaultHandle,
+                 NVM3_KEY_DHCPC_LEASE,
+                 (void *)&last_lease,
+                 sizeof(last_lease));
+}
+
+/***************************************************************************//**
+ * Station interface status callback, called when its address changes.
+ ******************************************************************************/
+static void dhcp_client_status_callback(struct netif *netif)
+{
+  if (!dhcp_client_running || !dhcp_supplied_address(netif)) {
+    return;
+  }
+  dhcp_client_running = false;
+  sys_untimeout(dhcp_client_timeout, netif);
+  wifi_conn_timing_mark(WIFI_CONN_STAGE_DHCP_BOUND);
+  wifi_conn_timing_end();
+  wifi_event_bus_publish(WIFI_EVENT_IP_BOUND, 0, latency_trace_timestamp());
+
+  printf("IP address : %d.%d.%d.%d (%s, %lu ms)\r\n",
+         (uint8_t)(netif->ip_addr.addr & 0xff),
+         (uint8_t)(netif->ip_addr.addr >> 8),
+         (uint8_t)(netif->ip_addr.addr >> 16),
+         (uint8_t)(netif->ip_addr.addr >> 24),
+         dhcp_client_rebooting ? "INIT-REBOOT" : "DISCOVER",
+         (unsigned long)(sys_now() - dhcp_client_start_ms));
+  dhcp_client_save_lease(netif);
+}
+
+/***************************************************************************//**
+ * Restore the last lease and register the status callback, core locked.
+ ******************************************************************************/
+static void dhcp_client_init(struct netif *netif)
+{
+  if (dhcp_client_initialized) {
+    return;
   }
+  if (nvm3_readData(nvm3_defaultHandle,
+                    NVM3_KEY_DHCPC_LEASE,
+                    (void *)&last_lease,
+                    sizeof(last_lease)) != ECODE_NVM3_OK) {
+    memset(&last_lease, 0, sizeof(last_lease));
+  }
+  last_lease.ssid[sizeof(last_lease.ssid) - 1] = '\0';
+  netif_set_status_callback(netif, dhcp_client_status_callback);
+  dhcp_client_initialized = true;
 }
 
 /***************************************************************************//**
- * DHCP client task.
+ * Notify DHCP client about the wifi status
  *
- * @param arg Network interface
+ * @param link_up link status
  ******************************************************************************/
-static void dhcp_client_task(void *arg)
+void dhcpclient_set_link_state(int link_up)
 {
-  struct netif *netif = (struct netif *) arg;
-  ip_addr_t ipaddr;
-  ip_addr_t netmask;
-  ip_addr_t gw;
+  struct netif *netif = &sta_netif;
   struct dhcp *dhcp;
-  for (;; ) {
-    switch (dhcp_state) {
-      case DHCP_START:
-      {
-        ip_addr_set_zero_ip4(&netif->ip_addr);
-        ip_addr_set_zero_ip4(&netif->netmask);
-        ip_addr_set_zero_ip4(&netif->gw);
-        netifapi_dhcp_start(netif);
-        dhcp_state = DHCP_WAIT_ADDRESS;
-      }
-      break;
-
-      case DHCP_WAIT_ADDRESS:
-      {
-        if (dhcp_supplied_address(netif)) {
-          dhcp_state = DHCP_ADDRESS_ASSIGNED;
-          printf("IP address : %d.%d.%d.%d\r\n",
-                 (uint8_t)(sta_netif.ip_addr.addr & 0xff),
-                 (uint8_t)(sta_netif.ip_addr.addr >> 8),
-                 (uint8_t)(sta_netif.ip_addr.addr >> 16),
-                 (uint8_t)(sta_netif.ip_addr.addr >> 24));
-        } else {
-          dhcp = (struct dhcp *)netif_get_client_data(netif, LWIP_NETIF_CLIENT_DATA_INDEX_DHCP);
-
-          // DHCP timeout
-          if (dhcp->tries > MAX_DHCP_TRIES) {
-            dhcp_state = DHCP_TIMEOUT;
-
-            // Stop DHCP
-            netifapi_dhcp_stop(netif);
-
-            // Static address used
-            IP_ADDR4(&ipaddr, sta_ip_addr0, sta_ip_addr1, sta_ip_addr2, sta_ip_addr3);
-            IP_ADDR4(&netmask, sta_netmask_addr0, sta_netmask_addr1, sta_netmask_addr2, sta_netmask_addr3);
-            IP_ADDR4(&gw, sta_gw_addr0, sta_gw_addr1, sta_gw_addr2, sta_gw_addr3);
-            netif_set_addr(netif, ip_2_ip4(&ipaddr), ip_2_ip4(&netmask), ip_2_ip4(&gw));
-          }
-        }
-      }
-      break;
-      case DHCP_LINK_DOWN:
-      {
-        // Stop DHCP
-        netifapi_dhcp_stop(netif);
-        dhcp_state = DHCP_OFF;
-      }
-      break;
-      default: break;
-    }
 
-    // wait 250 ms
-    KAL_Dly(250);
+  LOCK_TCPIP_CORE();
+  dhcp_client_init(netif);
+  sys_untimeout(dhcp_client_timeout, netif);
+
+  if (link_up) {
+    ip_addr_set_zero_ip4(&netif->ip_addr);
+    ip_addr_set_zero_ip4(&netif->netmask);
+    ip_addr_set_zero_ip4(&netif->gw);
+    dhcp_client_running = true;
+    dhcp_client_rebooting = false;
+    dhcp_client_start_ms = sys_now();
+
+    // With the link still down, lwIP waits for it before sending anything.
+    dhcp_start(netif);
+    dhcp = netif_dhcp_data(netif);
+    if ((dhcp != NULL) && !netif_is_link_up(netif)
+        && (last_lease.ip != 0) && (strcmp(last_lease.ssid, wlan_ssid) == 0)) {
+      // Same network: request the last address again at link up (INIT-REBOOT),
+      // lwIP going back to DISCOVER if the server does not answer.
+      ip4_addr_set_u32(&dhcp->offered_ip_addr, last_lease.ip);
+      ip4_addr_set_u32(&dhcp->offered_sn_mask, last_lease.netmask);
+      ip4_addr_set_u32(&dhcp->offered_gw_addr, last_lease.gw);
+      ip_addr_set_ip4_u32(&dhcp->server_ip_addr, last_lease.server);
+      dhcp->offered_t0_lease = last_lease.lease_time;
+      dhcp->tries = 0;
+      dhcp->state = DHCP_STATE_REBOOTING;
+      dhcp_client_rebooting = true;
+    }
+    sys_timeout(DHCP_CLIENT_TIMEOUT_MS, dhcp_client_timeout, netif);
+  } else {
+    // Stop DHCP
+    dhcp_client_running = false;
+    dhcp_stop(netif);
   }
+  UNLOCK_TCPIP_CORE();
 }
 
 /***************************************************************************//**
- * Start DHCP client task.
+ * Start DHCP client: restore the last lease and wait for the link.
  ******************************************************************************/
 void dhcpclient_start(void)
 {
-  RTOS_ERR err;
-  OSTaskCreate(&dhcp_task_tcb,
-               "DHCP Task",
-               dhcp_client_task,
-               &sta_netif,
-               DHCP_TASK_PRIO,
-               &dhcp_task_stk[0],
-               (DHCP_TASK_STK_SIZE / 10u),
-               DHCP_TASK_STK_SIZE,
-               0u,
-               0u,
-               DEF_NULL,
-               (OS_OPT_TASK_STK_CLR),
-               &err);
-  //   Check error code.
-  APP_RTOS_ASSERT_DBG((RTOS_ERR_CODE_GET(err) == RTOS_ERR_NONE), 1);
+  LOCK_TCPIP_CORE();
+  dhcp_client_init(&sta_netif);
+  UNLOCK_TCPIP_CORE();
 }
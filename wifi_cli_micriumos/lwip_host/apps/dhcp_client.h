@@ -21,14 +21,17 @@
 extern "C" {
 #endif
 /***************************************************************************//**
- * Notify DHCP client task about the wifi status
+ * Notify DHCP client about the wifi status. The link up notification has to
+ * come before the netif link up, so that the last lease is requested again
+ * (INIT-REBOOT) instead of starting with a DISCOVER.
  *
  * @param link_up link status
  ******************************************************************************/
 void dhcpclient_set_link_state(int link_up);
 
 /***************************************************************************//**
- * Start DHCP client task.
+ * Start DHCP client: restore the last lease from NVM3 and register the station
+ * interface status callback.
  ******************************************************************************/
 void dhcpclient_start(void);
 #ifdef __cplusplus
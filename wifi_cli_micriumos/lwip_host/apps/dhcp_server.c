@@ -18,13 +18,17 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  *****************************************************************************/
+#include <stddef.h>
 #include <string.h>
 #include "lwip/netifapi.h"
 #include "lwip/tcpip.h"
 #include "lwip/prot/dhcp.h"
 #include "lwip/etharp.h"
+#include "lwip/timeouts.h"
 #include "wifi_cli_params.h"
 #include "dhcp_server.h"
+#include "dhcp_server_lease.h"
+#include "dhcp_server_msg.h"
 
 #if LWIP_UDP && LWIP_DHCP
 
@@ -32,14 +36,36 @@
 static struct udp_pcb * dhcp_pcb = 0;
 static bool dhcp_server_started = false;
 
-#define DHCP_RESPONSE_DEFAULT_SIZE 1024
 #define DHCPS_DBG 0
 
 #define DHCP_SERVER_PORT 67
 #define DHCP_CLIENT_PORT 68
 
-/// Place to store mac addresses of dhcp clients.
-static struct eth_addr saved_mac[DHCPS_MAX_CLIENT];
+/// Seconds elapsed since the server start, the lease time base.
+static uint32_t dhcps_clock_sec = 0;
+/// sys_now() value matching dhcps_clock_sec.
+static uint32_t dhcps_clock_ms = 0;
+
+/// Period of the lease expiry check (ms).
+#define DHCPS_LEASE_TIMER_MS 10000
+/// Minimum time between two saves of the leases in NVM3 (s), bounding the
+/// flash wear whatever the client churn.
+#define DHCPS_LEASE_SAVE_PERIOD_SEC 60
+
+/// Leases saved in NVM3, restored if the address pool did not change.
+typedef struct {
+  uint32_t first_ip;
+  uint16_t pool_size;
+  uint16_t count;
+  dhcps_lease_record_t records[DHCPS_MAX_CLIENT];
+} dhcpserver_saved_leases_t;
+
+static dhcpserver_saved_leases_t saved_leases;
+/// Address pool of the running server.
+static uint32_t dhcps_pool_first_ip = 0;
+static uint16_t dhcps_pool_size = 0;
+/// Time of the last save of the leases (s).
+static uint32_t dhcps_save_sec = 0;
 
 #define UDP_DATA_OFS    0
 // DHCP message item offsets and length
@@ -60,50 +86,181 @@ static struct eth_addr saved_mac[DHCPS_MAX_CLIENT];
 #define DHCP_COOKIE_OFS (DHCP_MSG_OFS + DHCP_MSG_LEN)
 #define UDP_DHCP_OPTIONS_OFS (DHCP_MSG_OFS + DHCP_MSG_LEN + 4)
 
-#define LEASE_TIME_1DAY     (86400)
 
 /***************************************************************************//**
- * Remove mac address from list of clients.
- *
- * @param mac MAC address to remove.
+ * Get the lease time base in seconds, insensitive to the sys_now() wrap.
  ******************************************************************************/
-void dhcpserver_remove_mac(struct eth_addr *mac)
+static uint32_t dhcpserver_now(void)
 {
-  for (uint32_t i = 0; i < DHCPS_MAX_CLIENT; ++i) {
-    if (saved_mac[i].addr[0] == mac->addr[0] && saved_mac[i].addr[1] == mac->addr[1]
-        && saved_mac[i].addr[2] == mac->addr[2] && saved_mac[i].addr[3] == mac->addr[3]
-        && saved_mac[i].addr[4] == mac->addr[4] && saved_mac[i].addr[5] == mac->addr[5]) {
-      saved_mac[i].addr[0] = 0;
-      saved_mac[i].addr[1] = 0;
-      saved_mac[i].addr[2] = 0;
-      saved_mac[i].addr[3] = 0;
-      saved_mac[i].addr[4] = 0;
-      saved_mac[i].addr[5] = 0;
-    }
+  uint32_t elapsed_sec = (sys_now() - dhcps_clock_ms) / 1000;
+
+  dhcps_clock_sec += elapsed_sec;
+  dhcps_clock_ms += elapsed_sec * 1000;
+  return dhcps_clock_sec;
+}
+
+/***************************************************************************//**
+ * Get the server address (host order).
+ ******************************************************************************/
+static uint32_t dhcpserver_get_server_ip(void)
+{
+  return lwip_ntohl(ip_2_ip4(&ap_netif.ip_addr)->addr);
+}
+
+/***************************************************************************//**
+ * Get the server subnet mask (host order).
+ ******************************************************************************/
+static uint32_t dhcpserver_get_netmask(void)
+{
+  return lwip_ntohl(ip_2_ip4(&ap_netif.netmask)->addr);
+}
+
+/***************************************************************************//**
+ * Check an address pool against the server subnet.
+ ******************************************************************************/
+dhcps_pool_check_t dhcpserver_check_pool(uint8_t pool_start, uint8_t pool_end)
+{
+  uint32_t server_ip = dhcpserver_get_server_ip();
+  uint32_t netmask = dhcpserver_get_netmask();
+  uint32_t network = server_ip & netmask;
+  uint32_t broadcast = network | ~netmask;
+  // The pool octets replace the last one of the server address.
+  uint32_t first_ip = (server_ip & 0xFFFFFF00) | pool_start;
+  uint32_t last_ip = (server_ip & 0xFFFFFF00) | pool_end;
+
+  if (pool_start > pool_end) {
+    return DHCPS_POOL_INVERTED;
+  }
+  if ((first_ip <= network) && (network <= last_ip)) {
+    return DHCPS_POOL_NETWORK;
+  }
+  if ((first_ip <= broadcast) && (broadcast <= last_ip)) {
+    return DHCPS_POOL_BROADCAST;
   }
+  if (((first_ip & netmask) != network) || ((last_ip & netmask) != network)) {
+    return DHCPS_POOL_OUT_OF_SUBNET;
+  }
+  if ((first_ip <= server_ip) && (server_ip <= last_ip)) {
+    return DHCPS_POOL_SERVER;
+  }
+  return DHCPS_POOL_OK;
 }
 
 /***************************************************************************//**
- * Save mac address in list of clients.
+ * Remove the static ARP entry of a lease.
  ******************************************************************************/
-static void dhcpserver_save_mac(struct eth_addr *mac)
+static void dhcpserver_remove_arp_entry(uint32_t ip)
 {
-  // Remove previous listing of MAC.
-  dhcpserver_remove_mac(mac);
-
-  for (uint8_t i = 0; i < DHCPS_MAX_CLIENT; ++i) {
-    if (saved_mac[i].addr[0] == 0 && saved_mac[i].addr[1] == 0
-        && saved_mac[i].addr[2] == 0 && saved_mac[i].addr[3] == 0
-        && saved_mac[i].addr[4] == 0 && saved_mac[i].addr[5] == 0) {
-      saved_mac[i].addr[0] = mac->addr[0];
-      saved_mac[i].addr[1] = mac->addr[1];
-      saved_mac[i].addr[2] = mac->addr[2];
-      saved_mac[i].addr[3] = mac->addr[3];
-      saved_mac[i].addr[4] = mac->addr[4];
-      saved_mac[i].addr[5] = mac->addr[5];
-      break;
-    }
+  ip_addr_t ip_addr;
+
+  ip_addr.addr = lwip_htonl(ip);
+  etharp_remove_static_entry(&ip_addr);
+}
+
+/***************************************************************************//**
+ * Lease expiry callback: the client address is no longer valid.
+ ******************************************************************************/
+static void dhcpserver_lease_expired(const uint8_t *mac, uint32_t ip, void *arg)
+{
+  (void)mac;
+  (void)arg;
+  dhcpserver_remove_arp_entry(ip);
+}
+
+/***************************************************************************//**
+ * Save the leases in NVM3 if they changed, core locked.
+ ******************************************************************************/
+static void dhcpserver_save_leases(void)
+{
+  uint32_t now;
+
+  if (!dhcps_lease_is_dirty()) {
+    return;
+  }
+  now = dhcpserver_now();
+  saved_leases.first_ip = dhcps_pool_first_ip;
+  saved_leases.pool_size = dhcps_pool_size;
+  saved_leases.count = dhcps_lease_export(saved_leases.records, DHCPS_MAX_CLIENT, now);
+  nvm3_writeData(nvm3_defaultHandle,
+                 NVM3_KEY_DHCPS_LEASES,
+                 (void *)&saved_leases,
+                 offsetof(dhcpserver_saved_leases_t, records)
+                 + saved_leases.count * sizeof(dhcps_lease_record_t));
+  dhcps_save_sec = now;
+}
+
+/***************************************************************************//**
+ * Restore the leases saved in NVM3 for the current address pool.
+ ******************************************************************************/
+static void dhcpserver_restore_leases(void)
+{
+  uint32_t type;
+  size_t len;
+
+  if ((nvm3_getObjectInfo(nvm3_defaultHandle, NVM3_KEY_DHCPS_LEASES, &type, &len) != ECODE_NVM3_OK)
+      || (len < offsetof(dhcpserver_saved_leases_t, records))
+      || (len > sizeof(saved_leases))
+      || (nvm3_readData(nvm3_defaultHandle, NVM3_KEY_DHCPS_LEASES, (void *)&saved_leases, len) != ECODE_NVM3_OK)) {
+    return;
+  }
+  // Another pool gives other addresses: start from scratch.
+  if ((saved_leases.first_ip != dhcps_pool_first_ip)
+      || (saved_leases.pool_size != dhcps_pool_size)
+      || (len != offsetof(dhcpserver_saved_leases_t, records)
+          + saved_leases.count * sizeof(dhcps_lease_record_t))) {
+    return;
+  }
+  // The clients get their address back when they request it again.
+  dhcps_lease_import(saved_leases.records, saved_leases.count, dhcpserver_now());
+}
+
+/***************************************************************************//**
+ * Periodic check of the lease expiry, saving the changes at most once per
+ * DHCPS_LEASE_SAVE_PERIOD_SEC.
+ ******************************************************************************/
+static void dhcpserver_lease_timer(void *arg)
+{
+  uint32_t now = dhcpserver_now();
+
+  (void)arg;
+  dhcps_lease_expire(now, dhcpserver_lease_expired, NULL);
+  if (dhcps_lease_is_dirty() && ((now - dhcps_save_sec) >= DHCPS_LEASE_SAVE_PERIOD_SEC)) {
+    dhcpserver_save_leases();
+  }
+  sys_timeout(DHCPS_LEASE_TIMER_MS, dhcpserver_lease_timer, NULL);
+}
+
+/***************************************************************************//**
+ * Clear the leases and their ARP entries, core locked. The pending changes
+ * are saved first, the next start restores them.
+ ******************************************************************************/
+static void dhcpserver_clear_leases(void)
+{
+  dhcpserver_save_leases();
+
+  // Offered and bound addresses have a static entry.
+  for (uint16_t i = 0; i < dhcps_pool_size; ++i) {
+    dhcpserver_remove_arp_entry(dhcps_pool_first_ip + i);
+  }
+  dhcps_lease_clear();
+}
+
+/***************************************************************************//**
+ * Remove mac address from list of clients.
+ *
+ * @param mac MAC address to remove.
+ ******************************************************************************/
+void dhcpserver_remove_mac(struct eth_addr *mac)
+{
+  uint32_t ip;
+
+  LOCK_TCPIP_CORE();
+  /* The address stays reserved to the client while the pool allows it */
+  ip = dhcps_lease_release(mac->addr, dhcpserver_now());
+  if (ip != 0) {
+    dhcpserver_remove_arp_entry(ip);
   }
+  UNLOCK_TCPIP_CORE();
 }
 
 /***************************************************************************//**
@@ -115,14 +272,14 @@ static void dhcpserver_save_mac(struct eth_addr *mac)
 ip_addr_t dhcpserver_get_ip(struct eth_addr *mac)
 {
   ip_addr_t offer_ip = { 0 };
-  for (uint32_t i = 0; i < DHCPS_MAX_CLIENT; ++i) {
-    if (saved_mac[i].addr[0] == mac->addr[0] && saved_mac[i].addr[1] == mac->addr[1]
-        && saved_mac[i].addr[2] == mac->addr[2] && saved_mac[i].addr[3] == mac->addr[3]
-        && saved_mac[i].addr[4] == mac->addr[4] && saved_mac[i].addr[5] == mac->addr[5]) {
-      /* index is used to increment IP address. */
-      offer_ip.addr = ((10 + i) << 24) + ap_ip_addr0 + (ap_ip_addr1 << 8) + (ap_ip_addr2 << 16);
-      return offer_ip;
-    }
+  uint32_t ip;
+
+  LOCK_TCPIP_CORE();
+  ip = dhcps_lease_get_ip(mac->addr);
+  UNLOCK_TCPIP_CORE();
+
+  if (ip != 0) {
+    offer_ip.addr = lwip_htonl(ip);
   }
   return offer_ip;
 }
@@ -136,12 +293,16 @@ ip_addr_t dhcpserver_get_ip(struct eth_addr *mac)
  ******************************************************************************/
 void dhcpserver_get_mac(uint8_t client, struct eth_addr *mac)
 {
-  mac->addr[0] = saved_mac[client].addr[0];
-  mac->addr[1] = saved_mac[client].addr[1];
-  mac->addr[2] = saved_mac[client].addr[2];
-  mac->addr[3] = saved_mac[client].addr[3];
-  mac->addr[4] = saved_mac[client].addr[4];
-  mac->addr[5] = saved_mac[client].addr[5];
+  uint32_t ip;
+  bool bound;
+
+  LOCK_TCPIP_CORE();
+  bound = dhcps_lease_get(client, mac->addr, &ip, NULL);
+  UNLOCK_TCPIP_CORE();
+
+  if (!bound) {
+    memset(mac->addr, 0, sizeof(mac->addr));
+  }
 }
 
 /***************************************************************************//**
@@ -149,47 +310,102 @@ void dhcpserver_get_mac(uint8_t client, struct eth_addr *mac)
  ******************************************************************************/
 void dhcpserver_clear_stored_mac(void)
 {
-  //clear saved mac addresses
-  for (uint32_t i = 0; i < DHCPS_MAX_CLIENT; ++i) {
-    saved_mac[i].addr[0] = 0;
-    saved_mac[i].addr[1] = 0;
-    saved_mac[i].addr[2] = 0;
-    saved_mac[i].addr[3] = 0;
-    saved_mac[i].addr[4] = 0;
-    saved_mac[i].addr[5] = 0;
-  }
+  LOCK_TCPIP_CORE();
+  dhcpserver_clear_leases();
+  UNLOCK_TCPIP_CORE();
 }
 
 /***************************************************************************//**
- * Find a requested IP address in DHCP packet.
+ * Find an option in DHCP packet.
  *
  * @param pbuf_in The pbuf containing the a DHCP packet.
- * @param ipaddr IP address result.
+ * @param code Option code.
+ * @param value Option value result.
+ * @param len Expected option length.
  * @returns 1 if found, 0 if not found.
  ******************************************************************************/
-static uint16_t dhcpserver_find_requested_ip(struct pbuf * pbuf_in, uint8_t * ipaddr)
+static uint16_t dhcpserver_find_option(struct pbuf * pbuf_in, uint8_t code, uint8_t * value, uint8_t len)
 {
   uint32_t index = UDP_DHCP_OPTIONS_OFS;
-  uint8_t optionID = DHCP_OPTION_REQUESTED_IP;
-  uint16_t found = 0;
-  uint8_t val = 0;
+  uint8_t option;
   uint8_t size;
 
-  while ((val != 0xff) && (index < pbuf_in->tot_len)) {
-    val = pbuf_get_at(pbuf_in, index);
-    if (val == optionID) {
-      index++;
-      size = pbuf_get_at(pbuf_in, index);
+  while (index + 1 < pbuf_in->tot_len) {
+    option = pbuf_get_at(pbuf_in, index);
+    if (option == DHCP_OPTION_PAD) {
       index++;
-      pbuf_copy_partial(pbuf_in, ipaddr, size, index);
-      index += size;
-      found = 1;
+      continue;
+    }
+    if (option == DHCP_OPTION_END) {
+      break;
+    }
+    size = pbuf_get_at(pbuf_in, index + 1);
+    if ((option == code) && (size == len) && (index + 2 + size <= pbuf_in->tot_len)) {
+      pbuf_copy_partial(pbuf_in, value, size, index + 2);
+      return 1;
     }
-    index++;
-    index += ((pbuf_get_at(pbuf_in, index)) + 1);
+    index += 2 + size;
   }
 
-  return found;
+  return 0;
+}
+
+/***************************************************************************//**
+ * Read an IP address in DHCP packet.
+ *
+ * @param pbuf_in The pbuf containing the a DHCP packet.
+ * @param code Option code, 0 to read the client address (ciaddr).
+ * @returns the address in host order, 0 if not found.
+ ******************************************************************************/
+static uint32_t dhcpserver_get_ip_field(struct pbuf * pbuf_in, uint8_t code)
+{
+  uint32_t ip = 0;
+
+  if (code == 0) {
+    pbuf_copy_partial(pbuf_in, &ip, sizeof(ip), DHCP_CIADDR_OFS);
+  } else if (0 == dhcpserver_find_option(pbuf_in, code, (uint8_t *)&ip, sizeof(ip))) {
+    return 0;
+  }
+  return lwip_ntohl(ip);
+}
+
+/***************************************************************************//**
+ * Send a reply to a client.
+ *
+ * @param pbuf_in The pbuf containing the request.
+ * @param type DHCP_OFFER, DHCP_ACK or DHCP_NAK.
+ * @param yiaddr Client address (host order), 0 for a NAK.
+ * @param dest Destination address.
+ ******************************************************************************/
+static void dhcpserver_send_reply(struct pbuf *pbuf_in, uint8_t type, uint32_t yiaddr,
+                                  const ip_addr_t *dest)
+{
+  struct pbuf *pbuf_out;
+  dhcps_msg_t msg;
+  uint16_t len;
+  uint32_t server_ip = dhcpserver_get_server_ip();
+
+  // Contiguous buffer: the reply is written with block copies.
+  pbuf_out = pbuf_alloc(PBUF_TRANSPORT, DHCPS_MSG_REPLY_LEN, PBUF_RAM);
+  if (NULL == pbuf_out) {
+    return;
+  }
+  pbuf_copy_partial(pbuf_in, pbuf_out->payload, DHCPS_MSG_HEADER_LEN, 0);
+
+  dhcps_msg_reply_init(&msg, pbuf_out->payload, pbuf_out->len, type, yiaddr);
+  if (type != DHCP_NAK) {
+    dhcps_msg_add_u32(&msg, DHCP_OPTION_SUBNET_MASK, dhcpserver_get_netmask());
+    dhcps_msg_add_u32(&msg, DHCP_OPTION_ROUTER, server_ip);
+    dhcps_msg_add_u32(&msg, DHCP_OPTION_LEASE_TIME, ap_dhcp_lease_time);
+  }
+  dhcps_msg_add_u32(&msg, DHCP_OPTION_SERVER_ID, server_ip);
+  len = dhcps_msg_finish(&msg);
+
+  if (len != 0) {
+    pbuf_realloc(pbuf_out, len);
+    udp_sendto(dhcp_pcb, pbuf_out, dest, DHCP_CLIENT_PORT);
+  }
+  pbuf_free(pbuf_out);
 }
 
 /***************************************************************************//**
@@ -202,276 +418,132 @@ static void dhcpserver_fn(void *arg, struct udp_pcb *dhcp_pcb_recv,
   (void)dhcp_pcb_recv;
   (void)port;
   (void)client_addr;
-  struct pbuf * pbuf_out = 0;
-  uint32_t i;
-  uint8_t flags = 0;
   struct eth_addr ethaddr;
-
-  uint32_t options_offset = 0;
-  uint32_t client_requested_addr = 0;
-  uint8_t val = 0;
+  uint32_t requested_ip = 0;
+  uint32_t server_id = 0;
+  uint32_t lease_ip = 0;
+  uint32_t prev_ip = 0;
+  dhcps_lease_state_t prev_state;
+  uint32_t now;
+  uint8_t msg_type = 0;
   ip_addr_t client_ip_addr;
-  ip_addr_t r;
 
   if ((NULL == pbuf_in) || ((pbuf_in->tot_len) <= UDP_DHCP_OPTIONS_OFS)) {
     goto end_of_fcn;
   }
 
-  pbuf_out = pbuf_alloc(PBUF_TRANSPORT, DHCP_RESPONSE_DEFAULT_SIZE, PBUF_POOL);
-
-  if ((NULL == pbuf_out) || ((pbuf_out->tot_len) < UDP_DHCP_OPTIONS_OFS)) {
-    goto end_of_fcn;
-  }
-  pbuf_copy(pbuf_out, pbuf_in);
-
-#if DHCPS_DBG
-  printf("mac ");
-#endif
   // Read MAC address.
-  for (i = 0; i < 6; ++i) {
-    val = pbuf_get_at(pbuf_in, DHCP_CHADDR_OFS + i);
-    ethaddr.addr[i] = val;
-#if DHCPS_DBG
-    printf("%X ", val);
-#endif
-  }
+  pbuf_copy_partial(pbuf_in, ethaddr.addr, sizeof(ethaddr.addr), DHCP_CHADDR_OFS);
 #if DHCPS_DBG
-  printf("\r\n");
+  printf("mac %X %X %X %X %X %X\r\n", ethaddr.addr[0], ethaddr.addr[1], ethaddr.addr[2],
+         ethaddr.addr[3], ethaddr.addr[4], ethaddr.addr[5]);
 #endif
-  // Register MAC address and get an IP address.
-  dhcpserver_save_mac(&ethaddr);
-  client_ip_addr = dhcpserver_get_ip(&ethaddr);
-  if (0 == client_ip_addr.addr) {
+  /* request type. */
+  if (0 == dhcpserver_find_option(pbuf_in, DHCP_OPTION_MESSAGE_TYPE, &msg_type, 1)) {
     goto end_of_fcn;
   }
-#if DHCPS_DBG
-  printf("ip %d.%d.%d.%d\r\n", client_ip_addr.addr & 0xff, (client_ip_addr.addr >> 8) & 0xff, (client_ip_addr.addr >> 16) & 0xff, (client_ip_addr.addr >> 24) & 0xff);
-#endif
-  etharp_add_static_entry(&client_ip_addr, &ethaddr);   //add ARP table entry
-  /* request type. */
-  val = pbuf_get_at(pbuf_in, UDP_DHCP_OPTIONS_OFS + 2);
+  now = dhcpserver_now();
+  requested_ip = dhcpserver_get_ip_field(pbuf_in, DHCP_OPTION_REQUESTED_IP);
+  // An offered or bound address has a static ARP entry already.
+  prev_state = dhcps_lease_get_state(ethaddr.addr, &prev_ip);
+  if ((prev_state != DHCPS_LEASE_OFFERED) && (prev_state != DHCPS_LEASE_BOUND)) {
+    prev_ip = 0;
+  }
 
-  switch (val) {
+  switch (msg_type) {
     case DHCP_DISCOVER:
 #if DHCPS_DBG
       printf("DHCP Discover\r\n");
 #endif
-      pbuf_put_at(pbuf_out, DHCP_OP_OFS, DHCP_BOOTREPLY);
-      pbuf_put_at(pbuf_out, DHCP_SECS_OFS, 0);
-      pbuf_put_at(pbuf_out, DHCP_FLAGS_OFS, 0x0);       //unicast
-
-      // set the client IP address.
-      pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS, client_ip_addr.addr & 0xff);
-      pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS + 1, (client_ip_addr.addr >> 8) & 0xff);
-      pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS + 2, (client_ip_addr.addr >> 16) & 0xff);
-      pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS + 3, (client_ip_addr.addr >> 24) & 0xff);
-      // next server address.
-      pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS, 0);
-      pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS + 1, 0);
-      pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS + 2, 0);
-      pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS + 3, 0);
-      // DHCP cookie
-      pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS, (DHCP_MAGIC_COOKIE >> 24) & 0xff);
-      pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 1, (DHCP_MAGIC_COOKIE >> 16) & 0xff);
-      pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 2, (DHCP_MAGIC_COOKIE >> 8) & 0xff);
-      pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 3, (DHCP_MAGIC_COOKIE) & 0xff);
-      options_offset = UDP_DHCP_OPTIONS_OFS;
-      // Response is a DHCP Offer Packet.
-      pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_MESSAGE_TYPE);
-      options_offset++;
-      pbuf_put_at(pbuf_out, options_offset, 1);
-      options_offset++;
-      pbuf_put_at(pbuf_out, options_offset, DHCP_OFFER);
-      options_offset++;
-      // Subnet Mask
-      pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_SUBNET_MASK);
-      options_offset++;
-      pbuf_put_at(pbuf_out, options_offset, 4);
-      options_offset++;
-      IP4_ADDR(&r, ap_netmask_addr0, ap_netmask_addr1, ap_netmask_addr2, ap_netmask_addr3);
-      pbuf_put_at(pbuf_out, options_offset, r.addr & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 1, (r.addr >> 8) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 2, (r.addr >> 16) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 3, (r.addr >> 24) & 0xff);
-      options_offset += 4;
-      //Set router info.
-      pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_ROUTER);
-      options_offset++;
-      pbuf_put_at(pbuf_out, options_offset, 4);
-      options_offset++;
-      IP4_ADDR(&r, ap_ip_addr0, ap_ip_addr1, ap_ip_addr2, ap_ip_addr3);
-      pbuf_put_at(pbuf_out, options_offset, r.addr & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 1, (r.addr >> 8) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 2, (r.addr >> 16) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 3, (r.addr >> 24) & 0xff);
-      options_offset += 4;
-      // lease time.
-      pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_LEASE_TIME);
-      options_offset++;
-      pbuf_put_at(pbuf_out, options_offset, 4);
-      options_offset++;
-      pbuf_put_at(pbuf_out, options_offset, (LEASE_TIME_1DAY >> 24) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 1, (LEASE_TIME_1DAY >> 16) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 2, (LEASE_TIME_1DAY >> 8) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 3, (LEASE_TIME_1DAY) & 0xff);
-      options_offset += 4;
-      // server ID
-      pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_SERVER_ID);
-      options_offset++;
-      pbuf_put_at(pbuf_out, options_offset, 4);
-      options_offset++;
-      IP4_ADDR(&r, ap_ip_addr0, ap_ip_addr1, ap_ip_addr2, ap_ip_addr3);
-      pbuf_put_at(pbuf_out, options_offset, r.addr & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 1, (r.addr >> 8) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 2, (r.addr >> 16) & 0xff);
-      pbuf_put_at(pbuf_out, options_offset + 3, (r.addr >> 24) & 0xff);
-      options_offset += 4;
-
-      pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_END);
-      options_offset++;
-
-      pbuf_realloc(pbuf_out, options_offset);
-
-      if (ERR_OK != udp_sendto(dhcp_pcb, pbuf_out, &client_ip_addr, DHCP_CLIENT_PORT)) {
+      // Reserve an IP address: the previous one of the client if possible.
+      lease_ip = dhcps_lease_offer(ethaddr.addr, requested_ip, now);
+      if (0 == lease_ip) {
+        // Pool exhausted.
         goto end_of_fcn;
       }
-
+      client_ip_addr.addr = lwip_htonl(lease_ip);
+#if DHCPS_DBG
+      printf("ip %d.%d.%d.%d\r\n", client_ip_addr.addr & 0xff, (client_ip_addr.addr >> 8) & 0xff, (client_ip_addr.addr >> 16) & 0xff, (client_ip_addr.addr >> 24) & 0xff);
+#endif
+      // The client has no address yet to answer ARP requests.
+      if (lease_ip != prev_ip) {
+        etharp_add_static_entry(&client_ip_addr, &ethaddr);
+      }
+      dhcpserver_send_reply(pbuf_in, DHCP_OFFER, lease_ip, &client_ip_addr);
       break;
 
     case DHCP_REQUEST:
 #if DHCPS_DBG
       printf("DHCP Request\r\n");
 #endif
-      pbuf_put_at(pbuf_out, DHCP_OP_OFS, DHCP_BOOTREPLY);
-      pbuf_put_at(pbuf_out, DHCP_SECS_OFS, 0);
-
-      // broadcast flag
-      flags = 0;
-      flags = pbuf_get_at(pbuf_in, DHCP_FLAGS_OFS);
-      if (flags & 0x80) {
-        flags = pbuf_get_at(pbuf_out, DHCP_FLAGS_OFS);
-        flags |= 0x80;
-        pbuf_put_at(pbuf_out, DHCP_FLAGS_OFS, flags);
-      } else {
-        flags = pbuf_get_at(pbuf_out, DHCP_FLAGS_OFS);
-        flags &= ~0x80;
-        pbuf_put_at(pbuf_out, DHCP_FLAGS_OFS, flags);
+      // The client selected another server: give our offer back.
+      server_id = dhcpserver_get_ip_field(pbuf_in, DHCP_OPTION_SERVER_ID);
+      if ((server_id != 0) && (server_id != dhcpserver_get_server_ip())) {
+        lease_ip = dhcps_lease_release(ethaddr.addr, now);
+        if (lease_ip != 0) {
+          dhcpserver_remove_arp_entry(lease_ip);
+        }
+        goto end_of_fcn;
       }
 
-      // Check requested IP address
-      if (0 == dhcpserver_find_requested_ip(pbuf_in, (uint8_t *)&client_requested_addr)) {
+      // INIT-REBOOT of a client the server has no record of: its address
+      // may come from another server of the subnet, stay silent
+      // (RFC 2131 4.3.2). An address off the subnet is still NAKed.
+      if ((0 == server_id) && (0 != requested_ip) && (DHCPS_LEASE_FREE == prev_state)
+          && (0 == dhcpserver_get_ip_field(pbuf_in, 0))
+          && ((requested_ip & dhcpserver_get_netmask())
+              == (dhcpserver_get_server_ip() & dhcpserver_get_netmask()))) {
         goto end_of_fcn;
       }
 
-      if (client_requested_addr == client_ip_addr.addr) {
-        // set client IP address.
-        pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS, client_ip_addr.addr & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS + 1, (client_ip_addr.addr >> 8) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS + 2, (client_ip_addr.addr >> 16) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_YIADDR_OFS + 3, (client_ip_addr.addr >> 24) & 0xff);
-
-        // next server address.
-        pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS, 0);
-        pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS + 1, 0);
-        pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS + 2, 0);
-        pbuf_put_at(pbuf_out, DHCP_SIADDR_OFS + 3, 0);
-
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS, (DHCP_MAGIC_COOKIE >> 24) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 1, (DHCP_MAGIC_COOKIE >> 16) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 2, (DHCP_MAGIC_COOKIE >> 8) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 3, (DHCP_MAGIC_COOKIE) & 0xff);
-        options_offset = UDP_DHCP_OPTIONS_OFS;
-
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_MESSAGE_TYPE);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, 1);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, DHCP_ACK);
-        options_offset++;
-
-        // Subnet Mask.
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_SUBNET_MASK);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, 4);
-        options_offset++;
-        IP4_ADDR(&r, ap_netmask_addr0, ap_netmask_addr1, ap_netmask_addr2, ap_netmask_addr3);
-        pbuf_put_at(pbuf_out, options_offset, r.addr & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 1, (r.addr >> 8) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 2, (r.addr >> 16) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 3, (r.addr >> 24) & 0xff);
-        options_offset += 4;
-        // Router
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_ROUTER);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, 4);
-        options_offset++;
-        IP4_ADDR(&r, ap_ip_addr0, ap_ip_addr1, ap_ip_addr2, ap_ip_addr3);
-        pbuf_put_at(pbuf_out, options_offset, r.addr & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 1, (r.addr >> 8) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 2, (r.addr >> 16) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 3, (r.addr >> 24) & 0xff);
-        options_offset += 4;
-
-        // lease time.
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_LEASE_TIME);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, 4);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, (LEASE_TIME_1DAY >> 24) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 1, (LEASE_TIME_1DAY >> 16) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 2, (LEASE_TIME_1DAY >> 8) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 3, (LEASE_TIME_1DAY) & 0xff);
-        options_offset += 4;
-
-        // Server ID
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_SERVER_ID);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, 4);
-        options_offset++;
-        IP4_ADDR(&r, ap_ip_addr0, ap_ip_addr1, ap_ip_addr2, ap_ip_addr3);
-        pbuf_put_at(pbuf_out, options_offset, r.addr & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 1, (r.addr >> 8) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 2, (r.addr >> 16) & 0xff);
-        pbuf_put_at(pbuf_out, options_offset + 3, (r.addr >> 24) & 0xff);
-        options_offset += 4;
-
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_END);
-        options_offset++;
+      // Check requested IP address, the client one when renewing.
+      if (0 == requested_ip) {
+        requested_ip = dhcpserver_get_ip_field(pbuf_in, 0);
+      }
+      lease_ip = dhcps_lease_request(ethaddr.addr, requested_ip, now);
+
+      if (0 != lease_ip) {
+        client_ip_addr.addr = lwip_htonl(lease_ip);
+        if (lease_ip != prev_ip) {
+          etharp_add_static_entry(&client_ip_addr, &ethaddr);
+        }
+        dhcpserver_send_reply(pbuf_in, DHCP_ACK, lease_ip, &client_ip_addr);
       } else {
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS, (DHCP_MAGIC_COOKIE >> 24) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 1, (DHCP_MAGIC_COOKIE >> 16) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 2, (DHCP_MAGIC_COOKIE >> 8) & 0xff);
-        pbuf_put_at(pbuf_out, DHCP_COOKIE_OFS + 3, (DHCP_MAGIC_COOKIE) & 0xff);
-        options_offset = UDP_DHCP_OPTIONS_OFS;
-
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_MESSAGE_TYPE);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, 1);
-        options_offset++;
-        pbuf_put_at(pbuf_out, options_offset, DHCP_NAK);
-        options_offset++;
-
-        pbuf_put_at(pbuf_out, options_offset, DHCP_OPTION_END);
-        options_offset++;
+        // The client has no valid address: broadcast the NAK.
+        client_ip_addr.addr = IPADDR_BROADCAST;
+        dhcpserver_send_reply(pbuf_in, DHCP_NAK, 0, &client_ip_addr);
       }
+      break;
 
-      pbuf_realloc(pbuf_out, options_offset);
-
-      if (ERR_OK != udp_sendto(dhcp_pcb, pbuf_out, &client_ip_addr, DHCP_CLIENT_PORT)) {
-        goto end_of_fcn;
+    case DHCP_DECLINE:
+#if DHCPS_DBG
+      printf("DHCP Decline\r\n");
+#endif
+      // Another host uses the address: take it out of the pool for a while.
+      if (dhcps_lease_decline(ethaddr.addr, requested_ip, now)) {
+        dhcpserver_remove_arp_entry(requested_ip);
       }
+      break;
 
+    case DHCP_RELEASE:
+#if DHCPS_DBG
+      printf("DHCP Release\r\n");
+#endif
+      lease_ip = dhcps_lease_release(ethaddr.addr, now);
+      if (lease_ip != 0) {
+        dhcpserver_remove_arp_entry(lease_ip);
+      }
       break;
+
     // do nothing if not defined above
     default:
       break;
   }
 
   end_of_fcn:
-  if (pbuf_out) {
-    pbuf_free(pbuf_out);
+  if (pbuf_in) {
+    pbuf_free(pbuf_in);
   }
-  pbuf_free(pbuf_in);
 }
 
 /***************************************************************************//**
@@ -479,16 +551,40 @@ static void dhcpserver_fn(void *arg, struct udp_pcb *dhcp_pcb_recv,
  ******************************************************************************/
 static void dhcpserver_start_prv(void * arg)
 {
+  uint32_t server_ip = dhcpserver_get_server_ip();
+  uint32_t netmask = dhcpserver_get_netmask();
+  uint32_t network = server_ip & netmask;
+  uint32_t broadcast = network | ~netmask;
+  uint32_t first_ip = (server_ip & 0xFFFFFF00) | ap_dhcp_pool_start;
+  uint32_t last_ip = (server_ip & 0xFFFFFF00) | ap_dhcp_pool_end;
+  uint16_t pool_size = 0;
+
   (void)arg;
-  //clear saved mac addresses
-  for (uint32_t i = 0; i < DHCPS_MAX_CLIENT; ++i) {
-    saved_mac[i].addr[0] = 0;
-    saved_mac[i].addr[1] = 0;
-    saved_mac[i].addr[2] = 0;
-    saved_mac[i].addr[3] = 0;
-    saved_mac[i].addr[4] = 0;
-    saved_mac[i].addr[5] = 0;
+  // Set the address pool from the parameters, within the host addresses of
+  // the subnet and after the server address if it is in (the subnet or the
+  // server address may have changed since the pool was checked), and restore
+  // the leases saved for it.
+  if (first_ip <= network) {
+    first_ip = network + 1;
+  }
+  if (last_ip >= broadcast) {
+    last_ip = broadcast - 1;
+  }
+  if ((first_ip <= server_ip) && (server_ip <= last_ip)) {
+    first_ip = server_ip + 1;
+  }
+  if ((last_ip >= first_ip) && (broadcast - network >= 2)) {
+    pool_size = (uint16_t)((last_ip - first_ip + 1 < DHCPS_MAX_CLIENT)
+                           ? last_ip - first_ip + 1 : DHCPS_MAX_CLIENT);
   }
+  dhcps_lease_init(first_ip, pool_size, ap_dhcp_lease_time);
+  dhcps_pool_first_ip = first_ip;
+  dhcps_pool_size = pool_size;
+  dhcps_clock_ms = sys_now();
+  dhcpserver_restore_leases();
+  dhcps_save_sec = dhcps_clock_sec;
+  sys_untimeout(dhcpserver_lease_timer, NULL);
+  sys_timeout(DHCPS_LEASE_TIMER_MS, dhcpserver_lease_timer, NULL);
 
   if (NULL == dhcp_pcb) {
     dhcp_pcb = udp_new();
@@ -521,7 +617,8 @@ static void dhcpserver_stop_prv(void * arg)
 {
   (void)arg;
   if (dhcp_pcb != NULL) {
-    dhcpserver_clear_stored_mac();
+    sys_untimeout(dhcpserver_lease_timer, NULL);
+    dhcpserver_clear_leases();
     udp_disconnect(dhcp_pcb);
     udp_remove(dhcp_pcb);
     dhcp_pcb = NULL;
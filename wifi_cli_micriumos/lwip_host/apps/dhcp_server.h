@@ -20,8 +20,19 @@
 
 #include "lwip/ip_addr.h"
 #include "lwip/prot/ethernet.h"
+#include "dhcp_server_lease.h"
 
-#define DHCPS_MAX_CLIENT 8 /// Max number of dhcp clients.
+#define DHCPS_MAX_CLIENT DHCPS_LEASE_MAX /// Max number of dhcp clients.
+
+/// Result of an address pool check against the server subnet.
+typedef enum {
+  DHCPS_POOL_OK = 0,
+  DHCPS_POOL_INVERTED,            ///< First address after the last one
+  DHCPS_POOL_NETWORK,             ///< Subnet network address in the pool
+  DHCPS_POOL_BROADCAST,           ///< Subnet broadcast address in the pool
+  DHCPS_POOL_OUT_OF_SUBNET,       ///< Address out of the server subnet
+  DHCPS_POOL_SERVER,              ///< Server address in the pool
+} dhcps_pool_check_t;
 
 #ifdef __cplusplus
 extern "C" {
@@ -62,6 +73,15 @@ ip_addr_t dhcpserver_get_ip(struct eth_addr *mac);
  ******************************************************************************/
 void dhcpserver_clear_stored_mac(void);
 
+/***************************************************************************//**
+ * Check an address pool against the SoftAP address and netmask.
+ *
+ * @param pool_start Last octet of the first address of the pool.
+ * @param pool_end Last octet of the last address of the pool.
+ * @returns DHCPS_POOL_OK if the server can lease the whole pool
+ ******************************************************************************/
+dhcps_pool_check_t dhcpserver_check_pool(uint8_t pool_start, uint8_t pool_end);
+
 /***************************************************************************//**
  * Return the DHCP server state.
  ******************************************************************************/
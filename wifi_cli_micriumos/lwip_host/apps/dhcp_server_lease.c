@@ -0,0 +1,442 @@
+/***************************************************************************//**
+ * @file
+ * @brief DHCP server lease database
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * The lease i holds the address first_ip + i. The leases having a client are
+ * chained in the bucket of their MAC address hash, so that a client is found
+ * in a few compares whatever the pool size.
+ *
+ * The module has no lwIP dependency and the caller provides the time: it
+ * also builds on a host (see tools/dhcp_server_lease_bench.c).
+ ******************************************************************************/
+#include <string.h>
+#include "dhcp_server_lease.h"
+
+#if (DHCPS_LEASE_HASH_SIZE & (DHCPS_LEASE_HASH_SIZE - 1)) != 0
+#error "DHCPS_LEASE_HASH_SIZE must be a power of 2"
+#endif
+
+/// End of a hash chain
+#define DHCPS_LEASE_NONE              0xFFFF
+
+typedef struct {
+  uint8_t mac[6];
+  uint8_t state;          ///< dhcps_lease_state_t
+  uint16_t next;          ///< Next lease of the hash chain
+  uint32_t expiry;        ///< End of the offer, binding or declination
+} dhcps_lease_t;
+
+static dhcps_lease_t leases[DHCPS_LEASE_MAX];
+static uint16_t buckets[DHCPS_LEASE_HASH_SIZE];
+static uint32_t pool_first_ip = 0;
+static uint16_t pool_size = 0;
+static uint32_t pool_lease_time = 0;
+/// Where the search of a free lease starts, so that the addresses rotate
+static uint16_t free_cursor = 0;
+/// The leases to save changed
+static bool dirty = false;
+
+/***************************************************************************//**
+ * Hash a MAC address (FNV-1a).
+ ******************************************************************************/
+static uint16_t dhcps_lease_hash(const uint8_t *mac)
+{
+  uint32_t hash = 2166136261u;
+
+  for (uint8_t i = 0; i < 6; i++) {
+    hash = (hash ^ mac[i]) * 16777619u;
+  }
+  return (uint16_t)((hash ^ (hash >> 16)) & (DHCPS_LEASE_HASH_SIZE - 1));
+}
+
+/***************************************************************************//**
+ * Check whether the time of a lease is over.
+ ******************************************************************************/
+static bool dhcps_lease_is_over(const dhcps_lease_t *lease, uint32_t now)
+{
+  /* The difference keeps working when the time wraps */
+  return (int32_t)(lease->expiry - now) <= 0;
+}
+
+/***************************************************************************//**
+ * Check whether a lease can be given to a new client.
+ ******************************************************************************/
+static bool dhcps_lease_is_available(const dhcps_lease_t *lease, uint32_t now)
+{
+  switch (lease->state) {
+    case DHCPS_LEASE_FREE:
+    case DHCPS_LEASE_EXPIRED:
+      return true;
+    default:
+      return dhcps_lease_is_over(lease, now);
+  }
+}
+
+/***************************************************************************//**
+ * Find the lease of a client.
+ ******************************************************************************/
+static uint16_t dhcps_lease_find(const uint8_t *mac)
+{
+  uint16_t index = buckets[dhcps_lease_hash(mac)];
+
+  while ((index != DHCPS_LEASE_NONE) && (memcmp(leases[index].mac, mac, 6) != 0)) {
+    index = leases[index].next;
+  }
+  return index;
+}
+
+/***************************************************************************//**
+ * Chain a lease in the bucket of its client.
+ ******************************************************************************/
+static void dhcps_lease_link(uint16_t index)
+{
+  uint16_t *bucket = &buckets[dhcps_lease_hash(leases[index].mac)];
+
+  leases[index].next = *bucket;
+  *bucket = index;
+}
+
+/***************************************************************************//**
+ * Remove a lease from the bucket of its client.
+ ******************************************************************************/
+static void dhcps_lease_unlink(uint16_t index)
+{
+  uint16_t *link = &buckets[dhcps_lease_hash(leases[index].mac)];
+
+  while (*link != DHCPS_LEASE_NONE) {
+    if (*link == index) {
+      *link = leases[index].next;
+      break;
+    }
+    link = &leases[*link].next;
+  }
+  leases[index].next = DHCPS_LEASE_NONE;
+}
+
+/***************************************************************************//**
+ * Check whether a lease has a client, i.e. is chained.
+ ******************************************************************************/
+static bool dhcps_lease_has_client(const dhcps_lease_t *lease)
+{
+  return (lease->state != DHCPS_LEASE_FREE) && (lease->state != DHCPS_LEASE_DECLINED);
+}
+
+/***************************************************************************//**
+ * Give a lease to a client, taking it from its previous client if any.
+ ******************************************************************************/
+static void dhcps_lease_assign(uint16_t index, const uint8_t *mac)
+{
+  if (dhcps_lease_has_client(&leases[index])) {
+    dhcps_lease_unlink(index);
+  }
+  memcpy(leases[index].mac, mac, 6);
+  dhcps_lease_link(index);
+  dirty = true;
+}
+
+/***************************************************************************//**
+ * Get the lease of an address of the pool.
+ ******************************************************************************/
+static uint16_t dhcps_lease_index(uint32_t ip)
+{
+  uint32_t offset = ip - pool_first_ip;
+
+  return (offset < pool_size) ? (uint16_t)offset : DHCPS_LEASE_NONE;
+}
+
+/***************************************************************************//**
+ * Find a lease for a new client: a free one, else the one expired first.
+ ******************************************************************************/
+static uint16_t dhcps_lease_allocate(uint32_t now)
+{
+  uint16_t oldest = DHCPS_LEASE_NONE;
+  uint16_t index;
+  uint16_t i;
+
+  for (i = 0; i < pool_size; i++) {
+    index = (uint16_t)((free_cursor + i) % pool_size);
+    if (leases[index].state == DHCPS_LEASE_FREE) {
+      free_cursor = (uint16_t)((index + 1) % pool_size);
+      return index;
+    }
+    if (dhcps_lease_is_available(&leases[index], now)
+        && ((oldest == DHCPS_LEASE_NONE)
+            || ((int32_t)(leases[index].expiry - leases[oldest].expiry) < 0))) {
+      oldest = index;
+    }
+  }
+  return oldest;
+}
+
+/***************************************************************************//**
+ * Clear the leases and set the address pool.
+ ******************************************************************************/
+void dhcps_lease_init(uint32_t first_ip, uint16_t size, uint32_t lease_time)
+{
+  pool_first_ip = first_ip;
+  pool_size = (size < DHCPS_LEASE_MAX) ? size : DHCPS_LEASE_MAX;
+  pool_lease_time = lease_time;
+  dhcps_lease_clear();
+}
+
+/***************************************************************************//**
+ * Clear the leases, keeping the address pool.
+ ******************************************************************************/
+void dhcps_lease_clear(void)
+{
+  memset(leases, 0, sizeof(leases));
+  for (uint16_t i = 0; i < DHCPS_LEASE_MAX; i++) {
+    leases[i].next = DHCPS_LEASE_NONE;
+  }
+  for (uint16_t i = 0; i < DHCPS_LEASE_HASH_SIZE; i++) {
+    buckets[i] = DHCPS_LEASE_NONE;
+  }
+  free_cursor = 0;
+  dirty = false;
+}
+
+/***************************************************************************//**
+ * Reserve an address for a DHCPDISCOVER.
+ ******************************************************************************/
+uint32_t dhcps_lease_offer(const uint8_t *mac, uint32_t requested_ip, uint32_t now)
+{
+  uint16_t index = dhcps_lease_find(mac);
+
+  if (index == DHCPS_LEASE_NONE) {
+    index = dhcps_lease_index(requested_ip);
+    if ((index == DHCPS_LEASE_NONE) || !dhcps_lease_is_available(&leases[index], now)) {
+      index = dhcps_lease_allocate(now);
+      if (index == DHCPS_LEASE_NONE) {
+        return 0;
+      }
+    }
+    dhcps_lease_assign(index, mac);
+  }
+
+  /* A bound client keeps its lease until it requests it again */
+  if ((leases[index].state != DHCPS_LEASE_BOUND) || dhcps_lease_is_over(&leases[index], now)) {
+    leases[index].state = DHCPS_LEASE_OFFERED;
+    leases[index].expiry = now + DHCPS_LEASE_OFFER_TIME;
+  }
+  return pool_first_ip + index;
+}
+
+/***************************************************************************//**
+ * Bind an address for a DHCPREQUEST.
+ ******************************************************************************/
+uint32_t dhcps_lease_request(const uint8_t *mac, uint32_t requested_ip, uint32_t now)
+{
+  uint16_t index = dhcps_lease_find(mac);
+
+  if (index == DHCPS_LEASE_NONE) {
+    /* Unknown client, typically INIT-REBOOT after a server restart */
+    index = dhcps_lease_index(requested_ip);
+    if ((index == DHCPS_LEASE_NONE) || !dhcps_lease_is_available(&leases[index], now)) {
+      return 0;
+    }
+    dhcps_lease_assign(index, mac);
+  } else if (pool_first_ip + index != requested_ip) {
+    /* The client asks for another address than its own */
+    return 0;
+  }
+
+  if (leases[index].state != DHCPS_LEASE_BOUND) {
+    dirty = true;
+  }
+  leases[index].state = DHCPS_LEASE_BOUND;
+  leases[index].expiry = now + pool_lease_time;
+  return requested_ip;
+}
+
+/***************************************************************************//**
+ * Release the lease of a client.
+ ******************************************************************************/
+uint32_t dhcps_lease_release(const uint8_t *mac, uint32_t now)
+{
+  uint16_t index = dhcps_lease_find(mac);
+  uint8_t state;
+
+  if (index == DHCPS_LEASE_NONE) {
+    return 0;
+  }
+  state = leases[index].state;
+  dirty |= (state == DHCPS_LEASE_BOUND);
+  /* Expired now: the client gets it back unless another one needs it */
+  leases[index].state = DHCPS_LEASE_EXPIRED;
+  leases[index].expiry = now;
+  return ((state == DHCPS_LEASE_BOUND) || (state == DHCPS_LEASE_OFFERED)) ? pool_first_ip + index : 0;
+}
+
+/***************************************************************************//**
+ * Take a declined address out of the pool.
+ ******************************************************************************/
+bool dhcps_lease_decline(const uint8_t *mac, uint32_t ip, uint32_t now)
+{
+  uint16_t index = dhcps_lease_find(mac);
+
+  if ((index == DHCPS_LEASE_NONE) || (pool_first_ip + index != ip)) {
+    return false;
+  }
+  dhcps_lease_unlink(index);
+  dirty = true;
+  memset(leases[index].mac, 0, sizeof(leases[index].mac));
+  leases[index].state = DHCPS_LEASE_DECLINED;
+  leases[index].expiry = now + DHCPS_LEASE_DECLINE_TIME;
+  return true;
+}
+
+/***************************************************************************//**
+ * Expire the leases whose time is over.
+ ******************************************************************************/
+uint16_t dhcps_lease_expire(uint32_t now, dhcps_lease_expired_fn_t expired_fn, void *arg)
+{
+  uint16_t count = 0;
+
+  for (uint16_t i = 0; i < pool_size; i++) {
+    dhcps_lease_t *lease = &leases[i];
+
+    if ((lease->state == DHCPS_LEASE_FREE) || (lease->state == DHCPS_LEASE_EXPIRED)
+        || !dhcps_lease_is_over(lease, now)) {
+      continue;
+    }
+    if (lease->state == DHCPS_LEASE_DECLINED) {
+      /* Back in the pool */
+      lease->state = DHCPS_LEASE_FREE;
+      continue;
+    }
+    if (lease->state == DHCPS_LEASE_BOUND) {
+      dirty = true;
+    }
+    if (expired_fn != NULL) {
+      expired_fn(lease->mac, pool_first_ip + i, arg);
+    }
+    lease->state = DHCPS_LEASE_EXPIRED;
+    count++;
+  }
+  return count;
+}
+
+/***************************************************************************//**
+ * Get the address leased to a client.
+ ******************************************************************************/
+uint32_t dhcps_lease_get_ip(const uint8_t *mac)
+{
+  uint16_t index = dhcps_lease_find(mac);
+
+  return (index != DHCPS_LEASE_NONE) ? pool_first_ip + index : 0;
+}
+
+/***************************************************************************//**
+ * Get the lease state of a client.
+ ******************************************************************************/
+dhcps_lease_state_t dhcps_lease_get_state(const uint8_t *mac, uint32_t *ip)
+{
+  uint16_t index = dhcps_lease_find(mac);
+
+  if (index == DHCPS_LEASE_NONE) {
+    *ip = 0;
+    return DHCPS_LEASE_FREE;
+  }
+  *ip = pool_first_ip + index;
+  return (dhcps_lease_state_t)leases[index].state;
+}
+
+/***************************************************************************//**
+ * Get a bound lease by its index.
+ ******************************************************************************/
+bool dhcps_lease_get(uint16_t index, uint8_t *mac, uint32_t *ip, uint32_t *expiry)
+{
+  if ((index >= pool_size) || (leases[index].state != DHCPS_LEASE_BOUND)) {
+    return false;
+  }
+  memcpy(mac, leases[index].mac, 6);
+  *ip = pool_first_ip + index;
+  if (expiry != NULL) {
+    *expiry = leases[index].expiry;
+  }
+  return true;
+}
+
+/***************************************************************************//**
+ * Check whether the leases to save changed since the last export.
+ ******************************************************************************/
+bool dhcps_lease_is_dirty(void)
+{
+  return dirty;
+}
+
+/***************************************************************************//**
+ * Export the leases having a client.
+ ******************************************************************************/
+uint16_t dhcps_lease_export(dhcps_lease_record_t *records, uint16_t max, uint32_t now)
+{
+  uint16_t count = 0;
+
+  for (uint16_t i = 0; (i < pool_size) && (count < max); i++) {
+    const dhcps_lease_t *lease = &leases[i];
+
+    if (!dhcps_lease_has_client(lease)) {
+      continue;
+    }
+    memcpy(records[count].mac, lease->mac, 6);
+    records[count].index = i;
+    if ((lease->state == DHCPS_LEASE_BOUND) && !dhcps_lease_is_over(lease, now)) {
+      records[count].remaining = lease->expiry - now;
+    } else {
+      records[count].remaining = 0;
+    }
+    count++;
+  }
+  dirty = false;
+  return count;
+}
+
+/***************************************************************************//**
+ * Restore exported leases.
+ ******************************************************************************/
+uint16_t dhcps_lease_import(const dhcps_lease_record_t *records, uint16_t count, uint32_t now)
+{
+  uint16_t restored = 0;
+
+  for (uint16_t i = 0; i < count; i++) {
+    const dhcps_lease_record_t *record = &records[i];
+    dhcps_lease_t *lease;
+
+    if ((record->index >= pool_size)
+        || dhcps_lease_has_client(&leases[record->index])
+        || (dhcps_lease_find(record->mac) != DHCPS_LEASE_NONE)) {
+      continue;
+    }
+    lease = &leases[record->index];
+    memcpy(lease->mac, record->mac, 6);
+    dhcps_lease_link(record->index);
+    if (record->remaining != 0) {
+      lease->state = DHCPS_LEASE_BOUND;
+      lease->expiry = now + record->remaining;
+    } else {
+      lease->state = DHCPS_LEASE_EXPIRED;
+      lease->expiry = now;
+    }
+    restored++;
+  }
+  /* Nothing new to save */
+  dirty = false;
+  return restored;
+}
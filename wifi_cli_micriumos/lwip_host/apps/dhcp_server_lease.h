@@ -0,0 +1,200 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef DHCP_SERVER_LEASE_H
+#define DHCP_SERVER_LEASE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Number of leases, i.e. largest address pool.
+#ifndef DHCPS_LEASE_MAX
+#define DHCPS_LEASE_MAX               32
+#endif
+
+/// Number of hash buckets indexing the leases by MAC address, power of 2.
+#ifndef DHCPS_LEASE_HASH_SIZE
+#define DHCPS_LEASE_HASH_SIZE         32
+#endif
+
+/// Time an offered address stays reserved for the client, in seconds.
+#ifndef DHCPS_LEASE_OFFER_TIME
+#define DHCPS_LEASE_OFFER_TIME        60
+#endif
+
+/// Time a declined address stays out of the pool, in seconds.
+#ifndef DHCPS_LEASE_DECLINE_TIME
+#define DHCPS_LEASE_DECLINE_TIME      600
+#endif
+
+/// Lease states
+typedef enum {
+  DHCPS_LEASE_FREE = 0,       ///< Never assigned or reclaimed
+  DHCPS_LEASE_OFFERED,        ///< Reserved until the client requests it
+  DHCPS_LEASE_BOUND,          ///< Assigned until its expiry
+  DHCPS_LEASE_EXPIRED,        ///< Expired or released, kept for the same client
+                              ///  until another one needs the address
+  DHCPS_LEASE_DECLINED        ///< Used by an unknown host, out of the pool for a while
+} dhcps_lease_state_t;
+
+/// Lease saved across reboots. The time left is relative, the lease time
+/// base restarting at each boot.
+typedef struct {
+  uint8_t mac[6];
+  uint16_t index;             ///< Lease index, i.e. address offset in the pool
+  uint32_t remaining;         ///< Lease time left in seconds, 0 if expired
+} dhcps_lease_record_t;
+
+/// Function called for each lease found expired.
+typedef void (*dhcps_lease_expired_fn_t)(const uint8_t *mac, uint32_t ip, void *arg);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Clear the leases and set the address pool. The addresses are in host byte
+ * order and the times in seconds from any origin.
+ *
+ * @param first_ip first address of the pool
+ * @param size number of addresses, up to DHCPS_LEASE_MAX
+ * @param lease_time lease duration
+ ******************************************************************************/
+void dhcps_lease_init(uint32_t first_ip, uint16_t size, uint32_t lease_time);
+
+/***************************************************************************//**
+ * Clear the leases, keeping the address pool.
+ ******************************************************************************/
+void dhcps_lease_clear(void);
+
+/***************************************************************************//**
+ * Reserve an address for a DHCPDISCOVER: the client lease if any, else the
+ * requested address if available, else a free one, else the oldest expired
+ * one.
+ *
+ * @param mac client MAC address
+ * @param requested_ip address asked by the client, 0 if none
+ * @param now current time
+ * @returns the address offered, 0 if the pool is exhausted
+ ******************************************************************************/
+uint32_t dhcps_lease_offer(const uint8_t *mac, uint32_t requested_ip, uint32_t now);
+
+/***************************************************************************//**
+ * Bind an address for a DHCPREQUEST. A client unknown to the server (e.g.
+ * INIT-REBOOT after a restart) gets the requested address if available.
+ *
+ * @param mac client MAC address
+ * @param requested_ip requested address, or client address when renewing
+ * @param now current time
+ * @returns the address to acknowledge, 0 to reject the request
+ ******************************************************************************/
+uint32_t dhcps_lease_request(const uint8_t *mac, uint32_t requested_ip, uint32_t now);
+
+/***************************************************************************//**
+ * Release the lease of a client (DHCPRELEASE, disconnection or selection of
+ * another server). The address stays reserved to the client until another
+ * one needs it.
+ *
+ * @param mac client MAC address
+ * @param now current time
+ * @returns the released address if it was offered or bound, 0 otherwise
+ ******************************************************************************/
+uint32_t dhcps_lease_release(const uint8_t *mac, uint32_t now);
+
+/***************************************************************************//**
+ * Take a declined address out of the pool for DHCPS_LEASE_DECLINE_TIME.
+ *
+ * @param mac client MAC address
+ * @param ip declined address
+ * @param now current time
+ * @returns true if the address was leased to the client
+ ******************************************************************************/
+bool dhcps_lease_decline(const uint8_t *mac, uint32_t ip, uint32_t now);
+
+/***************************************************************************//**
+ * Expire the leases whose time is over.
+ *
+ * @param now current time
+ * @param expired_fn function called for each offered or bound lease expired,
+ *                   or NULL
+ * @param arg argument of expired_fn
+ * @returns number of leases expired
+ ******************************************************************************/
+uint16_t dhcps_lease_expire(uint32_t now, dhcps_lease_expired_fn_t expired_fn, void *arg);
+
+/***************************************************************************//**
+ * Get the address leased to a client.
+ *
+ * @param mac client MAC address
+ * @returns the address offered, bound or kept for the client, 0 if none
+ ******************************************************************************/
+uint32_t dhcps_lease_get_ip(const uint8_t *mac);
+
+/***************************************************************************//**
+ * Get the lease state of a client.
+ *
+ * @param mac client MAC address
+ * @param ip leased address result, 0 if none
+ * @returns the lease state, DHCPS_LEASE_FREE if the client has no lease
+ ******************************************************************************/
+dhcps_lease_state_t dhcps_lease_get_state(const uint8_t *mac, uint32_t *ip);
+
+/***************************************************************************//**
+ * Get a bound lease by its index.
+ *
+ * @param index lease index, 0 to DHCPS_LEASE_MAX - 1
+ * @param mac client MAC address result
+ * @param ip leased address result
+ * @param expiry expiry time result, or NULL
+ * @returns true if the lease is bound
+ ******************************************************************************/
+bool dhcps_lease_get(uint16_t index, uint8_t *mac, uint32_t *ip, uint32_t *expiry);
+
+/***************************************************************************//**
+ * Check whether the leases to save changed since the last export. A renewal
+ * only extending a binding does not count, so that the saves stay rare.
+ *
+ * @returns true if the leases have to be saved
+ ******************************************************************************/
+bool dhcps_lease_is_dirty(void);
+
+/***************************************************************************//**
+ * Export the leases having a client, bound or kept for it, and clear the
+ * dirty state.
+ *
+ * @param records records result
+ * @param max size of records
+ * @param now current time
+ * @returns number of records
+ ******************************************************************************/
+uint16_t dhcps_lease_export(dhcps_lease_record_t *records, uint16_t max, uint32_t now);
+
+/***************************************************************************//**
+ * Restore exported leases after dhcps_lease_init() with the same pool. The
+ * records out of the pool or of a client already restored are skipped.
+ *
+ * @param records exported records
+ * @param count number of records
+ * @param now current time
+ * @returns number of leases restored
+ ******************************************************************************/
+uint16_t dhcps_lease_import(const dhcps_lease_record_t *records, uint16_t count, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,128 @@
+/***************************************************************************//**
+ * @file
+ * @brief DHCP server message builder
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * The replies are written with block copies in a contiguous buffer (the
+ * payload of a PBUF_RAM pbuf on the target). The module has no lwIP
+ * dependency so that it also builds on a host
+ * (see tools/dhcp_server_msg_bench.c).
+ ******************************************************************************/
+#include <string.h>
+#include "dhcp_server_msg.h"
+
+#define DHCPS_MSG_OP_OFS              0
+#define DHCPS_MSG_HOPS_OFS            3
+#define DHCPS_MSG_SECS_OFS            8
+#define DHCPS_MSG_FLAGS_OFS           10
+#define DHCPS_MSG_YIADDR_OFS          16
+#define DHCPS_MSG_SIADDR_OFS          20
+#define DHCPS_MSG_SNAME_OFS           44
+
+#define DHCPS_MSG_BOOTREPLY           2
+#define DHCPS_MSG_FLAG_BROADCAST      0x80    ///< First byte of the flags
+#define DHCPS_MSG_OPTION_PAD          0
+#define DHCPS_MSG_OPTION_TYPE         53
+#define DHCPS_MSG_OPTION_END          255
+
+static const uint8_t magic_cookie[4] = { 0x63, 0x82, 0x53, 0x63 };
+
+/***************************************************************************//**
+ * Write a 32-bit value in network byte order.
+ ******************************************************************************/
+static void dhcps_msg_put_u32(uint8_t *dst, uint32_t value)
+{
+  dst[0] = (uint8_t)(value >> 24);
+  dst[1] = (uint8_t)(value >> 16);
+  dst[2] = (uint8_t)(value >> 8);
+  dst[3] = (uint8_t)value;
+}
+
+/***************************************************************************//**
+ * Start a reply in the buffer holding a copy of the request header.
+ ******************************************************************************/
+bool dhcps_msg_reply_init(dhcps_msg_t *msg, uint8_t *buf, uint16_t size,
+                          uint8_t type, uint32_t yiaddr)
+{
+  msg->buf = buf;
+  msg->size = size;
+  msg->len = DHCPS_MSG_OPTIONS_OFS;
+  msg->overflow = (size < DHCPS_MSG_REPLY_LEN);
+  if (msg->overflow) {
+    return false;
+  }
+
+  buf[DHCPS_MSG_OP_OFS] = DHCPS_MSG_BOOTREPLY;
+  buf[DHCPS_MSG_HOPS_OFS] = 0;
+  memset(&buf[DHCPS_MSG_SECS_OFS], 0, 2);
+  /* Only the broadcast flag is defined */
+  buf[DHCPS_MSG_FLAGS_OFS] &= DHCPS_MSG_FLAG_BROADCAST;
+  buf[DHCPS_MSG_FLAGS_OFS + 1] = 0;
+  dhcps_msg_put_u32(&buf[DHCPS_MSG_YIADDR_OFS], yiaddr);
+  memset(&buf[DHCPS_MSG_SIADDR_OFS], 0, 4);
+  /* sname and file */
+  memset(&buf[DHCPS_MSG_SNAME_OFS], 0, DHCPS_MSG_HEADER_LEN - DHCPS_MSG_SNAME_OFS);
+  memcpy(&buf[DHCPS_MSG_HEADER_LEN], magic_cookie, sizeof(magic_cookie));
+
+  return dhcps_msg_add_option(msg, DHCPS_MSG_OPTION_TYPE, &type, 1);
+}
+
+/***************************************************************************//**
+ * Append an option.
+ ******************************************************************************/
+bool dhcps_msg_add_option(dhcps_msg_t *msg, uint8_t code, const void *value, uint8_t len)
+{
+  /* Keep room for the end option */
+  if (msg->overflow || (msg->len + 2 + len + 1 > msg->size)) {
+    msg->overflow = true;
+    return false;
+  }
+  msg->buf[msg->len] = code;
+  msg->buf[msg->len + 1] = len;
+  memcpy(&msg->buf[msg->len + 2], value, len);
+  msg->len += 2 + len;
+  return true;
+}
+
+/***************************************************************************//**
+ * Append a 32-bit option.
+ ******************************************************************************/
+bool dhcps_msg_add_u32(dhcps_msg_t *msg, uint8_t code, uint32_t value)
+{
+  uint8_t bytes[4];
+
+  dhcps_msg_put_u32(bytes, value);
+  return dhcps_msg_add_option(msg, code, bytes, sizeof(bytes));
+}
+
+/***************************************************************************//**
+ * Append the end option and pad the message.
+ ******************************************************************************/
+uint16_t dhcps_msg_finish(dhcps_msg_t *msg)
+{
+  if (msg->overflow) {
+    return 0;
+  }
+  msg->buf[msg->len++] = DHCPS_MSG_OPTION_END;
+  if (msg->len < DHCPS_MSG_MIN_LEN) {
+    memset(&msg->buf[msg->len], DHCPS_MSG_OPTION_PAD, DHCPS_MSG_MIN_LEN - msg->len);
+    msg->len = DHCPS_MSG_MIN_LEN;
+  }
+  return msg->len;
+}
@@ -0,0 +1,94 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef DHCP_SERVER_MSG_H
+#define DHCP_SERVER_MSG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Fixed part of a DHCP message, from op to file.
+#define DHCPS_MSG_HEADER_LEN          236
+/// Offset of the options, after the magic cookie.
+#define DHCPS_MSG_OPTIONS_OFS         (DHCPS_MSG_HEADER_LEN + 4)
+/// Minimum BOOTP message length, some clients dropping shorter ones (RFC 1542).
+#define DHCPS_MSG_MIN_LEN             300
+/// Buffer length of a server reply: the message type, 4 address/time options
+/// and the end option fit in the minimum length.
+#define DHCPS_MSG_REPLY_LEN           DHCPS_MSG_MIN_LEN
+
+/// DHCP message being built in a contiguous buffer.
+typedef struct {
+  uint8_t *buf;
+  uint16_t size;              ///< Buffer size
+  uint16_t len;               ///< Message length so far
+  bool overflow;              ///< An option did not fit
+} dhcps_msg_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Start a reply in the buffer holding a copy of the request header
+ * (DHCPS_MSG_HEADER_LEN bytes): the client fields (xid, flags, giaddr,
+ * chaddr) are kept, the other ones set for a reply, followed by the magic
+ * cookie and the message type option.
+ *
+ * @param msg message to build
+ * @param buf buffer, DHCPS_MSG_REPLY_LEN bytes at least
+ * @param size buffer size
+ * @param type DHCP message type (DHCP_OFFER, DHCP_ACK...)
+ * @param yiaddr client address, host byte order
+ * @returns true if the buffer is large enough
+ ******************************************************************************/
+bool dhcps_msg_reply_init(dhcps_msg_t *msg, uint8_t *buf, uint16_t size,
+                          uint8_t type, uint32_t yiaddr);
+
+/***************************************************************************//**
+ * Append an option.
+ *
+ * @param msg message being built
+ * @param code option code
+ * @param value option value
+ * @param len value length
+ * @returns true if the option fits
+ ******************************************************************************/
+bool dhcps_msg_add_option(dhcps_msg_t *msg, uint8_t code, const void *value, uint8_t len);
+
+/***************************************************************************//**
+ * Append a 32-bit option (address or time).
+ *
+ * @param msg message being built
+ * @param code option code
+ * @param value option value, host byte order
+ * @returns true if the option fits
+ ******************************************************************************/
+bool dhcps_msg_add_u32(dhcps_msg_t *msg, uint8_t code, uint32_t value);
+
+/***************************************************************************//**
+ * Append the end option and pad the message to DHCPS_MSG_MIN_LEN.
+ *
+ * @param msg message being built
+ * @returns the message length, 0 if an option did not fit
+ ******************************************************************************/
+uint16_t dhcps_msg_finish(dhcps_msg_t *msg);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -20,15 +20,20 @@
  *****************************************************************************/
 
 #include <string.h>
+#include "lwip/sys.h"
 #include "lwip/timeouts.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcp_priv.h"
 #include "netif/etharp.h"
 #include "ethernetif.h"
+#include "latency_trace.h"
 #include "sl_wfx_constants.h"
 #include "sl_wfx_host_api.h"
 #include "sl_wfx_task.h"
 #include "sl_wfx.h"
 #include "wifi_cli_params.h"
 #include "app_wifi_events.h"
+#include "softap_clients.h"
 
 #include <kernel/include/os.h>
 #include <common/include/rtos_utils.h>
@@ -41,6 +46,35 @@
 const char *station_netif = "st";
 const char *softap_netif = "ap";
 
+/// TX flow control statistics, shared between lwIP and the WFX bus task.
+static ethernetif_tx_stats_t tx_stats = {
+  .window = ETHERNETIF_TX_MAX_OUTSTANDING_FRAMES,
+  .resume_threshold = ETHERNETIF_TX_MAX_OUTSTANDING_FRAMES / 2,
+};
+/// Set when lwIP is pushed back until the WFX confirms pending frames.
+static bool tx_paused = false;
+/// Last confirmation, or first frame queued with none outstanding.
+static uint32_t tx_progress_ms;
+/// Bytes exchanged on the station interface, wrapping.
+static uint32_t sta_tx_bytes;
+static uint32_t sta_rx_bytes;
+
+/***************************************************************************//**
+ * Resumes the TCP transmissions delayed by the TX flow control.
+ * Called from the TCP/IP thread.
+ ******************************************************************************/
+static void ethernetif_tx_resume(void *arg)
+{
+  struct tcp_pcb *pcb;
+  (void)arg;
+
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    if (pcb->unsent != NULL) {
+      tcp_output(pcb);
+    }
+  }
+}
+
 /***************************************************************************//**
  * Initializes the hardware parameters. Called from ethernetif_init().
  *
@@ -86,6 +120,49 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
   uint8_t *buffer;
   sl_wfx_packet_queue_item_t *queue_item;
   sl_status_t result;
+  uint32_t now_ms = sys_now();
+  bool resync = false;
+  LATENCY_TRACE_DECLARE(trace_start);
+
+  CPU_SR_ALLOC();
+
+  LATENCY_TRACE_START(trace_start);
+
+  /* Push back lwIP while the WFX has not confirmed enough frames, the
+     credit being taken with the check for the two interfaces to share it */
+  CPU_CRITICAL_ENTER();
+  if ((tx_paused || (tx_stats.outstanding >= tx_stats.window))
+      && ((now_ms - tx_progress_ms) >= ETHERNETIF_TX_CONFIRM_TIMEOUT_MS)) {
+    /* Confirmations lost (bus error, frame dropped): start again */
+    tx_stats.outstanding = 0;
+    tx_stats.resyncs++;
+    tx_paused = false;
+    resync = true;
+  }
+  if (tx_paused || (tx_stats.outstanding >= tx_stats.window)) {
+    if (!tx_paused) {
+      tx_paused = true;
+      tx_stats.pause_count++;
+    }
+    tx_stats.queue_full_events++;
+    CPU_CRITICAL_EXIT();
+    if (resync) {
+      LATENCY_TRACE_TX_FLUSH();
+    }
+    return ERR_MEM;
+  }
+  if (tx_stats.outstanding == 0) {
+    tx_progress_ms = now_ms;
+  }
+  tx_stats.outstanding++;
+  if (tx_stats.outstanding > tx_stats.outstanding_max) {
+    tx_stats.outstanding_max = tx_stats.outstanding;
+  }
+  CPU_CRITICAL_EXIT();
+  if (resync) {
+    /* The timestamps of the lost frames would pair with the next confirmations */
+    LATENCY_TRACE_TX_FLUSH();
+  }
 
   /* Take TX queue mutex */
   OSMutexPend(&sl_wfx_tx_queue_mutex, 0, OS_OPT_PEND_BLOCKING, 0, &err);
@@ -99,6 +176,12 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
   if ((result != SL_STATUS_OK) || (queue_item == NULL)) {
     /* Release TX queue mutex */
 	  OSMutexPost(&sl_wfx_tx_queue_mutex, OS_OPT_POST_NONE, &err);
+    CPU_CRITICAL_ENTER();
+    tx_stats.alloc_failures++;
+    if (tx_stats.outstanding > 0) {
+      tx_stats.outstanding--;
+    }
+    CPU_CRITICAL_EXIT();
     return ERR_MEM;
   }
 
@@ -125,6 +208,20 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
   /* Update the tail pointer */
   sl_wfx_tx_queue_context.tail_ptr = queue_item;
 
+  /* The frame holds its WFX credit until its confirmation */
+  CPU_CRITICAL_ENTER();
+  tx_stats.frames_queued++;
+  if (queue_item->interface == SL_WFX_STA_INTERFACE) {
+    sta_tx_bytes += p->tot_len;
+  }
+  CPU_CRITICAL_EXIT();
+  if (queue_item->interface == SL_WFX_SOFTAP_INTERFACE) {
+    softap_clients_count_tx((const uint8_t *)p->payload, p->tot_len);
+  }
+
+  LATENCY_TRACE_STOP(LATENCY_TRACE_TX_ENQUEUE, trace_start);
+  LATENCY_TRACE_TX_QUEUED();
+
   /* Notify that a TX frame is ready */
   OSFlagPost(&bus_events, SL_WFX_BUS_EVENT_FLAG_TX, OS_OPT_POST_FLAG_SET, &err);
 
@@ -134,6 +231,127 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
   return ERR_OK;
 }
 
+/***************************************************************************//**
+ * Notifies the interface that the WFX confirmed a frame transmission.
+ *
+ * @param status status of the SL_WFX_SEND_FRAME_CNF message
+ ******************************************************************************/
+void ethernetif_tx_frame_confirmed(uint32_t status)
+{
+  bool resume = false;
+  CPU_SR_ALLOC();
+
+  LATENCY_TRACE_TX_CONFIRMED();
+
+  CPU_CRITICAL_ENTER();
+  tx_stats.frames_confirmed++;
+  if (status != WFM_STATUS_SUCCESS) {
+    tx_stats.frames_failed++;
+  }
+  if (tx_stats.outstanding > 0) {
+    tx_stats.outstanding--;
+  }
+  tx_progress_ms = sys_now();
+  if (tx_paused && (tx_stats.outstanding <= tx_stats.resume_threshold)) {
+    tx_paused = false;
+    resume = true;
+  }
+  CPU_CRITICAL_EXIT();
+
+  if (resume) {
+    /* Kick the TCP connections which were pushed back, the regular
+       TCP timers take over if the TCP/IP mailbox is full */
+    tcpip_try_callback(ethernetif_tx_resume, NULL);
+  }
+}
+
+/***************************************************************************//**
+ * Gets the TX flow control statistics.
+ *
+ * @param stats statistics result
+ ******************************************************************************/
+void ethernetif_get_tx_stats(ethernetif_tx_stats_t *stats)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  *stats = tx_stats;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Gets the bytes exchanged on the station interface.
+ ******************************************************************************/
+void ethernetif_get_sta_traffic(uint32_t *tx_bytes, uint32_t *rx_bytes)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  *tx_bytes = sta_tx_bytes;
+  *rx_bytes = sta_rx_bytes;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Resets the TX flow control statistics counters.
+ ******************************************************************************/
+void ethernetif_reset_tx_stats(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  tx_stats.frames_queued = 0;
+  tx_stats.frames_confirmed = 0;
+  tx_stats.frames_failed = 0;
+  tx_stats.alloc_failures = 0;
+  tx_stats.queue_full_events = 0;
+  tx_stats.pause_count = 0;
+  tx_stats.resyncs = 0;
+  tx_stats.outstanding_max = tx_stats.outstanding;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Forgets the frames waiting for a confirmation and resumes the transmission.
+ ******************************************************************************/
+void ethernetif_tx_flush(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  tx_stats.outstanding = 0;
+  tx_paused = false;
+  CPU_CRITICAL_EXIT();
+
+  LATENCY_TRACE_TX_FLUSH();
+}
+
+/***************************************************************************//**
+ * Sizes the TX window from the WFX input buffers.
+ ******************************************************************************/
+void ethernetif_tx_start(uint16_t input_buffers)
+{
+  uint16_t window = 1;
+  CPU_SR_ALLOC();
+
+  if (input_buffers > ETHERNETIF_TX_RESERVED_BUFFERS + 1) {
+    window = input_buffers - ETHERNETIF_TX_RESERVED_BUFFERS;
+  }
+#if LATENCY_TRACE_ENABLED
+  /* A timestamp per outstanding frame, none dropped */
+  if (window > LATENCY_TRACE_TX_FIFO_SIZE) {
+    window = LATENCY_TRACE_TX_FIFO_SIZE;
+  }
+#endif
+
+  CPU_CRITICAL_ENTER();
+  tx_stats.window = window;
+  tx_stats.resume_threshold = window / 2;
+  CPU_CRITICAL_EXIT();
+
+  ethernetif_tx_flush();
+}
+
 /***************************************************************************//**
  * Transfers the receive packets from the wfx to lwip.
  *
@@ -186,20 +404,28 @@ void sl_wfx_host_received_frame_callback(sl_wfx_received_ind_t* rx_buffer)
 {
   struct pbuf *p;
   struct netif *netif;
+  LATENCY_TRACE_DECLARE(trace_start);
+
+  LATENCY_TRACE_START(trace_start);
   /* Check packet interface to send to AP or STA interface */
   if ((rx_buffer->header.info & SL_WFX_MSG_INFO_INTERFACE_MASK)
       == (SL_WFX_STA_INTERFACE << SL_WFX_MSG_INFO_INTERFACE_OFFSET)) {
     /* Send to station interface */
     netif = &sta_netif;
+    sta_rx_bytes += rx_buffer->body.frame_length;
   } else {
     /* Send to softAP interface */
     netif = &ap_netif;
+    softap_clients_count_rx(&rx_buffer->body.frame[rx_buffer->body.frame_padding],
+                            rx_buffer->body.frame_length);
   }
   if (netif != NULL) {
     p = low_level_input(netif, rx_buffer);
     if (p != NULL) {
       if (netif->input(p, netif) != ERR_OK ) {
         pbuf_free(p);
+      } else {
+        LATENCY_TRACE_STOP(LATENCY_TRACE_RX_INPUT, trace_start);
       }
     }
   }
@@ -22,6 +22,39 @@
 #include "lwip/err.h"
 #include "lwip/netif.h"
 
+/// Maximum number of frames handed to the WFX and not yet confirmed, until
+/// the startup indication gives the number of WFX input buffers. Past this
+/// point, lwIP is pushed back with ERR_MEM before the buffers are exhausted.
+#ifndef ETHERNETIF_TX_MAX_OUTSTANDING_FRAMES
+#define ETHERNETIF_TX_MAX_OUTSTANDING_FRAMES   8
+#endif
+
+/// WFX input buffers kept for the commands, out of the TX window.
+#ifndef ETHERNETIF_TX_RESERVED_BUFFERS
+#define ETHERNETIF_TX_RESERVED_BUFFERS         2
+#endif
+
+/// Time without any confirmation after which the frames still waiting for
+/// one are considered lost (ms).
+#ifndef ETHERNETIF_TX_CONFIRM_TIMEOUT_MS
+#define ETHERNETIF_TX_CONFIRM_TIMEOUT_MS       1000
+#endif
+
+/// TX flow control statistics
+typedef struct {
+  uint32_t frames_queued;       ///< Frames queued to the WFX
+  uint32_t frames_confirmed;    ///< Frames confirmed by the WFX
+  uint32_t frames_failed;       ///< Frames confirmed with an error status
+  uint32_t alloc_failures;      ///< Command buffer allocation failures
+  uint32_t queue_full_events;   ///< Frames pushed back because of the credit limit
+  uint32_t pause_count;         ///< Number of times the transmission was paused
+  uint32_t resyncs;             ///< Confirmations given up after the timeout
+  uint16_t outstanding;         ///< Frames currently waiting for a confirmation
+  uint16_t outstanding_max;     ///< High-water mark of outstanding frames
+  uint16_t window;              ///< Outstanding frames allowed
+  uint16_t resume_threshold;    ///< Outstanding frames under which TX resumes
+} ethernetif_tx_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +73,52 @@ err_t sta_ethernetif_init(struct netif *netif);
  * @returns ERR_OK if successful
  ******************************************************************************/
 err_t ap_ethernetif_init(struct netif *netif);
+
+/***************************************************************************//**
+ * Notifies the interface that the WFX confirmed a frame transmission.
+ *
+ * @param status status of the SL_WFX_SEND_FRAME_CNF message
+ ******************************************************************************/
+void ethernetif_tx_frame_confirmed(uint32_t status);
+
+/***************************************************************************//**
+ * Gets the TX flow control statistics.
+ *
+ * @param stats statistics result
+ ******************************************************************************/
+void ethernetif_get_tx_stats(ethernetif_tx_stats_t *stats);
+
+/***************************************************************************//**
+ * Gets the bytes exchanged on the station interface since the start.
+ *
+ * @param tx_bytes bytes queued to the WFX, wrapping
+ * @param rx_bytes bytes received from the WFX, wrapping
+ ******************************************************************************/
+void ethernetif_get_sta_traffic(uint32_t *tx_bytes, uint32_t *rx_bytes);
+
+/***************************************************************************//**
+ * Resets the TX flow control statistics counters.
+ *
+ * @note The outstanding frame count is kept since frames are still in flight.
+ ******************************************************************************/
+void ethernetif_reset_tx_stats(void);
+
+/***************************************************************************//**
+ * Forgets the frames waiting for a confirmation and resumes the transmission.
+ *
+ * @note To be called when the WFX is re-initialized or a link goes down,
+ *       pending confirmations are lost in this case.
+ ******************************************************************************/
+void ethernetif_tx_flush(void);
+
+/***************************************************************************//**
+ * Sizes the TX window from the startup indication of the WFX and forgets
+ * the frames sent to the previous firmware instance. With the latency
+ * tracing, the window is at most LATENCY_TRACE_TX_FIFO_SIZE.
+ *
+ * @param input_buffers number of WFX input buffers (num_inp_ch_bufs)
+ ******************************************************************************/
+void ethernetif_tx_start(uint16_t input_buffers);
 #ifdef __cplusplus
 }
 #endif
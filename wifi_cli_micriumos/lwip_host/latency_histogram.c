@@ -0,0 +1,94 @@
+/***************************************************************************//**
+ * @file
+ * @brief Latency histogram with percentiles
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include "em_device.h"
+#include "latency_histogram.h"
+
+/***************************************************************************//**
+ * Get the bucket of a latency.
+ ******************************************************************************/
+static uint32_t latency_histogram_bucket(uint32_t latency_us)
+{
+  uint32_t msb;
+  uint32_t bucket;
+
+  if (latency_us < 4) {
+    return latency_us;
+  }
+  /* 4 buckets per power of 2: [2^n, 2^n * 1.25[, [2^n * 1.25, 2^n * 1.5[... */
+  msb = 31 - __CLZ(latency_us);
+  bucket = ((msb - 1) * 4) + ((latency_us >> (msb - 2)) & 3);
+  return (bucket < LATENCY_HISTOGRAM_BUCKET_NB) ? bucket : LATENCY_HISTOGRAM_BUCKET_NB - 1;
+}
+
+/***************************************************************************//**
+ * Get the lower bound of a bucket in microseconds.
+ ******************************************************************************/
+uint32_t latency_histogram_bucket_low(uint32_t bucket)
+{
+  if (bucket < 4) {
+    return bucket;
+  }
+  return (4 + (bucket % 4)) << ((bucket / 4) - 1);
+}
+
+/***************************************************************************//**
+ * Record a latency.
+ ******************************************************************************/
+void latency_histogram_add(latency_histogram_t *histogram, uint32_t latency_us)
+{
+  if ((histogram->count == 0) || (latency_us < histogram->min_us)) {
+    histogram->min_us = latency_us;
+  }
+  if (latency_us > histogram->max_us) {
+    histogram->max_us = latency_us;
+  }
+  histogram->total_us += latency_us;
+  histogram->buckets[latency_histogram_bucket(latency_us)]++;
+  histogram->count++;
+}
+
+/***************************************************************************//**
+ * Estimate a latency percentile (per mille) from the histogram.
+ ******************************************************************************/
+uint32_t latency_histogram_percentile(const latency_histogram_t *histogram,
+                                      uint32_t per_mille)
+{
+  uint64_t rank = (((uint64_t)histogram->count * per_mille) + 999) / 1000;
+  uint64_t cumul = 0;
+  uint32_t low;
+  uint32_t high;
+
+  for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKET_NB; i++) {
+    cumul += histogram->buckets[i];
+    if ((cumul >= rank) && (histogram->buckets[i] > 0)) {
+      /* Middle of the bucket, within the observed bounds */
+      low = latency_histogram_bucket_low(i);
+      high = (i < LATENCY_HISTOGRAM_BUCKET_NB - 1) ? latency_histogram_bucket_low(i + 1)
+             : histogram->max_us + 1;
+      low = low + ((high - low) / 2);
+      if (low < histogram->min_us) {
+        low = histogram->min_us;
+      }
+      return (low < histogram->max_us) ? low : histogram->max_us;
+    }
+  }
+  return histogram->max_us;
+}
@@ -0,0 +1,65 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+/// Histogram resolution: 4 buckets per power of 2 (12.5% error at most),
+/// the last bucket gathers the latencies over 1.8 s.
+#define LATENCY_HISTOGRAM_BUCKET_NB   80
+
+/// Latency distribution, cleared with memset().
+typedef struct {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint32_t buckets[LATENCY_HISTOGRAM_BUCKET_NB];
+} latency_histogram_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Record a latency.
+ ******************************************************************************/
+void latency_histogram_add(latency_histogram_t *histogram, uint32_t latency_us);
+
+/***************************************************************************//**
+ * Estimate a latency percentile, the middle of its bucket within the
+ * observed bounds.
+ *
+ * @param per_mille percentile, 500 for the median
+ * @returns latency in microseconds, 0 if the histogram is empty
+ ******************************************************************************/
+uint32_t latency_histogram_percentile(const latency_histogram_t *histogram,
+                                      uint32_t per_mille);
+
+/***************************************************************************//**
+ * Get the lower bound of a bucket.
+ *
+ * @returns latency in microseconds
+ ******************************************************************************/
+uint32_t latency_histogram_bucket_low(uint32_t bucket);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,274 @@
+/***************************************************************************//**
+ * @file
+ * @brief Per-packet latency tracing through the host stack
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "em_device.h"
+#include <kernel/include/os.h>
+#include "latency_trace.h"
+
+/// CPU cycles per microsecond, computed on first use.
+static uint32_t cycles_per_us = 0;
+
+/***************************************************************************//**
+ * Get a timestamp from the CPU cycle counter.
+ ******************************************************************************/
+uint32_t latency_trace_timestamp(void)
+{
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0) {
+    /* Start the cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  return DWT->CYCCNT;
+}
+
+/***************************************************************************//**
+ * Convert a timestamp difference in microseconds.
+ ******************************************************************************/
+uint32_t latency_trace_cycles_to_us(uint32_t cycles)
+{
+  if (cycles_per_us == 0) {
+    cycles_per_us = SystemCoreClockGet() / 1000000;
+    if (cycles_per_us == 0) {
+      cycles_per_us = 1;
+    }
+  }
+  return cycles / cycles_per_us;
+}
+
+/***************************************************************************//**
+ * Get a microsecond time from the CPU cycle counter.
+ ******************************************************************************/
+uint32_t latency_trace_time_us(void)
+{
+  static uint32_t last_cycles = 0;
+  static OS_TICK last_tick = 0;
+  static uint32_t time_us = 0;
+  uint32_t elapsed_us;
+  uint32_t cycles;
+  OS_TICK tick;
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  cycles = latency_trace_timestamp();
+  tick = OSTimeGet(&err);
+  if ((tick - last_tick) < (OSCfg_TickRate_Hz * LATENCY_TRACE_RESYNC_S)) {
+    elapsed_us = latency_trace_cycles_to_us(cycles - last_cycles);
+    /* The cycles short of a microsecond count for the next call */
+    last_cycles += elapsed_us * cycles_per_us;
+  } else {
+    elapsed_us = (uint32_t)(((uint64_t)(tick - last_tick) * 1000000U) / OSCfg_TickRate_Hz);
+    last_cycles = cycles;
+  }
+  last_tick = tick;
+  time_us += elapsed_us;
+  CPU_CRITICAL_EXIT();
+
+  return time_us;
+}
+
+#if LATENCY_TRACE_ENABLED
+
+/// Latency histogram of a stage
+typedef struct {
+  uint32_t buckets[LATENCY_TRACE_BUCKET_NB];
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+} latency_trace_histogram_t;
+
+static const char *stage_names[LATENCY_TRACE_STAGE_NB] = {
+  "tx_enqueue",
+  "tx_confirm",
+  "rx_input"
+};
+
+static latency_trace_histogram_t histograms[LATENCY_TRACE_STAGE_NB];
+
+/// Timestamps of the frames waiting for a confirmation, in queuing order.
+static uint32_t tx_fifo[LATENCY_TRACE_TX_FIFO_SIZE];
+static uint8_t tx_fifo_head = 0;
+static uint8_t tx_fifo_count = 0;
+/// Timestamps dropped, the FIFO being full.
+static uint32_t tx_fifo_overflows = 0;
+
+/***************************************************************************//**
+ * Record the latency of a stage.
+ ******************************************************************************/
+void latency_trace_record(latency_trace_stage_t stage, uint32_t start)
+{
+  latency_trace_histogram_t *histo = &histograms[stage];
+  uint32_t latency_us;
+  uint32_t bucket;
+  CPU_SR_ALLOC();
+
+  latency_us = latency_trace_cycles_to_us(latency_trace_timestamp() - start);
+
+  /* Bucket n gathers the latencies in [2^(n-1), 2^n[ us */
+  bucket = (latency_us == 0) ? 0 : (32 - __CLZ(latency_us));
+  if (bucket >= LATENCY_TRACE_BUCKET_NB) {
+    bucket = LATENCY_TRACE_BUCKET_NB - 1;
+  }
+
+  CPU_CRITICAL_ENTER();
+  histo->buckets[bucket]++;
+  if ((histo->count == 0) || (latency_us < histo->min_us)) {
+    histo->min_us = latency_us;
+  }
+  if (latency_us > histo->max_us) {
+    histo->max_us = latency_us;
+  }
+  histo->total_us += latency_us;
+  histo->count++;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Store the timestamp of a frame queued to the WFX.
+ ******************************************************************************/
+void latency_trace_tx_queued(void)
+{
+  uint32_t now = latency_trace_timestamp();
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if (tx_fifo_count < LATENCY_TRACE_TX_FIFO_SIZE) {
+    tx_fifo[(tx_fifo_head + tx_fifo_count) % LATENCY_TRACE_TX_FIFO_SIZE] = now;
+    tx_fifo_count++;
+  } else {
+    tx_fifo_overflows++;
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Record the latency of the oldest frame queued to the WFX.
+ ******************************************************************************/
+void latency_trace_tx_confirmed(void)
+{
+  uint32_t start;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if (tx_fifo_count == 0) {
+    CPU_CRITICAL_EXIT();
+    return;
+  }
+  start = tx_fifo[tx_fifo_head];
+  tx_fifo_head = (tx_fifo_head + 1) % LATENCY_TRACE_TX_FIFO_SIZE;
+  tx_fifo_count--;
+  CPU_CRITICAL_EXIT();
+
+  latency_trace_record(LATENCY_TRACE_TX_CONFIRM, start);
+}
+
+/***************************************************************************//**
+ * Forget the timestamps of the frames waiting for a confirmation.
+ ******************************************************************************/
+void latency_trace_tx_flush(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  tx_fifo_head = 0;
+  tx_fifo_count = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Display the latency histograms.
+ ******************************************************************************/
+int latency_trace_display(void)
+{
+  latency_trace_histogram_t histo;
+  uint32_t overflows;
+  CPU_SR_ALLOC();
+
+  for (uint8_t stage = 0; stage < LATENCY_TRACE_STAGE_NB; stage++) {
+    CPU_CRITICAL_ENTER();
+    histo = histograms[stage];
+    CPU_CRITICAL_EXIT();
+
+    printf("%s: count %lu", stage_names[stage], histo.count);
+    if (histo.count > 0) {
+      printf(", min %lu us, avg %lu us, max %lu us",
+             histo.min_us,
+             (uint32_t)(histo.total_us / histo.count),
+             histo.max_us);
+    }
+    if (stage == LATENCY_TRACE_TX_CONFIRM) {
+      CPU_CRITICAL_ENTER();
+      overflows = tx_fifo_overflows;
+      CPU_CRITICAL_EXIT();
+      printf(", %lu timestamps dropped (FIFO full)", overflows);
+    }
+    printf("\r\n");
+
+    for (uint8_t i = 0; i < LATENCY_TRACE_BUCKET_NB; i++) {
+      if (histo.buckets[i] == 0) {
+        continue;
+      }
+      if (i == 0) {
+        printf("  [0, 1[ us: %lu\r\n", histo.buckets[i]);
+      } else if (i == (LATENCY_TRACE_BUCKET_NB - 1)) {
+        printf("  [%lu, +inf[ us: %lu\r\n", (1UL << (i - 1)), histo.buckets[i]);
+      } else {
+        printf("  [%lu, %lu[ us: %lu\r\n", (1UL << (i - 1)), (1UL << i), histo.buckets[i]);
+      }
+    }
+  }
+  return 0;
+}
+
+/***************************************************************************//**
+ * Reset the latency histograms.
+ ******************************************************************************/
+void latency_trace_reset(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  memset(histograms, 0, sizeof(histograms));
+  tx_fifo_overflows = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+#else
+
+/***************************************************************************//**
+ * Display the latency histograms.
+ ******************************************************************************/
+int latency_trace_display(void)
+{
+  return -1;
+}
+
+/***************************************************************************//**
+ * Reset the latency histograms.
+ ******************************************************************************/
+void latency_trace_reset(void)
+{
+}
+
+#endif
@@ -0,0 +1,131 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Enable the per-packet latency tracing in the host stack.
+/// When disabled, the trace points are compiled out.
+#ifndef LATENCY_TRACE_ENABLED
+#define LATENCY_TRACE_ENABLED       0
+#endif
+
+/// Number of log2 buckets per histogram, the last one gathers the overflows.
+#define LATENCY_TRACE_BUCKET_NB     20
+
+/// Number of TX timestamps waiting for a confirmation, bounds the TX window
+/// of ethernetif.c when the tracing is enabled.
+#define LATENCY_TRACE_TX_FIFO_SIZE  32
+
+/// Time (s) after which latency_trace_time_us() follows the kernel ticks,
+/// the cycle counter having possibly wrapped.
+#define LATENCY_TRACE_RESYNC_S      10
+
+/// Traced stages
+typedef enum {
+  LATENCY_TRACE_TX_ENQUEUE = 0,   ///< low_level_output() -> frame queued to the bus task
+  LATENCY_TRACE_TX_CONFIRM,       ///< frame queued -> SL_WFX_SEND_FRAME_CNF
+  LATENCY_TRACE_RX_INPUT,         ///< SL_WFX_RECEIVED_IND -> netif->input()
+  LATENCY_TRACE_STAGE_NB
+} latency_trace_stage_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Get a timestamp from the CPU cycle counter.
+ *
+ * @returns current timestamp in CPU cycles
+ ******************************************************************************/
+uint32_t latency_trace_timestamp(void);
+
+/***************************************************************************//**
+ * Convert a timestamp difference in microseconds.
+ *
+ * @param cycles number of CPU cycles
+ * @returns duration in microseconds
+ ******************************************************************************/
+uint32_t latency_trace_cycles_to_us(uint32_t cycles);
+
+/***************************************************************************//**
+ * Get a microsecond time from the CPU cycle counter, extended past its
+ * wrap with the kernel ticks when not read for LATENCY_TRACE_RESYNC_S.
+ *
+ * @returns current time in microseconds, wrapping
+ ******************************************************************************/
+uint32_t latency_trace_time_us(void);
+
+#if LATENCY_TRACE_ENABLED
+/***************************************************************************//**
+ * Record the latency of a stage.
+ *
+ * @param stage traced stage
+ * @param start timestamp taken at the beginning of the stage
+ ******************************************************************************/
+void latency_trace_record(latency_trace_stage_t stage, uint32_t start);
+
+/***************************************************************************//**
+ * Store the timestamp of a frame queued to the WFX, counted as an overflow
+ * if the FIFO is full.
+ ******************************************************************************/
+void latency_trace_tx_queued(void);
+
+/***************************************************************************//**
+ * Record the latency of the oldest frame queued to the WFX.
+ ******************************************************************************/
+void latency_trace_tx_confirmed(void);
+
+/***************************************************************************//**
+ * Forget the timestamps of the frames waiting for a confirmation.
+ ******************************************************************************/
+void latency_trace_tx_flush(void);
+
+#define LATENCY_TRACE_DECLARE(ts)           uint32_t ts
+#define LATENCY_TRACE_START(ts)             (ts) = latency_trace_timestamp()
+#define LATENCY_TRACE_STOP(stage, ts)       latency_trace_record((stage), (ts))
+#define LATENCY_TRACE_TX_QUEUED()           latency_trace_tx_queued()
+#define LATENCY_TRACE_TX_CONFIRMED()        latency_trace_tx_confirmed()
+#define LATENCY_TRACE_TX_FLUSH()            latency_trace_tx_flush()
+#else
+#define LATENCY_TRACE_DECLARE(ts)
+#define LATENCY_TRACE_START(ts)
+#define LATENCY_TRACE_STOP(stage, ts)
+#define LATENCY_TRACE_TX_QUEUED()
+#define LATENCY_TRACE_TX_CONFIRMED()
+#define LATENCY_TRACE_TX_FLUSH()
+#endif
+
+/***************************************************************************//**
+ * Display the latency histograms.
+ *
+ * @returns 0 if success, -1 if the tracing is disabled
+ ******************************************************************************/
+int latency_trace_display(void);
+
+/***************************************************************************//**
+ * Reset the latency histograms.
+ ******************************************************************************/
+void latency_trace_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -50,13 +50,16 @@
  */
 
 #include "lwiperf.h"
+#include "lwiperf_port.h"
 
 #include "lwip/tcp.h"
+#include "lwip/udp.h"
 #include "lwip/sys.h"
+#include "lwip/timeouts.h"
 
 #include <string.h>
 
-/* Currently, only TCP is implemented */
+/* TCP is required, UDP mode is added when LWIP_UDP is enabled */
 #if LWIP_TCP && LWIP_CALLBACK_API
 
 /** Specify the idle timeout (in seconds) after that the test fails */
@@ -67,6 +70,12 @@
 #error LWIPERF_TCP_MAX_IDLE_SEC must fit into an u8_t
 #endif
 
+/** Specify the time (in seconds) the listener of a dual or tradeoff client
+    waits for the remote host, after the test duration */
+#ifndef LWIPERF_TCP_MAX_ACCEPT_SEC
+#define LWIPERF_TCP_MAX_ACCEPT_SEC  LWIPERF_TCP_MAX_IDLE_SEC
+#endif
+
 /** Change this if you don't want to lwiperf to listen to any IP version */
 #ifndef LWIPERF_SERVER_IP_TYPE
 #define LWIPERF_SERVER_IP_TYPE      IPADDR_TYPE_ANY
@@ -84,6 +93,31 @@
 #define LWIPERF_CHECK_RX_DATA       0
 #endif
 
+/** Microsecond time source used for the UDP timestamps and jitter */
+#ifndef LWIPERF_TIME_US
+#define LWIPERF_TIME_US()           ((u32_t)sys_now() * 1000U)
+#endif
+
+/** Period (in milliseconds) of the UDP client transmissions */
+#ifndef LWIPERF_UDP_TICK_MS
+#define LWIPERF_UDP_TICK_MS         2U
+#endif
+
+/** Maximum number of datagrams sent by the UDP client per period */
+#ifndef LWIPERF_UDP_MAX_BURST
+#define LWIPERF_UDP_MAX_BURST       8U
+#endif
+
+/** Default UDP datagram length (iperf2 default) */
+#ifndef LWIPERF_UDP_DEFAULT_LEN
+#define LWIPERF_UDP_DEFAULT_LEN     1470U
+#endif
+
+/** Number of times the UDP client sends its final datagram until the
+    server report is received, and period between them (iperf2 values) */
+#define LWIPERF_UDP_FIN_RETRIES     10U
+#define LWIPERF_UDP_FIN_PERIOD_MS   250U
+
 /** This is the Iperf settings struct sent from the client */
 typedef struct _lwiperf_settings {
 #define LWIPERF_FLAGS_ANSWER_TEST 0x80000000
@@ -99,7 +133,7 @@ typedef struct _lwiperf_settings {
 typedef struct _lwiperf_state_base lwiperf_state_base_t;
 typedef union  _lwiperf_state_session lwiperf_state_session_t;
 typedef struct _lwiperf_state_tcp lwiperf_state_tcp_t;
-typedef struct _lwiperf_state_tcp lwiperf_state_udp_t;
+typedef struct _lwiperf_state_udp lwiperf_state_udp_t;
 
 /** Basic connection handle */
 struct _lwiperf_state_base {
@@ -132,21 +166,67 @@ struct _lwiperf_state_tcp {
   u8_t have_settings_buf;
   u8_t specific_remote;
   ip_addr_t remote_addr;
+  /* listener of a client: connections left to accept */
+  u8_t accept_count;
+  /* interval reports: period (0=none), start and bytes of the current interval */
+  u32_t report_interval_ms;
+  u32_t interval_start;
+  u32_t interval_bytes;
 };
 
+/** Header starting every iperf2 UDP datagram */
+typedef struct _lwiperf_udp_datagram {
+  s32_t id;
+  u32_t tv_sec;
+  u32_t tv_usec;
+} lwiperf_udp_datagram_t;
+
+/** Report appended by the server to the final datagram of an UDP test */
+typedef struct _lwiperf_udp_server_hdr {
+#define LWIPERF_UDP_HEADER_VERSION1 0x80000000
+  u32_t flags;
+  u32_t total_len1;
+  u32_t total_len2;
+  u32_t stop_sec;
+  u32_t stop_usec;
+  u32_t error_cnt;
+  u32_t outorder_cnt;
+  u32_t datagrams;
+  u32_t jitter1;
+  u32_t jitter2;
+} lwiperf_udp_server_hdr_t;
+
 /** Connection handle for an UDP iperf session */
 struct _lwiperf_state_udp {
   lwiperf_state_base_t base;
-  struct tcp_pcb *server_pcb;
-  struct tcp_pcb *conn_pcb;
+  struct udp_pcb *pcb;
   u32_t time_started;
-  lwiperf_report_fn report_fn;
+  u32_t time_last;
+  lwiperf_udp_report_fn report_fn;
   void *report_arg;
-  //TODO implement UDP test mode
+  u32_t bytes_transferred;
+  lwiperf_settings_t settings;
+  ip_addr_t remote_addr;
+  u16_t remote_port;
+  /* client: test parameters and state */
+  u32_t duration_ms;
+  u32_t bandwidth_bps;
+  u16_t datagram_len;
+  u8_t fin_count;
+  /* server: 1=a client is sending, 2=its test is done */
+  u8_t test_state;
+  s32_t packet_id;
+  lwiperf_udp_stats_t stats;
+  u32_t jitter_x16;
+  s32_t last_transit;
+  /* interval reports: period (0=none), start and bytes of the current interval */
+  u32_t report_interval_ms;
+  u32_t interval_start;
+  u32_t interval_bytes;
 };
 
 union _lwiperf_state_session {
-  lwiperf_state_udp_t *tcp_session;
+  lwiperf_state_tcp_t *tcp_session;
   lwiperf_state_udp_t *udp_session;
 };
 
@@ -198,6 +278,7 @@ static const u8_t lwiperf_txbuf_const[1600] = {
 
 static err_t lwiperf_tcp_poll(void *arg, struct tcp_pcb *tpcb);
 static void lwiperf_tcp_err(void *arg, err_t err);
+static void lwiperf_tcp_listener_tmr(void *arg);
 static err_t lwiperf_start_tcp_server_impl(const ip_addr_t *local_addr, u16_t local_port,
                                            lwiperf_report_fn report_fn, void *report_arg,
                                            lwiperf_state_base_t *related_master_state, lwiperf_state_tcp_t **state);
@@ -265,6 +346,30 @@ lwip_tcp_conn_report(lwiperf_state_tcp_t *conn, enum lwiperf_report_type report_
   }
 }
 
+/** Call the report function of an iperf tcp session when its report interval is over */
+static void
+lwiperf_tcp_interval_report(lwiperf_state_tcp_t *conn)
+{
+  u32_t now, duration_ms, bytes;
+
+  if ((conn->report_interval_ms == 0) || (conn->report_fn == NULL) || (conn->bytes_transferred == 0)) {
+    /* no interval report or test not started yet */
+    return;
+  }
+  now = sys_now();
+  duration_ms = now - conn->interval_start;
+  if (duration_ms < conn->report_interval_ms) {
+    return;
+  }
+  bytes = conn->bytes_transferred - conn->interval_bytes;
+  conn->report_fn(conn->report_arg, LWIPERF_INTERVAL,
+                  &conn->conn_pcb->local_ip, conn->conn_pcb->local_port,
+                  &conn->conn_pcb->remote_ip, conn->conn_pcb->remote_port,
+                  bytes, duration_ms, (u32_t)(((uint64_t)bytes * 8U) / duration_ms));
+  conn->interval_start = now;
+  conn->interval_bytes = conn->bytes_transferred;
+}
+
 /** Close an iperf tcp session */
 static void
 lwiperf_tcp_close(lwiperf_state_tcp_t *conn, enum lwiperf_report_type report_type)
@@ -286,6 +391,7 @@ lwiperf_tcp_close(lwiperf_state_tcp_t *conn, enum lwiperf_report_type report_typ
     }
   } else {
     /* no conn pcb, this is the listener pcb */
+    sys_untimeout(lwiperf_tcp_listener_tmr, conn);
     err = tcp_close(conn->server_pcb);
     LWIP_ASSERT("error", err == ERR_OK);
   }
@@ -382,6 +488,7 @@ lwiperf_tcp_client_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
 
   conn->poll_count = 0;
 
+  lwiperf_tcp_interval_report(conn);
   return lwiperf_tcp_client_send_more(conn);
 }
 
@@ -398,6 +505,7 @@ lwiperf_tcp_client_connected(void *arg, struct tcp_pcb *tpcb, err_t err)
   }
   conn->poll_count = 0;
   conn->time_started = sys_now();
+  conn->interval_start = conn->time_started;
   return lwiperf_tcp_client_send_more(conn);
 }
 
@@ -469,6 +577,7 @@ lwiperf_tx_start_passive(lwiperf_state_tcp_t *conn)
   if (ret == ERR_OK) {
     LWIP_ASSERT("new_conn != NULL", new_conn != NULL);
     new_conn->settings.flags = 0; /* prevent the remote side starting back as client again */
+    new_conn->report_interval_ms = conn->report_interval_ms;
   }
   return ret;
 }
@@ -542,6 +651,8 @@ lwiperf_tcp_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
     conn->bytes_transferred += sizeof(lwiperf_settings_t);
     if (conn->bytes_transferred <= 24) {
       conn->time_started = sys_now();
+      conn->interval_start = conn->time_started;
+      conn->interval_bytes = conn->bytes_transferred;
       tcp_recved(tpcb, p->tot_len);
       pbuf_free(p);
       return ERR_OK;
@@ -578,6 +689,7 @@ lwiperf_tcp_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
   conn->bytes_transferred += packet_idx;
   tcp_recved(tpcb, tot_len);
   pbuf_free(p);
+  lwiperf_tcp_interval_report(conn);
   return ERR_OK;
 }
 
@@ -602,6 +714,9 @@ lwiperf_tcp_poll(void *arg, struct tcp_pcb *tpcb)
     return ERR_OK; /* lwiperf_tcp_close frees conn */
   }
 
+  /* report the interval even when no data moved */
+  lwiperf_tcp_interval_report(conn);
+
   if (!conn->base.server) {
     lwiperf_tcp_client_send_more(conn);
   }
@@ -609,6 +724,16 @@ lwiperf_tcp_poll(void *arg, struct tcp_pcb *tpcb)
   return ERR_OK;
 }
 
+/** Timer of the listener of a client, the remote host did not connect back */
+static void
+lwiperf_tcp_listener_tmr(void *arg)
+{
+  lwiperf_state_tcp_t *s = (lwiperf_state_tcp_t *)arg;
+  /* the streams accepted so far report their own results */
+  s->report_fn = NULL;
+  lwiperf_tcp_close(s, LWIPERF_TCP_ABORTED_LOCAL);
+}
+
 /** This is called when a new client connects for an iperf tcp session */
 static err_t
 lwiperf_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
@@ -645,6 +770,8 @@ lwiperf_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
   conn->time_started = sys_now();
   conn->report_fn = s->report_fn;
   conn->report_arg = NULL;
+  conn->report_interval_ms = s->report_interval_ms;
+  conn->interval_start = conn->time_started;
 
   /* setup the tcp rx connection */
   tcp_arg(newpcb, conn);
@@ -655,8 +782,12 @@ lwiperf_tcp_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
   if (s->specific_remote) {
     /* this listener belongs to a client, so make the client the master of the newly created connection */
     conn->base.related_master_state = s->base.related_master_state;
-    /* if dual mode or (tradeoff mode AND client is done): close the listener */
-    if (!s->client_tradeoff_mode || !lwiperf_list_find(s->base.related_master_state)) {
+    if (s->accept_count > 0) {
+      s->accept_count--;
+    }
+    /* once every stream is back, if dual mode or (tradeoff mode AND client is done): close the listener */
+    if ((s->accept_count == 0)
+        && (!s->client_tradeoff_mode || !lwiperf_list_find(s->base.related_master_state))) {
       /* prevent report when closing: this is expected */
       s->report_fn = NULL;
       lwiperf_tcp_close(s, LWIPERF_TCP_ABORTED_LOCAL);
@@ -785,10 +916,34 @@ void* lwiperf_start_tcp_client_default(const ip_addr_t* remote_addr,
 void* lwiperf_start_tcp_client(const ip_addr_t* remote_addr, u16_t remote_port,
                                enum lwiperf_client_type type, u32_t duration_sec,
                                lwiperf_report_fn report_fn, void* report_arg)
+{
+  return lwiperf_start_tcp_client_streams(remote_addr, remote_port, type, duration_sec, 1,
+                                          report_fn, report_arg);
+}
+
+/**
+ * @ingroup iperf
+ * Start a TCP iperf client with parallel streams to a specific IP address
+ * and port. Each stream reports its own results, the first one is the
+ * master of the others.
+ *
+ * @param num_streams number of parallel streams, up to @ref LWIPERF_TCP_MAX_STREAMS
+ * @returns a connection handle that can be used to abort all the streams
+ *          by calling @ref lwiperf_abort()
+ */
+void* lwiperf_start_tcp_client_streams(const ip_addr_t* remote_addr, u16_t remote_port,
+                                       enum lwiperf_client_type type, u32_t duration_sec, u8_t num_streams,
+                                       lwiperf_report_fn report_fn, void* report_arg)
 {
   err_t ret;
+  u8_t i;
   lwiperf_settings_t settings;
   lwiperf_state_tcp_t *state = NULL;
+  lwiperf_state_tcp_t *stream = NULL;
+
+  if ((num_streams == 0) || (num_streams > LWIPERF_TCP_MAX_STREAMS)) {
+    return NULL;
+  }
 
   memset(&settings, 0, sizeof(settings));
   switch (type) {
@@ -808,7 +963,7 @@ void* lwiperf_start_tcp_client(const ip_addr_t* remote_addr, u16_t remote_port,
     /* invalid argument */
     return NULL;
   }
-  settings.num_threads = htonl(1);
+  settings.num_threads = htonl(num_streams);
   settings.remote_port = htonl(remote_port);
   /* Update the test duration */
   settings.amount = htonl((u32_t)-(duration_sec*1000/10));
@@ -816,6 +971,15 @@ void* lwiperf_start_tcp_client(const ip_addr_t* remote_addr, u16_t remote_port,
   ret = lwiperf_tx_start_impl(remote_addr, remote_port, &settings, report_fn, report_arg, NULL, &state);
   if (ret == ERR_OK) {
     LWIP_ASSERT("state != NULL", state != NULL);
+    for (i = 1; i < num_streams; i++) {
+      /* the other streams are aborted with the first one */
+      ret = lwiperf_tx_start_impl(remote_addr, remote_port, &settings, report_fn, report_arg,
+        &state->base, &stream);
+      if (ret != ERR_OK) {
+        lwiperf_abort(state);
+        return NULL;
+      }
+    }
     if (type != LWIPERF_CLIENT) {
       /* start corresponding server now */
       lwiperf_state_tcp_t *server = NULL;
@@ -826,20 +990,501 @@ void* lwiperf_start_tcp_client(const ip_addr_t* remote_addr, u16_t remote_port,
         lwiperf_abort(state);
         return NULL;
       }
-      /* make this server accept one connection only */
+      /* make this server accept one connection per stream only */
       server->specific_remote = 1;
       server->remote_addr = state->conn_pcb->remote_ip;
+      server->accept_count = num_streams;
       if (type == LWIPERF_TRADEOFF) {
         /* tradeoff means that the remote host connects only after the client is done,
            so keep the listen pcb open until the client is done */
         server->client_tradeoff_mode = 1;
       }
+      /* don't wait forever for a remote host that does not connect back */
+      sys_timeout((duration_sec + LWIPERF_TCP_MAX_ACCEPT_SEC) * 1000U, lwiperf_tcp_listener_tmr, server);
     }
     return state;
   }
   return NULL;
 }
 
+#if LWIP_UDP
+static void lwiperf_udp_client_tmr(void *arg);
+static void lwiperf_udp_server_tmr(void *arg);
+
+/** Call the report function of an iperf udp session */
+static void
+lwiperf_udp_conn_report(lwiperf_state_udp_t *conn, enum lwiperf_report_type report_type,
+                        u32_t duration_ms, const lwiperf_udp_stats_t *stats)
+{
+  u32_t bandwidth_kbitpsec;
+
+  if (conn->report_fn != NULL) {
+    if (duration_ms == 0) {
+      bandwidth_kbitpsec = 0;
+    } else {
+      bandwidth_kbitpsec = (conn->bytes_transferred / duration_ms) * 8U;
+    }
+    conn->report_fn(conn->report_arg, report_type,
+                    &conn->pcb->local_ip, conn->pcb->local_port,
+                    &conn->remote_addr, conn->remote_port,
+                    conn->bytes_transferred, duration_ms, bandwidth_kbitpsec, stats);
+  }
+}
+
+/** Call the report function of an iperf udp session when its report interval is over */
+static void
+lwiperf_udp_interval_report(lwiperf_state_udp_t *conn)
+{
+  u32_t now, duration_ms, bytes;
+
+  if ((conn->report_interval_ms == 0) || (conn->report_fn == NULL) || (conn->bytes_transferred == 0)) {
+    return;
+  }
+  now = sys_now();
+  duration_ms = now - conn->interval_start;
+  if (duration_ms < conn->report_interval_ms) {
+    return;
+  }
+  bytes = conn->bytes_transferred - conn->interval_bytes;
+  conn->report_fn(conn->report_arg, LWIPERF_INTERVAL,
+                  &conn->pcb->local_ip, conn->pcb->local_port,
+                  &conn->remote_addr, conn->remote_port,
+                  bytes, duration_ms, (u32_t)(((uint64_t)bytes * 8U) / duration_ms), NULL);
+  conn->interval_start = now;
+  conn->interval_bytes = conn->bytes_transferred;
+}
+
+/** Close an iperf udp session */
+static void
+lwiperf_udp_close(lwiperf_state_udp_t *conn, enum lwiperf_report_type report_type,
+                  const lwiperf_udp_stats_t *stats)
+{
+  lwiperf_list_remove(&conn->base);
+  if (conn->base.server) {
+    sys_untimeout(lwiperf_udp_server_tmr, conn);
+    if (conn->test_state == 1) {
+      /* a test was running, report what was received */
+      lwiperf_udp_conn_report(conn, report_type, conn->time_last - conn->time_started, &conn->stats);
+    }
+  } else {
+    sys_untimeout(lwiperf_udp_client_tmr, conn);
+    lwiperf_udp_conn_report(conn, report_type, conn->time_last - conn->time_started, stats);
+  }
+  udp_remove(conn->pcb);
+  LWIPERF_FREE(lwiperf_state_udp_t, conn);
+}
+
+/** Send an iperf udp datagram: header and settings followed by constant data */
+static err_t
+lwiperf_udp_client_send(lwiperf_state_udp_t *conn, s32_t id)
+{
+  err_t err;
+  struct pbuf *hdr;
+  struct pbuf *data;
+  lwiperf_udp_datagram_t *dgram;
+  u32_t now_us = LWIPERF_TIME_US();
+  u16_t hdr_len = sizeof(lwiperf_udp_datagram_t) + sizeof(lwiperf_settings_t);
+
+  hdr = pbuf_alloc(PBUF_TRANSPORT, hdr_len, PBUF_RAM);
+  if (hdr == NULL) {
+    return ERR_MEM;
+  }
+  dgram = (lwiperf_udp_datagram_t *)hdr->payload;
+  dgram->id = (s32_t)lwip_htonl((u32_t)id);
+  dgram->tv_sec = lwip_htonl(now_us / 1000000U);
+  dgram->tv_usec = lwip_htonl(now_us % 1000000U);
+  memcpy(dgram + 1, &conn->settings, sizeof(lwiperf_settings_t));
+
+  if (conn->datagram_len > hdr_len) {
+    /* no copy of the data: reference the const buffer */
+    data = pbuf_alloc(PBUF_RAW, (u16_t)(conn->datagram_len - hdr_len), PBUF_REF);
+    if (data == NULL) {
+      pbuf_free(hdr);
+      return ERR_MEM;
+    }
+    data->payload = LWIP_CONST_CAST(void *, lwiperf_txbuf_const);
+    pbuf_cat(hdr, data);
+  }
+
+  err = udp_sendto(conn->pcb, hdr, &conn->remote_addr, conn->remote_port);
+  pbuf_free(hdr);
+  return err;
+}
+
+/** UDP client timer: pace the datagrams, then request the server report */
+static void
+lwiperf_udp_client_tmr(void *arg)
+{
+  lwiperf_state_udp_t *conn = (lwiperf_state_udp_t *)arg;
+  u32_t now = sys_now();
+  u32_t elapsed_ms = now - conn->time_started;
+  u8_t burst = 0;
+
+  if (conn->fin_count == 0) {
+    if (elapsed_ms < conn->duration_ms) {
+      /* send the datagrams due at the requested bandwidth */
+      while ((burst < LWIPERF_UDP_MAX_BURST)
+             && (((uint64_t)conn->bytes_transferred * 8000U) <= ((uint64_t)conn->bandwidth_bps * elapsed_ms))) {
+        if (lwiperf_udp_client_send(conn, conn->packet_id) != ERR_OK) {
+          /* interface pushed back, retry on next period */
+          break;
+        }
+        conn->packet_id++;
+        conn->bytes_transferred += conn->datagram_len;
+        burst++;
+      }
+      conn->time_last = now;
+      lwiperf_udp_interval_report(conn);
+      sys_timeout(LWIPERF_UDP_TICK_MS, lwiperf_udp_client_tmr, conn);
+      return;
+    }
+  } else if (conn->fin_count >= LWIPERF_UDP_FIN_RETRIES) {
+    /* no server report */
+    lwiperf_udp_close(conn, LWIPERF_UDP_DONE_CLIENT, NULL);
+    return;
+  }
+
+  /* test is over: a negative id asks the server for its report */
+  conn->fin_count++;
+  lwiperf_udp_client_send(conn, -conn->packet_id);
+  sys_timeout(LWIPERF_UDP_FIN_PERIOD_MS, lwiperf_udp_client_tmr, conn);
+}
+
+/** UDP client: receive the server report */
+static void
+lwiperf_udp_client_recv(lwiperf_state_udp_t *conn, struct pbuf *p)
+{
+  lwiperf_udp_server_hdr_t hdr;
+  lwiperf_udp_stats_t stats;
+
+  if ((conn->fin_count == 0)
+      || (pbuf_copy_partial(p, &hdr, sizeof(hdr), sizeof(lwiperf_udp_datagram_t)) != sizeof(hdr))
+      || ((hdr.flags & PP_HTONL(LWIPERF_UDP_HEADER_VERSION1)) == 0)) {
+    return;
+  }
+  stats.datagrams = lwip_ntohl(hdr.datagrams);
+  stats.lost = lwip_ntohl(hdr.error_cnt);
+  stats.out_of_order = lwip_ntohl(hdr.outorder_cnt);
+  stats.jitter_us = lwip_ntohl(hdr.jitter1) * 1000000U + lwip_ntohl(hdr.jitter2);
+  lwiperf_udp_close(conn, LWIPERF_UDP_DONE_CLIENT, &stats);
+}
+
+/** UDP server: answer the final datagram of a test with the server report */
+static void
+lwiperf_udp_server_send_report(lwiperf_state_udp_t *conn, const lwiperf_udp_datagram_t *dgram)
+{
+  struct pbuf *p;
+  lwiperf_udp_server_hdr_t *hdr;
+  u32_t duration_ms = conn->time_last - conn->time_started;
+
+  p = pbuf_alloc(PBUF_TRANSPORT, sizeof(lwiperf_udp_datagram_t) + sizeof(lwiperf_udp_server_hdr_t), PBUF_RAM);
+  if (p == NULL) {
+    return;
+  }
+  memcpy(p->payload, dgram, sizeof(lwiperf_udp_datagram_t));
+  hdr = (lwiperf_udp_server_hdr_t *)((u8_t *)p->payload + sizeof(lwiperf_udp_datagram_t));
+  hdr->flags = PP_HTONL(LWIPERF_UDP_HEADER_VERSION1);
+  hdr->total_len1 = 0;
+  hdr->total_len2 = lwip_htonl(conn->bytes_transferred);
+  hdr->stop_sec = lwip_htonl(duration_ms / 1000U);
+  hdr->stop_usec = lwip_htonl((duration_ms % 1000U) * 1000U);
+  hdr->error_cnt = lwip_htonl(conn->stats.lost);
+  hdr->outorder_cnt = lwip_htonl(conn->stats.out_of_order);
+  hdr->datagrams = lwip_htonl(conn->stats.datagrams);
+  hdr->jitter1 = lwip_htonl(conn->stats.jitter_us / 1000000U);
+  hdr->jitter2 = lwip_htonl(conn->stats.jitter_us % 1000000U);
+  udp_sendto(conn->pcb, p, &conn->remote_addr, conn->remote_port);
+  pbuf_free(p);
+}
+
+/** UDP server: account a received datagram */
+static void
+lwiperf_udp_server_recv(lwiperf_state_udp_t *conn, struct pbuf *p, const lwiperf_udp_datagram_t *dgram,
+                        const ip_addr_t *addr, u16_t port)
+{
+  s32_t id = (s32_t)lwip_ntohl((u32_t)dgram->id);
+  u32_t now_us = LWIPERF_TIME_US();
+  s32_t transit;
+  u32_t delta;
+
+  if ((conn->test_state != 0)
+      && ((!ip_addr_cmp(addr, &conn->remote_addr)) || (port != conn->remote_port))) {
+    if ((conn->test_state == 1) || (id < 0)) {
+      /* one test at a time */
+      return;
+    }
+    /* previous test is done, accept a new client */
+    conn->test_state = 0;
+  }
+
+  if (id < 0) {
+    if (conn->test_state == 1) {
+      /* last datagram of the test: the loss count excludes the datagrams
+         received out of order, which were first counted as lost */
+      conn->test_state = 2;
+      if (-id > conn->packet_id + 1) {
+        /* the last datagrams were lost */
+        conn->stats.lost += (u32_t)(-id - conn->packet_id - 1);
+        conn->packet_id = -id - 1;
+      }
+      conn->stats.datagrams = (u32_t)(conn->packet_id + 1);
+      conn->stats.lost -= LWIP_MIN(conn->stats.lost, conn->stats.out_of_order);
+      conn->stats.jitter_us = conn->jitter_x16 / 16U;
+      lwiperf_udp_conn_report(conn, LWIPERF_UDP_DONE_SERVER, conn->time_last - conn->time_started, &conn->stats);
+    }
+    if (conn->test_state == 2) {
+      /* the client repeats its final datagram until it gets the report */
+      lwiperf_udp_server_send_report(conn, dgram);
+    }
+    return;
+  }
+
+  if (conn->test_state != 1) {
+    /* a new test starts */
+    conn->test_state = 1;
+    ip_addr_copy(conn->remote_addr, *addr);
+    conn->remote_port = port;
+    conn->time_started = sys_now();
+    conn->bytes_transferred = 0;
+    conn->interval_start = conn->time_started;
+    conn->interval_bytes = 0;
+    conn->packet_id = -1;
+    memset(&conn->stats, 0, sizeof(conn->stats));
+    conn->jitter_x16 = 0;
+    conn->last_transit = (s32_t)(now_us - (lwip_ntohl(dgram->tv_sec) * 1000000U + lwip_ntohl(dgram->tv_usec)));
+  }
+
+  conn->time_last = sys_now();
+  conn->bytes_transferred += p->tot_len;
+
+  /* RFC 1889 interarrival jitter: J += (|D| - J) / 16 */
+  transit = (s32_t)(now_us - (lwip_ntohl(dgram->tv_sec) * 1000000U + lwip_ntohl(dgram->tv_usec)));
+  delta = (u32_t)((transit > conn->last_transit) ? (transit - conn->last_transit) : (conn->last_transit - transit));
+  conn->last_transit = transit;
+  conn->jitter_x16 += delta - (conn->jitter_x16 / 16U);
+
+  if (id != conn->packet_id + 1) {
+    if (id < conn->packet_id + 1) {
+      conn->stats.out_of_order++;
+    } else {
+      conn->stats.lost += (u32_t)(id - conn->packet_id - 1);
+    }
+  }
+  if (id > conn->packet_id) {
+    conn->packet_id = id;
+  }
+
+  lwiperf_udp_interval_report(conn);
+}
+
+/** Receive a datagram on an iperf udp session */
+static void
+lwiperf_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  lwiperf_state_udp_t *conn = (lwiperf_state_udp_t *)arg;
+  lwiperf_udp_datagram_t dgram;
+
+  LWIP_UNUSED_ARG(pcb);
+
+  if (pbuf_copy_partial(p, &dgram, sizeof(dgram), 0) == sizeof(dgram)) {
+    if (conn->base.server) {
+      lwiperf_udp_server_recv(conn, p, &dgram, addr, port);
+    } else {
+      lwiperf_udp_client_recv(conn, p);
+    }
+  }
+  pbuf_free(p);
+}
+
+/** UDP server timer: abort a test when the client stops sending */
+static void
+lwiperf_udp_server_tmr(void *arg)
+{
+  lwiperf_state_udp_t *conn = (lwiperf_state_udp_t *)arg;
+
+  if ((conn->test_state == 1)
+      && ((sys_now() - conn->time_last) >= (LWIPERF_TCP_MAX_IDLE_SEC * 1000U))) {
+    conn->test_state = 0;
+    conn->stats.datagrams = (u32_t)(conn->packet_id + 1);
+    conn->stats.lost -= LWIP_MIN(conn->stats.lost, conn->stats.out_of_order);
+    conn->stats.jitter_us = conn->jitter_x16 / 16U;
+    lwiperf_udp_conn_report(conn, LWIPERF_UDP_ABORTED_IDLE, conn->time_last - conn->time_started, &conn->stats);
+  }
+  sys_timeout(1000U, lwiperf_udp_server_tmr, conn);
+}
+
+/** Allocate an iperf udp session */
+static lwiperf_state_udp_t *
+lwiperf_udp_new(u8_t server, u8_t ip_type, lwiperf_udp_report_fn report_fn, void *report_arg)
+{
+  lwiperf_state_udp_t *conn;
+
+  conn = (lwiperf_state_udp_t *)LWIPERF_ALLOC(lwiperf_state_udp_t);
+  if (conn == NULL) {
+    return NULL;
+  }
+  memset(conn, 0, sizeof(lwiperf_state_udp_t));
+  conn->pcb = udp_new_ip_type(ip_type);
+  if (conn->pcb == NULL) {
+    LWIPERF_FREE(lwiperf_state_udp_t, conn);
+    return NULL;
+  }
+  conn->base.tcp = 0;
+  conn->base.server = server;
+  conn->base.conn_session = (lwiperf_state_session_t *)conn;
+  conn->report_fn = report_fn;
+  conn->report_arg = report_arg;
+  udp_recv(conn->pcb, lwiperf_udp_recv, conn);
+  return conn;
+}
+
+/**
+ * @ingroup iperf
+ * Start an UDP iperf server on a specific IP address and port and wait for
+ * datagrams from iperf clients, one test at a time.
+ *
+ * @returns a connection handle that can be used to abort the server
+ *          by calling @ref lwiperf_abort()
+ */
+void *
+lwiperf_start_udp_server(const ip_addr_t *local_addr, u16_t local_port,
+                         lwiperf_udp_report_fn report_fn, void *report_arg)
+{
+  lwiperf_state_udp_t *conn;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if (local_addr == NULL) {
+    return NULL;
+  }
+  conn = lwiperf_udp_new(1, LWIPERF_SERVER_IP_TYPE, report_fn, report_arg);
+  if (conn == NULL) {
+    return NULL;
+  }
+  if (udp_bind(conn->pcb, local_addr, local_port) != ERR_OK) {
+    udp_remove(conn->pcb);
+    LWIPERF_FREE(lwiperf_state_udp_t, conn);
+    return NULL;
+  }
+  sys_timeout(1000U, lwiperf_udp_server_tmr, conn);
+  lwiperf_list_add(&conn->base);
+  return conn;
+}
+
+/**
+ * @ingroup iperf
+ * Start an UDP iperf client to a specific IP address and port.
+ *
+ * @param bandwidth_bps target bandwidth in bits per second
+ * @param datagram_len UDP payload length, 0 for the default length
+ * @returns a connection handle that can be used to abort the client
+ *          by calling @ref lwiperf_abort()
+ */
+void *
+lwiperf_start_udp_client(const ip_addr_t *remote_addr, u16_t remote_port,
+                         u32_t duration_sec, u32_t bandwidth_bps, u16_t datagram_len,
+                         lwiperf_udp_report_fn report_fn, void *report_arg)
+{
+  lwiperf_state_udp_t *conn;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if (datagram_len == 0) {
+    datagram_len = LWIPERF_UDP_DEFAULT_LEN;
+  }
+  if ((remote_addr == NULL) || (bandwidth_bps == 0)
+      || (datagram_len < (sizeof(lwiperf_udp_datagram_t) + sizeof(lwiperf_settings_t)))
+      || (datagram_len > LWIPERF_UDP_MAX_LEN)) {
+    return NULL;
+  }
+  conn = lwiperf_udp_new(0, IP_GET_TYPE(remote_addr), report_fn, report_arg);
+  if (conn == NULL) {
+    return NULL;
+  }
+  ip_addr_copy(conn->remote_addr, *remote_addr);
+  conn->remote_port = remote_port;
+  conn->duration_ms = duration_sec * 1000U;
+  conn->bandwidth_bps = bandwidth_bps;
+  conn->datagram_len = datagram_len;
+  conn->settings.num_threads = PP_HTONL(1);
+  conn->settings.remote_port = lwip_htonl(remote_port);
+  conn->settings.buffer_len = lwip_htonl(datagram_len);
+  conn->settings.win_band = lwip_htonl(bandwidth_bps);
+  conn->settings.amount = lwip_htonl((u32_t) - (s32_t)(duration_sec * 1000 / 10));
+  conn->time_started = sys_now();
+  conn->time_last = conn->time_started;
+  conn->interval_start = conn->time_started;
+
+  lwiperf_list_add(&conn->base);
+  lwiperf_udp_client_tmr(conn);
+  return conn;
+}
+#endif /* LWIP_UDP */
+
+/** Abort a session started on the behalf of another one */
+static void
+lwiperf_abort_related(lwiperf_state_tcp_t *conn)
+{
+  if (conn->conn_pcb == NULL) {
+    /* listener waiting for the streams of a client: its closing is
+       expected and is not a test result */
+    conn->report_fn = NULL;
+  }
+  lwiperf_tcp_close(conn, LWIPERF_TCP_ABORTED_LOCAL);
+}
+
+/**
+ * @ingroup iperf
+ * Set the report interval of an iperf session (handle returned by
+ * lwiperf_start_*()), the report function is then called with
+ * @ref LWIPERF_INTERVAL at this period while a test is running.
+ * The connections accepted by a server and the sessions started on the
+ * behalf of a client get the interval of their master session.
+ *
+ * @param interval_ms report period in milliseconds, 0 to disable the reports
+ */
+void
+lwiperf_set_report_interval(void *lwiperf_session, u32_t interval_ms)
+{
+  lwiperf_state_base_t *i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  for (i = lwiperf_all_connections; i != NULL; i = i->next) {
+    if ((i == lwiperf_session) || (i->related_master_state == lwiperf_session)) {
+      if (i->tcp) {
+        ((lwiperf_state_tcp_t *)i->conn_session)->report_interval_ms = interval_ms;
+#if LWIP_UDP
+      } else {
+        ((lwiperf_state_udp_t *)i->conn_session)->report_interval_ms = interval_ms;
+#endif /* LWIP_UDP */
+      }
+    }
+  }
+}
+
+/**
+ * @ingroup iperf
+ * Tell whether an iperf session (handle returned by lwiperf_start_*()) or a
+ * session started on its behalf (other streams, listener and connections
+ * back from the remote host of a dual or tradeoff client) is still running.
+ * Called from a report function, the reporting session is not running anymore.
+ */
+u8_t
+lwiperf_is_running(void *lwiperf_session)
+{
+  lwiperf_state_base_t *i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  for (i = lwiperf_all_connections; i != NULL; i = i->next) {
+    if ((i == lwiperf_session) || (i->related_master_state == lwiperf_session)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
 /**
  * @ingroup iperf
  * Abort an iperf session (handle returned by lwiperf_start_tcp_server*())
@@ -847,13 +1492,33 @@ void* lwiperf_start_tcp_client(const ip_addr_t* remote_addr, u16_t remote_port,
 void
 lwiperf_abort(void *lwiperf_session)
 {
-  lwiperf_state_base_t *i;
+  lwiperf_state_base_t *i, *next;
   lwiperf_state_tcp_t *session = (lwiperf_state_tcp_t *)lwiperf_session;
 
   LWIP_ASSERT_CORE_LOCKED();
 
+  if (lwiperf_list_find((lwiperf_state_base_t *)lwiperf_session) == NULL) {
+    /* the master session is done (e.g. first stream of a client),
+       abort the sessions still running on its behalf */
+    for (i = lwiperf_all_connections; i != NULL; i = next) {
+      next = i->next;
+      if (i->related_master_state == lwiperf_session) {
+        lwiperf_abort_related((lwiperf_state_tcp_t *)i->conn_session);
+      }
+    }
+    return;
+  }
+
+#if LWIP_UDP
+  if (!session->base.tcp) {
+    lwiperf_udp_close((lwiperf_state_udp_t *)lwiperf_session, LWIPERF_UDP_ABORTED_LOCAL, NULL);
+    return;
+  }
+#endif /* LWIP_UDP */
+
   if (session->server_pcb != NULL) {
-    for (i = lwiperf_all_connections; i != NULL; i = i->next) {
+    for (i = lwiperf_all_connections; i != NULL; i = next) {
+      next = i->next;
       if (i->related_master_state == lwiperf_session) {
         lwiperf_tcp_close((lwiperf_state_tcp_t *)i->conn_session,
                           LWIPERF_TCP_ABORTED_LOCAL);
@@ -861,10 +1526,13 @@ lwiperf_abort(void *lwiperf_session)
     }
   }
 
-  for (i = lwiperf_all_connections; i != NULL; i = i->next) {
-    if ((i == lwiperf_session) || (i->related_master_state == lwiperf_session)) {
+  for (i = lwiperf_all_connections; i != NULL; i = next) {
+    next = i->next;
+    if (i == lwiperf_session) {
       lwiperf_tcp_close((lwiperf_state_tcp_t *)i->conn_session,
                         LWIPERF_TCP_ABORTED_LOCAL);
+    } else if (i->related_master_state == lwiperf_session) {
+      lwiperf_abort_related((lwiperf_state_tcp_t *)i->conn_session);
     }
   }
 }
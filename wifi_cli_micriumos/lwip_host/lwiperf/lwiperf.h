@@ -45,6 +45,15 @@ extern "C" {
 #endif
 
 #define LWIPERF_TCP_PORT_DEFAULT  5001
+#define LWIPERF_UDP_PORT_DEFAULT  5001
+
+/** Maximum UDP datagram length fitting in an Ethernet frame */
+#define LWIPERF_UDP_MAX_LEN       1472U
+
+/** Maximum number of parallel streams of a TCP client */
+#ifndef LWIPERF_TCP_MAX_STREAMS
+#define LWIPERF_TCP_MAX_STREAMS     4
+#endif
 
 /** lwIPerf test results */
 enum lwiperf_report_type
@@ -60,7 +69,17 @@ enum lwiperf_report_type
   /** Transmit error lead to test abort */
   LWIPERF_TCP_ABORTED_LOCAL_TXERROR,
   /** Remote side aborted the test */
-  LWIPERF_TCP_ABORTED_REMOTE
+  LWIPERF_TCP_ABORTED_REMOTE,
+  /** The UDP server side test is done */
+  LWIPERF_UDP_DONE_SERVER,
+  /** The UDP client side test is done */
+  LWIPERF_UDP_DONE_CLIENT,
+  /** Local stop or error lead to UDP test abort */
+  LWIPERF_UDP_ABORTED_LOCAL,
+  /** The UDP peer stopped sending before the end of the test */
+  LWIPERF_UDP_ABORTED_IDLE,
+  /** A report interval of a running test is over */
+  LWIPERF_INTERVAL
 };
 
 /** Control */
@@ -76,20 +95,54 @@ enum lwiperf_client_type
 
 /** Prototype of a report function that is called when a session is finished.
     This report function can show the test results.
+    It is also called with @ref LWIPERF_INTERVAL at the end of each report
+    interval, the bytes, duration and bandwidth then cover the interval only.
     @param report_type contains the test result */
 typedef void (*lwiperf_report_fn)(void *arg, enum lwiperf_report_type report_type,
   const ip_addr_t* local_addr, u16_t local_port, const ip_addr_t* remote_addr, u16_t remote_port,
   u32_t bytes_transferred, u32_t ms_duration, u32_t bandwidth_kbitpsec);
 
+/** UDP test statistics measured by the server */
+typedef struct _lwiperf_udp_stats
+{
+  /** Number of datagrams sent by the client */
+  u32_t datagrams;
+  /** Number of datagrams lost */
+  u32_t lost;
+  /** Number of datagrams received out of order */
+  u32_t out_of_order;
+  /** Interarrival jitter (RFC 1889) in microseconds */
+  u32_t jitter_us;
+} lwiperf_udp_stats_t;
+
+/** Prototype of a report function that is called when an UDP session is finished.
+    @param udp_stats contains the server statistics, NULL if the client
+                     did not get the server report */
+typedef void (*lwiperf_udp_report_fn)(void *arg, enum lwiperf_report_type report_type,
+  const ip_addr_t* local_addr, u16_t local_port, const ip_addr_t* remote_addr, u16_t remote_port,
+  u32_t bytes_transferred, u32_t ms_duration, u32_t bandwidth_kbitpsec,
+  const lwiperf_udp_stats_t *udp_stats);
+
 void* lwiperf_start_tcp_server(const ip_addr_t* local_addr, u16_t local_port,
                                lwiperf_report_fn report_fn, void* report_arg);
 void* lwiperf_start_tcp_server_default(lwiperf_report_fn report_fn, void* report_arg);
 void* lwiperf_start_tcp_client(const ip_addr_t* remote_addr, u16_t remote_port,
                                enum lwiperf_client_type type, u32_t duration_sec,
                                lwiperf_report_fn report_fn, void* report_arg);
+void* lwiperf_start_tcp_client_streams(const ip_addr_t* remote_addr, u16_t remote_port,
+                               enum lwiperf_client_type type, u32_t duration_sec, u8_t num_streams,
+                               lwiperf_report_fn report_fn, void* report_arg);
 void* lwiperf_start_tcp_client_default(const ip_addr_t* remote_addr, u32_t duration_sec,
                                lwiperf_report_fn report_fn, void* report_arg);
 
+void* lwiperf_start_udp_server(const ip_addr_t* local_addr, u16_t local_port,
+                               lwiperf_udp_report_fn report_fn, void* report_arg);
+void* lwiperf_start_udp_client(const ip_addr_t* remote_addr, u16_t remote_port,
+                               u32_t duration_sec, u32_t bandwidth_bps, u16_t datagram_len,
+                               lwiperf_udp_report_fn report_fn, void* report_arg);
+
+void  lwiperf_set_report_interval(void* lwiperf_session, u32_t interval_ms);
+u8_t  lwiperf_is_running(void* lwiperf_session);
 void  lwiperf_abort(void* lwiperf_session);
 
 
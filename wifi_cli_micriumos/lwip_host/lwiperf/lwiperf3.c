@@ -0,0 +1,1449 @@
+/**
+ * @file
+ * lwIP iPerf3 client/server implementation
+ */
+
+/**
+ * @defgroup iperf3 Iperf3 client/server
+ * @ingroup apps
+ *
+ * This is a minimal implementation of the iPerf3 protocol to measure the
+ * bandwidth against a stock iperf3 on a PC as server/client.
+ *
+ * A test is driven by a TCP control connection:
+ * - the client sends a cookie identifying the test,
+ * - the parameters are exchanged in JSON (length-prefixed),
+ * - the client connects the data streams (TCP: cookie, UDP: connect message),
+ * - the data flows until the client ends the test,
+ * - both sides exchange their results in JSON.
+ *
+ * Only the TCP and UDP tests, in normal or reverse mode, are supported.
+ * The server runs one test at a time.
+ */
+
+/*
+ * Copyright 2022 Silicon Laboratories Inc. www.silabs.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lwiperf3.h"
+#include "lwiperf_port.h"
+
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The control channel and the TCP streams require TCP, UDP is needed for the UDP tests */
+#if LWIP_TCP && LWIP_UDP && LWIP_CALLBACK_API
+
+/** Specify the idle timeout (in seconds) of the control connection out of the data transfer */
+#ifndef LWIPERF3_MAX_IDLE_SEC
+#define LWIPERF3_MAX_IDLE_SEC       10U
+#endif
+#if LWIPERF3_MAX_IDLE_SEC > 255
+#error LWIPERF3_MAX_IDLE_SEC must fit into an u8_t
+#endif
+
+/** Maximum length of the JSON parameters and results */
+#ifndef LWIPERF3_JSON_MAX_LEN
+#define LWIPERF3_JSON_MAX_LEN       1024
+#endif
+
+/** IP type the server listens on */
+#ifndef LWIPERF3_SERVER_IP_TYPE
+#define LWIPERF3_SERVER_IP_TYPE     IPADDR_TYPE_ANY
+#endif
+
+/** Sessions running at the same time: a server and a client */
+#ifndef LWIPERF3_MAX_SESSIONS
+#define LWIPERF3_MAX_SESSIONS       2
+#endif
+
+/* File internal memory allocation (struct lwiperf3_*): this defaults to
+   a static pool, the JSON buffers of a session being too large for the
+   lwIP heap */
+#ifndef LWIPERF3_ALLOC
+#define LWIPERF3_ALLOC(type)        lwiperf3_session_alloc()
+#define LWIPERF3_FREE(type, item)   lwiperf3_session_free(item)
+#define LWIPERF3_SESSION_POOL       1
+#endif
+
+/** Length of the test cookie, including the terminating null character */
+#define LWIPERF3_COOKIE_SIZE        37
+
+/** iPerf3 default lengths and UDP bandwidth */
+#define LWIPERF3_TCP_DEFAULT_LEN    (128 * 1024)
+#define LWIPERF3_UDP_DEFAULT_LEN    1460
+#define LWIPERF3_UDP_MAX_LEN        1472
+#define LWIPERF3_UDP_DEFAULT_BANDWIDTH 1000000
+
+/** UDP datagrams pacing period and maximum burst per stream */
+#define LWIPERF3_UDP_TICK_MS        2
+#define LWIPERF3_UDP_MAX_BURST      8
+
+/** UDP stream connection message and reply */
+#define LWIPERF3_UDP_CONNECT_MSG    0x36373839
+#define LWIPERF3_UDP_CONNECT_REPLY  0x39383736
+
+#if TCP_MSS > LWIPERF3_UDP_MAX_LEN
+#error TCP_MSS must not exceed the iPerf3 transmit buffer
+#endif
+
+/** Current time in microseconds, for the UDP timestamps and jitter */
+#ifdef LWIPERF_TIME_US
+#define LWIPERF3_TIME_US()          LWIPERF_TIME_US()
+#else
+#define LWIPERF3_TIME_US()          ((u32_t)sys_now() * 1000U)
+#endif
+
+/** iPerf3 control states */
+#define LWIPERF3_IDLE               0
+#define LWIPERF3_TEST_START         1
+#define LWIPERF3_TEST_RUNNING       2
+#define LWIPERF3_TEST_END           4
+#define LWIPERF3_PARAM_EXCHANGE     9
+#define LWIPERF3_CREATE_STREAMS     10
+#define LWIPERF3_SERVER_TERMINATE   11
+#define LWIPERF3_CLIENT_TERMINATE   12
+#define LWIPERF3_EXCHANGE_RESULTS   13
+#define LWIPERF3_DISPLAY_RESULTS    14
+#define LWIPERF3_IPERF_DONE         16
+#define LWIPERF3_ACCESS_DENIED      (-1)
+#define LWIPERF3_SERVER_ERROR       (-2)
+
+/** What is expected next on the control connection */
+enum lwiperf3_rx {
+  LWIPERF3_RX_COOKIE,
+  LWIPERF3_RX_STATE,
+  LWIPERF3_RX_JSON_LEN,
+  LWIPERF3_RX_JSON,
+  LWIPERF3_RX_ERROR
+};
+
+/** Header starting every iPerf3 UDP datagram */
+typedef struct _lwiperf3_udp_datagram {
+  u32_t sec;
+  u32_t usec;
+  u32_t pcount;
+} lwiperf3_udp_datagram_t;
+
+struct _lwiperf3_session;
+
+/** Data stream of an iPerf3 test */
+typedef struct _lwiperf3_stream {
+  struct _lwiperf3_session *session;
+  struct tcp_pcb *tcp_pcb;
+  /* client: UDP stream */
+  struct udp_pcb *udp_pcb;
+  /* server: UDP stream peer */
+  ip_addr_t remote_addr;
+  u16_t remote_port;
+  /* 1=cookie checked (server TCP) or connect reply received (UDP) */
+  u8_t connected;
+  /* server TCP: cookie bytes checked */
+  u8_t cookie_rx;
+  u32_t bytes_transferred;
+  /* UDP: sent datagrams (sender) or highest received counter (receiver) */
+  u32_t packet_count;
+  u32_t errors;
+  u32_t out_of_order;
+  u32_t jitter_x16;
+  s32_t last_transit;
+} lwiperf3_stream_t;
+
+/** Connection handle for an iPerf3 client or server */
+typedef struct _lwiperf3_session {
+  u8_t server;
+  /* last state sent or received */
+  s8_t state;
+  u8_t rx_expect;
+  u16_t rx_count;
+  u32_t json_len;
+  u8_t rx_buf[8];
+  u8_t idle_count;
+  u8_t sending;
+  u8_t have_params;
+  u8_t have_peer_json;
+  u8_t num_connected;
+  enum lwiperf_report_type report_type;
+  struct tcp_pcb *listen_pcb;
+  struct tcp_pcb *ctrl_pcb;
+  /* server: UDP streams */
+  struct udp_pcb *udp_pcb;
+  u16_t local_port;
+  ip_addr_t remote_addr;
+  u16_t remote_port;
+  lwiperf3_params_t params;
+  lwiperf3_stream_t streams[LWIPERF_TCP_MAX_STREAMS];
+  u32_t time_started;
+  u32_t time_ended;
+  lwiperf3_report_fn report_fn;
+  void *report_arg;
+  char cookie[LWIPERF3_COOKIE_SIZE];
+  char peer_json[LWIPERF3_JSON_MAX_LEN];
+  char local_json[LWIPERF3_JSON_MAX_LEN];
+} lwiperf3_session_t;
+
+/** Data sent by the TCP streams (no copy) and the UDP datagrams */
+static const u8_t lwiperf3_txbuf[LWIPERF3_UDP_MAX_LEN];
+
+#ifdef LWIPERF3_SESSION_POOL
+static lwiperf3_session_t lwiperf3_sessions[LWIPERF3_MAX_SESSIONS];
+static u8_t lwiperf3_sessions_used[LWIPERF3_MAX_SESSIONS];
+
+/** Take a session from the pool */
+static lwiperf3_session_t *
+lwiperf3_session_alloc(void)
+{
+  u8_t i;
+
+  for (i = 0; i < LWIPERF3_MAX_SESSIONS; i++) {
+    if (!lwiperf3_sessions_used[i]) {
+      lwiperf3_sessions_used[i] = 1;
+      return &lwiperf3_sessions[i];
+    }
+  }
+  return NULL;
+}
+
+/** Give a session back to the pool */
+static void
+lwiperf3_session_free(lwiperf3_session_t *s)
+{
+  lwiperf3_sessions_used[s - lwiperf3_sessions] = 0;
+}
+#endif /* LWIPERF3_SESSION_POOL */
+
+static err_t lwiperf3_ctrl_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+static void lwiperf3_ctrl_err(void *arg, err_t err);
+static err_t lwiperf3_ctrl_poll(void *arg, struct tcp_pcb *tpcb);
+static void lwiperf3_client_end_tmr(void *arg);
+static void lwiperf3_udp_tmr(void *arg);
+
+/** Identifier of a stream as iperf3 numbers them */
+static u32_t
+lwiperf3_stream_id(u8_t index)
+{
+  return (index == 0) ? 1 : (u32_t)index + 2;
+}
+
+/** 1 if the local side sends the data */
+static u8_t
+lwiperf3_is_sender(const lwiperf3_session_t *s)
+{
+  return s->server ? s->params.reverse : !s->params.reverse;
+}
+
+/** Generate the cookie of a client test */
+static void
+lwiperf3_make_cookie(lwiperf3_session_t *s)
+{
+  static const char charset[] = "abcdefghijklmnopqrstuvwxyz234567";
+  u32_t seed = sys_now() ^ (u32_t)(mem_ptr_t)s;
+  u8_t i;
+
+  for (i = 0; i < LWIPERF3_COOKIE_SIZE - 1; i++) {
+    seed = seed * 1103515245U + 12345U;
+    s->cookie[i] = charset[(seed >> 16) % (sizeof(charset) - 1)];
+  }
+  s->cookie[LWIPERF3_COOKIE_SIZE - 1] = '\0';
+}
+
+/*
+ * Minimal JSON reader: the iPerf3 messages are flat objects, plus the
+ * 'streams' array of the results.
+ */
+
+/** Find the value of a key, searching from json */
+static const char *
+lwiperf3_json_find(const char *json, const char *key)
+{
+  size_t key_len = strlen(key);
+  const char *p = json;
+  const char *end;
+
+  while ((p = strchr(p, '"')) != NULL) {
+    end = strchr(p + 1, '"');
+    if (end == NULL) {
+      return NULL;
+    }
+    if (((size_t)(end - p - 1) == key_len) && (strncmp(p + 1, key, key_len) == 0)) {
+      p = end + 1;
+      while (*p == ' ') {
+        p++;
+      }
+      if (*p == ':') {
+        p++;
+        while (*p == ' ') {
+          p++;
+        }
+        return p;
+      }
+    }
+    p = end + 1;
+  }
+  return NULL;
+}
+
+/** Get an integer value, default_value if the key is missing */
+static u32_t
+lwiperf3_json_u32(const char *json, const char *key, u32_t default_value)
+{
+  const char *value = lwiperf3_json_find(json, key);
+
+  if ((value == NULL) || (*value < '0') || (*value > '9')) {
+    return default_value;
+  }
+  return (u32_t)strtoul(value, NULL, 10);
+}
+
+/** Get a boolean value, 0 if the key is missing */
+static u8_t
+lwiperf3_json_bool(const char *json, const char *key)
+{
+  const char *value = lwiperf3_json_find(json, key);
+
+  return (value != NULL) && (strncmp(value, "true", 4) == 0);
+}
+
+/** Convert a number of seconds (possibly with a fraction and an exponent) to microseconds */
+static u32_t
+lwiperf3_json_seconds_to_us(const char *value)
+{
+  uint64_t mantissa = 0;
+  int scale = 6;
+  u8_t fraction = 0;
+
+  for (; ((*value >= '0') && (*value <= '9')) || (*value == '.'); value++) {
+    if (*value == '.') {
+      fraction = 1;
+    } else if (mantissa < 100000000000000ULL) {
+      mantissa = mantissa * 10 + (u32_t)(*value - '0');
+      scale -= fraction;
+    } else if (!fraction) {
+      scale++;
+    }
+  }
+  if ((*value == 'e') || (*value == 'E')) {
+    scale += (int)strtol(value + 1, NULL, 10);
+  }
+  for (; (scale > 0) && (mantissa < 100000000000000ULL); scale--) {
+    mantissa *= 10;
+  }
+  for (; scale < 0; scale++) {
+    mantissa /= 10;
+  }
+  return (mantissa > 0xFFFFFFFFUL) ? 0xFFFFFFFFUL : (u32_t)mantissa;
+}
+
+/** Sum a value over the streams of iPerf3 results */
+static u32_t
+lwiperf3_json_streams_sum(const char *json, const char *key)
+{
+  const char *value = strstr(json, "\"streams\"");
+  u32_t sum = 0;
+
+  while ((value != NULL) && ((value = lwiperf3_json_find(value, key)) != NULL)) {
+    sum += (u32_t)strtoul(value, NULL, 10);
+  }
+  return sum;
+}
+
+/** Maximum of a duration (in seconds) over the streams of iPerf3 results, in microseconds */
+static u32_t
+lwiperf3_json_streams_max_us(const char *json, const char *key)
+{
+  const char *value = strstr(json, "\"streams\"");
+  u32_t max_us = 0;
+
+  while ((value != NULL) && ((value = lwiperf3_json_find(value, key)) != NULL)) {
+    max_us = LWIP_MAX(max_us, lwiperf3_json_seconds_to_us(value));
+  }
+  return max_us;
+}
+
+/** Send a state on the control connection */
+static err_t
+lwiperf3_ctrl_send_state(lwiperf3_session_t *s, s8_t state)
+{
+  err_t err;
+
+  s->state = state;
+  err = tcp_write(s->ctrl_pcb, &state, 1, TCP_WRITE_FLAG_COPY);
+  if (err == ERR_OK) {
+    err = tcp_output(s->ctrl_pcb);
+  }
+  return err;
+}
+
+/** Send a length-prefixed JSON message on the control connection */
+static err_t
+lwiperf3_ctrl_send_json(lwiperf3_session_t *s, const char *json)
+{
+  u32_t len = (u32_t)strlen(json);
+  u32_t len_be = lwip_htonl(len);
+  err_t err;
+
+  err = tcp_write(s->ctrl_pcb, &len_be, sizeof(len_be), TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+  if (err == ERR_OK) {
+    err = tcp_write(s->ctrl_pcb, json, (u16_t)len, TCP_WRITE_FLAG_COPY);
+  }
+  if (err == ERR_OK) {
+    err = tcp_output(s->ctrl_pcb);
+  }
+  return err;
+}
+
+/** Build the parameters of a client test */
+static void
+lwiperf3_build_params(lwiperf3_session_t *s)
+{
+  const lwiperf3_params_t *params = &s->params;
+  int len;
+
+  len = snprintf(s->local_json, LWIPERF3_JSON_MAX_LEN,
+                 "{\"%s\":true,\"omit\":0,\"time\":%lu,\"num\":0,\"blockcount\":0,"
+                 "\"parallel\":%u,\"len\":%lu",
+                 params->udp ? "udp" : "tcp",
+                 (unsigned long)params->duration_sec,
+                 params->num_streams,
+                 (unsigned long)params->len);
+  if (params->udp) {
+    len += snprintf(s->local_json + len, LWIPERF3_JSON_MAX_LEN - len,
+                    ",\"bandwidth\":%lu", (unsigned long)params->bandwidth_bps);
+  }
+  if (params->reverse) {
+    len += snprintf(s->local_json + len, LWIPERF3_JSON_MAX_LEN - len, ",\"reverse\":true");
+  }
+  snprintf(s->local_json + len, LWIPERF3_JSON_MAX_LEN - len, "}");
+}
+
+/** Read the parameters sent by a client, 0 if the test is not supported */
+static u8_t
+lwiperf3_parse_params(lwiperf3_session_t *s)
+{
+  lwiperf3_params_t *params = &s->params;
+  const char *json = s->peer_json;
+
+  memset(params, 0, sizeof(*params));
+  params->udp = lwiperf3_json_bool(json, "udp");
+  params->reverse = lwiperf3_json_bool(json, "reverse");
+  params->duration_sec = lwiperf3_json_u32(json, "time", 0);
+  params->num_streams = (u8_t)LWIP_MIN(lwiperf3_json_u32(json, "parallel", 1), 0xFF);
+  params->len = lwiperf3_json_u32(json, "len",
+                                  params->udp ? LWIPERF3_UDP_DEFAULT_LEN : LWIPERF3_TCP_DEFAULT_LEN);
+  params->bandwidth_bps = lwiperf3_json_u32(json, "bandwidth",
+                                            params->udp ? LWIPERF3_UDP_DEFAULT_BANDWIDTH : 0);
+
+  if (lwiperf3_json_bool(json, "bidirectional")
+      || (params->num_streams == 0) || (params->num_streams > LWIPERF_TCP_MAX_STREAMS)) {
+    return 0;
+  }
+  if (params->udp
+      && ((params->len < sizeof(lwiperf3_udp_datagram_t)) || (params->len > LWIPERF3_UDP_MAX_LEN)
+          || (params->bandwidth_bps == 0))) {
+    return 0;
+  }
+  return 1;
+}
+
+/** Build the results of the local side */
+static void
+lwiperf3_build_results(lwiperf3_session_t *s)
+{
+  u32_t duration_ms = s->time_ended - s->time_started;
+  u8_t sender = lwiperf3_is_sender(s);
+  lwiperf3_stream_t *st;
+  int len;
+  u8_t i;
+
+  len = snprintf(s->local_json, LWIPERF3_JSON_MAX_LEN,
+                 "{\"cpu_util_total\":0,\"cpu_util_user\":0,\"cpu_util_system\":0,"
+                 "\"sender_has_retransmits\":0,\"streams\":[");
+  for (i = 0; (i < s->params.num_streams) && (len < LWIPERF3_JSON_MAX_LEN); i++) {
+    st = &s->streams[i];
+    len += snprintf(s->local_json + len, LWIPERF3_JSON_MAX_LEN - len,
+                    "%s{\"id\":%lu,\"bytes\":%lu,\"retransmits\":-1,\"jitter\":%lu.%06lu,"
+                    "\"errors\":%lu,\"packets\":%lu,\"start_time\":0,\"end_time\":%lu.%03lu}",
+                    (i > 0) ? "," : "",
+                    (unsigned long)lwiperf3_stream_id(i),
+                    (unsigned long)st->bytes_transferred,
+                    sender ? 0UL : (unsigned long)(st->jitter_x16 / 16U / 1000000U),
+                    sender ? 0UL : (unsigned long)(st->jitter_x16 / 16U % 1000000U),
+                    sender ? 0UL : (unsigned long)st->errors,
+                    (unsigned long)st->packet_count,
+                    (unsigned long)(duration_ms / 1000U),
+                    (unsigned long)(duration_ms % 1000U));
+  }
+  if (len < LWIPERF3_JSON_MAX_LEN) {
+    snprintf(s->local_json + len, LWIPERF3_JSON_MAX_LEN - len, "]}");
+  }
+}
+
+/** Call the report function of an iPerf3 test */
+static void
+lwiperf3_report(lwiperf3_session_t *s, enum lwiperf_report_type report_type)
+{
+  lwiperf3_results_t results;
+  u32_t time_ended;
+  u8_t i;
+
+  if (s->report_fn == NULL) {
+    return;
+  }
+  memset(&results, 0, sizeof(results));
+  results.sender = lwiperf3_is_sender(s);
+  for (i = 0; i < s->params.num_streams; i++) {
+    results.bytes_transferred += s->streams[i].bytes_transferred;
+    if (!results.sender) {
+      results.udp_stats.datagrams += s->streams[i].packet_count;
+      results.udp_stats.lost += s->streams[i].errors;
+      results.udp_stats.out_of_order += s->streams[i].out_of_order;
+      results.udp_stats.jitter_us = LWIP_MAX(results.udp_stats.jitter_us, s->streams[i].jitter_x16 / 16U);
+    }
+  }
+  if (s->time_started != 0) {
+    time_ended = (s->time_ended != 0) ? s->time_ended : sys_now();
+    results.ms_duration = time_ended - s->time_started;
+  }
+  if (results.ms_duration != 0) {
+    results.bandwidth_kbitpsec = (u32_t)(((uint64_t)results.bytes_transferred * 8U) / results.ms_duration);
+  }
+  if (s->have_peer_json) {
+    results.peer_json = s->peer_json;
+    results.peer_bytes_transferred = lwiperf3_json_streams_sum(s->peer_json, "bytes");
+    if (results.sender) {
+      /* the receiver measured the UDP statistics */
+      results.udp_stats.datagrams = lwiperf3_json_streams_sum(s->peer_json, "packets");
+      results.udp_stats.lost = lwiperf3_json_streams_sum(s->peer_json, "errors");
+      results.udp_stats.jitter_us = lwiperf3_json_streams_max_us(s->peer_json, "jitter");
+    }
+  }
+  if (s->local_json[0] == '{') {
+    results.local_json = s->local_json;
+  }
+  s->report_fn(s->report_arg, report_type, &s->remote_addr, &s->params, &results);
+}
+
+/** Close a TCP connection, ERR_ABRT if it had to be aborted */
+static err_t
+lwiperf3_tcp_close(struct tcp_pcb *pcb)
+{
+  tcp_arg(pcb, NULL);
+  tcp_poll(pcb, NULL, 0);
+  tcp_sent(pcb, NULL);
+  tcp_recv(pcb, NULL);
+  tcp_err(pcb, NULL);
+  if (tcp_close(pcb) != ERR_OK) {
+    /* don't want to wait for free memory here... */
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  return ERR_OK;
+}
+
+/** Close the control connection and the streams of a test
+ * @param current pcb whose callback is running, ERR_ABRT is returned if it is aborted
+ */
+static err_t
+lwiperf3_test_close(lwiperf3_session_t *s, struct tcp_pcb *current)
+{
+  err_t ret = ERR_OK;
+  err_t err;
+  u8_t i;
+
+  sys_untimeout(lwiperf3_client_end_tmr, s);
+  sys_untimeout(lwiperf3_udp_tmr, s);
+  s->sending = 0;
+
+  for (i = 0; i < LWIPERF_TCP_MAX_STREAMS; i++) {
+    if (s->streams[i].tcp_pcb != NULL) {
+      err = lwiperf3_tcp_close(s->streams[i].tcp_pcb);
+      if (s->streams[i].tcp_pcb == current) {
+        ret = err;
+      }
+      s->streams[i].tcp_pcb = NULL;
+    }
+    if (s->streams[i].udp_pcb != NULL) {
+      udp_remove(s->streams[i].udp_pcb);
+      s->streams[i].udp_pcb = NULL;
+    }
+  }
+  if (s->udp_pcb != NULL) {
+    udp_remove(s->udp_pcb);
+    s->udp_pcb = NULL;
+  }
+  if (s->ctrl_pcb != NULL) {
+    err = lwiperf3_tcp_close(s->ctrl_pcb);
+    if (s->ctrl_pcb == current) {
+      ret = err;
+    }
+    s->ctrl_pcb = NULL;
+  }
+  s->state = LWIPERF3_IDLE;
+  return ret;
+}
+
+/** End a test: report it and close its connections, a client session is freed */
+static err_t
+lwiperf3_test_done(lwiperf3_session_t *s, enum lwiperf_report_type report_type, struct tcp_pcb *current)
+{
+  err_t err;
+
+  if (!s->server || s->have_params) {
+    lwiperf3_report(s, report_type);
+  }
+  err = lwiperf3_test_close(s, current);
+  s->have_params = 0;
+  if (!s->server) {
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+  }
+  return err;
+}
+
+/** Try to send more data on a TCP stream */
+static void
+lwiperf3_tcp_send_more(lwiperf3_stream_t *st)
+{
+  err_t err;
+  u16_t txlen;
+
+  if (!st->session->sending || (st->tcp_pcb == NULL)) {
+    return;
+  }
+  do {
+    txlen = TCP_MSS;
+    do {
+      /* no copying needed */
+      err = tcp_write(st->tcp_pcb, lwiperf3_txbuf, txlen, 0);
+      if (err == ERR_MEM) {
+        txlen /= 2;
+      }
+    } while ((err == ERR_MEM) && (txlen >= (TCP_MSS / 2)));
+    if (err == ERR_OK) {
+      st->bytes_transferred += txlen;
+    }
+  } while (err == ERR_OK);
+  tcp_output(st->tcp_pcb);
+}
+
+/** Send an iPerf3 UDP datagram: header followed by constant data */
+static err_t
+lwiperf3_udp_send(lwiperf3_session_t *s, lwiperf3_stream_t *st)
+{
+  err_t err;
+  struct pbuf *hdr;
+  struct pbuf *data;
+  lwiperf3_udp_datagram_t *dgram;
+  u32_t now_us = LWIPERF3_TIME_US();
+
+  hdr = pbuf_alloc(PBUF_TRANSPORT, sizeof(lwiperf3_udp_datagram_t), PBUF_RAM);
+  if (hdr == NULL) {
+    return ERR_MEM;
+  }
+  dgram = (lwiperf3_udp_datagram_t *)hdr->payload;
+  dgram->sec = lwip_htonl(now_us / 1000000U);
+  dgram->usec = lwip_htonl(now_us % 1000000U);
+  dgram->pcount = lwip_htonl(st->packet_count + 1);
+
+  if (s->params.len > sizeof(lwiperf3_udp_datagram_t)) {
+    /* no copy of the data: reference the const buffer */
+    data = pbuf_alloc(PBUF_RAW, (u16_t)(s->params.len - sizeof(lwiperf3_udp_datagram_t)), PBUF_REF);
+    if (data == NULL) {
+      pbuf_free(hdr);
+      return ERR_MEM;
+    }
+    data->payload = LWIP_CONST_CAST(void *, lwiperf3_txbuf);
+    pbuf_cat(hdr, data);
+  }
+
+  if (s->server) {
+    err = udp_sendto(s->udp_pcb, hdr, &st->remote_addr, st->remote_port);
+  } else {
+    err = udp_sendto(st->udp_pcb, hdr, &s->remote_addr, s->remote_port);
+  }
+  pbuf_free(hdr);
+  return err;
+}
+
+/** UDP timer: pace the datagrams of every stream */
+static void
+lwiperf3_udp_tmr(void *arg)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+  u32_t elapsed_ms = sys_now() - s->time_started;
+  lwiperf3_stream_t *st;
+  u8_t burst;
+  u8_t i;
+
+  if (!s->sending) {
+    return;
+  }
+  for (i = 0; i < s->params.num_streams; i++) {
+    st = &s->streams[i];
+    burst = 0;
+    while ((burst < LWIPERF3_UDP_MAX_BURST)
+           && (((uint64_t)st->bytes_transferred * 8000U) <= ((uint64_t)s->params.bandwidth_bps * elapsed_ms))) {
+      if (lwiperf3_udp_send(s, st) != ERR_OK) {
+        /* interface pushed back, retry on next period */
+        break;
+      }
+      st->packet_count++;
+      st->bytes_transferred += s->params.len;
+      burst++;
+    }
+  }
+  sys_timeout(LWIPERF3_UDP_TICK_MS, lwiperf3_udp_tmr, s);
+}
+
+/** Start sending the data on every stream */
+static void
+lwiperf3_start_sending(lwiperf3_session_t *s)
+{
+  u8_t i;
+
+  s->sending = 1;
+  if (s->params.udp) {
+    lwiperf3_udp_tmr(s);
+  } else {
+    for (i = 0; i < s->params.num_streams; i++) {
+      lwiperf3_tcp_send_more(&s->streams[i]);
+    }
+  }
+}
+
+/** Stop sending the data, the test is over */
+static void
+lwiperf3_stop_sending(lwiperf3_session_t *s)
+{
+  if (s->time_started != 0) {
+    s->time_ended = sys_now();
+  }
+  s->sending = 0;
+  sys_untimeout(lwiperf3_udp_tmr, s);
+}
+
+/** UDP receiver: account a datagram */
+static void
+lwiperf3_udp_input(lwiperf3_stream_t *st, struct pbuf *p)
+{
+  lwiperf3_udp_datagram_t dgram;
+  u32_t now_us = LWIPERF3_TIME_US();
+  u32_t pcount;
+  s32_t transit;
+  u32_t delta;
+
+  if (pbuf_copy_partial(p, &dgram, sizeof(dgram), 0) != sizeof(dgram)) {
+    return;
+  }
+  st->bytes_transferred += p->tot_len;
+  pcount = lwip_ntohl(dgram.pcount);
+
+  /* RFC 1889 interarrival jitter: J += (|D| - J) / 16 */
+  transit = (s32_t)(now_us - (lwip_ntohl(dgram.sec) * 1000000U + lwip_ntohl(dgram.usec)));
+  if (st->packet_count == 0) {
+    st->last_transit = transit;
+  }
+  delta = (u32_t)((transit > st->last_transit) ? (transit - st->last_transit) : (st->last_transit - transit));
+  st->last_transit = transit;
+  st->jitter_x16 += delta - (st->jitter_x16 / 16U);
+
+  /* losses and reordering counted as iperf3 does */
+  if (pcount >= st->packet_count + 1) {
+    if (pcount > st->packet_count + 1) {
+      st->errors += pcount - 1 - st->packet_count;
+    }
+    st->packet_count = pcount;
+  } else {
+    st->out_of_order++;
+    if (st->errors > 0) {
+      st->errors--;
+    }
+  }
+}
+
+/** Send a 4-byte UDP stream connection message or reply */
+static void
+lwiperf3_udp_send_u32(struct udp_pcb *pcb, const ip_addr_t *addr, u16_t port, u32_t value)
+{
+  struct pbuf *p;
+
+  p = pbuf_alloc(PBUF_TRANSPORT, sizeof(value), PBUF_RAM);
+  if (p != NULL) {
+    /* iperf3 sends it in host order, which is little endian on a PC */
+    memcpy(p->payload, &value, sizeof(value));
+    udp_sendto(pcb, p, addr, port);
+    pbuf_free(p);
+  }
+}
+
+/** Receive data on a TCP stream */
+static err_t
+lwiperf3_stream_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+  lwiperf3_stream_t *st = (lwiperf3_stream_t *)arg;
+  lwiperf3_session_t *s = st->session;
+  u16_t offset = 0;
+
+  if ((p == NULL) || (err != ERR_OK)) {
+    /* stream closed by the peer */
+    if (p != NULL) {
+      pbuf_free(p);
+    }
+    st->tcp_pcb = NULL;
+    return lwiperf3_tcp_close(tpcb);
+  }
+  tcp_recved(tpcb, p->tot_len);
+
+  if (s->server && !st->connected) {
+    /* a stream starts with the cookie of the test */
+    for (; (offset < p->tot_len) && (st->cookie_rx < LWIPERF3_COOKIE_SIZE); offset++, st->cookie_rx++) {
+      if (pbuf_get_at(p, offset) != (u8_t)s->cookie[st->cookie_rx]) {
+        pbuf_free(p);
+        st->tcp_pcb = NULL;
+        return lwiperf3_tcp_close(tpcb);
+      }
+    }
+    if (st->cookie_rx == LWIPERF3_COOKIE_SIZE) {
+      st->connected = 1;
+      s->num_connected++;
+      if (s->num_connected == s->params.num_streams) {
+        /* every stream is there: go */
+        lwiperf3_ctrl_send_state(s, LWIPERF3_TEST_START);
+        lwiperf3_ctrl_send_state(s, LWIPERF3_TEST_RUNNING);
+        s->time_started = sys_now();
+        if (s->params.reverse) {
+          lwiperf3_start_sending(s);
+        }
+      }
+    }
+  }
+  st->bytes_transferred += p->tot_len - offset;
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+/** TCP sent callback of a stream, try to send more data */
+static err_t
+lwiperf3_stream_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+  LWIP_UNUSED_ARG(tpcb);
+  LWIP_UNUSED_ARG(len);
+  lwiperf3_tcp_send_more((lwiperf3_stream_t *)arg);
+  return ERR_OK;
+}
+
+/** TCP poll callback of a stream, try to send more data */
+static err_t
+lwiperf3_stream_poll(void *arg, struct tcp_pcb *tpcb)
+{
+  LWIP_UNUSED_ARG(tpcb);
+  lwiperf3_tcp_send_more((lwiperf3_stream_t *)arg);
+  return ERR_OK;
+}
+
+/** Error callback of a stream, the pcb is already freed */
+static void
+lwiperf3_stream_err(void *arg, err_t err)
+{
+  lwiperf3_stream_t *st = (lwiperf3_stream_t *)arg;
+  LWIP_UNUSED_ARG(err);
+  st->tcp_pcb = NULL;
+}
+
+/** Set up the callbacks of a TCP stream */
+static void
+lwiperf3_stream_setup(lwiperf3_session_t *s, lwiperf3_stream_t *st, struct tcp_pcb *pcb)
+{
+  st->session = s;
+  st->tcp_pcb = pcb;
+  tcp_arg(pcb, st);
+  tcp_recv(pcb, lwiperf3_stream_recv);
+  tcp_sent(pcb, lwiperf3_stream_sent);
+  tcp_poll(pcb, lwiperf3_stream_poll, 2U);
+  tcp_err(pcb, lwiperf3_stream_err);
+}
+
+/** Client: TCP stream connected, send the cookie */
+static err_t
+lwiperf3_client_stream_connected(void *arg, struct tcp_pcb *tpcb, err_t err)
+{
+  lwiperf3_stream_t *st = (lwiperf3_stream_t *)arg;
+  LWIP_UNUSED_ARG(err);
+
+  st->connected = 1;
+  st->session->num_connected++;
+  tcp_write(tpcb, st->session->cookie, LWIPERF3_COOKIE_SIZE, TCP_WRITE_FLAG_COPY);
+  return tcp_output(tpcb);
+}
+
+/** Client: receive on an UDP stream */
+static void
+lwiperf3_client_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  lwiperf3_stream_t *st = (lwiperf3_stream_t *)arg;
+  lwiperf3_session_t *s = st->session;
+  lwiperf3_stream_t *next;
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+
+  if (st->connected) {
+    lwiperf3_udp_input(st, p);
+  } else {
+    /* connect reply: the server is ready for the next stream */
+    st->connected = 1;
+    s->num_connected++;
+    if (s->num_connected < s->params.num_streams) {
+      next = &s->streams[s->num_connected];
+      lwiperf3_udp_send_u32(next->udp_pcb, &s->remote_addr, s->remote_port, LWIPERF3_UDP_CONNECT_MSG);
+    }
+  }
+  pbuf_free(p);
+}
+
+/** Client: create the data streams */
+static u8_t
+lwiperf3_client_create_streams(lwiperf3_session_t *s)
+{
+  lwiperf3_stream_t *st;
+  struct tcp_pcb *pcb;
+  u8_t i;
+
+  for (i = 0; i < s->params.num_streams; i++) {
+    st = &s->streams[i];
+    st->session = s;
+    if (s->params.udp) {
+      st->udp_pcb = udp_new_ip_type(IP_GET_TYPE(&s->remote_addr));
+      if ((st->udp_pcb == NULL)
+          || (udp_connect(st->udp_pcb, &s->remote_addr, s->remote_port) != ERR_OK)) {
+        return 0;
+      }
+      udp_recv(st->udp_pcb, lwiperf3_client_udp_recv, st);
+    } else {
+      pcb = tcp_new_ip_type(IP_GET_TYPE(&s->remote_addr));
+      if (pcb == NULL) {
+        return 0;
+      }
+      lwiperf3_stream_setup(s, st, pcb);
+      if (tcp_connect(pcb, &s->remote_addr, s->remote_port, lwiperf3_client_stream_connected) != ERR_OK) {
+        return 0;
+      }
+    }
+  }
+  if (s->params.udp) {
+    /* the streams are connected one after the other */
+    lwiperf3_udp_send_u32(s->streams[0].udp_pcb, &s->remote_addr, s->remote_port, LWIPERF3_UDP_CONNECT_MSG);
+  }
+  return 1;
+}
+
+/** Client: the test duration is over */
+static void
+lwiperf3_client_end_tmr(void *arg)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+
+  lwiperf3_stop_sending(s);
+  lwiperf3_ctrl_send_state(s, LWIPERF3_TEST_END);
+}
+
+/** Server: receive on the UDP streams */
+static void
+lwiperf3_server_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+  lwiperf3_stream_t *st;
+  u8_t i;
+  LWIP_UNUSED_ARG(pcb);
+
+  for (i = 0; i < s->num_connected; i++) {
+    st = &s->streams[i];
+    if ((st->remote_port == port) && ip_addr_cmp(&st->remote_addr, addr)) {
+      lwiperf3_udp_input(st, p);
+      pbuf_free(p);
+      return;
+    }
+  }
+
+  if ((s->state == LWIPERF3_CREATE_STREAMS) && ip_addr_cmp(&s->remote_addr, addr)) {
+    /* connect message of a new stream */
+    st = &s->streams[s->num_connected];
+    st->session = s;
+    ip_addr_copy(st->remote_addr, *addr);
+    st->remote_port = port;
+    st->connected = 1;
+    s->num_connected++;
+    lwiperf3_udp_send_u32(s->udp_pcb, addr, port, LWIPERF3_UDP_CONNECT_REPLY);
+    if (s->num_connected == s->params.num_streams) {
+      lwiperf3_ctrl_send_state(s, LWIPERF3_TEST_START);
+      lwiperf3_ctrl_send_state(s, LWIPERF3_TEST_RUNNING);
+      s->time_started = sys_now();
+      if (s->params.reverse) {
+        lwiperf3_start_sending(s);
+      }
+    }
+  }
+  pbuf_free(p);
+}
+
+/** Client: handle a state received on the control connection
+ * @returns 1 when the test is over (s->report_type is set)
+ */
+static u8_t
+lwiperf3_client_state(lwiperf3_session_t *s, s8_t state)
+{
+  switch (state) {
+    case LWIPERF3_PARAM_EXCHANGE:
+      s->state = state;
+      lwiperf3_build_params(s);
+      lwiperf3_ctrl_send_json(s, s->local_json);
+      s->local_json[0] = '\0';
+      break;
+    case LWIPERF3_CREATE_STREAMS:
+      s->state = state;
+      if (!lwiperf3_client_create_streams(s)) {
+        s->report_type = LWIPERF_TCP_ABORTED_LOCAL;
+        return 1;
+      }
+      break;
+    case LWIPERF3_TEST_START:
+      s->state = state;
+      break;
+    case LWIPERF3_TEST_RUNNING:
+      s->state = state;
+      s->time_started = sys_now();
+      if (!s->params.reverse) {
+        lwiperf3_start_sending(s);
+      }
+      sys_timeout(s->params.duration_sec * 1000U, lwiperf3_client_end_tmr, s);
+      break;
+    case LWIPERF3_EXCHANGE_RESULTS:
+      s->state = state;
+      lwiperf3_build_results(s);
+      lwiperf3_ctrl_send_json(s, s->local_json);
+      s->rx_expect = LWIPERF3_RX_JSON_LEN;
+      break;
+    case LWIPERF3_DISPLAY_RESULTS:
+      lwiperf3_ctrl_send_state(s, LWIPERF3_IPERF_DONE);
+      s->report_type = s->params.udp ? LWIPERF_UDP_DONE_CLIENT : LWIPERF_TCP_DONE_CLIENT;
+      return 1;
+    case LWIPERF3_SERVER_ERROR:
+      /* followed by the error codes */
+      s->rx_expect = LWIPERF3_RX_ERROR;
+      break;
+    case LWIPERF3_ACCESS_DENIED:
+    case LWIPERF3_SERVER_TERMINATE:
+      s->report_type = LWIPERF_TCP_ABORTED_REMOTE;
+      return 1;
+    default:
+      break;
+  }
+  return 0;
+}
+
+/** Server: handle a state received on the control connection
+ * @returns 1 when the test is over (s->report_type is set)
+ */
+static u8_t
+lwiperf3_server_state(lwiperf3_session_t *s, s8_t state)
+{
+  switch (state) {
+    case LWIPERF3_TEST_END:
+      lwiperf3_stop_sending(s);
+      lwiperf3_ctrl_send_state(s, LWIPERF3_EXCHANGE_RESULTS);
+      s->rx_expect = LWIPERF3_RX_JSON_LEN;
+      break;
+    case LWIPERF3_IPERF_DONE:
+      s->report_type = s->params.udp ? LWIPERF_UDP_DONE_SERVER : LWIPERF_TCP_DONE_SERVER;
+      return 1;
+    case LWIPERF3_CLIENT_TERMINATE:
+      s->report_type = LWIPERF_TCP_ABORTED_REMOTE;
+      return 1;
+    default:
+      break;
+  }
+  return 0;
+}
+
+/** Handle a JSON message received on the control connection
+ * @returns 1 when the test is over (s->report_type is set)
+ */
+static u8_t
+lwiperf3_json_received(lwiperf3_session_t *s)
+{
+  s->rx_expect = LWIPERF3_RX_STATE;
+
+  if (s->server && (s->state == LWIPERF3_PARAM_EXCHANGE)) {
+    /* test parameters */
+    if (!lwiperf3_parse_params(s)) {
+      lwiperf3_ctrl_send_state(s, LWIPERF3_ACCESS_DENIED);
+      s->report_type = LWIPERF_TCP_ABORTED_LOCAL;
+      return 1;
+    }
+    s->have_params = 1;
+    if (s->params.udp) {
+      s->udp_pcb = udp_new_ip_type(LWIPERF3_SERVER_IP_TYPE);
+      if ((s->udp_pcb == NULL) || (udp_bind(s->udp_pcb, IP_ANY_TYPE, s->local_port) != ERR_OK)) {
+        lwiperf3_ctrl_send_state(s, LWIPERF3_ACCESS_DENIED);
+        s->report_type = LWIPERF_TCP_ABORTED_LOCAL;
+        return 1;
+      }
+      udp_recv(s->udp_pcb, lwiperf3_server_udp_recv, s);
+    }
+    lwiperf3_ctrl_send_state(s, LWIPERF3_CREATE_STREAMS);
+  } else if (s->state == LWIPERF3_EXCHANGE_RESULTS) {
+    /* results of the peer */
+    s->have_peer_json = 1;
+    if (s->server) {
+      lwiperf3_build_results(s);
+      lwiperf3_ctrl_send_json(s, s->local_json);
+      lwiperf3_ctrl_send_state(s, LWIPERF3_DISPLAY_RESULTS);
+    }
+  }
+  return 0;
+}
+
+/** Process a byte received on the control connection
+ * @returns 1 when the test is over (s->report_type is set)
+ */
+static u8_t
+lwiperf3_ctrl_input(lwiperf3_session_t *s, u8_t c)
+{
+  switch (s->rx_expect) {
+    case LWIPERF3_RX_COOKIE:
+      s->cookie[s->rx_count++] = (char)c;
+      if (s->rx_count == LWIPERF3_COOKIE_SIZE) {
+        s->cookie[LWIPERF3_COOKIE_SIZE - 1] = '\0';
+        s->rx_count = 0;
+        s->rx_expect = LWIPERF3_RX_JSON_LEN;
+        lwiperf3_ctrl_send_state(s, LWIPERF3_PARAM_EXCHANGE);
+      }
+      break;
+    case LWIPERF3_RX_STATE:
+      return s->server ? lwiperf3_server_state(s, (s8_t)c) : lwiperf3_client_state(s, (s8_t)c);
+    case LWIPERF3_RX_JSON_LEN:
+      s->rx_buf[s->rx_count++] = c;
+      if (s->rx_count == sizeof(u32_t)) {
+        s->json_len = ((u32_t)s->rx_buf[0] << 24) | ((u32_t)s->rx_buf[1] << 16)
+                      | ((u32_t)s->rx_buf[2] << 8) | s->rx_buf[3];
+        s->rx_count = 0;
+        if (s->json_len >= LWIPERF3_JSON_MAX_LEN) {
+          s->report_type = LWIPERF_TCP_ABORTED_LOCAL_DATAERROR;
+          return 1;
+        }
+        s->rx_expect = LWIPERF3_RX_JSON;
+        if (s->json_len == 0) {
+          s->peer_json[0] = '\0';
+          return lwiperf3_json_received(s);
+        }
+      }
+      break;
+    case LWIPERF3_RX_JSON:
+      s->peer_json[s->rx_count++] = (char)c;
+      if (s->rx_count == s->json_len) {
+        s->peer_json[s->json_len] = '\0';
+        s->rx_count = 0;
+        return lwiperf3_json_received(s);
+      }
+      break;
+    case LWIPERF3_RX_ERROR:
+      /* i_errno and errno of the server */
+      if (++s->rx_count == 2 * sizeof(u32_t)) {
+        s->report_type = LWIPERF_TCP_ABORTED_REMOTE;
+        return 1;
+      }
+      break;
+    default:
+      break;
+  }
+  return 0;
+}
+
+/** Receive on the control connection */
+static err_t
+lwiperf3_ctrl_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+  struct pbuf *q;
+  u16_t i;
+  u8_t over = 0;
+
+  if ((p == NULL) || (err != ERR_OK)) {
+    if (p != NULL) {
+      pbuf_free(p);
+    }
+    if (s->server && (s->state == LWIPERF3_DISPLAY_RESULTS)) {
+      /* the client may close without sending IPERF_DONE */
+      return lwiperf3_test_done(s, s->params.udp ? LWIPERF_UDP_DONE_SERVER : LWIPERF_TCP_DONE_SERVER, tpcb);
+    }
+    return lwiperf3_test_done(s, LWIPERF_TCP_ABORTED_REMOTE, tpcb);
+  }
+  tcp_recved(tpcb, p->tot_len);
+  s->idle_count = 0;
+
+  for (q = p; (q != NULL) && !over; q = q->next) {
+    for (i = 0; (i < q->len) && !over; i++) {
+      over = lwiperf3_ctrl_input(s, ((const u8_t *)q->payload)[i]);
+    }
+  }
+  pbuf_free(p);
+
+  if (over) {
+    return lwiperf3_test_done(s, s->report_type, tpcb);
+  }
+  return ERR_OK;
+}
+
+/** Error callback of the control connection, the pcb is already freed */
+static void
+lwiperf3_ctrl_err(void *arg, err_t err)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+  LWIP_UNUSED_ARG(err);
+
+  s->ctrl_pcb = NULL;
+  lwiperf3_test_done(s, LWIPERF_TCP_ABORTED_REMOTE, NULL);
+}
+
+/** Poll callback of the control connection: abort idle tests */
+static err_t
+lwiperf3_ctrl_poll(void *arg, struct tcp_pcb *tpcb)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+
+  if ((s->state != LWIPERF3_TEST_RUNNING) && (++s->idle_count >= LWIPERF3_MAX_IDLE_SEC)) {
+    return lwiperf3_test_done(s, LWIPERF_TCP_ABORTED_LOCAL, tpcb);
+  }
+  return ERR_OK;
+}
+
+/** Set up the callbacks of the control connection */
+static void
+lwiperf3_ctrl_setup(lwiperf3_session_t *s, struct tcp_pcb *pcb)
+{
+  s->ctrl_pcb = pcb;
+  tcp_arg(pcb, s);
+  tcp_recv(pcb, lwiperf3_ctrl_recv);
+  tcp_err(pcb, lwiperf3_ctrl_err);
+  tcp_poll(pcb, lwiperf3_ctrl_poll, 2U);
+}
+
+/** Client: control connection established, send the cookie */
+static err_t
+lwiperf3_client_connected(void *arg, struct tcp_pcb *tpcb, err_t err)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+  LWIP_UNUSED_ARG(err);
+
+  tcp_write(tpcb, s->cookie, LWIPERF3_COOKIE_SIZE, TCP_WRITE_FLAG_COPY);
+  return tcp_output(tpcb);
+}
+
+/** Server: a client connects the control connection or a stream */
+static err_t
+lwiperf3_server_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)arg;
+  static const s8_t access_denied = LWIPERF3_ACCESS_DENIED;
+  u8_t i;
+
+  if ((err != ERR_OK) || (newpcb == NULL) || (arg == NULL)) {
+    return ERR_VAL;
+  }
+
+  if (s->ctrl_pcb == NULL) {
+    /* new test */
+    memset(s->streams, 0, sizeof(s->streams));
+    memset(&s->params, 0, sizeof(s->params));
+    s->rx_expect = LWIPERF3_RX_COOKIE;
+    s->rx_count = 0;
+    s->idle_count = 0;
+    s->num_connected = 0;
+    s->have_params = 0;
+    s->have_peer_json = 0;
+    s->time_started = 0;
+    s->time_ended = 0;
+    s->local_json[0] = '\0';
+    ip_addr_copy(s->remote_addr, newpcb->remote_ip);
+    s->remote_port = newpcb->remote_port;
+    lwiperf3_ctrl_setup(s, newpcb);
+    return ERR_OK;
+  }
+
+  if ((s->state == LWIPERF3_CREATE_STREAMS) && !s->params.udp
+      && ip_addr_cmp(&newpcb->remote_ip, &s->remote_addr)) {
+    /* stream of the test, identified by its cookie */
+    for (i = 0; i < s->params.num_streams; i++) {
+      if ((s->streams[i].tcp_pcb == NULL) && !s->streams[i].connected) {
+        s->streams[i].cookie_rx = 0;
+        lwiperf3_stream_setup(s, &s->streams[i], newpcb);
+        return ERR_OK;
+      }
+    }
+  }
+
+  /* a test is running */
+  tcp_write(newpcb, &access_denied, 1, TCP_WRITE_FLAG_COPY);
+  return lwiperf3_tcp_close(newpcb);
+}
+
+/**
+ * @ingroup iperf3
+ * Start an iPerf3 server on a specific IP address and port and listen for
+ * incoming tests from iperf3 clients, one at a time.
+ *
+ * @returns a connection handle that can be used to abort the server
+ *          by calling @ref lwiperf3_abort()
+ */
+void *
+lwiperf3_start_server(const ip_addr_t *local_addr, u16_t local_port,
+                      lwiperf3_report_fn report_fn, void *report_arg)
+{
+  lwiperf3_session_t *s;
+  struct tcp_pcb *pcb;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if (local_addr == NULL) {
+    return NULL;
+  }
+  s = (lwiperf3_session_t *)LWIPERF3_ALLOC(lwiperf3_session_t);
+  if (s == NULL) {
+    return NULL;
+  }
+  memset(s, 0, sizeof(lwiperf3_session_t));
+  s->server = 1;
+  s->local_port = local_port;
+  s->report_fn = report_fn;
+  s->report_arg = report_arg;
+
+  pcb = tcp_new_ip_type(LWIPERF3_SERVER_IP_TYPE);
+  if (pcb == NULL) {
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+    return NULL;
+  }
+  if (tcp_bind(pcb, local_addr, local_port) != ERR_OK) {
+    tcp_close(pcb);
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+    return NULL;
+  }
+  s->listen_pcb = tcp_listen_with_backlog(pcb, LWIPERF_TCP_MAX_STREAMS + 1);
+  if (s->listen_pcb == NULL) {
+    tcp_close(pcb);
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+    return NULL;
+  }
+  tcp_arg(s->listen_pcb, s);
+  tcp_accept(s->listen_pcb, lwiperf3_server_accept);
+  return s;
+}
+
+/**
+ * @ingroup iperf3
+ * Start an iPerf3 client test to a specific IP address and port.
+ *
+ * @param params test parameters, the zero values select the iperf3 defaults
+ * @returns a connection handle that can be used to abort the client
+ *          by calling @ref lwiperf3_abort(), it is freed once the test is reported
+ */
+void *
+lwiperf3_start_client(const ip_addr_t *remote_addr, u16_t remote_port,
+                      const lwiperf3_params_t *params,
+                      lwiperf3_report_fn report_fn, void *report_arg)
+{
+  lwiperf3_session_t *s;
+  struct tcp_pcb *pcb;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if ((remote_addr == NULL) || (params == NULL) || (params->duration_sec == 0)
+      || (params->num_streams > LWIPERF_TCP_MAX_STREAMS)) {
+    return NULL;
+  }
+  s = (lwiperf3_session_t *)LWIPERF3_ALLOC(lwiperf3_session_t);
+  if (s == NULL) {
+    return NULL;
+  }
+  memset(s, 0, sizeof(lwiperf3_session_t));
+  s->params = *params;
+  if (s->params.num_streams == 0) {
+    s->params.num_streams = 1;
+  }
+  if (s->params.len == 0) {
+    s->params.len = s->params.udp ? LWIPERF3_UDP_DEFAULT_LEN : LWIPERF3_TCP_DEFAULT_LEN;
+  }
+  if (s->params.udp && (s->params.bandwidth_bps == 0)) {
+    s->params.bandwidth_bps = LWIPERF3_UDP_DEFAULT_BANDWIDTH;
+  }
+  if (s->params.udp
+      && ((s->params.len < sizeof(lwiperf3_udp_datagram_t)) || (s->params.len > LWIPERF3_UDP_MAX_LEN))) {
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+    return NULL;
+  }
+  ip_addr_copy(s->remote_addr, *remote_addr);
+  s->remote_port = remote_port;
+  s->report_fn = report_fn;
+  s->report_arg = report_arg;
+  s->rx_expect = LWIPERF3_RX_STATE;
+  lwiperf3_make_cookie(s);
+
+  pcb = tcp_new_ip_type(IP_GET_TYPE(remote_addr));
+  if (pcb == NULL) {
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+    return NULL;
+  }
+  lwiperf3_ctrl_setup(s, pcb);
+  if (tcp_connect(pcb, remote_addr, remote_port, lwiperf3_client_connected) != ERR_OK) {
+    lwiperf3_tcp_close(pcb);
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+    return NULL;
+  }
+  return s;
+}
+
+/**
+ * @ingroup iperf3
+ * Abort an iPerf3 session (handle returned by lwiperf3_start_*()),
+ * the running test is reported as aborted.
+ */
+void
+lwiperf3_abort(void *lwiperf3_session)
+{
+  lwiperf3_session_t *s = (lwiperf3_session_t *)lwiperf3_session;
+  struct tcp_pcb *listen_pcb = s->listen_pcb;
+  u8_t server = s->server;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if (s->ctrl_pcb != NULL) {
+    /* let the peer know */
+    lwiperf3_ctrl_send_state(s, server ? LWIPERF3_SERVER_TERMINATE : LWIPERF3_CLIENT_TERMINATE);
+  }
+  /* a client session is freed here */
+  lwiperf3_test_done(s, LWIPERF_TCP_ABORTED_LOCAL, NULL);
+
+  if (server) {
+    tcp_arg(listen_pcb, NULL);
+    tcp_close(listen_pcb);
+    LWIPERF3_FREE(lwiperf3_session_t, s);
+  }
+}
+
+#endif /* LWIP_TCP && LWIP_UDP && LWIP_CALLBACK_API */
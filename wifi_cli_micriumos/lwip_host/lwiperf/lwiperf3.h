@@ -0,0 +1,89 @@
+/**
+ * @file
+ * lwIP iPerf3 client/server implementation
+ */
+
+/*
+ * Copyright 2022 Silicon Laboratories Inc. www.silabs.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LWIP_HDR_APPS_LWIPERF3_H
+#define LWIP_HDR_APPS_LWIPERF3_H
+
+#include "lwip/opt.h"
+#include "lwip/ip_addr.h"
+#include "lwiperf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LWIPERF3_PORT_DEFAULT  5201
+
+/** iPerf3 test parameters */
+typedef struct _lwiperf3_params
+{
+  /** 1=UDP test, 0=TCP test */
+  u8_t udp;
+  /** 1=the server sends, 0=the client sends */
+  u8_t reverse;
+  /** Number of parallel streams, up to @ref LWIPERF_TCP_MAX_STREAMS */
+  u8_t num_streams;
+  /** Test duration in seconds */
+  u32_t duration_sec;
+  /** UDP target bandwidth per stream in bits per second, 0 for the default one */
+  u32_t bandwidth_bps;
+  /** Write (TCP) or datagram (UDP) length, 0 for the default one */
+  u32_t len;
+} lwiperf3_params_t;
+
+/** iPerf3 test results */
+typedef struct _lwiperf3_results
+{
+  /** 1=the local side sent the data */
+  u8_t sender;
+  /** Bytes sent or received by the local side (all streams) */
+  u32_t bytes_transferred;
+  /** Bytes the peer reported in its results */
+  u32_t peer_bytes_transferred;
+  u32_t ms_duration;
+  u32_t bandwidth_kbitpsec;
+  /** UDP test statistics of the receiver (local or peer) */
+  lwiperf_udp_stats_t udp_stats;
+  /** Results sent to the peer (JSON) */
+  const char *local_json;
+  /** Results received from the peer (JSON), NULL if none */
+  const char *peer_json;
+} lwiperf3_results_t;
+
+/** Prototype of a report function that is called when an iPerf3 test is finished.
+    @param report_type contains the test result
+    @param results test results, valid during the call only */
+typedef void (*lwiperf3_report_fn)(void *arg, enum lwiperf_report_type report_type,
+  const ip_addr_t* remote_addr, const lwiperf3_params_t *params,
+  const lwiperf3_results_t *results);
+
+void* lwiperf3_start_server(const ip_addr_t* local_addr, u16_t local_port,
+                            lwiperf3_report_fn report_fn, void* report_arg);
+void* lwiperf3_start_client(const ip_addr_t* remote_addr, u16_t remote_port,
+                            const lwiperf3_params_t *params,
+                            lwiperf3_report_fn report_fn, void* report_arg);
+void  lwiperf3_abort(void* lwiperf3_session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_HDR_APPS_LWIPERF3_H */
@@ -0,0 +1,36 @@
+/**
+ * @file
+ * Time base of the lwiperf applications on this host
+ */
+
+/*
+ * Copyright 2022 Silicon Laboratories Inc. www.silabs.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LWIP_HDR_APPS_LWIPERF_PORT_H
+#define LWIP_HDR_APPS_LWIPERF_PORT_H
+
+/* The CPU cycle counter read by the host stack latency tracing replaces
+   the sys_now() defaults of the lwiperf applications. */
+#include "latency_trace.h"
+
+/** UDP timestamps and jitter */
+#define LWIPERF_TIME_US()               latency_trace_time_us()
+
+/** Request/response latencies */
+#define LWIPERF_RR_TIMESTAMP()          latency_trace_timestamp()
+#define LWIPERF_RR_TIMESTAMP_TO_US(t)   latency_trace_cycles_to_us(t)
+
+#endif /* LWIP_HDR_APPS_LWIPERF_PORT_H */
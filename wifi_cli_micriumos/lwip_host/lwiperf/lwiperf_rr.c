@@ -0,0 +1,488 @@
+/**
+ * @file
+ * lwIP request/response latency benchmark
+ */
+
+/**
+ * @defgroup iperf_rr Request/response benchmark
+ * @ingroup apps
+ *
+ * This benchmark measures the transaction latency as netperf TCP_RR and
+ * UDP_RR do: the client sends a request of N bytes, the peer answers with
+ * M bytes, then the next request leaves. The transaction rate and the
+ * latency percentiles are reported at the end of the test.
+ *
+ * The request header tells the peer the request and response lengths
+ * (see @ref lwiperf_rr_hdr_t), the response echoes the sequence number.
+ * The matching Linux peer is tools/lwiperf_rr_peer.c.
+ */
+
+/*
+ * Copyright 2022 Silicon Laboratories Inc. www.silabs.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lwiperf_rr.h"
+#include "lwiperf_port.h"
+#include "latency_histogram.h"
+
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+
+#include <string.h>
+
+#if LWIP_TCP && LWIP_UDP && LWIP_CALLBACK_API
+
+/** Timestamp of the latency measurements, sys_now() by default.
+    Define it in lwiperf_port.h with LWIPERF_RR_TIMESTAMP_TO_US() for a finer time base. */
+#ifndef LWIPERF_RR_TIMESTAMP
+#define LWIPERF_RR_TIMESTAMP()          sys_now()
+#define LWIPERF_RR_TIMESTAMP_TO_US(t)   ((t) * 1000U)
+#endif
+
+/** Time (in seconds) without response after which a TCP test is aborted */
+#ifndef LWIPERF_RR_TCP_TIMEOUT_SEC
+#define LWIPERF_RR_TCP_TIMEOUT_SEC      10U
+#endif
+
+/** Time (in milliseconds) after which an UDP transaction is lost */
+#ifndef LWIPERF_RR_UDP_TIMEOUT_MS
+#define LWIPERF_RR_UDP_TIMEOUT_MS       1000U
+#endif
+
+/* File internal memory allocation (struct lwiperf_rr_*): this defaults to
+   the heap */
+#ifndef LWIPERF_RR_ALLOC
+#define LWIPERF_RR_ALLOC(type)          mem_malloc(sizeof(type))
+#define LWIPERF_RR_FREE(type, item)     mem_free(item)
+#endif
+
+/** Connection handle for a request/response benchmark */
+typedef struct _lwiperf_rr_session {
+  u8_t udp;
+  /** 1=a request is waiting for its response */
+  u8_t waiting;
+  /** 1=the request could not be queued yet (TCP) */
+  u8_t send_pending;
+  u8_t idle_sec;
+  struct tcp_pcb *tcp_pcb;
+  struct udp_pcb *udp_pcb;
+  ip_addr_t remote_addr;
+  u16_t remote_port;
+  u16_t request_len;
+  u16_t response_len;
+  u32_t duration_ms;
+  u32_t seq;
+  /** response bytes received (TCP) */
+  u32_t rx_count;
+  u32_t time_started;
+  u32_t time_ended;
+  u32_t request_timestamp;
+  u32_t timeouts;
+  /** latencies of the transactions done */
+  latency_histogram_t latency;
+  lwiperf_rr_report_fn report_fn;
+  void *report_arg;
+} lwiperf_rr_session_t;
+
+/** Request payload, sent without copy */
+static const u8_t lwiperf_rr_txbuf[LWIPERF_RR_MAX_LEN];
+
+static void lwiperf_rr_udp_tmr(void *arg);
+
+/** Compute the results and call the report function */
+static void
+lwiperf_rr_report(lwiperf_rr_session_t *conn, enum lwiperf_report_type report_type)
+{
+  lwiperf_rr_results_t results;
+
+  memset(&results, 0, sizeof(results));
+  if (conn->time_ended == 0) {
+    conn->time_ended = sys_now();
+  }
+  results.transactions = conn->latency.count;
+  results.timeouts = conn->timeouts;
+  if (conn->time_started != 0) {
+    results.ms_duration = conn->time_ended - conn->time_started;
+  }
+  if (results.ms_duration != 0) {
+    results.rate_x100 = (u32_t)(((u64_t)conn->latency.count * 100000U) / results.ms_duration);
+  }
+  if (conn->latency.count != 0) {
+    results.min_us = conn->latency.min_us;
+    results.avg_us = (u32_t)(conn->latency.total_us / conn->latency.count);
+    results.max_us = conn->latency.max_us;
+    results.p50_us = latency_histogram_percentile(&conn->latency, 500);
+    results.p90_us = latency_histogram_percentile(&conn->latency, 900);
+    results.p99_us = latency_histogram_percentile(&conn->latency, 990);
+    results.p999_us = latency_histogram_percentile(&conn->latency, 999);
+  }
+  if (conn->report_fn != NULL) {
+    conn->report_fn(conn->report_arg, report_type, &conn->remote_addr, conn->remote_port, &results);
+  }
+}
+
+/** Close the connection, report the test and free the session
+ * @returns ERR_ABRT if the TCP pcb had to be aborted
+ */
+static err_t
+lwiperf_rr_close(lwiperf_rr_session_t *conn, enum lwiperf_report_type report_type)
+{
+  err_t err = ERR_OK;
+
+  sys_untimeout(lwiperf_rr_udp_tmr, conn);
+  lwiperf_rr_report(conn, report_type);
+
+  if (conn->tcp_pcb != NULL) {
+    tcp_arg(conn->tcp_pcb, NULL);
+    tcp_poll(conn->tcp_pcb, NULL, 0);
+    tcp_sent(conn->tcp_pcb, NULL);
+    tcp_recv(conn->tcp_pcb, NULL);
+    tcp_err(conn->tcp_pcb, NULL);
+    if (tcp_close(conn->tcp_pcb) != ERR_OK) {
+      /* don't want to wait for free memory here... */
+      tcp_abort(conn->tcp_pcb);
+      err = ERR_ABRT;
+    }
+  }
+  if (conn->udp_pcb != NULL) {
+    udp_remove(conn->udp_pcb);
+  }
+  LWIPERF_RR_FREE(lwiperf_rr_session_t, conn);
+  return err;
+}
+
+/** Fill the header of the next request */
+static void
+lwiperf_rr_fill_hdr(lwiperf_rr_session_t *conn, lwiperf_rr_hdr_t *hdr)
+{
+  hdr->seq = lwip_htonl(conn->seq);
+  hdr->request_len = lwip_htonl(conn->request_len);
+  hdr->response_len = lwip_htonl(conn->response_len);
+}
+
+/** Try to queue the next request on the TCP connection
+ * @returns ERR_ABRT if the test had to be aborted
+ */
+static err_t
+lwiperf_rr_tcp_send(lwiperf_rr_session_t *conn)
+{
+  lwiperf_rr_hdr_t hdr;
+  u16_t payload_len = conn->request_len - sizeof(lwiperf_rr_hdr_t);
+  err_t err;
+
+  if ((tcp_sndbuf(conn->tcp_pcb) < conn->request_len)
+      || ((tcp_sndqueuelen(conn->tcp_pcb) + 2) > TCP_SND_QUEUELEN)) {
+    /* retry from the sent or poll callback */
+    conn->send_pending = 1;
+    return ERR_OK;
+  }
+  lwiperf_rr_fill_hdr(conn, &hdr);
+  err = tcp_write(conn->tcp_pcb, &hdr, sizeof(hdr),
+                  TCP_WRITE_FLAG_COPY | ((payload_len > 0) ? TCP_WRITE_FLAG_MORE : 0));
+  if (err != ERR_OK) {
+    conn->send_pending = 1;
+    return ERR_OK;
+  }
+  if (payload_len > 0) {
+    /* no copying needed */
+    err = tcp_write(conn->tcp_pcb, lwiperf_rr_txbuf, payload_len, 0);
+    if (err != ERR_OK) {
+      /* the header is queued already, the stream can't be resynchronized */
+      return lwiperf_rr_close(conn, LWIPERF_TCP_ABORTED_LOCAL_TXERROR);
+    }
+  }
+  conn->send_pending = 0;
+  conn->waiting = 1;
+  conn->idle_sec = 0;
+  conn->request_timestamp = LWIPERF_RR_TIMESTAMP();
+  tcp_output(conn->tcp_pcb);
+  return ERR_OK;
+}
+
+/** Send the next request as an UDP datagram: header followed by constant data */
+static void
+lwiperf_rr_udp_send(lwiperf_rr_session_t *conn)
+{
+  struct pbuf *hdr;
+  struct pbuf *data;
+  u16_t payload_len = conn->request_len - sizeof(lwiperf_rr_hdr_t);
+
+  conn->waiting = 1;
+  /* the transaction is lost if the datagram can't be sent */
+  sys_timeout(LWIPERF_RR_UDP_TIMEOUT_MS, lwiperf_rr_udp_tmr, conn);
+
+  hdr = pbuf_alloc(PBUF_TRANSPORT, sizeof(lwiperf_rr_hdr_t), PBUF_RAM);
+  if (hdr == NULL) {
+    return;
+  }
+  lwiperf_rr_fill_hdr(conn, (lwiperf_rr_hdr_t *)hdr->payload);
+  if (payload_len > 0) {
+    data = pbuf_alloc(PBUF_RAW, payload_len, PBUF_REF);
+    if (data == NULL) {
+      pbuf_free(hdr);
+      return;
+    }
+    data->payload = LWIP_CONST_CAST(void *, lwiperf_rr_txbuf);
+    pbuf_cat(hdr, data);
+  }
+  conn->request_timestamp = LWIPERF_RR_TIMESTAMP();
+  udp_send(conn->udp_pcb, hdr);
+  pbuf_free(hdr);
+}
+
+/** A response is complete: account it and send the next request
+ * @returns 1 if the test is over
+ */
+static u8_t
+lwiperf_rr_transaction_done(lwiperf_rr_session_t *conn)
+{
+  u32_t latency_us;
+
+  latency_us = LWIPERF_RR_TIMESTAMP_TO_US(LWIPERF_RR_TIMESTAMP() - conn->request_timestamp);
+  latency_histogram_add(&conn->latency, latency_us);
+  conn->waiting = 0;
+  conn->seq++;
+
+  if ((sys_now() - conn->time_started) >= conn->duration_ms) {
+    conn->time_ended = sys_now();
+    return 1;
+  }
+  return 0;
+}
+
+/** Receive a response on the TCP connection */
+static err_t
+lwiperf_rr_tcp_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)arg;
+
+  if ((err != ERR_OK) || (p == NULL)) {
+    if (p != NULL) {
+      pbuf_free(p);
+    }
+    /* connection closed by the peer */
+    return lwiperf_rr_close(conn, LWIPERF_TCP_ABORTED_REMOTE);
+  }
+  tcp_recved(tpcb, p->tot_len);
+  conn->rx_count += p->tot_len;
+  pbuf_free(p);
+
+  if (!conn->waiting) {
+    /* the peer sends more than requested */
+    return lwiperf_rr_close(conn, LWIPERF_TCP_ABORTED_LOCAL_DATAERROR);
+  }
+  if (conn->rx_count >= conn->response_len) {
+    conn->rx_count -= conn->response_len;
+    if (lwiperf_rr_transaction_done(conn)) {
+      return lwiperf_rr_close(conn, LWIPERF_TCP_DONE_CLIENT);
+    }
+    return lwiperf_rr_tcp_send(conn);
+  }
+  return ERR_OK;
+}
+
+/** TCP sent callback, queue a pending request */
+static err_t
+lwiperf_rr_tcp_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)arg;
+  LWIP_UNUSED_ARG(tpcb);
+  LWIP_UNUSED_ARG(len);
+
+  if (conn->send_pending) {
+    return lwiperf_rr_tcp_send(conn);
+  }
+  return ERR_OK;
+}
+
+/** TCP poll callback, abort the test if the peer doesn't answer */
+static err_t
+lwiperf_rr_tcp_poll(void *arg, struct tcp_pcb *tpcb)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)arg;
+  LWIP_UNUSED_ARG(tpcb);
+
+  if (++conn->idle_sec > LWIPERF_RR_TCP_TIMEOUT_SEC) {
+    return lwiperf_rr_close(conn, LWIPERF_TCP_ABORTED_LOCAL);
+  }
+  if (conn->send_pending) {
+    return lwiperf_rr_tcp_send(conn);
+  }
+  return ERR_OK;
+}
+
+/** TCP error callback, the pcb is already freed */
+static void
+lwiperf_rr_tcp_err(void *arg, err_t err)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)arg;
+  LWIP_UNUSED_ARG(err);
+
+  conn->tcp_pcb = NULL;
+  lwiperf_rr_close(conn, LWIPERF_TCP_ABORTED_REMOTE);
+}
+
+/** TCP connected callback, send the first request */
+static err_t
+lwiperf_rr_tcp_connected(void *arg, struct tcp_pcb *tpcb, err_t err)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)arg;
+
+  if (err != ERR_OK) {
+    return lwiperf_rr_close(conn, LWIPERF_TCP_ABORTED_REMOTE);
+  }
+  /* every request leaves at once */
+  tcp_nagle_disable(tpcb);
+  conn->time_started = sys_now();
+  return lwiperf_rr_tcp_send(conn);
+}
+
+/** Receive a response datagram */
+static void
+lwiperf_rr_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                    const ip_addr_t *addr, u16_t port)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)arg;
+  u32_t seq;
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+
+  if (!conn->waiting
+      || (pbuf_copy_partial(p, &seq, sizeof(seq), 0) != sizeof(seq))
+      || (lwip_ntohl(seq) != conn->seq)) {
+    /* late response of a lost transaction */
+    pbuf_free(p);
+    return;
+  }
+  pbuf_free(p);
+
+  sys_untimeout(lwiperf_rr_udp_tmr, conn);
+  if (lwiperf_rr_transaction_done(conn)) {
+    lwiperf_rr_close(conn, LWIPERF_UDP_DONE_CLIENT);
+    return;
+  }
+  lwiperf_rr_udp_send(conn);
+}
+
+/** UDP timer: the request or its response is lost */
+static void
+lwiperf_rr_udp_tmr(void *arg)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)arg;
+
+  conn->timeouts++;
+  conn->waiting = 0;
+  conn->seq++;
+  if ((sys_now() - conn->time_started) >= conn->duration_ms) {
+    conn->time_ended = sys_now();
+    lwiperf_rr_close(conn, LWIPERF_UDP_DONE_CLIENT);
+    return;
+  }
+  lwiperf_rr_udp_send(conn);
+}
+
+/**
+ * @ingroup iperf_rr
+ * Start a request/response benchmark against a peer.
+ *
+ * @param udp 1=UDP transactions, 0=TCP transactions
+ * @param request_len request length, from @ref LWIPERF_RR_MIN_REQUEST_LEN
+ * @param response_len response length, from @ref LWIPERF_RR_MIN_RESPONSE_LEN
+ * @returns a connection handle that can be used to abort the client
+ *          by calling @ref lwiperf_rr_abort(), it is freed once the test is reported
+ */
+void *
+lwiperf_rr_start_client(const ip_addr_t *remote_addr, u16_t remote_port,
+                        u8_t udp, u16_t request_len, u16_t response_len,
+                        u32_t duration_sec,
+                        lwiperf_rr_report_fn report_fn, void *report_arg)
+{
+  lwiperf_rr_session_t *conn;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if ((remote_addr == NULL) || (duration_sec == 0)
+      || (request_len < LWIPERF_RR_MIN_REQUEST_LEN) || (request_len > LWIPERF_RR_MAX_LEN)
+      || (response_len < LWIPERF_RR_MIN_RESPONSE_LEN) || (response_len > LWIPERF_RR_MAX_LEN)) {
+    return NULL;
+  }
+
+  conn = (lwiperf_rr_session_t *)LWIPERF_RR_ALLOC(lwiperf_rr_session_t);
+  if (conn == NULL) {
+    return NULL;
+  }
+  memset(conn, 0, sizeof(lwiperf_rr_session_t));
+  conn->udp = udp;
+  ip_addr_copy(conn->remote_addr, *remote_addr);
+  conn->remote_port = remote_port;
+  conn->request_len = request_len;
+  conn->response_len = response_len;
+  conn->duration_ms = duration_sec * 1000U;
+  conn->report_fn = report_fn;
+  conn->report_arg = report_arg;
+
+  if (udp) {
+    conn->udp_pcb = udp_new_ip_type(IP_GET_TYPE(remote_addr));
+    if ((conn->udp_pcb == NULL)
+        || (udp_connect(conn->udp_pcb, remote_addr, remote_port) != ERR_OK)) {
+      if (conn->udp_pcb != NULL) {
+        udp_remove(conn->udp_pcb);
+      }
+      LWIPERF_RR_FREE(lwiperf_rr_session_t, conn);
+      return NULL;
+    }
+    udp_recv(conn->udp_pcb, lwiperf_rr_udp_recv, conn);
+    conn->time_started = sys_now();
+    lwiperf_rr_udp_send(conn);
+  } else {
+    conn->tcp_pcb = tcp_new_ip_type(IP_GET_TYPE(remote_addr));
+    if (conn->tcp_pcb == NULL) {
+      LWIPERF_RR_FREE(lwiperf_rr_session_t, conn);
+      return NULL;
+    }
+    tcp_arg(conn->tcp_pcb, conn);
+    tcp_recv(conn->tcp_pcb, lwiperf_rr_tcp_recv);
+    tcp_sent(conn->tcp_pcb, lwiperf_rr_tcp_sent);
+    tcp_poll(conn->tcp_pcb, lwiperf_rr_tcp_poll, 2U);
+    tcp_err(conn->tcp_pcb, lwiperf_rr_tcp_err);
+    if (tcp_connect(conn->tcp_pcb, remote_addr, remote_port, lwiperf_rr_tcp_connected) != ERR_OK) {
+      tcp_arg(conn->tcp_pcb, NULL);
+      tcp_err(conn->tcp_pcb, NULL);
+      tcp_abort(conn->tcp_pcb);
+      LWIPERF_RR_FREE(lwiperf_rr_session_t, conn);
+      return NULL;
+    }
+  }
+  return conn;
+}
+
+/**
+ * @ingroup iperf_rr
+ * Abort a running benchmark, it is reported as aborted and freed.
+ */
+void
+lwiperf_rr_abort(void *lwiperf_rr_session)
+{
+  lwiperf_rr_session_t *conn = (lwiperf_rr_session_t *)lwiperf_rr_session;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  lwiperf_rr_close(conn, conn->udp ? LWIPERF_UDP_ABORTED_LOCAL : LWIPERF_TCP_ABORTED_LOCAL);
+}
+
+#endif /* LWIP_TCP && LWIP_UDP && LWIP_CALLBACK_API */
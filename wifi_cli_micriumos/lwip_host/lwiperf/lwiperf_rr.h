@@ -0,0 +1,85 @@
+/**
+ * @file
+ * lwIP request/response latency benchmark
+ */
+
+/*
+ * Copyright 2022 Silicon Laboratories Inc. www.silabs.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LWIP_HDR_APPS_LWIPERF_RR_H
+#define LWIP_HDR_APPS_LWIPERF_RR_H
+
+#include "lwip/opt.h"
+#include "lwip/ip_addr.h"
+#include "lwiperf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LWIPERF_RR_PORT_DEFAULT     5003
+
+/** Every request starts with this header, network byte order.
+    The response starts with the sequence number of its request. */
+typedef struct _lwiperf_rr_hdr
+{
+  u32_t seq;
+  u32_t request_len;
+  u32_t response_len;
+} lwiperf_rr_hdr_t;
+
+/** Smallest request and response */
+#define LWIPERF_RR_MIN_REQUEST_LEN  sizeof(lwiperf_rr_hdr_t)
+#define LWIPERF_RR_MIN_RESPONSE_LEN sizeof(u32_t)
+
+/** Largest request and response, one UDP datagram without fragmentation */
+#define LWIPERF_RR_MAX_LEN          1472
+
+/** Request/response benchmark results, latencies in microseconds */
+typedef struct _lwiperf_rr_results
+{
+  u32_t transactions;
+  /** UDP requests or responses lost */
+  u32_t timeouts;
+  u32_t ms_duration;
+  /** Transactions per second, x100 */
+  u32_t rate_x100;
+  u32_t min_us;
+  u32_t avg_us;
+  u32_t max_us;
+  u32_t p50_us;
+  u32_t p90_us;
+  u32_t p99_us;
+  u32_t p999_us;
+} lwiperf_rr_results_t;
+
+/** Prototype of a report function that is called when a benchmark is finished.
+    @param report_type contains the test result
+    @param results valid during the call only */
+typedef void (*lwiperf_rr_report_fn)(void *arg, enum lwiperf_report_type report_type,
+  const ip_addr_t* remote_addr, u16_t remote_port, const lwiperf_rr_results_t *results);
+
+void* lwiperf_rr_start_client(const ip_addr_t* remote_addr, u16_t remote_port,
+                              u8_t udp, u16_t request_len, u16_t response_len,
+                              u32_t duration_sec,
+                              lwiperf_rr_report_fn report_fn, void* report_arg);
+void  lwiperf_rr_abort(void* lwiperf_rr_session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_HDR_APPS_LWIPERF_RR_H */
@@ -31,21 +31,26 @@
 /* Memory options */
 #define MEM_ALIGNMENT           4
 
-/* the size of the heap memory.  */
-#define MEM_SIZE                (20 * 1024)
+/* the size of the heap memory: a full TCP send buffer, the segments of a
+   bulk sender being allocated there, plus the room needed by the other
+   connections, the UDP and ICMP frames and the iPerf3 control messages. */
+#define MEM_SIZE                (TCP_SND_BUF + 10 * 1024)
 
 /* the number of memp struct pbufs. */
 #define MEMP_NUM_PBUF           10
-/* the number of UDP protocol control blocks. One per active UDP "connection". */
-#define MEMP_NUM_UDP_PCB        6
+/* the number of UDP protocol control blocks. One per active UDP "connection"
+   (including the iPerf3 client streams). */
+#define MEMP_NUM_UDP_PCB        10
 /* the number of simultaneously active TCP connections. */
 #define MEMP_NUM_TCP_PCB        10
 /* the number of listening TCP connections. */
 #define MEMP_NUM_TCP_PCB_LISTEN 5
 /* the number of simultaneously queued TCP segments. */
-#define MEMP_NUM_TCP_SEG        16
-/*  the number of simultaneously active timeouts. */
-#define MEMP_NUM_SYS_TIMEOUT    10
+#define MEMP_NUM_TCP_SEG        TCP_SND_QUEUELEN
+/*  the number of simultaneously active timeouts (including the TCP tuning,
+    the iPerf TCP client listener, the iPerf UDP client & server, the iPerf3,
+    the RR benchmark, the DHCP server lease and the DHCP client fallback ones). */
+#define MEMP_NUM_SYS_TIMEOUT    19
 
 // pbuf options
 /* the number of buffers in the pbuf pool. */
@@ -65,15 +70,18 @@
 /* TCP Maximum segment size. */
 #define TCP_MSS                 (1500 - 40)
 
-/* TCP sender buffer space (bytes). */
-#define TCP_SND_BUF             (8 * TCP_MSS)
+/* TCP sender buffer space (bytes). This is an upper bound, the
+   allowance of each connection is tuned at runtime from the memory
+   pressure (see tcp_autotune.h). */
+#define TCP_SND_BUF             (12 * TCP_MSS)
 
 /*  TCP sender buffer space (pbufs). This must be at least
    as much as (2 * TCP_SND_BUF/TCP_MSS) for things to work. */
 #define TCP_SND_QUEUELEN        (2 * TCP_SND_BUF / TCP_MSS)
 
-/* TCP receive window. */
-#define TCP_WND                 (8 * TCP_MSS)
+/* TCP receive window. This is an upper bound, limited by the
+   pbuf pool, tuned at runtime as TCP_SND_BUF. */
+#define TCP_WND                 (10 * TCP_MSS)
 
 /* ICMP options */
 #define LWIP_ICMP                       1
@@ -81,6 +89,9 @@
 /* DHCP options */
 #define LWIP_DHCP               1
 #define ETHARP_SUPPORT_STATIC_ENTRIES 1
+/* ARP entries: the DHCP server adds a static one per SoftAP client
+   (DHCPS_LEASE_MAX), the others are for the station peers. */
+#define ARP_TABLE_SIZE          40
 
 /* UDP options */
 #define LWIP_UDP                1
@@ -96,6 +107,8 @@
  * whenever the link changes (i.e., link down)
  */
 #define LWIP_NETIF_LINK_CALLBACK        1
+/* The DHCP client waits for its address with the status callback */
+#define LWIP_NETIF_STATUS_CALLBACK      1
 #define LWIP_NETIF_API                  1
 
 // Checksum options
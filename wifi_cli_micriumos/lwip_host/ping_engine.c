@@ -0,0 +1,434 @@
+/***************************************************************************//**
+ * @file
+ * @brief Concurrent ICMP echo engine with microsecond RTT statistics
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "lwip/tcpip.h"
+#include "lwip/raw.h"
+#include "lwip/icmp.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/ip4.h"
+#include "latency_trace.h"
+#include "latency_histogram.h"
+#include "ping_engine.h"
+
+#if LWIP_RAW
+
+/// Request waiting for its reply.
+typedef struct {
+  bool used;
+  uint8_t target;
+  uint16_t seqno;
+  uint16_t size;
+  uint32_t sent_cycles;     ///< RTT time base (CPU cycles)
+  uint32_t sent_ms;         ///< Timeout time base
+} ping_engine_request_t;
+
+/// RTT statistics of a payload size.
+typedef struct {
+  uint16_t size;
+  uint32_t received;
+  uint64_t total_us;
+} ping_engine_size_stats_t;
+
+/// State and statistics of a target.
+typedef struct {
+  uint16_t seqno;
+  uint16_t next_size;
+  uint32_t sent;
+  uint32_t lost;
+  uint32_t late;            ///< Replies received after their timeout
+  uint8_t outstanding;
+  uint32_t last_sent_ms;
+  latency_histogram_t rtt;  ///< RTTs of the replies received
+  uint64_t total_sq_us;     ///< Sum of the squared RTTs, for the deviation
+  ping_engine_size_stats_t sizes[PING_ENGINE_MAX_SWEEP_STEPS];
+} ping_engine_target_t;
+
+static ping_engine_config_t cfg;
+static ping_engine_target_t targets[PING_ENGINE_MAX_TARGETS];
+static ping_engine_request_t requests[PING_ENGINE_MAX_OUTSTANDING];
+static uint8_t size_step_nb = 0;
+static sys_sem_t reply_sem;
+
+/***************************************************************************//**
+ * Integer square root.
+ ******************************************************************************/
+static uint32_t ping_engine_sqrt(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = 1ULL << 62;
+
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/***************************************************************************//**
+ * Record the RTT of a reply.
+ ******************************************************************************/
+static void ping_engine_record(ping_engine_target_t *target,
+                               uint16_t size,
+                               uint32_t rtt_us)
+{
+  latency_histogram_add(&target->rtt, rtt_us);
+  target->total_sq_us += (uint64_t)rtt_us * rtt_us;
+
+  for (uint8_t i = 0; i < size_step_nb; i++) {
+    if (target->sizes[i].size == size) {
+      target->sizes[i].received++;
+      target->sizes[i].total_us += rtt_us;
+      break;
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Handle the ICMP messages, called from the TCP/IP thread.
+ ******************************************************************************/
+static u8_t ping_engine_recv(void *arg,
+                             struct raw_pcb *pcb,
+                             struct pbuf *p,
+                             const ip_addr_t *addr)
+{
+  uint32_t now_cycles = latency_trace_timestamp();
+  struct icmp_echo_hdr *iecho;
+  ping_engine_request_t *request;
+  ping_engine_target_t *target;
+  uint32_t rtt_us;
+  uint8_t i;
+  (void)arg;
+  (void)pcb;
+
+  if ((p->tot_len < (PBUF_IP_HLEN + sizeof(struct icmp_echo_hdr)))
+      || (pbuf_remove_header(p, PBUF_IP_HLEN) != 0)) {
+    return 0;
+  }
+
+  iecho = (struct icmp_echo_hdr *)p->payload;
+  if ((ICMPH_TYPE(iecho) != ICMP_ER) || (iecho->id != PING_ENGINE_ID)) {
+    /* Not a reply to the engine, restore the original packet */
+    pbuf_add_header(p, PBUF_IP_HLEN);
+    return 0;
+  }
+
+  for (i = 0; i < PING_ENGINE_MAX_OUTSTANDING; i++) {
+    request = &requests[i];
+    if (request->used
+        && (request->seqno == lwip_ntohs(iecho->seqno))
+        && ip_addr_cmp(&cfg.targets[request->target], addr)) {
+      break;
+    }
+  }
+
+  if (i < PING_ENGINE_MAX_OUTSTANDING) {
+    target = &targets[request->target];
+    rtt_us = latency_trace_cycles_to_us(now_cycles - request->sent_cycles);
+    ping_engine_record(target, request->size, rtt_us);
+    target->outstanding--;
+    request->used = false;
+    if (!cfg.quiet) {
+      printf("Reply from %s: bytes=%u seq=%u time=%lu.%03lums\r\n",
+             ipaddr_ntoa(addr),
+             request->size,
+             request->seqno,
+             rtt_us / 1000,
+             rtt_us % 1000);
+    }
+    sys_sem_signal(&reply_sem);
+  } else {
+    /* Reply to a request already given up */
+    for (i = 0; i < cfg.target_nb; i++) {
+      if (ip_addr_cmp(&cfg.targets[i], addr)) {
+        targets[i].late++;
+        break;
+      }
+    }
+  }
+
+  pbuf_free(p);
+  return 1;
+}
+
+/***************************************************************************//**
+ * Send the next request to a target, with the TCP/IP core locked.
+ ******************************************************************************/
+static int ping_engine_send(struct raw_pcb *pcb, uint8_t target_index)
+{
+  ping_engine_target_t *target = &targets[target_index];
+  ping_engine_request_t *request = NULL;
+  struct icmp_echo_hdr *iecho;
+  struct pbuf *p;
+  uint16_t size = target->next_size;
+  err_t err;
+
+  for (uint8_t i = 0; i < PING_ENGINE_MAX_OUTSTANDING; i++) {
+    if (!requests[i].used) {
+      request = &requests[i];
+      break;
+    }
+  }
+  if (request == NULL) {
+    /* Retry once a request is answered or lost */
+    return -1;
+  }
+
+  p = pbuf_alloc(PBUF_IP, sizeof(struct icmp_echo_hdr) + size, PBUF_RAM);
+  if (p == NULL) {
+    return -1;
+  }
+  iecho = (struct icmp_echo_hdr *)p->payload;
+  ICMPH_TYPE_SET(iecho, ICMP_ECHO);
+  ICMPH_CODE_SET(iecho, 0);
+  iecho->chksum = 0;
+  iecho->id = PING_ENGINE_ID;
+  iecho->seqno = lwip_htons(++target->seqno);
+  for (uint16_t i = 0; i < size; i++) {
+    ((uint8_t *)iecho)[sizeof(struct icmp_echo_hdr) + i] = (uint8_t)i;
+  }
+  iecho->chksum = inet_chksum(iecho, p->len);
+
+  request->sent_cycles = latency_trace_timestamp();
+  err = raw_sendto(pcb, p, &cfg.targets[target_index]);
+  pbuf_free(p);
+  if (err != ERR_OK) {
+    target->seqno--;
+    return -1;
+  }
+
+  request->used = true;
+  request->target = target_index;
+  request->seqno = target->seqno;
+  request->size = size;
+  request->sent_ms = sys_now();
+  target->last_sent_ms = request->sent_ms;
+  target->outstanding++;
+  target->sent++;
+
+  /* Next size of the sweep */
+  target->next_size = size + cfg.size_step;
+  if ((cfg.size_step == 0) || (target->next_size > cfg.size_max)) {
+    target->next_size = cfg.size_min;
+  }
+  return 0;
+}
+
+/***************************************************************************//**
+ * Give up the requests without reply, with the TCP/IP core locked.
+ ******************************************************************************/
+static void ping_engine_expire(uint32_t now_ms)
+{
+  ping_engine_request_t *request;
+
+  for (uint8_t i = 0; i < PING_ENGINE_MAX_OUTSTANDING; i++) {
+    request = &requests[i];
+    if (request->used && ((now_ms - request->sent_ms) >= cfg.timeout_ms)) {
+      request->used = false;
+      targets[request->target].outstanding--;
+      targets[request->target].lost++;
+      if (!cfg.quiet) {
+        printf("Request timed out: %s seq=%u\r\n",
+               ipaddr_ntoa(&cfg.targets[request->target]),
+               request->seqno);
+      }
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Ping the targets until every request is answered or lost.
+ ******************************************************************************/
+int ping_engine_run(const ping_engine_config_t *config)
+{
+  struct raw_pcb *pcb;
+  ping_engine_target_t *target;
+  uint32_t now_ms;
+  uint32_t wait_ms;
+  uint32_t elapsed_ms;
+  bool done;
+
+  if ((config == NULL)
+      || (config->target_nb == 0) || (config->target_nb > PING_ENGINE_MAX_TARGETS)
+      || (config->count == 0) || (config->window == 0) || (config->timeout_ms == 0)
+      || (config->size_min > config->size_max) || (config->size_max > PING_ENGINE_MAX_SIZE)
+      || ((config->size_step == 0) && (config->size_min != config->size_max))) {
+    return -1;
+  }
+
+  if (sys_sem_new(&reply_sem, 0) != ERR_OK) {
+    return -1;
+  }
+
+  LOCK_TCPIP_CORE();
+  pcb = raw_new(IP_PROTO_ICMP);
+  if (pcb == NULL) {
+    UNLOCK_TCPIP_CORE();
+    sys_sem_free(&reply_sem);
+    return -1;
+  }
+
+  cfg = *config;
+  memset(targets, 0, sizeof(targets));
+  memset(requests, 0, sizeof(requests));
+  size_step_nb = 0;
+  if (cfg.size_step != 0) {
+    for (uint32_t size = cfg.size_min;
+         (size <= cfg.size_max) && (size_step_nb < PING_ENGINE_MAX_SWEEP_STEPS);
+         size += cfg.size_step) {
+      for (uint8_t i = 0; i < cfg.target_nb; i++) {
+        targets[i].sizes[size_step_nb].size = (uint16_t)size;
+      }
+      size_step_nb++;
+    }
+  }
+  for (uint8_t i = 0; i < cfg.target_nb; i++) {
+    targets[i].next_size = cfg.size_min;
+  }
+
+  raw_recv(pcb, ping_engine_recv, NULL);
+  raw_bind(pcb, IP_ADDR_ANY);
+  UNLOCK_TCPIP_CORE();
+
+  do {
+    done = true;
+    wait_ms = cfg.timeout_ms;
+
+    LOCK_TCPIP_CORE();
+    now_ms = sys_now();
+    ping_engine_expire(now_ms);
+
+    for (uint8_t i = 0; i < cfg.target_nb; i++) {
+      target = &targets[i];
+      if (target->sent < cfg.count) {
+        done = false;
+        elapsed_ms = now_ms - target->last_sent_ms;
+        if ((target->outstanding < cfg.window)
+            && ((target->sent == 0) || (elapsed_ms >= cfg.interval_ms))) {
+          if (ping_engine_send(pcb, i) == 0) {
+            elapsed_ms = 0;
+          }
+        }
+        if ((target->outstanding < cfg.window) && (cfg.interval_ms > elapsed_ms)) {
+          wait_ms = LWIP_MIN(wait_ms, cfg.interval_ms - elapsed_ms);
+        } else if (target->outstanding < cfg.window) {
+          /* Flood mode or send failure: retry as soon as possible */
+          wait_ms = 1;
+        }
+      } else if (target->outstanding > 0) {
+        done = false;
+      }
+    }
+    UNLOCK_TCPIP_CORE();
+
+    if (!done) {
+      /* Woken up by a reply, or when the next request or timeout is due */
+      sys_arch_sem_wait(&reply_sem, LWIP_MAX(wait_ms, 1));
+    }
+  } while (!done);
+
+  LOCK_TCPIP_CORE();
+  raw_remove(pcb);
+  UNLOCK_TCPIP_CORE();
+  sys_sem_free(&reply_sem);
+
+  ping_engine_display();
+  return 0;
+}
+
+/***************************************************************************//**
+ * Display the RTT statistics and histogram of the last run.
+ ******************************************************************************/
+void ping_engine_display(void)
+{
+  ping_engine_target_t *target;
+  uint32_t avg_us;
+  uint32_t mdev_us;
+  uint32_t percentile_us;
+  static const uint16_t percentiles[] = { 500, 900, 990, 999 };
+
+  for (uint8_t i = 0; i < cfg.target_nb; i++) {
+    target = &targets[i];
+
+    printf("\r\n--- %s ping statistics ---\r\n", ipaddr_ntoa(&cfg.targets[i]));
+    printf("%lu packets transmitted, %lu received, %lu lost (%lu%% loss), %lu late\r\n",
+           target->sent,
+           target->rtt.count,
+           target->lost,
+           (target->sent > 0) ? ((target->lost * 100) / target->sent) : 0,
+           target->late);
+    if (target->rtt.count == 0) {
+      continue;
+    }
+
+    avg_us = (uint32_t)(target->rtt.total_us / target->rtt.count);
+    mdev_us = ping_engine_sqrt((target->total_sq_us / target->rtt.count)
+                               - ((uint64_t)avg_us * avg_us));
+    printf("rtt min/avg/max/mdev = %lu.%03lu/%lu.%03lu/%lu.%03lu/%lu.%03lu ms\r\n",
+           target->rtt.min_us / 1000, target->rtt.min_us % 1000,
+           avg_us / 1000, avg_us % 1000,
+           target->rtt.max_us / 1000, target->rtt.max_us % 1000,
+           mdev_us / 1000, mdev_us % 1000);
+
+    printf("rtt p50/p90/p99/p99.9 =");
+    for (uint8_t j = 0; j < sizeof(percentiles) / sizeof(percentiles[0]); j++) {
+      percentile_us = latency_histogram_percentile(&target->rtt, percentiles[j]);
+      printf("%s%lu.%03lu", (j == 0) ? " " : "/", percentile_us / 1000, percentile_us % 1000);
+    }
+    printf(" ms\r\n");
+
+    for (uint8_t j = 0; j < LATENCY_HISTOGRAM_BUCKET_NB; j++) {
+      if (target->rtt.buckets[j] == 0) {
+        continue;
+      }
+      if (j == (LATENCY_HISTOGRAM_BUCKET_NB - 1)) {
+        printf("  [%lu, +inf[ us: %lu\r\n", latency_histogram_bucket_low(j), target->rtt.buckets[j]);
+      } else {
+        printf("  [%lu, %lu[ us: %lu\r\n",
+               latency_histogram_bucket_low(j),
+               latency_histogram_bucket_low(j + 1),
+               target->rtt.buckets[j]);
+      }
+    }
+
+    for (uint8_t j = 0; j < size_step_nb; j++) {
+      if (target->sizes[j].received == 0) {
+        continue;
+      }
+      avg_us = (uint32_t)(target->sizes[j].total_us / target->sizes[j].received);
+      printf("  size %4u: %lu replies, avg %lu.%03lu ms\r\n",
+             target->sizes[j].size,
+             target->sizes[j].received,
+             avg_us / 1000,
+             avg_us % 1000);
+    }
+  }
+}
+
+#endif
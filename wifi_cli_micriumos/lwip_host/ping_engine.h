@@ -0,0 +1,83 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef PING_ENGINE_H
+#define PING_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/ip_addr.h"
+
+/// Identifier of the echo requests sent by the engine.
+#ifndef PING_ENGINE_ID
+#define PING_ENGINE_ID                0xAFAF      /*!< LSB = MSB */
+#endif
+
+/// Number of targets pinged concurrently.
+#ifndef PING_ENGINE_MAX_TARGETS
+#define PING_ENGINE_MAX_TARGETS       4
+#endif
+
+/// Number of requests waiting for a reply, all targets included.
+#ifndef PING_ENGINE_MAX_OUTSTANDING
+#define PING_ENGINE_MAX_OUTSTANDING   16
+#endif
+
+/// Number of payload sizes of a sweep with their own statistics.
+#ifndef PING_ENGINE_MAX_SWEEP_STEPS
+#define PING_ENGINE_MAX_SWEEP_STEPS   16
+#endif
+
+/// Largest payload, an echo request is not fragmented.
+#define PING_ENGINE_MAX_SIZE          1472
+
+/// Ping configuration
+typedef struct {
+  ip_addr_t targets[PING_ENGINE_MAX_TARGETS];
+  uint8_t target_nb;
+  uint32_t count;           ///< Requests per target
+  uint32_t interval_ms;     ///< Delay between the requests of a target, 0 for the flood mode
+  uint16_t size_min;        ///< Payload size, or first size of a sweep
+  uint16_t size_max;        ///< Last size of a sweep, size_min if no sweep
+  uint16_t size_step;       ///< Size increment of a sweep
+  uint8_t window;           ///< Requests of a target waiting for a reply
+  uint32_t timeout_ms;      ///< Time after which a request is lost
+  bool quiet;               ///< Display the statistics only
+} ping_engine_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Ping the targets until every request is answered or lost, then display the
+ * statistics of each target. The caller task is blocked meanwhile.
+ *
+ * @param config ping configuration
+ * @returns 0 if success, -1 if the configuration or the resources are invalid
+ ******************************************************************************/
+int ping_engine_run(const ping_engine_config_t *config);
+
+/***************************************************************************//**
+ * Display the RTT statistics and histogram of the last run.
+ ******************************************************************************/
+void ping_engine_display(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,308 @@
+/***************************************************************************//**
+ * @file
+ * @brief TCP window and send buffer tuning from the LwIP memory pressure
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "lwip/tcpip.h"
+#include "lwip/stats.h"
+#include "lwip/timeouts.h"
+#include "lwip/priv/tcp_priv.h"
+#include "tcp_autotune.h"
+
+#if LWIP_TCP
+
+/// Window and send buffer withheld from a connection.
+typedef struct {
+  struct tcp_pcb *pcb;
+  u16_t local_port;
+  u16_t remote_port;
+  tcpwnd_size_t wnd_cut;
+  tcpwnd_size_t snd_cut;
+} tcp_autotune_entry_t;
+
+static tcp_autotune_entry_t entries[MEMP_NUM_TCP_PCB];
+static bool tcp_autotune_started = false;
+static uint8_t last_pressure = 0;
+static uint32_t adjustment_count = 0;
+
+/***************************************************************************//**
+ * Compute the usage ratio (%) of a memory statistic.
+ ******************************************************************************/
+static uint8_t tcp_autotune_usage(const struct stats_mem *mem)
+{
+  if ((mem == NULL) || (mem->avail == 0)) {
+    return 0;
+  }
+  return (uint8_t)((mem->used * 100) / mem->avail);
+}
+
+/***************************************************************************//**
+ * Compute the memory pressure (%) from the heap and pools used by TCP.
+ ******************************************************************************/
+static uint8_t tcp_autotune_pressure(void)
+{
+  uint8_t pressure = 0;
+  uint8_t usage;
+
+#if MEM_STATS
+  pressure = tcp_autotune_usage(&lwip_stats.mem);
+#endif
+#if MEMP_STATS
+  usage = tcp_autotune_usage(lwip_stats.memp[MEMP_PBUF_POOL]);
+  pressure = LWIP_MAX(pressure, usage);
+  usage = tcp_autotune_usage(lwip_stats.memp[MEMP_TCP_SEG]);
+  pressure = LWIP_MAX(pressure, usage);
+#else
+  (void)usage;
+#endif
+
+  return pressure;
+}
+
+/***************************************************************************//**
+ * Scale an allowance between its bounds according to the memory pressure.
+ ******************************************************************************/
+static u32_t tcp_autotune_scale(u32_t min, u32_t max, uint8_t pressure)
+{
+  if (pressure <= TCP_AUTOTUNE_PRESSURE_LOW) {
+    return max;
+  }
+  if (pressure >= TCP_AUTOTUNE_PRESSURE_HIGH) {
+    return min;
+  }
+  return max - ((max - min) * (pressure - TCP_AUTOTUNE_PRESSURE_LOW))
+         / (TCP_AUTOTUNE_PRESSURE_HIGH - TCP_AUTOTUNE_PRESSURE_LOW);
+}
+
+/***************************************************************************//**
+ * Find the entry of a connection, a new one is set up if needed.
+ ******************************************************************************/
+static tcp_autotune_entry_t *tcp_autotune_get_entry(struct tcp_pcb *pcb)
+{
+  tcp_autotune_entry_t *free_entry = NULL;
+
+  for (uint8_t i = 0; i < MEMP_NUM_TCP_PCB; i++) {
+    if (entries[i].pcb == pcb) {
+      if ((entries[i].local_port == pcb->local_port)
+          && (entries[i].remote_port == pcb->remote_port)) {
+        return &entries[i];
+      }
+      /* The PCB was recycled for another connection */
+      free_entry = &entries[i];
+      break;
+    }
+    if ((free_entry == NULL) && (entries[i].pcb == NULL)) {
+      free_entry = &entries[i];
+    }
+  }
+
+  if (free_entry != NULL) {
+    free_entry->pcb = pcb;
+    free_entry->local_port = pcb->local_port;
+    free_entry->remote_port = pcb->remote_port;
+    free_entry->wnd_cut = 0;
+    free_entry->snd_cut = 0;
+  }
+  return free_entry;
+}
+
+/***************************************************************************//**
+ * Move the allowance of a connection to its target.
+ ******************************************************************************/
+static void tcp_autotune_apply(tcp_autotune_entry_t *entry,
+                               u32_t wnd_target,
+                               u32_t snd_target)
+{
+  struct tcp_pcb *pcb = entry->pcb;
+  tcpwnd_size_t cut;
+  tcpwnd_size_t delta;
+  tcpwnd_size_t unannounced = 0;
+  u32_t announced;
+
+  /* Receive window: shrink what is not advertised yet, the announced
+     window is never retracted */
+  announced = pcb->rcv_ann_right_edge - pcb->rcv_nxt;
+  if (pcb->rcv_wnd > announced) {
+    unannounced = (tcpwnd_size_t)(pcb->rcv_wnd - announced);
+  }
+  cut = (tcpwnd_size_t)(TCP_WND_MAX(pcb) - LWIP_MIN(wnd_target, TCP_WND_MAX(pcb)));
+  if (cut > entry->wnd_cut) {
+    delta = LWIP_MIN(cut - entry->wnd_cut, unannounced);
+    pcb->rcv_wnd -= delta;
+    entry->wnd_cut += delta;
+    adjustment_count += (delta > 0);
+  } else if (cut < entry->wnd_cut) {
+    delta = entry->wnd_cut - cut;
+    entry->wnd_cut = cut;
+    tcp_recved(pcb, delta);
+    adjustment_count++;
+  }
+
+  /* Send buffer: lwIP gives back the acknowledged bytes to snd_buf,
+     the withheld part stays out of it until released */
+  cut = (tcpwnd_size_t)(TCP_SND_BUF - LWIP_MIN(snd_target, TCP_SND_BUF));
+  if (cut > entry->snd_cut) {
+    delta = LWIP_MIN(cut - entry->snd_cut, pcb->snd_buf);
+    pcb->snd_buf -= delta;
+    entry->snd_cut += delta;
+    adjustment_count += (delta > 0);
+  } else if (cut < entry->snd_cut) {
+    delta = entry->snd_cut - cut;
+    entry->snd_cut = cut;
+    pcb->snd_buf += delta;
+    adjustment_count++;
+  }
+}
+
+/***************************************************************************//**
+ * Forget the connections which are not active anymore.
+ ******************************************************************************/
+static void tcp_autotune_purge(void)
+{
+  struct tcp_pcb *pcb;
+
+  for (uint8_t i = 0; i < MEMP_NUM_TCP_PCB; i++) {
+    if (entries[i].pcb == NULL) {
+      continue;
+    }
+    for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+      if (pcb == entries[i].pcb) {
+        break;
+      }
+    }
+    if (pcb == NULL) {
+      entries[i].pcb = NULL;
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Periodic tuning, called from the TCP/IP thread.
+ ******************************************************************************/
+static void tcp_autotune_timer(void *arg)
+{
+  struct tcp_pcb *pcb;
+  tcp_autotune_entry_t *entry;
+  uint8_t conn_count = 0;
+  u32_t wnd_target;
+  u32_t snd_target;
+  (void)arg;
+
+  tcp_autotune_purge();
+
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    if ((pcb->state == ESTABLISHED) || (pcb->state == CLOSE_WAIT)) {
+      conn_count++;
+    }
+  }
+
+  last_pressure = tcp_autotune_pressure();
+
+  if (conn_count > 0) {
+    /* The connections share the allowance permitted by the memory pressure */
+    wnd_target = tcp_autotune_scale(TCP_AUTOTUNE_WND_MIN, TCP_AUTOTUNE_WND_MAX, last_pressure) / conn_count;
+    wnd_target = LWIP_MAX(wnd_target, TCP_AUTOTUNE_WND_MIN);
+    snd_target = tcp_autotune_scale(TCP_AUTOTUNE_SND_BUF_MIN, TCP_AUTOTUNE_SND_BUF_MAX, last_pressure) / conn_count;
+    snd_target = LWIP_MAX(snd_target, TCP_AUTOTUNE_SND_BUF_MIN);
+
+    for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+      if ((pcb->state != ESTABLISHED) && (pcb->state != CLOSE_WAIT)) {
+        continue;
+      }
+      entry = tcp_autotune_get_entry(pcb);
+      if (entry != NULL) {
+        tcp_autotune_apply(entry, wnd_target, snd_target);
+      }
+    }
+  }
+
+  sys_timeout(TCP_AUTOTUNE_INTERVAL_MS, tcp_autotune_timer, NULL);
+}
+
+/***************************************************************************//**
+ * Start the periodic TCP window and send buffer tuning.
+ ******************************************************************************/
+void tcp_autotune_start(void)
+{
+  LOCK_TCPIP_CORE();
+  if (!tcp_autotune_started) {
+    memset(entries, 0, sizeof(entries));
+    sys_timeout(TCP_AUTOTUNE_INTERVAL_MS, tcp_autotune_timer, NULL);
+    tcp_autotune_started = true;
+  }
+  UNLOCK_TCPIP_CORE();
+}
+
+/***************************************************************************//**
+ * Stop the TCP tuning and give back the full window and send buffer to
+ * the connections.
+ ******************************************************************************/
+void tcp_autotune_stop(void)
+{
+  LOCK_TCPIP_CORE();
+  if (tcp_autotune_started) {
+    sys_untimeout(tcp_autotune_timer, NULL);
+    tcp_autotune_purge();
+    for (uint8_t i = 0; i < MEMP_NUM_TCP_PCB; i++) {
+      if (entries[i].pcb != NULL) {
+        tcp_autotune_apply(&entries[i], TCP_WND_MAX(entries[i].pcb), TCP_SND_BUF);
+        entries[i].pcb = NULL;
+      }
+    }
+    tcp_autotune_started = false;
+  }
+  UNLOCK_TCPIP_CORE();
+}
+
+/***************************************************************************//**
+ * Return the TCP tuning state.
+ ******************************************************************************/
+bool tcp_autotune_is_started(void)
+{
+  return tcp_autotune_started;
+}
+
+/***************************************************************************//**
+ * Display the memory pressure and the allowance of each connection.
+ ******************************************************************************/
+void tcp_autotune_display(void)
+{
+  LOCK_TCPIP_CORE();
+  tcp_autotune_purge();
+  printf("TCP tuning %s, memory pressure %u%%, %lu adjustments\r\n",
+         tcp_autotune_started ? "on" : "off",
+         tcp_autotune_started ? last_pressure : tcp_autotune_pressure(),
+         adjustment_count);
+  for (uint8_t i = 0; i < MEMP_NUM_TCP_PCB; i++) {
+    if (entries[i].pcb == NULL) {
+      continue;
+    }
+    printf("%5u <-> %5u: wnd %5lu (rcv_wnd %5lu), snd_buf %5lu (free %5lu)\r\n",
+           entries[i].local_port,
+           entries[i].remote_port,
+           (u32_t)(TCP_WND_MAX(entries[i].pcb) - entries[i].wnd_cut),
+           (u32_t)entries[i].pcb->rcv_wnd,
+           (u32_t)(TCP_SND_BUF - entries[i].snd_cut),
+           (u32_t)entries[i].pcb->snd_buf);
+  }
+  UNLOCK_TCPIP_CORE();
+}
+
+#endif
@@ -0,0 +1,84 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef TCP_AUTOTUNE_H
+#define TCP_AUTOTUNE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/opt.h"
+
+/// Period of the window and send buffer adjustments.
+#ifndef TCP_AUTOTUNE_INTERVAL_MS
+#define TCP_AUTOTUNE_INTERVAL_MS    250
+#endif
+
+/// Receive window bounds, the upper bound can't exceed TCP_WND.
+#ifndef TCP_AUTOTUNE_WND_MIN
+#define TCP_AUTOTUNE_WND_MIN        (2 * TCP_MSS)
+#endif
+#ifndef TCP_AUTOTUNE_WND_MAX
+#define TCP_AUTOTUNE_WND_MAX        TCP_WND
+#endif
+
+/// Send buffer bounds, the upper bound can't exceed TCP_SND_BUF.
+#ifndef TCP_AUTOTUNE_SND_BUF_MIN
+#define TCP_AUTOTUNE_SND_BUF_MIN    (2 * TCP_MSS)
+#endif
+#ifndef TCP_AUTOTUNE_SND_BUF_MAX
+#define TCP_AUTOTUNE_SND_BUF_MAX    TCP_SND_BUF
+#endif
+
+/// Memory pressure (%) under which the connections share the upper bounds.
+#ifndef TCP_AUTOTUNE_PRESSURE_LOW
+#define TCP_AUTOTUNE_PRESSURE_LOW   50
+#endif
+
+/// Memory pressure (%) above which the connections get the lower bounds.
+#ifndef TCP_AUTOTUNE_PRESSURE_HIGH
+#define TCP_AUTOTUNE_PRESSURE_HIGH  85
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Start the periodic TCP window and send buffer tuning.
+ ******************************************************************************/
+void tcp_autotune_start(void);
+
+/***************************************************************************//**
+ * Stop the TCP tuning and give back the full window and send buffer to
+ * the connections.
+ ******************************************************************************/
+void tcp_autotune_stop(void);
+
+/***************************************************************************//**
+ * Return the TCP tuning state.
+ ******************************************************************************/
+bool tcp_autotune_is_started(void);
+
+/***************************************************************************//**
+ * Display the memory pressure and the allowance of each connection.
+ ******************************************************************************/
+void tcp_autotune_display(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
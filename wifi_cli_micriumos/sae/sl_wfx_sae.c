@@ -24,6 +24,7 @@
 #include "common/ieee802_11_defs.h"
 #include "sl_wfx.h"
 #include "sl_wfx_sae.h"
+#include "wifi_conn_timing.h"
 
 #define SL_IANA_IKE_GROUP_NIST_P256         19
 #define SL_D11_SUCCESS                      0
@@ -34,7 +35,10 @@
 
 static struct sae_data sae_ctx;
 static struct sae_pt *sae_pt;
-sae_pmksa_t sae_pmksa;
+/* PMKs of the access points joined, and the one of the exchange in progress */
+static sae_pmksa_t sae_pmksa_cache[SAE_PMKSA_CACHE_SIZE];
+static sl_wfx_ext_auth_msk_t sae_pmk_pending;
+static uint32_t sae_pmksa_use_count;
 
 typedef union {
   sl_wfx_ext_auth_sae_start_t sae_start;
@@ -44,18 +48,18 @@ typedef union {
 } sae_data_t;
 
 /**
- * @brief Check if there is a Pairwise Master Key (PMK) already derived and cached
+ * @brief Check if a Pairwise Master Key (PMK) is set
  * 
- * @return true There is a valid Pairwise Master Key (PMK)
+ * @return true The Pairwise Master Key (PMK) is not null
  * @return false There is no valid Pairwise Master Key (PMK)
  */
-bool validate_pmk()
+bool validate_pmk(const sl_wfx_ext_auth_msk_t *msk)
 {
   bool is_pmk_valid = false;
   uint8_t i; /* loop index */ 
 
   for (i = 0; i < SL_WFX_MSK_SIZE; i++) {
-    if (sae_pmksa.msk.msk[i] != 0) {
+    if (msk->msk[i] != 0) {
       is_pmk_valid = true;
       break;
     }
@@ -64,6 +68,24 @@ bool validate_pmk()
   return is_pmk_valid;
 }
 
+/**
+ * @brief Find the PMK cached for an access point
+ * 
+ * @return the cache entry, NULL if none
+ */
+static sae_pmksa_t *sae_pmksa_find(const uint8_t *bssid)
+{
+  uint8_t i;
+
+  for (i = 0; i < SAE_PMKSA_CACHE_SIZE; i++) {
+    if (!memcmp(sae_pmksa_cache[i].bssid, bssid, SL_WFX_BSSID_SIZE)
+        && validate_pmk(&sae_pmksa_cache[i].msk)) {
+      return &sae_pmksa_cache[i];
+    }
+  }
+  return NULL;
+}
+
 int sae_send_commit(bool h2e, struct wpabuf* token)
 {
   struct wpabuf* buf = NULL;
@@ -186,6 +208,7 @@ void sl_wfx_sae_exchange (sl_wfx_ext_auth_ind_t *ext_auth_indication, bool *cach
   static struct wpabuf* buf = NULL;
   struct wpabuf* token_buf = NULL;
   sae_data_t *sae_data = (sae_data_t *)ext_auth_indication->body.auth_data;
+  sae_pmksa_t *pmksa;
   int ret;
 
   switch (ext_auth_indication->body.auth_data_type) {
@@ -197,13 +220,15 @@ void sl_wfx_sae_exchange (sl_wfx_ext_auth_ind_t *ext_auth_indication, bool *cach
               sae_data->sae_start.bssid[4], sae_data->sae_start.bssid[5],
               *((uint8_t*)&sae_data->sae_start.security_mode));
 
-      if ((memcmp(sae_pmksa.bssid, sae_data->sae_start.bssid, SL_WFX_BSSID_SIZE)) 
-          || (!validate_pmk())) {
+      pmksa = sae_pmksa_find(sae_data->sae_start.bssid);
+      if (pmksa == NULL) {
         printf("Sending SAE-COMMIT\r\n");
+        wifi_conn_timing_mark(WIFI_CONN_STAGE_SAE_COMMIT);
         ret = sae_send_commit(sae_ctx.h2e, NULL);
       } else {
         printf("Sending MSK\r\n");
-        sl_wfx_ext_auth(WFM_EXT_AUTH_DATA_TYPE_MSK, sizeof(sae_pmksa.msk), (const uint8_t *)&sae_pmksa.msk);
+        pmksa->last_use = ++sae_pmksa_use_count;
+        sl_wfx_ext_auth(WFM_EXT_AUTH_DATA_TYPE_MSK, sizeof(pmksa->msk), (const uint8_t *)&pmksa->msk);
       }
       break;
     }
@@ -257,9 +282,10 @@ void sl_wfx_sae_exchange (sl_wfx_ext_auth_ind_t *ext_auth_indication, bool *cach
 							  NULL); /* ie_offset */
       printf("sae_check_confirm: %s\r\n", RET_STATUS(ret));
       if (!ret) {
-        memcpy(sae_pmksa.msk.msk, sae_ctx.pmk, SAE_PMK_LEN);
-        memcpy(sae_pmksa.msk.mskid, sae_ctx.pmkid, SAE_PMKID_LEN);
-        sl_wfx_ext_auth(WFM_EXT_AUTH_DATA_TYPE_MSK, sizeof(sae_pmksa.msk), (const uint8_t *)&sae_pmksa.msk);
+        wifi_conn_timing_mark(WIFI_CONN_STAGE_SAE_CONFIRM);
+        memcpy(sae_pmk_pending.msk, sae_ctx.pmk, SAE_PMK_LEN);
+        memcpy(sae_pmk_pending.mskid, sae_ctx.pmkid, SAE_PMKID_LEN);
+        sl_wfx_ext_auth(WFM_EXT_AUTH_DATA_TYPE_MSK, sizeof(sae_pmk_pending), (const uint8_t *)&sae_pmk_pending);
         *caching_pmk = true;
       }
       break;
@@ -275,24 +301,48 @@ void sl_wfx_sae_exchange (sl_wfx_ext_auth_ind_t *ext_auth_indication, bool *cach
 
 void sl_wfx_sae_invalidate_pmksa()
 {
-  uint8_t zeros_bssid[6] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+  printf("Invalidating the PMKSA cache\r\n");
+  memset(sae_pmksa_cache, 0, sizeof(sae_pmksa_cache));
+}
 
-  if (memcmp(sae_pmksa.bssid, zeros_bssid, SL_WFX_BSSID_SIZE))
+void sl_wfx_sae_invalidate_pmksa_bssid(const sl_wfx_mac_address_t *bssid)
+{
+  sae_pmksa_t *pmksa = sae_pmksa_find(bssid->octet);
+
+  if (pmksa != NULL)
   {
     printf("Invalidating PMKSA for %02x:%02x:%02x:%02x:%02x:%02x\r\n",
-            sae_pmksa.bssid[0], sae_pmksa.bssid[1], sae_pmksa.bssid[2],
-            sae_pmksa.bssid[3], sae_pmksa.bssid[4], sae_pmksa.bssid[5]);
-    memset(sae_pmksa.bssid, 0, SL_WFX_BSSID_SIZE);
+            bssid->octet[0], bssid->octet[1], bssid->octet[2],
+            bssid->octet[3], bssid->octet[4], bssid->octet[5]);
+    memset(pmksa, 0, sizeof(*pmksa));
   }
 }
 
 void sl_wfx_sae_cache_pmksa(const sl_wfx_mac_address_t *bssid)
 {
-  if (memcmp(sae_pmksa.bssid, bssid, SL_WFX_BSSID_SIZE))
+  sae_pmksa_t *pmksa = sae_pmksa_find(bssid->octet);
+  uint8_t i;
+
+  if (pmksa == NULL)
   {
+    /* Free entry, or else the least recently used one */
+    pmksa = &sae_pmksa_cache[0];
+    for (i = 1; (i < SAE_PMKSA_CACHE_SIZE) && validate_pmk(&pmksa->msk); i++) {
+      if (!validate_pmk(&sae_pmksa_cache[i].msk)
+          || (sae_pmksa_cache[i].last_use < pmksa->last_use)) {
+        pmksa = &sae_pmksa_cache[i];
+      }
+    }
     printf("Caching PMKSA for %02x:%02x:%02x:%02x:%02x:%02x\r\n",
          bssid->octet[0], bssid->octet[1], bssid->octet[2],
          bssid->octet[3], bssid->octet[4], bssid->octet[5]);
-    memcpy(sae_pmksa.bssid, bssid, SL_WFX_BSSID_SIZE);
+    memcpy(pmksa->bssid, bssid, SL_WFX_BSSID_SIZE);
   }
-}
\ No newline at end of file
+  pmksa->msk = sae_pmk_pending;
+  pmksa->last_use = ++sae_pmksa_use_count;
+}
+
+bool sl_wfx_sae_has_pmksa(const sl_wfx_mac_address_t *bssid)
+{
+  return sae_pmksa_find(bssid->octet) != NULL;
+}
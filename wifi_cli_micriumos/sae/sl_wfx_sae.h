@@ -20,9 +20,15 @@
 extern "C" {
 #endif
 
+/// Number of access points whose PMK is cached, for roaming back and forth.
+#ifndef SAE_PMKSA_CACHE_SIZE
+#define SAE_PMKSA_CACHE_SIZE 4
+#endif
+
 typedef struct {
   uint8_t bssid[SL_WFX_BSSID_SIZE];
   sl_wfx_ext_auth_msk_t msk;
+  uint32_t last_use;          ///< Least recently used entry replaced first
 } sae_pmksa_t;
 
 /**************************************************************************//**
@@ -42,10 +48,26 @@ sl_status_t sl_wfx_sae_prepare(const sl_wfx_mac_address_t *sta_addr,
  *****************************************************************************/
 void sl_wfx_sae_exchange (sl_wfx_ext_auth_ind_t* ext_auth_indication, bool *caching_pmk);
 
+/**************************************************************************//**
+ * Clear the PMK cache.
+ *****************************************************************************/
 void sl_wfx_sae_invalidate_pmksa();
 
+/**************************************************************************//**
+ * Remove the PMK cached for an access point, if any.
+ *****************************************************************************/
+void sl_wfx_sae_invalidate_pmksa_bssid(const sl_wfx_mac_address_t *bssid);
+
+/**************************************************************************//**
+ * Cache the PMK of the last SAE exchange for an access point.
+ *****************************************************************************/
 void sl_wfx_sae_cache_pmksa(const sl_wfx_mac_address_t *bssid);
 
+/**************************************************************************//**
+ * Check whether a PMK is cached for an access point.
+ *****************************************************************************/
+bool sl_wfx_sae_has_pmksa(const sl_wfx_mac_address_t *bssid);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,323 @@
+/***************************************************************************//**
+ * @file
+ * @brief Scan profiles: channel plan, active/passive channels and dwell times
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * A scan request has a single mode, so the active and passive channels of the
+ * regulatory domain are scanned by two requests, each one preceded by the
+ * dwell settings of the profile. The channels "learned" are the ones of the
+ * scan store entries, i.e. of the previous scans.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "sl_wfx.h"
+#include "lwip/sys.h"
+#include "scan_store.h"
+#include "scan_profile.h"
+#include "wifi_cli_params.h"
+
+#define CHANNEL_BIT(ch)               (1u << (ch))
+#define CHANNEL_RANGE(first, last)    ((uint16_t)((CHANNEL_BIT((last) + 1) - 1) & ~(CHANNEL_BIT(first) - 1)))
+
+/// Channel plan of a regulatory domain.
+typedef struct {
+  const char *name;
+  uint16_t active_mask;
+  uint16_t passive_mask;
+} scan_region_plan_t;
+
+static const scan_region_plan_t scan_region_plans[SCAN_REGION_NB] = {
+  [SCAN_REGION_WORLD] = { "WORLD", CHANNEL_RANGE(1, 11), CHANNEL_RANGE(12, 13) },
+  [SCAN_REGION_ETSI]  = { "ETSI",  CHANNEL_RANGE(1, 13), 0 },
+  [SCAN_REGION_FCC]   = { "FCC",   CHANNEL_RANGE(1, 11), 0 },
+  [SCAN_REGION_MKK]   = { "MKK",   CHANNEL_RANGE(1, 13), CHANNEL_BIT(14) },
+};
+
+static const char *const scan_profile_names[SCAN_PROFILE_NB] = {
+  [SCAN_PROFILE_FULL]     = "full",
+  [SCAN_PROFILE_LEARNED]  = "learned",
+  [SCAN_PROFILE_DIRECTED] = "directed",
+};
+
+static scan_profile_dwell_t scan_profile_dwell[SCAN_PROFILE_NB] = {
+  [SCAN_PROFILE_FULL]     = { 0, 0, 0 },
+  [SCAN_PROFILE_LEARNED]  = { 30, 110, 1 },
+  [SCAN_PROFILE_DIRECTED] = { 40, 110, 2 },
+};
+
+static scan_profile_stats_t scan_profile_stats[SCAN_PROFILE_NB];
+static scan_region_t scan_region = SCAN_REGION_WORLD;
+
+/***************************************************************************//**
+ * Scan the channels of a mask with one mode and wait for the completion.
+ ******************************************************************************/
+static sl_status_t scan_profile_request(const scan_profile_dwell_t *dwell,
+                                        uint16_t mode,
+                                        uint16_t channel_mask,
+                                        const sl_wfx_ssid_def_t *ssid,
+                                        uint8_t *channel_nb)
+{
+  uint8_t channels[SCAN_PROFILE_CHANNEL_MAX];
+  uint8_t nb = 0;
+  sl_status_t status;
+  RTOS_ERR_CODE err_code;
+
+  for (uint8_t ch = 1; ch <= SCAN_PROFILE_CHANNEL_MAX; ch++) {
+    if (channel_mask & CHANNEL_BIT(ch)) {
+      channels[nb++] = ch;
+    }
+  }
+  if (nb == 0) {
+    return SL_STATUS_OK;
+  }
+  *channel_nb += nb;
+
+  wifi_event_bus_request_begin(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_SCAN_COMPLETE));
+  sl_wfx_set_scan_parameters(dwell->active_time, dwell->passive_time, dwell->probe_nb);
+  status = sl_wfx_send_scan_command(mode,
+                                    channels,
+                                    nb,
+                                    (mode == WFM_SCAN_MODE_ACTIVE) ? ssid : NULL,
+                                    ((mode == WFM_SCAN_MODE_ACTIVE) && (ssid != NULL)) ? 1 : 0,
+                                    NULL,
+                                    0,
+                                    NULL);
+  if ((status != SL_STATUS_OK) && (status != SL_STATUS_WIFI_WARNING)) {
+    wifi_event_bus_request_end(&g_cli_events);
+    return status;
+  }
+
+  err_code = wifi_event_bus_wait(&g_cli_events,
+                                 WIFI_EVENT_MASK(WIFI_EVENT_SCAN_COMPLETE),
+                                 SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS,
+                                 NULL);
+  wifi_event_bus_request_end(&g_cli_events);
+  if (err_code == RTOS_ERR_TIMEOUT) {
+    return SL_STATUS_TIMEOUT;
+  }
+  return (err_code == RTOS_ERR_NONE) ? SL_STATUS_OK : SL_STATUS_FAIL;
+}
+
+/***************************************************************************//**
+ * Scan the channels of a mask, the active ones then the passive ones.
+ ******************************************************************************/
+static sl_status_t scan_profile_channels(const scan_profile_dwell_t *dwell,
+                                         uint16_t channel_mask,
+                                         const sl_wfx_ssid_def_t *ssid,
+                                         uint8_t *channel_nb)
+{
+  const scan_region_plan_t *plan = &scan_region_plans[scan_region];
+  sl_status_t status;
+
+  status = scan_profile_request(dwell,
+                                WFM_SCAN_MODE_ACTIVE,
+                                channel_mask & plan->active_mask,
+                                ssid,
+                                channel_nb);
+  if (status == SL_STATUS_OK) {
+    status = scan_profile_request(dwell,
+                                  WFM_SCAN_MODE_PASSIVE,
+                                  channel_mask & plan->passive_mask,
+                                  ssid,
+                                  channel_nb);
+  }
+  return status;
+}
+
+/***************************************************************************//**
+ * Check whether an SSID was seen since a given time.
+ ******************************************************************************/
+static bool scan_profile_ssid_seen(const sl_wfx_ssid_def_t *ssid, uint32_t since_ms)
+{
+  uint32_t now_ms = sys_now();
+  scan_store_filter_t filter = {
+    .ssid = ssid,
+    .max_age_ms = now_ms - since_ms + 1,
+  };
+  scan_store_entry_t entry;
+  uint8_t index = 0;
+
+  return scan_store_find(&filter, now_ms, &index, &entry);
+}
+
+/***************************************************************************//**
+ * Get the name of a profile.
+ ******************************************************************************/
+const char *scan_profile_name(scan_profile_id_t id)
+{
+  return (id < SCAN_PROFILE_NB) ? scan_profile_names[id] : "";
+}
+
+/***************************************************************************//**
+ * Get a profile by name.
+ ******************************************************************************/
+scan_profile_id_t scan_profile_find(const char *name)
+{
+  uint8_t id;
+
+  for (id = 0; id < SCAN_PROFILE_NB; id++) {
+    if (strcmp(name, scan_profile_names[id]) == 0) {
+      break;
+    }
+  }
+  return (scan_profile_id_t)id;
+}
+
+/***************************************************************************//**
+ * Get the name of a regulatory domain.
+ ******************************************************************************/
+const char *scan_region_name(scan_region_t region)
+{
+  return (region < SCAN_REGION_NB) ? scan_region_plans[region].name : "";
+}
+
+/***************************************************************************//**
+ * Select the regulatory domain by name.
+ ******************************************************************************/
+bool scan_region_set(const char *name)
+{
+  for (uint8_t region = 0; region < SCAN_REGION_NB; region++) {
+    if (strcmp(name, scan_region_plans[region].name) == 0) {
+      scan_region = (scan_region_t)region;
+      return true;
+    }
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * Get the regulatory domain and its channel masks.
+ ******************************************************************************/
+scan_region_t scan_region_get(uint16_t *active_mask, uint16_t *passive_mask)
+{
+  *active_mask = scan_region_plans[scan_region].active_mask;
+  *passive_mask = scan_region_plans[scan_region].passive_mask;
+  return scan_region;
+}
+
+/***************************************************************************//**
+ * Get the channels where APs were seen.
+ ******************************************************************************/
+uint16_t scan_profile_learned_channels(const sl_wfx_ssid_def_t *ssid)
+{
+  scan_store_filter_t filter = { .ssid = ssid };
+  scan_store_entry_t entry;
+  uint16_t channel_mask = 0;
+  uint8_t index = 0;
+
+  while (scan_store_find(&filter, sys_now(), &index, &entry)) {
+    if ((entry.ap.channel >= 1) && (entry.ap.channel <= SCAN_PROFILE_CHANNEL_MAX)) {
+      channel_mask |= CHANNEL_BIT(entry.ap.channel);
+    }
+  }
+  return channel_mask;
+}
+
+/***************************************************************************//**
+ * Set the channel dwell settings of a profile.
+ ******************************************************************************/
+void scan_profile_set_dwell(scan_profile_id_t id, const scan_profile_dwell_t *dwell)
+{
+  if (id < SCAN_PROFILE_NB) {
+    scan_profile_dwell[id] = *dwell;
+  }
+}
+
+/***************************************************************************//**
+ * Get the settings and scan durations of a profile.
+ ******************************************************************************/
+void scan_profile_get(scan_profile_id_t id,
+                      scan_profile_dwell_t *dwell,
+                      scan_profile_stats_t *stats)
+{
+  if (id < SCAN_PROFILE_NB) {
+    *dwell = scan_profile_dwell[id];
+    *stats = scan_profile_stats[id];
+  }
+}
+
+/***************************************************************************//**
+ * Scan with a profile.
+ ******************************************************************************/
+sl_status_t scan_profile_run(scan_profile_id_t id,
+                             const sl_wfx_ssid_def_t *ssid,
+                             uint8_t hint_channel)
+{
+  const scan_region_plan_t *plan = &scan_region_plans[scan_region];
+  const scan_profile_dwell_t *dwell;
+  scan_profile_stats_t *stats;
+  uint16_t plan_mask = plan->active_mask | plan->passive_mask;
+  uint16_t known_mask;
+  uint32_t start_ms = sys_now();
+  uint32_t elapsed_ms;
+  uint8_t channel_nb = 0;
+  sl_status_t status;
+
+  if (id >= SCAN_PROFILE_NB) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  dwell = &scan_profile_dwell[id];
+  stats = &scan_profile_stats[id];
+
+  switch (id) {
+    case SCAN_PROFILE_LEARNED:
+      known_mask = scan_profile_learned_channels(NULL) & plan_mask;
+      status = scan_profile_channels(dwell,
+                                     (known_mask != 0) ? known_mask : plan_mask,
+                                     ssid,
+                                     &channel_nb);
+      break;
+
+    case SCAN_PROFILE_DIRECTED:
+      known_mask = scan_profile_learned_channels(ssid);
+      if (hint_channel <= SCAN_PROFILE_CHANNEL_MAX) {
+        known_mask |= CHANNEL_BIT(hint_channel);
+      }
+      known_mask &= plan_mask;
+      status = scan_profile_channels(dwell, known_mask, ssid, &channel_nb);
+      if ((status == SL_STATUS_OK)
+          && ((known_mask == 0) || (ssid == NULL) || !scan_profile_ssid_seen(ssid, start_ms))) {
+        /* Not on the known channels: the others */
+        status = scan_profile_channels(dwell, plan_mask & ~known_mask, ssid, &channel_nb);
+      }
+      break;
+
+    default:
+      status = scan_profile_channels(dwell, plan_mask, ssid, &channel_nb);
+      break;
+  }
+
+  /* Back to the firmware defaults */
+  sl_wfx_set_scan_parameters(0, 0, 0);
+
+  if (status == SL_STATUS_OK) {
+    elapsed_ms = sys_now() - start_ms;
+    if ((stats->runs == 0) || (elapsed_ms < stats->min_ms)) {
+      stats->min_ms = elapsed_ms;
+    }
+    if (elapsed_ms > stats->max_ms) {
+      stats->max_ms = elapsed_ms;
+    }
+    stats->runs++;
+    stats->last_ms = elapsed_ms;
+    stats->total_ms += elapsed_ms;
+    stats->last_channels = channel_nb;
+  }
+  return status;
+}
@@ -0,0 +1,132 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef SCAN_PROFILE_H
+#define SCAN_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_wfx_constants.h"
+
+/// Highest 2.4 GHz channel.
+#define SCAN_PROFILE_CHANNEL_MAX      14
+
+/// Regulatory domains, selecting the channels scanned actively or passively.
+typedef enum {
+  SCAN_REGION_WORLD = 0,      ///< 1-11 active, 12-13 passive
+  SCAN_REGION_ETSI,           ///< 1-13 active
+  SCAN_REGION_FCC,            ///< 1-11 active
+  SCAN_REGION_MKK,            ///< 1-13 active, 14 passive
+  SCAN_REGION_NB
+} scan_region_t;
+
+/// Scan profiles.
+typedef enum {
+  SCAN_PROFILE_FULL = 0,      ///< All the channels of the region
+  SCAN_PROFILE_LEARNED,       ///< Channels where APs were seen, else all
+  SCAN_PROFILE_DIRECTED,      ///< Channels of the SSID first, the others if not found
+  SCAN_PROFILE_NB
+} scan_profile_id_t;
+
+/// Channel dwell settings of a profile, 0 keeping the firmware default.
+typedef struct {
+  uint16_t active_time;       ///< Time per active channel (TU)
+  uint16_t passive_time;      ///< Time per passive channel (TU)
+  uint8_t probe_nb;           ///< Probe requests per active channel
+} scan_profile_dwell_t;
+
+/// Scan durations of a profile.
+typedef struct {
+  uint32_t runs;
+  uint32_t last_ms;
+  uint32_t min_ms;
+  uint32_t max_ms;
+  uint32_t total_ms;
+  uint8_t last_channels;      ///< Channels scanned by the last run
+} scan_profile_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Get the name of a profile.
+ ******************************************************************************/
+const char *scan_profile_name(scan_profile_id_t id);
+
+/***************************************************************************//**
+ * Get a profile by name.
+ *
+ * @returns the profile, SCAN_PROFILE_NB if unknown
+ ******************************************************************************/
+scan_profile_id_t scan_profile_find(const char *name);
+
+/***************************************************************************//**
+ * Get the name of a regulatory domain.
+ ******************************************************************************/
+const char *scan_region_name(scan_region_t region);
+
+/***************************************************************************//**
+ * Select the regulatory domain by name.
+ *
+ * @returns false if unknown
+ ******************************************************************************/
+bool scan_region_set(const char *name);
+
+/***************************************************************************//**
+ * Get the regulatory domain and its channel masks (bit n for channel n).
+ ******************************************************************************/
+scan_region_t scan_region_get(uint16_t *active_mask, uint16_t *passive_mask);
+
+/***************************************************************************//**
+ * Get the channels where APs were seen, from the scan store.
+ *
+ * @param ssid SSID of the APs, NULL for any
+ * @returns channel mask, bit n for channel n
+ ******************************************************************************/
+uint16_t scan_profile_learned_channels(const sl_wfx_ssid_def_t *ssid);
+
+/***************************************************************************//**
+ * Set the channel dwell settings of a profile.
+ ******************************************************************************/
+void scan_profile_set_dwell(scan_profile_id_t id, const scan_profile_dwell_t *dwell);
+
+/***************************************************************************//**
+ * Get the settings and scan durations of a profile.
+ ******************************************************************************/
+void scan_profile_get(scan_profile_id_t id,
+                      scan_profile_dwell_t *dwell,
+                      scan_profile_stats_t *stats);
+
+/***************************************************************************//**
+ * Scan with a profile, from the CLI task, the results going to the scan
+ * store. The active and passive channels are scanned by separate requests.
+ *
+ * @param id profile
+ * @param ssid SSID probed on the active channels and searched by the directed
+ *        profile, NULL for a broadcast probe
+ * @param hint_channel channel tried first by the directed profile, 0 for none
+ * @returns SL_STATUS_OK, or the error of the scan request or wait
+ ******************************************************************************/
+sl_status_t scan_profile_run(scan_profile_id_t id,
+                             const sl_wfx_ssid_def_t *ssid,
+                             uint8_t hint_channel);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,235 @@
+/***************************************************************************//**
+ * @file
+ * @brief Store of the access points seen by the scans
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * One entry per BSSID, updated in place by the repeated probe responses and
+ * beacons, the array being kept ordered by decreasing RCPI: the strongest
+ * candidates come first and the weakest one is the eviction victim. The
+ * results are added from the WFx receive task and read from the CLI task,
+ * hence the mutex.
+ ******************************************************************************/
+#include <string.h>
+#include <kernel/include/os.h>
+#include "scan_store.h"
+
+static scan_store_entry_t scan_store[SCAN_STORE_SIZE];
+static uint8_t scan_store_nb = 0;
+static OS_MUTEX scan_store_mutex;
+
+static void scan_store_lock(void)
+{
+  RTOS_ERR err;
+
+  OSMutexPend(&scan_store_mutex, 0, OS_OPT_PEND_BLOCKING, NULL, &err);
+}
+
+static void scan_store_unlock(void)
+{
+  RTOS_ERR err;
+
+  OSMutexPost(&scan_store_mutex, OS_OPT_POST_NONE, &err);
+}
+
+/***************************************************************************//**
+ * Remove an entry, shifting the weaker ones.
+ ******************************************************************************/
+static void scan_store_remove(uint8_t index)
+{
+  scan_store_nb--;
+  memmove(&scan_store[index],
+          &scan_store[index + 1],
+          (scan_store_nb - index) * sizeof(scan_store[0]));
+}
+
+/***************************************************************************//**
+ * Initialize the store, before the first scan.
+ ******************************************************************************/
+void scan_store_init(void)
+{
+  RTOS_ERR err;
+
+  OSMutexCreate(&scan_store_mutex, "scan store", &err);
+  scan_store_nb = 0;
+}
+
+/***************************************************************************//**
+ * Remove all the entries.
+ ******************************************************************************/
+void scan_store_clear(void)
+{
+  scan_store_lock();
+  scan_store_nb = 0;
+  scan_store_unlock();
+}
+
+/***************************************************************************//**
+ * Add a scan result, or update the entry of its BSSID.
+ ******************************************************************************/
+bool scan_store_update(const scan_result_list_t *result, uint32_t now_ms)
+{
+  uint8_t pos;
+  bool kept = true;
+
+  scan_store_lock();
+
+  for (pos = 0; pos < scan_store_nb; pos++) {
+    if (memcmp(scan_store[pos].ap.mac, result->mac, SL_WFX_BSSID_SIZE) == 0) {
+      break;
+    }
+  }
+
+  if (pos < scan_store_nb) {
+    /* Known BSSID, moved to its new rank below */
+    scan_store_remove(pos);
+  } else if (scan_store_nb == SCAN_STORE_SIZE) {
+    /* Full: the weakest stale entry goes first, then the weakest one */
+    for (pos = scan_store_nb; pos > 0; pos--) {
+      if ((now_ms - scan_store[pos - 1].seen_ms) >= SCAN_STORE_STALE_MS) {
+        break;
+      }
+    }
+    if (pos > 0) {
+      scan_store_remove(pos - 1);
+    } else if (result->rcpi > scan_store[scan_store_nb - 1].ap.rcpi) {
+      scan_store_nb--;
+    } else {
+      kept = false;
+    }
+  }
+
+  if (kept) {
+    /* After the entries at least as strong */
+    for (pos = 0; pos < scan_store_nb; pos++) {
+      if (scan_store[pos].ap.rcpi < result->rcpi) {
+        break;
+      }
+    }
+    memmove(&scan_store[pos + 1],
+            &scan_store[pos],
+            (scan_store_nb - pos) * sizeof(scan_store[0]));
+    scan_store[pos].ap = *result;
+    scan_store[pos].seen_ms = now_ms;
+    scan_store_nb++;
+  }
+
+  scan_store_unlock();
+  return kept;
+}
+
+/***************************************************************************//**
+ * Get the number of entries.
+ ******************************************************************************/
+uint8_t scan_store_count(void)
+{
+  return scan_store_nb;
+}
+
+/***************************************************************************//**
+ * Find the next entry matching a filter, by decreasing RCPI.
+ ******************************************************************************/
+bool scan_store_find(const scan_store_filter_t *filter,
+                     uint32_t now_ms,
+                     uint8_t *index,
+                     scan_store_entry_t *entry)
+{
+  bool found = false;
+
+  scan_store_lock();
+
+  for (; *index < scan_store_nb; (*index)++) {
+    const scan_store_entry_t *e = &scan_store[*index];
+
+    if (filter != NULL) {
+      if ((filter->ssid != NULL)
+          && ((e->ap.ssid_def.ssid_length != filter->ssid->ssid_length)
+              || (memcmp(e->ap.ssid_def.ssid,
+                         filter->ssid->ssid,
+                         filter->ssid->ssid_length) != 0))) {
+        continue;
+      }
+      if ((filter->bssid != NULL)
+          && (memcmp(e->ap.mac, filter->bssid, SL_WFX_BSSID_SIZE) != 0)) {
+        continue;
+      }
+      if ((filter->security != 0)
+          && !(scan_store_security_flags(e->ap.security_mode) & filter->security)) {
+        continue;
+      }
+      if ((filter->channel != 0) && (e->ap.channel != filter->channel)) {
+        continue;
+      }
+      if ((filter->max_age_ms != 0) && ((now_ms - e->seen_ms) > filter->max_age_ms)) {
+        continue;
+      }
+    }
+    *entry = *e;
+    (*index)++;
+    found = true;
+    break;
+  }
+
+  scan_store_unlock();
+  return found;
+}
+
+/***************************************************************************//**
+ * Get the security filter flags of a security mode.
+ ******************************************************************************/
+uint8_t scan_store_security_flags(sl_wfx_security_mode_bitmask_t security_mode)
+{
+  uint8_t flags = 0;
+
+  if (security_mode.wep) {
+    flags |= SCAN_STORE_SECURITY_WEP;
+  }
+  if (security_mode.wpa) {
+    flags |= SCAN_STORE_SECURITY_WPA;
+  }
+  if (security_mode.wpa2) {
+    flags |= SCAN_STORE_SECURITY_WPA2;
+  }
+  if (security_mode.wpa3) {
+    flags |= SCAN_STORE_SECURITY_WPA3;
+  }
+  return (flags != 0) ? flags : SCAN_STORE_SECURITY_OPEN;
+}
+
+/***************************************************************************//**
+ * Get the security filter flags of the APs a station can join.
+ ******************************************************************************/
+uint8_t scan_store_security_filter(sl_wfx_security_mode_t secur_mode)
+{
+  switch (secur_mode) {
+    case WFM_SECURITY_MODE_OPEN:
+      return SCAN_STORE_SECURITY_OPEN;
+    case WFM_SECURITY_MODE_WEP:
+      return SCAN_STORE_SECURITY_WEP;
+    case WFM_SECURITY_MODE_WPA2_WPA1_PSK:
+      return SCAN_STORE_SECURITY_WPA | SCAN_STORE_SECURITY_WPA2;
+    case WFM_SECURITY_MODE_WPA2_PSK:
+      return SCAN_STORE_SECURITY_WPA2;
+    case WFM_SECURITY_MODE_WPA3_SAE:
+      return SCAN_STORE_SECURITY_WPA3;
+    case WFM_SECURITY_MODE_WPA3_SAE_WPA2_PSK:
+      return SCAN_STORE_SECURITY_WPA2 | SCAN_STORE_SECURITY_WPA3;
+    default:
+      return 0;
+  }
+}
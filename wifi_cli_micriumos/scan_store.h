@@ -0,0 +1,116 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef SCAN_STORE_H
+#define SCAN_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_wfx_constants.h"
+
+/// Number of access points kept.
+#define SCAN_STORE_SIZE               SL_WFX_MAX_SCAN_RESULTS
+/// Age after which an entry is evicted before stronger but fresh ones (ms).
+#define SCAN_STORE_STALE_MS           60000
+
+/// Security filter flags, derived from the security mode of the results.
+#define SCAN_STORE_SECURITY_OPEN      0x01
+#define SCAN_STORE_SECURITY_WEP       0x02
+#define SCAN_STORE_SECURITY_WPA       0x04
+#define SCAN_STORE_SECURITY_WPA2      0x08
+#define SCAN_STORE_SECURITY_WPA3      0x10
+
+/// Access point seen by a scan.
+typedef struct {
+  scan_result_list_t ap;      ///< SSID, BSSID, channel, security mode, RCPI
+  uint32_t seen_ms;           ///< Time of the last scan result
+} scan_store_entry_t;
+
+/// Selection of entries, the fields at 0 (or NULL) matching any entry.
+typedef struct {
+  const sl_wfx_ssid_def_t *ssid;  ///< SSID
+  const uint8_t *bssid;       ///< BSSID
+  uint8_t security;           ///< SCAN_STORE_SECURITY_* flags accepted
+  uint16_t channel;           ///< Channel
+  uint32_t max_age_ms;        ///< Entries seen for the last max_age_ms only
+} scan_store_filter_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Initialize the store, before the first scan.
+ ******************************************************************************/
+void scan_store_init(void);
+
+/***************************************************************************//**
+ * Remove all the entries.
+ ******************************************************************************/
+void scan_store_clear(void);
+
+/***************************************************************************//**
+ * Add a scan result, or update the entry of its BSSID, keeping the entries
+ * ordered by decreasing RCPI. When the store is full, the weakest stale
+ * entry is evicted, or else the weakest entry if the result is stronger.
+ *
+ * @param result scan result
+ * @param now_ms current time
+ * @returns true if the result is kept
+ ******************************************************************************/
+bool scan_store_update(const scan_result_list_t *result, uint32_t now_ms);
+
+/***************************************************************************//**
+ * Get the number of entries.
+ ******************************************************************************/
+uint8_t scan_store_count(void);
+
+/***************************************************************************//**
+ * Find the next entry matching a filter, by decreasing RCPI.
+ *
+ * @param filter selection, NULL for all entries
+ * @param now_ms current time, for the age filter
+ * @param index position to search from, updated past the entry found
+ * @param entry copy of the entry found
+ * @returns true if an entry was found
+ ******************************************************************************/
+bool scan_store_find(const scan_store_filter_t *filter,
+                     uint32_t now_ms,
+                     uint8_t *index,
+                     scan_store_entry_t *entry);
+
+/***************************************************************************//**
+ * Get the security filter flags of a security mode.
+ *
+ * @param security_mode security mode advertised by an AP
+ * @returns SCAN_STORE_SECURITY_* flags
+ ******************************************************************************/
+uint8_t scan_store_security_flags(sl_wfx_security_mode_bitmask_t security_mode);
+
+/***************************************************************************//**
+ * Get the security filter flags of the APs a station can join with the given
+ * security setting.
+ *
+ * @param secur_mode security mode of the station
+ * @returns SCAN_STORE_SECURITY_* flags, 0 for any AP
+ ******************************************************************************/
+uint8_t scan_store_security_filter(sl_wfx_security_mode_t secur_mode);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,390 @@
+/***************************************************************************//**
+ * @file
+ * @brief Traffic and signal of the clients associated to the SoftAP
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * Every frame of the SoftAP interface looks its client up, from lwIP for
+ * the transmissions and from the bus task for the receptions. The clients
+ * are kept in an open addressing table hashed on the MAC address, with
+ * linear probing: a lookup is one hash and a probe or two, in a short
+ * critical section. A removal shifts the following entries of the probe
+ * sequence back instead of leaving a tombstone, so that the lookups never
+ * get longer with the association churn.
+ ******************************************************************************/
+#include <string.h>
+#include <kernel/include/os.h>
+#include "sl_wfx.h"
+#include "lwip/sys.h"
+#include "app_wifi_events.h"
+#include "softap_clients.h"
+
+#define SOFTAP_CLIENTS_TASK_PRIO            25u
+#define SOFTAP_CLIENTS_TASK_STK_SIZE        600u
+
+#define SOFTAP_CLIENTS_MASK                 (SOFTAP_CLIENTS_TABLE_SIZE - 1)
+
+#if (SOFTAP_CLIENTS_TABLE_SIZE & SOFTAP_CLIENTS_MASK) != 0
+#error "SOFTAP_CLIENTS_TABLE_SIZE must be a power of two"
+#endif
+
+static softap_client_t clients[SOFTAP_CLIENTS_TABLE_SIZE];
+static bool slot_used[SOFTAP_CLIENTS_TABLE_SIZE];
+static softap_clients_stats_t clients_stats;
+static uint32_t clients_idle_timeout_s;
+
+static CPU_STK softap_clients_task_stk[SOFTAP_CLIENTS_TASK_STK_SIZE];
+static OS_TCB softap_clients_task_tcb;
+
+/***************************************************************************//**
+ * Get the home slot of a MAC address (FNV-1a).
+ ******************************************************************************/
+static uint16_t softap_clients_hash(const uint8_t *mac)
+{
+  uint32_t hash = 2166136261u;
+
+  for (uint8_t i = 0; i < 6; i++) {
+    hash = (hash ^ mac[i]) * 16777619u;
+  }
+  return (uint16_t)(hash & SOFTAP_CLIENTS_MASK);
+}
+
+/***************************************************************************//**
+ * Find the slot of a client, in a critical section.
+ *
+ * @returns the slot, -1 if the client is not in the table
+ ******************************************************************************/
+static int softap_clients_find(const uint8_t *mac)
+{
+  uint16_t slot = softap_clients_hash(mac);
+  uint16_t probes;
+
+  for (probes = 1; probes <= SOFTAP_CLIENTS_TABLE_SIZE; probes++) {
+    if (!slot_used[slot]) {
+      break;
+    }
+    if (memcmp(clients[slot].mac, mac, 6) == 0) {
+      if (probes > clients_stats.max_probes) {
+        clients_stats.max_probes = probes;
+      }
+      return slot;
+    }
+    slot = (slot + 1) & SOFTAP_CLIENTS_MASK;
+  }
+  return -1;
+}
+
+/***************************************************************************//**
+ * Free a slot, moving back the entries it separates from their home slot.
+ * In a critical section.
+ ******************************************************************************/
+static void softap_clients_free_slot(uint16_t slot)
+{
+  uint16_t next = slot;
+  uint16_t home;
+
+  slot_used[slot] = false;
+  while (1) {
+    next = (next + 1) & SOFTAP_CLIENTS_MASK;
+    if (!slot_used[next]) {
+      return;
+    }
+    home = softap_clients_hash(clients[next].mac);
+    /* The entry stays if its home is cyclically in (slot, next] */
+    if (((next - home) & SOFTAP_CLIENTS_MASK) < ((next - slot) & SOFTAP_CLIENTS_MASK)) {
+      continue;
+    }
+    clients[slot] = clients[next];
+    slot_used[slot] = true;
+    slot_used[next] = false;
+    slot = next;
+  }
+}
+
+/***************************************************************************//**
+ * Add an associated client.
+ ******************************************************************************/
+void softap_clients_add(const uint8_t *mac)
+{
+  uint32_t now_ms = sys_now();
+  softap_client_t *client;
+  int slot;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  slot = softap_clients_find(mac);
+  if (slot < 0) {
+    if (clients_stats.clients == SOFTAP_CLIENTS_MAX) {
+      clients_stats.table_full++;
+      CPU_CRITICAL_EXIT();
+      return;
+    }
+    slot = softap_clients_hash(mac);
+    while (slot_used[slot]) {
+      slot = (slot + 1) & SOFTAP_CLIENTS_MASK;
+    }
+    slot_used[slot] = true;
+    clients_stats.clients++;
+  }
+  client = &clients[slot];
+  memset(client, 0, sizeof(*client));
+  memcpy(client->mac, mac, 6);
+  client->assoc_ms = now_ms;
+  client->last_rx_ms = now_ms;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Remove a client.
+ ******************************************************************************/
+void softap_clients_remove(const uint8_t *mac)
+{
+  int slot;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  slot = softap_clients_find(mac);
+  if (slot >= 0) {
+    softap_clients_free_slot((uint16_t)slot);
+    clients_stats.clients--;
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Remove all the clients.
+ ******************************************************************************/
+void softap_clients_clear(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  memset(slot_used, 0, sizeof(slot_used));
+  clients_stats.clients = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Count a frame sent on the SoftAP interface.
+ ******************************************************************************/
+void softap_clients_count_tx(const uint8_t *frame, uint16_t len)
+{
+  int slot;
+  CPU_SR_ALLOC();
+
+  if (frame[0] & 0x01) {
+    /* Group address, to every client */
+    return;
+  }
+  CPU_CRITICAL_ENTER();
+  slot = softap_clients_find(frame);
+  if (slot >= 0) {
+    clients[slot].tx_bytes += len;
+    clients[slot].tx_packets++;
+  } else {
+    clients_stats.unknown_frames++;
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Count a frame received on the SoftAP interface.
+ ******************************************************************************/
+void softap_clients_count_rx(const uint8_t *frame, uint16_t len)
+{
+  uint32_t now_ms = sys_now();
+  int slot;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  /* Source address */
+  slot = softap_clients_find(&frame[6]);
+  if (slot >= 0) {
+    clients[slot].rx_bytes += len;
+    clients[slot].rx_packets++;
+    clients[slot].last_rx_ms = now_ms;
+  } else {
+    clients_stats.unknown_frames++;
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Get a copy of the clients, the busiest first.
+ ******************************************************************************/
+uint16_t softap_clients_get(softap_client_t *copy)
+{
+  softap_client_t tmp;
+  uint16_t nb = 0;
+  uint16_t i, j;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  for (i = 0; i < SOFTAP_CLIENTS_TABLE_SIZE; i++) {
+    if (slot_used[i]) {
+      copy[nb++] = clients[i];
+    }
+  }
+  CPU_CRITICAL_EXIT();
+
+  /* Insertion sort, a few clients at most */
+  for (i = 1; i < nb; i++) {
+    tmp = copy[i];
+    for (j = i;
+         (j > 0) && (((uint64_t)tmp.tx_bytes + tmp.rx_bytes)
+                     > ((uint64_t)copy[j - 1].tx_bytes + copy[j - 1].rx_bytes));
+         j--) {
+      copy[j] = copy[j - 1];
+    }
+    copy[j] = tmp;
+  }
+  return nb;
+}
+
+/***************************************************************************//**
+ * Set the idle time after which a client is disconnected.
+ ******************************************************************************/
+void softap_clients_set_idle_timeout(uint32_t idle_timeout_s)
+{
+  clients_idle_timeout_s = idle_timeout_s;
+}
+
+/***************************************************************************//**
+ * Get the idle timeout and the table statistics.
+ ******************************************************************************/
+void softap_clients_get_stats(uint32_t *idle_timeout_s, softap_clients_stats_t *stats)
+{
+  CPU_SR_ALLOC();
+
+  *idle_timeout_s = clients_idle_timeout_s;
+  CPU_CRITICAL_ENTER();
+  *stats = clients_stats;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Reset the traffic counters of the clients and the table statistics.
+ ******************************************************************************/
+void softap_clients_reset_stats(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  for (uint16_t i = 0; i < SOFTAP_CLIENTS_TABLE_SIZE; i++) {
+    clients[i].tx_bytes = 0;
+    clients[i].tx_packets = 0;
+    clients[i].rx_bytes = 0;
+    clients[i].rx_packets = 0;
+  }
+  clients_stats.max_probes = 0;
+  clients_stats.evictions = 0;
+  clients_stats.table_full = 0;
+  clients_stats.unknown_frames = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Client table task: refresh the RSSI of the clients and disconnect the idle
+ * ones.
+ ******************************************************************************/
+static void softap_clients_task(void *p_arg)
+{
+  sl_wfx_mac_address_t macs[SOFTAP_CLIENTS_MAX];
+  uint32_t last_rx_ms[SOFTAP_CLIENTS_MAX];
+  uint32_t idle_timeout_ms;
+  uint32_t now_ms;
+  uint32_t rcpi;
+  uint16_t nb;
+  uint16_t i;
+  int slot;
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  (void)p_arg;
+
+  while (1) {
+    OSTimeDly((OS_TICK)(((uint64_t)SOFTAP_CLIENTS_PERIOD_MS * OSCfg_TickRate_Hz) / 1000),
+              OS_OPT_TIME_DLY,
+              &err);
+
+    if (!(wifi.state & SL_WFX_AP_INTERFACE_UP)) {
+      continue;
+    }
+
+    nb = 0;
+    CPU_CRITICAL_ENTER();
+    for (i = 0; i < SOFTAP_CLIENTS_TABLE_SIZE; i++) {
+      if (slot_used[i]) {
+        memcpy(macs[nb].octet, clients[i].mac, 6);
+        last_rx_ms[nb++] = clients[i].last_rx_ms;
+      }
+    }
+    CPU_CRITICAL_EXIT();
+
+    idle_timeout_ms = clients_idle_timeout_s * 1000;
+    for (i = 0; i < nb; i++) {
+      now_ms = sys_now();
+      if ((idle_timeout_ms != 0) && ((now_ms - last_rx_ms[i]) >= idle_timeout_ms)) {
+        /* The client disconnected indication removes it */
+        if (sl_wfx_disconnect_ap_client_command(&macs[i]) == SL_STATUS_OK) {
+          CPU_CRITICAL_ENTER();
+          clients_stats.evictions++;
+          slot = softap_clients_find(macs[i].octet);
+          if (slot >= 0) {
+            /* No new request until the indication */
+            clients[slot].last_rx_ms = now_ms;
+          }
+          CPU_CRITICAL_EXIT();
+        }
+        continue;
+      }
+
+      if (sl_wfx_get_ap_client_signal_strength(&macs[i], &rcpi) == SL_STATUS_OK) {
+        CPU_CRITICAL_ENTER();
+        slot = softap_clients_find(macs[i].octet);
+        if (slot >= 0) {
+          clients[slot].rssi = (int16_t)(((int32_t)rcpi - 220) / 2);
+        }
+        CPU_CRITICAL_EXIT();
+      }
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Create the client table task.
+ ******************************************************************************/
+void softap_clients_start(void)
+{
+  RTOS_ERR err;
+
+  OSTaskCreate(&softap_clients_task_tcb,
+               "WFX SoftAP clients task",
+               softap_clients_task,
+               DEF_NULL,
+               SOFTAP_CLIENTS_TASK_PRIO,
+               &softap_clients_task_stk[0],
+               (SOFTAP_CLIENTS_TASK_STK_SIZE / 10u),
+               SOFTAP_CLIENTS_TASK_STK_SIZE,
+               0u,
+               0u,
+               DEF_NULL,
+               (OS_OPT_TASK_STK_CLR),
+               &err);
+  APP_RTOS_ASSERT_DBG((RTOS_ERR_CODE_GET(err) == RTOS_ERR_NONE), 1);
+}
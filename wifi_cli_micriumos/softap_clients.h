@@ -0,0 +1,121 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef SOFTAP_CLIENTS_H
+#define SOFTAP_CLIENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Clients tracked, the table being twice as large to keep the probes short.
+#define SOFTAP_CLIENTS_MAX                16
+#define SOFTAP_CLIENTS_TABLE_SIZE         (2 * SOFTAP_CLIENTS_MAX)
+/// Period of the RSSI refresh and of the idle check (ms).
+#define SOFTAP_CLIENTS_PERIOD_MS          5000
+
+/// Client associated to the SoftAP.
+typedef struct {
+  uint8_t mac[6];
+  int16_t rssi;               ///< Last RSSI read (dBm), 0 before the first read
+  uint32_t assoc_ms;          ///< Association time
+  uint32_t last_rx_ms;        ///< Last frame received from the client
+  uint32_t tx_bytes;          ///< Sent to the client
+  uint32_t tx_packets;
+  uint32_t rx_bytes;          ///< Received from the client
+  uint32_t rx_packets;
+} softap_client_t;
+
+/// Client table statistics.
+typedef struct {
+  uint16_t clients;
+  uint16_t max_probes;        ///< Longest lookup since the reset
+  uint32_t evictions;         ///< Idle clients disconnected
+  uint32_t table_full;        ///< Associations not tracked
+  uint32_t unknown_frames;    ///< Unicast frames of clients not in the table
+} softap_clients_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Create the task refreshing the RSSI of the clients and disconnecting the
+ * idle ones.
+ ******************************************************************************/
+void softap_clients_start(void);
+
+/***************************************************************************//**
+ * Add an associated client, from the client connected indication. Its
+ * counters restart if already known.
+ ******************************************************************************/
+void softap_clients_add(const uint8_t *mac);
+
+/***************************************************************************//**
+ * Remove a client, from the client disconnected or rejected indications.
+ ******************************************************************************/
+void softap_clients_remove(const uint8_t *mac);
+
+/***************************************************************************//**
+ * Remove all the clients, when the SoftAP stops.
+ ******************************************************************************/
+void softap_clients_clear(void);
+
+/***************************************************************************//**
+ * Count a frame sent on the SoftAP interface.
+ *
+ * @param frame Ethernet frame, starting with the destination address
+ * @param len frame length
+ ******************************************************************************/
+void softap_clients_count_tx(const uint8_t *frame, uint16_t len);
+
+/***************************************************************************//**
+ * Count a frame received on the SoftAP interface.
+ *
+ * @param frame Ethernet frame, starting with the destination address
+ * @param len frame length
+ ******************************************************************************/
+void softap_clients_count_rx(const uint8_t *frame, uint16_t len);
+
+/***************************************************************************//**
+ * Get a copy of the clients, the busiest (TX+RX bytes) first.
+ *
+ * @param clients SOFTAP_CLIENTS_MAX clients
+ * @returns number of clients
+ ******************************************************************************/
+uint16_t softap_clients_get(softap_client_t *clients);
+
+/***************************************************************************//**
+ * Set the idle time after which a client is disconnected.
+ *
+ * @param idle_timeout_s time without any frame received, 0 to never disconnect
+ ******************************************************************************/
+void softap_clients_set_idle_timeout(uint32_t idle_timeout_s);
+
+/***************************************************************************//**
+ * Get the idle timeout and the table statistics.
+ ******************************************************************************/
+void softap_clients_get_stats(uint32_t *idle_timeout_s, softap_clients_stats_t *stats);
+
+/***************************************************************************//**
+ * Reset the traffic counters of the clients and the table statistics.
+ ******************************************************************************/
+void softap_clients_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,356 @@
+/***************************************************************************//**
+ * @file
+ * @brief Host run of the bench and rate_sweep runners against a mock driver
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * Runs wifi_cli/wifi_cli_bench.c with a bench_ops_t simulating the WFx:
+ * the rate algorithm settles on the rate of the set with the best goodput,
+ * the fastest rates failing the most, AARF losing more than Minstrel to
+ * the probing of a large set. The power mode and the direction also
+ * change the throughput.
+ * The full matrix (with the latency tests) and a sweep of the default rate
+ * sets are run, their CSV rows and ranking printed, then the calls made
+ * to the mock are checked: test count, power mode and TX rates restored, sweep
+ * ranked.
+ * -f n makes one test in n fail.
+ *
+ * Build: gcc -O2 -Wall -I tools/host -I wifi_cli -o bench_mock \
+ *          tools/bench_mock.c wifi_cli/wifi_cli_bench.c
+ * Usage: ./bench_mock [-f n]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "wifi_cli_bench.h"
+
+/* Simulated station */
+static struct {
+  uint8_t power_mode;
+  uint8_t rate_algo;
+  uint32_t rates;
+  uint8_t saved_rate_algo;      ///< TX settings of the station, as wlan_tx_params
+  uint32_t saved_rates;
+  bench_stats_t stats;
+  uint32_t fail_period;
+  uint32_t tests;
+  uint32_t throughput_tests;
+  uint32_t latency_tests;
+  uint32_t slept_ms;
+} mock = {
+  .power_mode = BENCH_PM_ACTIVE,
+  .rate_algo = BENCH_RATE_MINSTREL,
+  .rates = BENCH_RATES_N,
+  .saved_rate_algo = BENCH_RATE_MINSTREL,
+  .saved_rates = BENCH_RATES_N,
+};
+
+static int errors = 0;
+
+static void check(int condition, const char *what)
+{
+  if (!condition) {
+    fprintf(stderr, "FAILED: %s\n", what);
+    errors++;
+  }
+}
+
+/* PHY rates in kbps of the sl_wfx_rate_set_bitmask_t bits, 0 for the unused ones */
+static const uint32_t mock_rate_kbps[32] = {
+  1000, 2000, 5500, 11000, 0, 0, 0, 0,
+  6000, 9000, 12000, 18000, 24000, 36000, 48000, 54000,
+  6500, 13000, 19500, 26000, 39000, 52000, 58500, 65000,
+};
+
+/* Failed frames per mille at a PHY rate, the fastest ones failing the most */
+static uint32_t mock_failure_per_mille(uint32_t kbps)
+{
+  if (kbps >= 58500) {
+    return 350;
+  }
+  if (kbps >= 48000) {
+    return 200;
+  }
+  if (kbps >= 36000) {
+    return 80;
+  }
+  return 20;
+}
+
+/* Rate of the set with the best goodput, as the rate algorithm converges to it */
+static uint32_t mock_best_rate(uint32_t rates, uint32_t *rate_nb)
+{
+  uint32_t best = 0;
+  uint32_t best_goodput = 0;
+  uint32_t goodput;
+  uint32_t i;
+
+  *rate_nb = 0;
+  for (i = 0; i < 32; i++) {
+    if (!(rates & (1u << i)) || (mock_rate_kbps[i] == 0)) {
+      continue;
+    }
+    (*rate_nb)++;
+    goodput = (mock_rate_kbps[i] * (1000 - mock_failure_per_mille(mock_rate_kbps[i]))) / 1000;
+    if (goodput > best_goodput) {
+      best_goodput = goodput;
+      best = mock_rate_kbps[i];
+    }
+  }
+  return best;
+}
+
+/* The next test fails, one in fail_period */
+static int mock_test_fails(void)
+{
+  mock.tests++;
+  return (mock.fail_period != 0) && ((mock.tests % mock.fail_period) == 0);
+}
+
+static sl_status_t mock_set_power_mode(uint8_t power_mode)
+{
+  mock.power_mode = power_mode;
+  return SL_STATUS_OK;
+}
+
+static sl_status_t mock_set_tx_rates(uint8_t rate_algo, uint32_t rates)
+{
+  uint32_t rate_nb;
+
+  if ((mock_best_rate(rates, &rate_nb) == 0)
+      || ((rate_algo != BENCH_RATE_AARF) && (rate_algo != BENCH_RATE_MINSTREL))) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  mock.rate_algo = rate_algo;
+  mock.rates = rates;
+  return SL_STATUS_OK;
+}
+
+static sl_status_t mock_set_rate_algo(uint8_t rate_algo)
+{
+  return mock_set_tx_rates(rate_algo, 0xFFFFFFFF);
+}
+
+static sl_status_t mock_restore_tx_rates(void)
+{
+  return mock_set_tx_rates(mock.saved_rate_algo, mock.saved_rates);
+}
+
+static sl_status_t mock_get_statistics(bench_stats_t *stats)
+{
+  *stats = mock.stats;
+  return SL_STATUS_OK;
+}
+
+static sl_status_t mock_run_throughput(const char *server,
+                                       uint16_t port,
+                                       const bench_throughput_params_t *params,
+                                       bench_throughput_results_t *results)
+{
+  uint32_t rate_nb;
+  uint32_t phy_kbps = mock_best_rate(mock.rates, &rate_nb);
+  uint32_t failure_per_mille = mock_failure_per_mille(phy_kbps);
+  uint32_t efficiency;
+  uint32_t kbps;
+  uint32_t frames;
+  (void)server;
+  (void)port;
+
+  mock.throughput_tests++;
+  if (mock_test_fails()) {
+    return SL_STATUS_TIMEOUT;
+  }
+
+  /* The goodput of the best rate, less the probing of the other rates:
+     AARF walks through every rate of the set, Minstrel samples a few */
+  efficiency = (mock.rate_algo == BENCH_RATE_MINSTREL) ? 950 : (920 - (rate_nb * 2));
+  kbps = (((phy_kbps * (1000 - failure_per_mille)) / 1000) * efficiency) / 1000;
+  /* MAC and TCP/IP overheads */
+  kbps = (kbps * 70) / 100;
+  if (mock.power_mode == BENCH_PM_PS) {
+    kbps = (kbps * 70) / 100;
+  } else if (mock.power_mode == BENCH_PM_DTIM) {
+    kbps = (kbps * 50) / 100;
+  }
+  if (params->reverse) {
+    kbps = (kbps * 90) / 100;
+  }
+  if (params->udp && (params->bandwidth_bps != 0) && (kbps > params->bandwidth_bps / 1000)) {
+    kbps = params->bandwidth_bps / 1000;
+  }
+
+  memset(results, 0, sizeof(*results));
+  results->ms_duration = params->duration_sec * 1000;
+  results->kbps = kbps;
+  results->bytes = (uint32_t)(((uint64_t)kbps * results->ms_duration) / 8);
+  if (params->udp) {
+    results->datagrams = results->bytes / (params->len ? params->len : 1460);
+    results->lost = (results->datagrams * failure_per_mille) / 10000;
+    results->jitter_us = (mock.power_mode == BENCH_PM_ACTIVE) ? 300 : 2500;
+  }
+
+  frames = results->bytes / 1500;
+  if (!params->reverse) {
+    mock.stats.tx_success += frames;
+    mock.stats.tx_failure += (frames * failure_per_mille) / 1000;
+  }
+  mock.stats.beacon_missed += (mock.power_mode == BENCH_PM_ACTIVE) ? 0 : 1;
+  return SL_STATUS_OK;
+}
+
+static sl_status_t mock_run_latency(const char *peer,
+                                    uint16_t port,
+                                    bool udp,
+                                    uint16_t len,
+                                    uint32_t duration_sec,
+                                    bench_latency_results_t *results)
+{
+  /* The device wakes up at each beacon or DTIM to get the response */
+  uint32_t rtt_us = (mock.power_mode == BENCH_PM_ACTIVE) ? 2000 : 51000;
+  (void)peer;
+  (void)port;
+
+  mock.latency_tests++;
+  if (mock_test_fails()) {
+    return SL_STATUS_TIMEOUT;
+  }
+
+  rtt_us += (uint32_t)len * 2;
+  memset(results, 0, sizeof(*results));
+  results->ms_duration = duration_sec * 1000;
+  results->transactions = (duration_sec * 1000000) / rtt_us;
+  results->timeouts = udp ? results->transactions / 500 : 0;
+  results->min_us = rtt_us - 500;
+  results->avg_us = rtt_us;
+  results->p50_us = rtt_us;
+  results->p99_us = rtt_us * 2;
+  results->max_us = rtt_us * 3;
+  return SL_STATUS_OK;
+}
+
+static void mock_sleep_ms(uint32_t ms)
+{
+  mock.slept_ms += ms;
+}
+
+static const bench_ops_t mock_ops = {
+  .set_power_mode   = mock_set_power_mode,
+  .set_rate_algo    = mock_set_rate_algo,
+  .set_tx_rates     = mock_set_tx_rates,
+  .restore_tx_rates = mock_restore_tx_rates,
+  .get_statistics   = mock_get_statistics,
+  .run_throughput   = mock_run_throughput,
+  .run_latency      = mock_run_latency,
+  .sleep_ms         = mock_sleep_ms,
+};
+
+static void run_matrix(void)
+{
+  bench_matrix_t matrix;
+  sl_status_t status;
+  uint32_t cells;
+
+  memset(&matrix, 0, sizeof(matrix));
+  matrix.server = "192.168.0.1";
+  matrix.iperf3_port = 5201;
+  matrix.rr_port = 5003;
+  matrix.duration_sec = BENCH_DEFAULT_DURATION_SEC;
+  matrix.udp_bandwidth_bps = 20000000;
+  matrix.lens[0] = 512;
+  matrix.lens[1] = 1400;
+  matrix.len_nb = 2;
+  matrix.protos = BENCH_PROTO_TCP | BENCH_PROTO_UDP;
+  matrix.dirs = BENCH_DIR_TX | BENCH_DIR_RX;
+  matrix.power_modes = BENCH_PM_ACTIVE | BENCH_PM_PS | BENCH_PM_DTIM;
+  matrix.rate_algos = BENCH_RATE_AARF | BENCH_RATE_MINSTREL;
+
+  mock.throughput_tests = 0;
+  mock.latency_tests = 0;
+  status = bench_run(&matrix, &mock_ops);
+
+  /* rate algorithms x power modes x protocols x lengths */
+  cells = 2 * 3 * 2 * 2;
+  printf("# matrix: %lu throughput and %lu latency tests, status %s\n",
+         (unsigned long)mock.throughput_tests, (unsigned long)mock.latency_tests,
+         (status == SL_STATUS_OK) ? "ok" : "fail");
+  check(mock.throughput_tests == cells * 2, "one throughput test per cell and direction");
+  check(mock.latency_tests == cells, "one latency test per cell");
+  check(mock.power_mode == BENCH_PM_ACTIVE, "power mode set back to active");
+  check((mock.rate_algo == mock.saved_rate_algo) && (mock.rates == mock.saved_rates),
+        "TX rates restored after the matrix");
+  check((status == SL_STATUS_OK) == (mock.fail_period == 0), "matrix status");
+}
+
+static void run_sweep(void)
+{
+  static bench_sweep_result_t results[BENCH_SWEEP_MAX_RESULTS];
+  bench_sweep_t sweep;
+  sl_status_t status;
+  uint8_t result_nb;
+  uint8_t i;
+
+  memset(&sweep, 0, sizeof(sweep));
+  sweep.server = "192.168.0.1";
+  sweep.iperf3_port = 5201;
+  sweep.duration_sec = BENCH_DEFAULT_DURATION_SEC;
+  sweep.rate_sets[0] = (bench_rate_set_t){ "all", BENCH_RATES_ALL };
+  sweep.rate_sets[1] = (bench_rate_set_t){ "bg", BENCH_RATES_B | BENCH_RATES_G };
+  sweep.rate_sets[2] = (bench_rate_set_t){ "n", BENCH_RATES_N };
+  sweep.rate_sets[3] = (bench_rate_set_t){ "n_high", BENCH_RATES_N_HIGH };
+  sweep.rate_set_nb = 4;
+  sweep.rate_algos = BENCH_RATE_AARF | BENCH_RATE_MINSTREL;
+
+  mock.throughput_tests = 0;
+  status = bench_sweep(&sweep, &mock_ops, results, &result_nb);
+
+  printf("# sweep: %u results, status %s\n", result_nb, (status == SL_STATUS_OK) ? "ok" : "fail");
+  check(result_nb == 8, "one result per rate set and algorithm");
+  check(mock.throughput_tests == 8, "one test per rate set and algorithm");
+  check((mock.rate_algo == mock.saved_rate_algo) && (mock.rates == mock.saved_rates),
+        "TX rates restored after the sweep");
+  for (i = 1; i < result_nb; i++) {
+    if ((results[i].status == SL_STATUS_OK) && (results[i - 1].status == SL_STATUS_OK)) {
+      check(results[i].kbps <= results[i - 1].kbps, "results ranked by throughput");
+    } else {
+      check(results[i].status != SL_STATUS_OK, "failed tests ranked last");
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:h")) != -1) {
+    switch (opt) {
+      case 'f':
+        mock.fail_period = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-f n]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  run_matrix();
+  run_sweep();
+  printf("# %lu ms of gaps between the tests, %s\n",
+         (unsigned long)mock.slept_ms, errors ? "FAILED" : "passed");
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,294 @@
+/***************************************************************************//**
+ * @file
+ * @brief Host benchmark of the DHCP server lease database
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * Churns simulated clients through the lease database of the SoftAP DHCP
+ * server, 3/4 of the pool size by default so that the pool is not exhausted:
+ * each step, a random client joins (DISCOVER + REQUEST),
+ * renews, releases, declines or silently leaves, and the simulated time
+ * advances so that leases expire and get reclaimed. The database consistency
+ * (one address per client) is checked all along and the client lookup time
+ * is compared with the linear MAC list the server used before. The leases
+ * are saved as the server does, and restored at the end as after a reboot.
+ *
+ * Build, for a full /24 pool (the 32 leases of the target default make the
+ * hashed and linear lookups cost the same):
+ *        gcc -O2 -Wall -DDHCPS_LEASE_MAX=253 -DDHCPS_LEASE_HASH_SIZE=256 \
+ *          -I lwip_host/apps -o dhcp_server_lease_bench \
+ *          tools/dhcp_server_lease_bench.c lwip_host/apps/dhcp_server_lease.c
+ * Usage: ./dhcp_server_lease_bench [-n clients] [-o operations] [-p pool]
+ *                                  [-l lease_sec] [-s seed]
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dhcp_server_lease.h"
+
+#define BENCH_FIRST_IP        0x0A0A0002  /* 10.10.0.2 */
+#define BENCH_SAVE_PERIOD     60          /* Save coalescing of the server (s) */
+
+typedef struct {
+  uint8_t mac[6];
+  uint32_t ip;                /* Address the client believes it owns, 0 if none */
+} client_t;
+
+typedef struct {
+  uint64_t joins;
+  uint64_t naks;
+  uint64_t exhausted;
+  uint64_t renewals;
+  uint64_t releases;
+  uint64_t declines;
+  uint64_t leaves;
+  uint64_t expired;
+  uint64_t reused;            /* Idle clients whose address is still kept */
+  uint64_t saves;
+} counters_t;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Check that no address is bound to two clients */
+static int check_leases(uint16_t pool)
+{
+  uint8_t macs[DHCPS_LEASE_MAX][6];
+  uint8_t mac[6];
+  uint32_t ip;
+  uint16_t nb = 0;
+
+  for (uint16_t i = 0; i < pool; i++) {
+    if (!dhcps_lease_get(i, mac, &ip, NULL)) {
+      continue;
+    }
+    if (ip != BENCH_FIRST_IP + (uint32_t)i) {
+      fprintf(stderr, "lease %u: bad address %08x\n", i, ip);
+      return -1;
+    }
+    for (uint16_t j = 0; j < nb; j++) {
+      if (memcmp(macs[j], mac, 6) == 0) {
+        fprintf(stderr, "lease %u: client bound twice\n", i);
+        return -1;
+      }
+    }
+    if (dhcps_lease_get_ip(mac) != ip) {
+      fprintf(stderr, "lease %u: not found by its client\n", i);
+      return -1;
+    }
+    memcpy(macs[nb++], mac, 6);
+  }
+  return 0;
+}
+
+/* Save, clear and restore the leases, then compare them */
+static int check_restore(uint32_t first_ip, uint16_t pool, uint32_t lease_time, uint32_t now)
+{
+  static dhcps_lease_record_t saved[DHCPS_LEASE_MAX];
+  static dhcps_lease_record_t restored[DHCPS_LEASE_MAX];
+  uint16_t count = dhcps_lease_export(saved, DHCPS_LEASE_MAX, now);
+
+  dhcps_lease_init(first_ip, pool, lease_time);
+  if ((dhcps_lease_import(saved, count, now) != count)
+      || (dhcps_lease_export(restored, DHCPS_LEASE_MAX, now) != count)
+      || (memcmp(saved, restored, count * sizeof(saved[0])) != 0)) {
+    fprintf(stderr, "leases not restored\n");
+    return -1;
+  }
+  return count;
+}
+
+/* Lookup of the previous server: linear compare of the client list */
+static int linear_find(uint8_t (*list)[6], uint16_t size, const uint8_t *mac)
+{
+  for (uint16_t i = 0; i < size; i++) {
+    if (memcmp(list[i], mac, 6) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t client_nb = 0;             /* 3/4 of the pool */
+  uint32_t op_nb = 1000000;
+  uint32_t pool = DHCPS_LEASE_MAX;
+  uint32_t lease_time = 3600;
+  unsigned seed = 1;
+  counters_t cnt = { 0 };
+  client_t *clients;
+  uint8_t (*list)[6];
+  uint32_t now = 0;
+  uint32_t last_save = 0;
+  int restored;
+  uint64_t start, lease_ns, hash_ns, linear_ns;
+  volatile int sink = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:o:p:l:s:")) != -1) {
+    switch (opt) {
+      case 'n': client_nb = strtoul(optarg, NULL, 0); break;
+      case 'o': op_nb = strtoul(optarg, NULL, 0); break;
+      case 'p': pool = strtoul(optarg, NULL, 0); break;
+      case 'l': lease_time = strtoul(optarg, NULL, 0); break;
+      case 's': seed = strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "Usage: %s [-n clients] [-o operations] [-p pool] [-l lease_sec] [-s seed]\n", argv[0]);
+        return 1;
+    }
+  }
+  if ((pool == 0) || (pool > DHCPS_LEASE_MAX)) {
+    fprintf(stderr, "pool of 1 to %d addresses\n", DHCPS_LEASE_MAX);
+    return 1;
+  }
+  if (client_nb == 0) {
+    client_nb = (pool * 3 + 3) / 4;
+  }
+
+  clients = calloc(client_nb, sizeof(*clients));
+  list = calloc(pool, sizeof(*list));
+  if ((clients == NULL) || (list == NULL)) {
+    return 1;
+  }
+  srand(seed);
+  for (uint32_t i = 0; i < client_nb; i++) {
+    clients[i].mac[0] = 0x02;
+    clients[i].mac[1] = (uint8_t)rand();
+    clients[i].mac[2] = (uint8_t)(i >> 24);
+    clients[i].mac[3] = (uint8_t)(i >> 16);
+    clients[i].mac[4] = (uint8_t)(i >> 8);
+    clients[i].mac[5] = (uint8_t)i;
+  }
+
+  dhcps_lease_init(BENCH_FIRST_IP, (uint16_t)pool, lease_time);
+  start = now_ns();
+  for (uint32_t op = 0; op < op_nb; op++) {
+    client_t *c = &clients[(uint32_t)rand() % client_nb];
+    int action = rand() % 100;
+
+    /* A few seconds between operations, the server timer every 10 s */
+    now += (uint32_t)(rand() % 4);
+    if ((op % 4) == 0) {
+      cnt.expired += dhcps_lease_expire(now, NULL, NULL);
+    }
+
+    if (c->ip == 0) {
+      uint32_t offered = dhcps_lease_offer(c->mac, 0, now);
+      if (offered == 0) {
+        cnt.exhausted++;
+        continue;
+      }
+      if (dhcps_lease_request(c->mac, offered, now) != offered) {
+        cnt.naks++;
+        continue;
+      }
+      cnt.joins++;
+      c->ip = offered;
+    } else if (action < 50) {
+      /* Renewal, NAK if the lease was reclaimed meanwhile */
+      if (dhcps_lease_request(c->mac, c->ip, now) == c->ip) {
+        cnt.renewals++;
+      } else {
+        cnt.naks++;
+        c->ip = 0;
+      }
+    } else if (action < 80) {
+      dhcps_lease_release(c->mac, now);
+      cnt.releases++;
+      c->ip = 0;
+    } else if (action < 81) {
+      dhcps_lease_decline(c->mac, c->ip, now);
+      cnt.declines++;
+      c->ip = 0;
+    } else {
+      /* Leaves without release: the lease has to expire */
+      cnt.leaves++;
+      c->ip = 0;
+    }
+
+    if (dhcps_lease_is_dirty() && ((now - last_save) >= BENCH_SAVE_PERIOD)) {
+      static dhcps_lease_record_t records[DHCPS_LEASE_MAX];
+      dhcps_lease_export(records, DHCPS_LEASE_MAX, now);
+      last_save = now;
+      cnt.saves++;
+    }
+
+    if (((op & 0xFFF) == 0) && (check_leases((uint16_t)pool) != 0)) {
+      fprintf(stderr, "database check failed at operation %u\n", op);
+      return 1;
+    }
+  }
+  lease_ns = now_ns() - start;
+  if (check_leases((uint16_t)pool) != 0) {
+    return 1;
+  }
+
+  /* Count the idle clients whose address is still kept for them */
+  for (uint32_t i = 0; i < client_nb; i++) {
+    if ((clients[i].ip == 0) && (dhcps_lease_get_ip(clients[i].mac) != 0)) {
+      cnt.reused++;
+    }
+  }
+
+  restored = check_restore(BENCH_FIRST_IP, (uint16_t)pool, lease_time, now);
+  if (restored < 0) {
+    return 1;
+  }
+
+  /* Lookup time: hashed database against a full linear list */
+  for (uint32_t i = 0; i < pool; i++) {
+    memcpy(list[i], clients[i % client_nb].mac, 6);
+  }
+  start = now_ns();
+  for (uint32_t op = 0; op < op_nb; op++) {
+    sink += (int)dhcps_lease_get_ip(clients[op % client_nb].mac);
+  }
+  hash_ns = now_ns() - start;
+  start = now_ns();
+  for (uint32_t op = 0; op < op_nb; op++) {
+    sink += linear_find(list, (uint16_t)pool, clients[op % client_nb].mac);
+  }
+  linear_ns = now_ns() - start;
+
+  printf("clients %u, pool %u, lease %u s, %u operations, %u s simulated\n",
+         client_nb, pool, lease_time, op_nb, now);
+  printf("joins %llu, renewals %llu, releases %llu, declines %llu, leaves %llu\n",
+         (unsigned long long)cnt.joins, (unsigned long long)cnt.renewals,
+         (unsigned long long)cnt.releases, (unsigned long long)cnt.declines,
+         (unsigned long long)cnt.leaves);
+  printf("naks %llu, pool exhausted %llu, leases expired %llu, idle clients keeping an address %llu\n",
+         (unsigned long long)cnt.naks, (unsigned long long)cnt.exhausted,
+         (unsigned long long)cnt.expired, (unsigned long long)cnt.reused);
+  printf("saves %llu (one per %u s at most), %d leases restored\n",
+         (unsigned long long)cnt.saves, BENCH_SAVE_PERIOD, restored);
+  printf("churn: %.1f ns/operation\n", (double)lease_ns / op_nb);
+  printf("lookup: hashed %.1f ns, linear %.1f ns\n",
+         (double)hash_ns / op_nb, (double)linear_ns / op_nb);
+  free(clients);
+  free(list);
+  return sink == 0x7FFFFFFF;
+}
@@ -0,0 +1,200 @@
+/***************************************************************************//**
+ * @file
+ * @brief Host benchmark of the DHCP server reply builder
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * Builds DHCPOFFER replies to a DHCPDISCOVER in a loop and prints the
+ * replies/s of:
+ * - the previous server: copy of the request into a 1024-byte pool buffer,
+ *   then one pbuf_put_at() per byte of the reply (emulated with the same
+ *   chain walk as lwIP),
+ * - the block-copy builder of lwip_host/apps/dhcp_server_msg.c.
+ * The buffer allocation is left out of both.
+ *
+ * Build: gcc -O2 -Wall -I lwip_host/apps -o dhcp_server_msg_bench \
+ *          tools/dhcp_server_msg_bench.c lwip_host/apps/dhcp_server_msg.c
+ * Usage: ./dhcp_server_msg_bench [-n replies]
+ ******************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dhcp_server_msg.h"
+
+#define OLD_RESPONSE_SIZE     1024        /* DHCP_RESPONSE_DEFAULT_SIZE */
+#define OPTIONS_OFS           240
+#define COOKIE                0x63825363u
+#define SERVER_IP             0x0A0A0001u /* 10.10.0.1 */
+#define NETMASK               0xFFFFFF00u
+#define LEASE_TIME            86400u
+#define CLIENT_IP             0x0A0A0002u
+
+/* Minimal pbuf, enough for the per-byte accessors */
+typedef struct seg {
+  struct seg *next;
+  uint8_t *payload;
+  uint16_t len;
+} seg_t;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Same walk as pbuf_skip() + write of lwIP pbuf_put_at() */
+__attribute__((noinline)) static void put_at(seg_t *p, uint16_t offset, uint8_t data)
+{
+  while ((p != NULL) && (offset >= p->len)) {
+    offset -= p->len;
+    p = p->next;
+  }
+  if (p != NULL) {
+    p->payload[offset] = data;
+  }
+}
+
+__attribute__((noinline)) static uint8_t get_at(const seg_t *p, uint16_t offset)
+{
+  while ((p != NULL) && (offset >= p->len)) {
+    offset -= p->len;
+    p = p->next;
+  }
+  return (p != NULL) ? p->payload[offset] : 0;
+}
+
+static uint16_t put_u32(seg_t *p, uint16_t offset, uint8_t code, uint32_t value)
+{
+  put_at(p, offset++, code);
+  put_at(p, offset++, 4);
+  for (int i = 3; i >= 0; i--) {
+    put_at(p, offset++, (uint8_t)(value >> (8 * i)));
+  }
+  return offset;
+}
+
+/* Reply of the previous server, one access per byte */
+static uint16_t old_reply(seg_t *out, const uint8_t *request, uint16_t request_len)
+{
+  uint16_t offset;
+
+  memcpy(out->payload, request, request_len);   /* pbuf_copy() */
+  put_at(out, 0, 2);
+  put_at(out, 8, 0);
+  put_at(out, 10, get_at(out, 10) & 0x80);
+  for (int i = 0; i < 4; i++) {
+    put_at(out, 16 + i, (uint8_t)(CLIENT_IP >> (24 - 8 * i)));
+    put_at(out, 20 + i, 0);
+    put_at(out, 236 + i, (uint8_t)(COOKIE >> (24 - 8 * i)));
+  }
+  offset = OPTIONS_OFS;
+  put_at(out, offset++, 53);
+  put_at(out, offset++, 1);
+  put_at(out, offset++, 2);
+  offset = put_u32(out, offset, 1, NETMASK);
+  offset = put_u32(out, offset, 3, SERVER_IP);
+  offset = put_u32(out, offset, 51, LEASE_TIME);
+  offset = put_u32(out, offset, 54, SERVER_IP);
+  put_at(out, offset++, 255);
+  return offset;
+}
+
+/* Reply of the block-copy builder */
+static uint16_t new_reply(uint8_t *buf, const uint8_t *request)
+{
+  dhcps_msg_t msg;
+
+  memcpy(buf, request, DHCPS_MSG_HEADER_LEN);   /* pbuf_copy_partial() */
+  dhcps_msg_reply_init(&msg, buf, DHCPS_MSG_REPLY_LEN, 2, CLIENT_IP);
+  dhcps_msg_add_u32(&msg, 1, NETMASK);
+  dhcps_msg_add_u32(&msg, 3, SERVER_IP);
+  dhcps_msg_add_u32(&msg, 51, LEASE_TIME);
+  dhcps_msg_add_u32(&msg, 54, SERVER_IP);
+  return dhcps_msg_finish(&msg);
+}
+
+int main(int argc, char *argv[])
+{
+  static uint8_t request[DHCPS_MSG_MIN_LEN];
+  static uint8_t old_buf[OLD_RESPONSE_SIZE];
+  static uint8_t new_buf[DHCPS_MSG_REPLY_LEN];
+  static const uint8_t discover_options[] = {
+    0x63, 0x82, 0x53, 0x63, 53, 1, 1, 61, 7, 1, 2, 0, 0, 0, 0, 1,
+    55, 4, 1, 3, 6, 15, 12, 4, 'w', 'f', 'x', '0', 255
+  };
+  seg_t out = { NULL, old_buf, sizeof(old_buf) };
+  uint32_t reply_nb = 2000000;
+  uint16_t old_len = 0, new_len = 0;
+  uint64_t start, old_ns, new_ns;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    if (opt == 'n') {
+      reply_nb = strtoul(optarg, NULL, 0);
+    } else {
+      fprintf(stderr, "Usage: %s [-n replies]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (reply_nb == 0) {
+    return 1;
+  }
+
+  /* DHCPDISCOVER of 02:00:00:00:00:01, broadcast flag set */
+  request[0] = 1;
+  request[1] = 1;
+  request[2] = 6;
+  memcpy(&request[4], "\x12\x34\x56\x78", 4);
+  request[10] = 0x80;
+  memcpy(&request[28], "\x02\x00\x00\x00\x00\x01", 6);
+  memcpy(&request[236], discover_options, sizeof(discover_options));
+
+  start = now_ns();
+  for (uint32_t i = 0; i < reply_nb; i++) {
+    old_len = old_reply(&out, request, sizeof(request));
+    __asm__ volatile ("" : : "r" (old_buf) : "memory");
+  }
+  old_ns = now_ns() - start;
+
+  start = now_ns();
+  for (uint32_t i = 0; i < reply_nb; i++) {
+    new_len = new_reply(new_buf, request);
+    __asm__ volatile ("" : : "r" (new_buf) : "memory");
+  }
+  new_ns = now_ns() - start;
+
+  /* Same options, the new reply being padded to the BOOTP minimum length */
+  if ((new_len != DHCPS_MSG_MIN_LEN)
+      || (memcmp(old_buf, new_buf, 44) != 0)
+      || (memcmp(&old_buf[236], &new_buf[236], old_len - 236) != 0)) {
+    fprintf(stderr, "replies differ\n");
+    return 1;
+  }
+
+  printf("%u DHCPOFFER replies, %u-byte message\n", reply_nb, new_len);
+  printf("per-byte pbuf_put_at: %.0f replies/s (%.1f ns/reply)\n",
+         reply_nb * 1e9 / old_ns, (double)old_ns / reply_nb);
+  printf("block-copy builder:   %.0f replies/s (%.1f ns/reply)\n",
+         reply_nb * 1e9 / new_ns, (double)new_ns / reply_nb);
+  return 0;
+}
@@ -0,0 +1,318 @@
+/***************************************************************************//**
+ * @file
+ * @brief Linux peer of the request/response latency benchmark (rr command)
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * Answers the requests of the Wi-Fi CLI "rr" command on TCP and UDP:
+ * every request starts with {seq, request_len, response_len} (32-bit,
+ * network byte order), the response is response_len bytes starting with
+ * the sequence number.
+ *
+ * Build: gcc -O2 -Wall -o lwiperf_rr_peer lwiperf_rr_peer.c
+ * Usage: ./lwiperf_rr_peer [-p port] [-v]
+ ******************************************************************************/
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define RR_PORT_DEFAULT   5003      /* LWIPERF_RR_PORT_DEFAULT */
+#define RR_HDR_LEN        12
+#define RR_MAX_LEN        1472      /* LWIPERF_RR_MAX_LEN */
+#define RR_MAX_CLIENTS    8
+
+/* TCP client state, the socket being non-blocking: the header is read first,
+   then the rest of the request, then the response is sent, each step
+   resuming where the previous wakeup left it */
+typedef struct {
+  int fd;
+  uint8_t hdr[RR_HDR_LEN];
+  uint32_t hdr_count;
+  uint32_t request_left;
+  uint32_t response_len;
+  uint32_t response_left;
+  uint8_t response[RR_MAX_LEN];
+  unsigned long transactions;
+} rr_client_t;
+
+static rr_client_t clients[RR_MAX_CLIENTS];
+static uint8_t buffer[RR_MAX_LEN];
+static int verbose = 0;
+
+static uint32_t get_u32(const uint8_t *p)
+{
+  uint32_t value;
+
+  memcpy(&value, p, sizeof(value));
+  return ntohl(value);
+}
+
+static int open_socket(int type, uint16_t port)
+{
+  struct sockaddr_in addr;
+  int one = 1;
+  int fd;
+
+  fd = socket(AF_INET, type, 0);
+  if (fd < 0) {
+    perror("socket");
+    exit(EXIT_FAILURE);
+  }
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    exit(EXIT_FAILURE);
+  }
+  if ((type == SOCK_STREAM) && (listen(fd, RR_MAX_CLIENTS) < 0)) {
+    perror("listen");
+    exit(EXIT_FAILURE);
+  }
+  return fd;
+}
+
+static void close_client(rr_client_t *client)
+{
+  printf("TCP client closed after %lu transactions\n", client->transactions);
+  close(client->fd);
+  memset(client, 0, sizeof(*client));
+  client->fd = -1;
+}
+
+static void accept_client(int listen_fd)
+{
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  int one = 1;
+  int fd;
+  int i;
+
+  fd = accept(listen_fd, (struct sockaddr *)&addr, &addr_len);
+  if (fd < 0) {
+    return;
+  }
+  for (i = 0; i < RR_MAX_CLIENTS; i++) {
+    if (clients[i].fd < 0) {
+      break;
+    }
+  }
+  if (i == RR_MAX_CLIENTS) {
+    close(fd);
+    return;
+  }
+  /* Every response leaves at once, and no call waits for the client */
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  memset(&clients[i], 0, sizeof(clients[i]));
+  clients[i].fd = fd;
+  printf("TCP client %s:%u\n", inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+}
+
+/* Receive what is available: > 0 bytes received, 0 nothing yet, < 0 client closed */
+static ssize_t recv_some(rr_client_t *client, uint8_t *data, size_t len)
+{
+  ssize_t ret;
+
+  do {
+    ret = recv(client->fd, data, len, 0);
+  } while ((ret < 0) && (errno == EINTR));
+  if (ret > 0) {
+    return ret;
+  }
+  if ((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+    return 0;
+  }
+  close_client(client);
+  return -1;
+}
+
+/* Send what the socket takes of the response: 1 all sent, 0 not yet, < 0 client closed */
+static int send_response(rr_client_t *client)
+{
+  ssize_t ret;
+
+  while (client->response_left > 0) {
+    ret = send(client->fd, client->response + client->response_len - client->response_left,
+               client->response_left, MSG_NOSIGNAL);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        return 0;
+      }
+      close_client(client);
+      return -1;
+    }
+    client->response_left -= (uint32_t)ret;
+  }
+  return 1;
+}
+
+static void serve_client(rr_client_t *client)
+{
+  uint32_t request_len;
+  ssize_t ret;
+
+  for (;;) {
+    if (send_response(client) <= 0) {
+      return;
+    }
+
+    if (client->hdr_count < RR_HDR_LEN) {
+      ret = recv_some(client, client->hdr + client->hdr_count, RR_HDR_LEN - client->hdr_count);
+      if (ret <= 0) {
+        return;
+      }
+      client->hdr_count += (uint32_t)ret;
+      if (client->hdr_count < RR_HDR_LEN) {
+        continue;
+      }
+      request_len = get_u32(client->hdr + 4);
+      client->response_len = get_u32(client->hdr + 8);
+      if ((request_len < RR_HDR_LEN) || (request_len > RR_MAX_LEN)
+          || (client->response_len < sizeof(uint32_t)) || (client->response_len > RR_MAX_LEN)) {
+        fprintf(stderr, "Invalid request header\n");
+        close_client(client);
+        return;
+      }
+      client->request_left = request_len - RR_HDR_LEN;
+    }
+
+    if (client->request_left > 0) {
+      /* The request payload is not checked */
+      ret = recv_some(client, buffer, client->request_left);
+      if (ret <= 0) {
+        return;
+      }
+      client->request_left -= (uint32_t)ret;
+      if (client->request_left > 0) {
+        continue;
+      }
+    }
+
+    /* Request complete: answer with its sequence number */
+    memset(client->response, 0, client->response_len);
+    memcpy(client->response, client->hdr, sizeof(uint32_t));
+    client->response_left = client->response_len;
+    client->transactions++;
+    if (verbose) {
+      printf("TCP seq %u\n", get_u32(client->hdr));
+    }
+    client->hdr_count = 0;
+  }
+}
+
+static void serve_udp(int fd)
+{
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  uint32_t response_len;
+  ssize_t ret;
+
+  ret = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&addr, &addr_len);
+  if (ret < RR_HDR_LEN) {
+    return;
+  }
+  response_len = get_u32(buffer + 8);
+  if ((response_len < sizeof(uint32_t)) || (response_len > RR_MAX_LEN)) {
+    return;
+  }
+  /* The sequence number stays in place, the rest of the response is zeroed */
+  memset(buffer + sizeof(uint32_t), 0, response_len - sizeof(uint32_t));
+  sendto(fd, buffer, response_len, 0, (struct sockaddr *)&addr, addr_len);
+  if (verbose) {
+    printf("UDP seq %u from %s:%u\n", get_u32(buffer), inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  struct pollfd fds[2 + RR_MAX_CLIENTS];
+  uint16_t port = RR_PORT_DEFAULT;
+  int tcp_fd;
+  int udp_fd;
+  int opt;
+  int i;
+
+  while ((opt = getopt(argc, argv, "p:vh")) != -1) {
+    switch (opt) {
+      case 'p':
+        port = (uint16_t)atoi(optarg);
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-p port] [-v]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  for (i = 0; i < RR_MAX_CLIENTS; i++) {
+    clients[i].fd = -1;
+  }
+  tcp_fd = open_socket(SOCK_STREAM, port);
+  udp_fd = open_socket(SOCK_DGRAM, port);
+  printf("Request/response peer listening on TCP and UDP port %u\n", port);
+
+  for (;;) {
+    fds[0].fd = tcp_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = udp_fd;
+    fds[1].events = POLLIN;
+    for (i = 0; i < RR_MAX_CLIENTS; i++) {
+      fds[2 + i].fd = clients[i].fd;
+      /* A response waiting for room is sent before the next request is read */
+      fds[2 + i].events = (clients[i].response_left > 0) ? POLLOUT : POLLIN;
+      fds[2 + i].revents = 0;
+    }
+    if (poll(fds, 2 + RR_MAX_CLIENTS, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll");
+      return EXIT_FAILURE;
+    }
+    if (fds[0].revents & POLLIN) {
+      accept_client(tcp_fd);
+    }
+    if (fds[1].revents & POLLIN) {
+      serve_udp(udp_fd);
+    }
+    for (i = 0; i < RR_MAX_CLIENTS; i++) {
+      if ((clients[i].fd >= 0) && (fds[2 + i].revents & (POLLIN | POLLOUT | POLLHUP | POLLERR))) {
+        serve_client(&clients[i]);
+      }
+    }
+  }
+}
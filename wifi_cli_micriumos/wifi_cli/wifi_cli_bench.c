@@ -0,0 +1,412 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "wifi_cli_bench.h"
+
+/* Names of the CSV columns, the rows follow this order */
+#define BENCH_CSV_HEADER  "test,proto,dir,len,power_mode,rate_algo,status," \
+                          "duration_ms,bytes,kbps,jitter_us,lost,datagrams," \
+                          "transactions,min_us,avg_us,p50_us,p99_us,max_us," \
+                          "tx_success,tx_failure,beacon_missed"
+
+/* One cell of the matrix */
+typedef struct {
+  uint8_t proto;
+  uint8_t dir;
+  uint16_t len;
+  uint8_t power_mode;
+  uint8_t rate_algo;
+} bench_cell_t;
+
+/***************************************************************************//**
+ * @brief
+ *    Get the CSV name of a power mode.
+ ******************************************************************************/
+static const char *bench_power_mode_name(uint8_t power_mode)
+{
+  switch (power_mode) {
+    case BENCH_PM_ACTIVE: return "active";
+    case BENCH_PM_PS:     return "ps";
+    case BENCH_PM_DTIM:   return "dtim";
+    default:              return "unknown";
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Get the CSV name of a rate algorithm.
+ ******************************************************************************/
+static const char *bench_rate_algo_name(uint8_t rate_algo)
+{
+  switch (rate_algo) {
+    case BENCH_RATE_AARF:     return "aarf";
+    case BENCH_RATE_MINSTREL: return "minstrel";
+    default:                  return "current";
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Print the columns shared by every test of a cell.
+ ******************************************************************************/
+static void bench_print_cell(const char *test, const bench_cell_t *cell, const char *dir, sl_status_t status)
+{
+  printf("%s,%s,%s,%u,%s,%s,%s,",
+         test,
+         (cell->proto == BENCH_PROTO_UDP) ? "udp" : "tcp",
+         dir,
+         cell->len,
+         bench_power_mode_name(cell->power_mode),
+         bench_rate_algo_name(cell->rate_algo),
+         (status == SL_STATUS_OK) ? "ok" : "error");
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Print the driver statistics gathered during a test, empty columns if the
+ *    driver did not provide them.
+ ******************************************************************************/
+static void bench_print_stats(const bench_ops_t *ops, const bench_stats_t *before, sl_status_t before_status)
+{
+  bench_stats_t after;
+
+  if ((before_status != SL_STATUS_OK) || (ops->get_statistics(&after) != SL_STATUS_OK)) {
+    printf(",,\r\n");
+    return;
+  }
+  /* Unsigned differences stay right when a counter wraps */
+  printf("%lu,%lu,%lu\r\n",
+         (unsigned long)(after.tx_success - before->tx_success),
+         (unsigned long)(after.tx_failure - before->tx_failure),
+         (unsigned long)(after.beacon_missed - before->beacon_missed));
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Run the throughput test of a cell and print its row.
+ ******************************************************************************/
+static sl_status_t bench_run_throughput(const bench_matrix_t *matrix, const bench_ops_t *ops, const bench_cell_t *cell)
+{
+  bench_throughput_params_t params;
+  bench_throughput_results_t results;
+  bench_stats_t stats;
+  sl_status_t stats_status;
+  sl_status_t status;
+
+  memset(&params, 0, sizeof(params));
+  memset(&results, 0, sizeof(results));
+  params.udp = (cell->proto == BENCH_PROTO_UDP);
+  params.reverse = (cell->dir == BENCH_DIR_RX);
+  params.duration_sec = matrix->duration_sec;
+  params.bandwidth_bps = params.udp ? matrix->udp_bandwidth_bps : 0;
+  params.len = cell->len;
+
+  stats_status = ops->get_statistics(&stats);
+  status = ops->run_throughput(matrix->server, matrix->iperf3_port, &params, &results);
+
+  bench_print_cell("throughput", cell, (cell->dir == BENCH_DIR_RX) ? "rx" : "tx", status);
+  if (status == SL_STATUS_OK) {
+    printf("%lu,%lu,%lu,",
+           (unsigned long)results.ms_duration,
+           (unsigned long)results.bytes,
+           (unsigned long)results.kbps);
+    if (params.udp) {
+      printf("%lu,%lu,%lu,",
+             (unsigned long)results.jitter_us,
+             (unsigned long)results.lost,
+             (unsigned long)results.datagrams);
+    } else {
+      printf(",,,");
+    }
+  } else {
+    printf(",,,,,,");
+  }
+  /* No latency columns */
+  printf(",,,,,,");
+  bench_print_stats(ops, &stats, stats_status);
+
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Run the latency test of a cell and print its row.
+ ******************************************************************************/
+static sl_status_t bench_run_latency(const bench_matrix_t *matrix, const bench_ops_t *ops, const bench_cell_t *cell)
+{
+  bench_latency_results_t results;
+  bench_stats_t stats;
+  sl_status_t stats_status;
+  sl_status_t status;
+
+  memset(&results, 0, sizeof(results));
+  stats_status = ops->get_statistics(&stats);
+  status = ops->run_latency(matrix->server,
+                            matrix->rr_port,
+                            (cell->proto == BENCH_PROTO_UDP),
+                            cell->len,
+                            matrix->duration_sec,
+                            &results);
+
+  bench_print_cell("latency", cell, "rr", status);
+  if (status == SL_STATUS_OK) {
+    printf("%lu,,,,%lu,",
+           (unsigned long)results.ms_duration,
+           (unsigned long)results.timeouts);
+    if (cell->proto == BENCH_PROTO_UDP) {
+      /* One request datagram per transaction */
+      printf("%lu,", (unsigned long)(results.transactions + results.timeouts));
+    } else {
+      printf(",");
+    }
+    printf("%lu,%lu,%lu,%lu,%lu,%lu,",
+           (unsigned long)results.transactions,
+           (unsigned long)results.min_us,
+           (unsigned long)results.avg_us,
+           (unsigned long)results.p50_us,
+           (unsigned long)results.p99_us,
+           (unsigned long)results.max_us);
+  } else {
+    printf(",,,,,,,,,,,,");
+  }
+  bench_print_stats(ops, &stats, stats_status);
+
+  return status;
+}
+
+/***************************************************************************//**
+ * Run every cell of the matrix and print one CSV row per test.
+ ******************************************************************************/
+sl_status_t bench_run(const bench_matrix_t *matrix, const bench_ops_t *ops)
+{
+  static const uint16_t default_len = 0;
+  const uint16_t *lens = matrix->len_nb ? matrix->lens : &default_len;
+  uint8_t len_nb = matrix->len_nb ? matrix->len_nb : 1;
+  /* No rate algorithm: one pass keeping the current one */
+  uint8_t rate_algos = matrix->rate_algos ? matrix->rate_algos : BENCH_RATE_AARF;
+  sl_status_t result = SL_STATUS_OK;
+  bench_cell_t cell;
+  uint8_t rate_algo;
+  uint8_t power_mode;
+  uint8_t proto;
+  uint8_t dir;
+  uint8_t i;
+
+  if ((matrix->server == NULL) || (matrix->protos == 0) || (matrix->dirs == 0)
+      || (matrix->power_modes == 0) || (matrix->len_nb > BENCH_MAX_LENS)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  printf(BENCH_CSV_HEADER "\r\n");
+
+  /* The settings change in the outer loops, the least often */
+  for (rate_algo = BENCH_RATE_AARF; rate_algo <= BENCH_RATE_MINSTREL; rate_algo <<= 1) {
+    if (!(rate_algos & rate_algo)) {
+      continue;
+    }
+    cell.rate_algo = matrix->rate_algos ? rate_algo : 0;
+    if ((cell.rate_algo != 0) && (ops->set_rate_algo(cell.rate_algo) != SL_STATUS_OK)) {
+      printf("# failed to set the %s rate algorithm\r\n", bench_rate_algo_name(cell.rate_algo));
+      result = SL_STATUS_FAIL;
+      continue;
+    }
+
+    for (power_mode = BENCH_PM_ACTIVE; power_mode <= BENCH_PM_DTIM; power_mode <<= 1) {
+      if (!(matrix->power_modes & power_mode)) {
+        continue;
+      }
+      cell.power_mode = power_mode;
+      if (ops->set_power_mode(power_mode) != SL_STATUS_OK) {
+        printf("# failed to set the %s power mode\r\n", bench_power_mode_name(power_mode));
+        result = SL_STATUS_FAIL;
+        continue;
+      }
+
+      for (proto = BENCH_PROTO_TCP; proto <= BENCH_PROTO_UDP; proto <<= 1) {
+        if (!(matrix->protos & proto)) {
+          continue;
+        }
+        cell.proto = proto;
+
+        for (i = 0; i < len_nb; i++) {
+          cell.len = lens[i];
+
+          for (dir = BENCH_DIR_TX; dir <= BENCH_DIR_RX; dir <<= 1) {
+            if (!(matrix->dirs & dir)) {
+              continue;
+            }
+            cell.dir = dir;
+            if (bench_run_throughput(matrix, ops, &cell) != SL_STATUS_OK) {
+              result = SL_STATUS_FAIL;
+            }
+            ops->sleep_ms(BENCH_CELL_GAP_MS);
+          }
+
+          if (matrix->rr_port != 0) {
+            if (bench_run_latency(matrix, ops, &cell) != SL_STATUS_OK) {
+              result = SL_STATUS_FAIL;
+            }
+            ops->sleep_ms(BENCH_CELL_GAP_MS);
+          }
+        }
+      }
+    }
+  }
+
+  if ((matrix->power_modes != BENCH_PM_ACTIVE)
+      && (ops->set_power_mode(BENCH_PM_ACTIVE) != SL_STATUS_OK)) {
+    printf("# failed to restore the active power mode\r\n");
+    result = SL_STATUS_FAIL;
+  }
+  if ((matrix->rate_algos != 0) && (ops->restore_tx_rates() != SL_STATUS_OK)) {
+    printf("# failed to restore the TX rates\r\n");
+    result = SL_STATUS_FAIL;
+  }
+
+  return result;
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Tell whether a sweep result ranks before another one.
+ ******************************************************************************/
+static bool bench_sweep_better(const bench_sweep_result_t *a, const bench_sweep_result_t *b)
+{
+  if ((a->status == SL_STATUS_OK) != (b->status == SL_STATUS_OK)) {
+    return (a->status == SL_STATUS_OK);
+  }
+  if (a->kbps != b->kbps) {
+    return (a->kbps > b->kbps);
+  }
+  return (a->tx_failure < b->tx_failure);
+}
+
+/***************************************************************************//**
+ * Run the rate sweep and print its ranked results.
+ ******************************************************************************/
+sl_status_t bench_sweep(const bench_sweep_t *sweep,
+                        const bench_ops_t *ops,
+                        bench_sweep_result_t *results,
+                        uint8_t *result_nb)
+{
+  bench_throughput_params_t params;
+  bench_throughput_results_t iperf_results;
+  bench_stats_t before;
+  bench_stats_t after;
+  bench_sweep_result_t *result;
+  bench_sweep_result_t tmp;
+  uint32_t frames;
+  uint8_t rate_algo;
+  uint8_t nb = 0;
+  uint8_t i;
+  uint8_t j;
+
+  *result_nb = 0;
+  if ((sweep->server == NULL) || (sweep->rate_set_nb == 0)
+      || (sweep->rate_set_nb > BENCH_SWEEP_MAX_RATE_SETS) || (sweep->rate_algos == 0)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  memset(&params, 0, sizeof(params));
+  params.duration_sec = sweep->duration_sec;
+
+  for (i = 0; i < sweep->rate_set_nb; i++) {
+    for (rate_algo = BENCH_RATE_AARF; rate_algo <= BENCH_RATE_MINSTREL; rate_algo <<= 1) {
+      if (!(sweep->rate_algos & rate_algo)) {
+        continue;
+      }
+      result = &results[nb++];
+      memset(result, 0, sizeof(*result));
+      result->rate_set = sweep->rate_sets[i];
+      result->rate_algo = rate_algo;
+
+      result->status = ops->set_tx_rates(rate_algo, result->rate_set.rates);
+      if (result->status != SL_STATUS_OK) {
+        printf("# failed to set the TX rates 0x%08lX with %s\r\n",
+               (unsigned long)result->rate_set.rates, bench_rate_algo_name(rate_algo));
+        continue;
+      }
+
+      memset(&iperf_results, 0, sizeof(iperf_results));
+      if (ops->get_statistics(&before) != SL_STATUS_OK) {
+        /* The frame counts compare the rate sets, do not rank without them */
+        result->status = SL_STATUS_FAIL;
+        continue;
+      }
+      result->status = ops->run_throughput(sweep->server, sweep->iperf3_port, &params, &iperf_results);
+      if ((result->status == SL_STATUS_OK)
+          && (ops->get_statistics(&after) == SL_STATUS_OK)) {
+        result->kbps = iperf_results.kbps;
+        result->tx_success = after.tx_success - before.tx_success;
+        result->tx_failure = after.tx_failure - before.tx_failure;
+      } else {
+        result->status = SL_STATUS_FAIL;
+      }
+      printf("# %s 0x%08lX %s: ",
+             result->rate_set.name ? result->rate_set.name : "custom",
+             (unsigned long)result->rate_set.rates,
+             bench_rate_algo_name(rate_algo));
+      if (result->status == SL_STATUS_OK) {
+        printf("%lu kbps\r\n", (unsigned long)result->kbps);
+      } else {
+        printf("error\r\n");
+      }
+      ops->sleep_ms(BENCH_CELL_GAP_MS);
+    }
+  }
+
+  if (ops->restore_tx_rates() != SL_STATUS_OK) {
+    printf("# failed to restore the TX rates\r\n");
+  }
+
+  /* Insertion sort, a dozen results at most */
+  for (i = 1; i < nb; i++) {
+    tmp = results[i];
+    for (j = i; (j > 0) && bench_sweep_better(&tmp, &results[j - 1]); j--) {
+      results[j] = results[j - 1];
+    }
+    results[j] = tmp;
+  }
+
+  printf("rank rate_set rates      algo     status     kbps    tx_ok  tx_fail fail%%\r\n");
+  for (i = 0; i < nb; i++) {
+    result = &results[i];
+    frames = result->tx_success + result->tx_failure;
+    printf("%4u %-8s 0x%08lX %-8s %-6s %8lu %8lu %8lu",
+           i + 1,
+           result->rate_set.name ? result->rate_set.name : "custom",
+           (unsigned long)result->rate_set.rates,
+           bench_rate_algo_name(result->rate_algo),
+           (result->status == SL_STATUS_OK) ? "ok" : "error",
+           (unsigned long)result->kbps,
+           (unsigned long)result->tx_success,
+           (unsigned long)result->tx_failure);
+    if (frames != 0) {
+      printf(" %3lu.%lu\r\n",
+             (unsigned long)(((uint64_t)result->tx_failure * 100) / frames),
+             (unsigned long)((((uint64_t)result->tx_failure * 1000) / frames) % 10));
+    } else {
+      printf("     -\r\n");
+    }
+  }
+
+  *result_nb = nb;
+  return ((nb > 0) && (results[0].status == SL_STATUS_OK)) ? SL_STATUS_OK : SL_STATUS_FAIL;
+}
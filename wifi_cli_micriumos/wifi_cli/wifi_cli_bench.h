@@ -0,0 +1,192 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef WIFI_CLI_BENCH_H
+#define WIFI_CLI_BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+
+#define BENCH_DEFAULT_DURATION_SEC          5
+#define BENCH_MAX_LENS                      4           /*!< packet sizes of a matrix */
+#define BENCH_CELL_GAP_MS                   500         /*!< lets the peer close the previous test */
+
+/* Matrix dimensions, each one is a bitmask of the values to run */
+#define BENCH_PROTO_TCP                     0x01
+#define BENCH_PROTO_UDP                     0x02
+
+#define BENCH_DIR_TX                        0x01        /*!< the device sends */
+#define BENCH_DIR_RX                        0x02        /*!< the device receives */
+
+#define BENCH_PM_ACTIVE                     0x01
+#define BENCH_PM_PS                         0x02        /*!< wakes up at each beacon */
+#define BENCH_PM_DTIM                       0x04        /*!< wakes up at each DTIM */
+
+#define BENCH_RATE_AARF                     0x01
+#define BENCH_RATE_MINSTREL                 0x02        /*!< no bit: the rate algorithm is kept */
+
+/* TX rate sets, as the 32 bits of sl_wfx_rate_set_bitmask_t */
+#define BENCH_RATES_B                       0x0000000F  /*!< 1, 2, 5.5 and 11 Mbps */
+#define BENCH_RATES_G                       0x0000FF00  /*!< 6 to 54 Mbps */
+#define BENCH_RATES_N                       0x00FF0000  /*!< MCS0 to MCS7 */
+#define BENCH_RATES_N_HIGH                  0x00F00000  /*!< MCS4 to MCS7 */
+#define BENCH_RATES_ALL                     (BENCH_RATES_B | BENCH_RATES_G | BENCH_RATES_N)
+
+#define BENCH_SWEEP_MAX_RATE_SETS           6
+#define BENCH_SWEEP_MAX_RESULTS             (BENCH_SWEEP_MAX_RATE_SETS * 2)
+
+/// Benchmark matrix
+typedef struct {
+  const char *server;           ///< IP address of the iPerf3 server and of the RR peer
+  uint16_t iperf3_port;
+  uint16_t rr_port;             ///< Port of the RR peer, 0 to skip the latency tests
+  uint32_t duration_sec;        ///< Duration of each test
+  uint32_t udp_bandwidth_bps;   ///< UDP target bandwidth, 0 for the iperf3 default one
+  uint16_t lens[BENCH_MAX_LENS];///< Write/datagram/request lengths, 0 for the default one
+  uint8_t len_nb;
+  uint8_t protos;               ///< BENCH_PROTO_xxx
+  uint8_t dirs;                 ///< BENCH_DIR_xxx
+  uint8_t power_modes;          ///< BENCH_PM_xxx
+  uint8_t rate_algos;           ///< BENCH_RATE_xxx
+} bench_matrix_t;
+
+/// TX rate set of a sweep
+typedef struct {
+  const char *name;             ///< NULL for a set given as a bitmask
+  uint32_t rates;               ///< BENCH_RATES_xxx or any sl_wfx_rate_set_bitmask_t value
+} bench_rate_set_t;
+
+/// Rate sweep: one TCP upload per rate set and rate algorithm
+typedef struct {
+  const char *server;           ///< IP address of the iPerf3 server
+  uint16_t iperf3_port;
+  uint32_t duration_sec;        ///< Duration of each test
+  bench_rate_set_t rate_sets[BENCH_SWEEP_MAX_RATE_SETS];
+  uint8_t rate_set_nb;
+  uint8_t rate_algos;           ///< BENCH_RATE_xxx, at least one
+} bench_sweep_t;
+
+/// Result of a sweep test
+typedef struct {
+  bench_rate_set_t rate_set;
+  uint8_t rate_algo;            ///< BENCH_RATE_xxx
+  sl_status_t status;
+  uint32_t kbps;
+  uint32_t tx_success;          ///< Unicast frames sent during the test
+  uint32_t tx_failure;          ///< Unicast frames given up during the test
+} bench_sweep_result_t;
+
+/// Driver counters, read before and after each test
+typedef struct {
+  uint32_t tx_success;          ///< Unicast frames sent
+  uint32_t tx_failure;          ///< Unicast frames given up
+  uint32_t beacon_missed;       ///< Beacons missed
+} bench_stats_t;
+
+/// Throughput test (an iPerf3 client on the target)
+typedef struct {
+  bool udp;
+  bool reverse;                 ///< The device receives
+  uint32_t duration_sec;
+  uint32_t bandwidth_bps;       ///< UDP target bandwidth, 0 for the default one
+  uint32_t len;                 ///< Write/datagram length, 0 for the default one
+} bench_throughput_params_t;
+
+/// Throughput test results
+typedef struct {
+  uint32_t ms_duration;
+  uint32_t bytes;
+  uint32_t kbps;
+  uint32_t jitter_us;           ///< UDP only
+  uint32_t lost;                ///< UDP only
+  uint32_t datagrams;           ///< UDP only
+} bench_throughput_results_t;
+
+/// Latency test results (request/response transactions)
+typedef struct {
+  uint32_t ms_duration;
+  uint32_t transactions;
+  uint32_t timeouts;            ///< UDP requests or responses lost
+  uint32_t min_us;
+  uint32_t avg_us;
+  uint32_t p50_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+} bench_latency_results_t;
+
+/// Target operations of the runner, so that it also runs against another
+/// driver, or a mock on a host (see tools/bench_mock.c)
+typedef struct {
+  sl_status_t (*set_power_mode)(uint8_t power_mode);
+  sl_status_t (*set_rate_algo)(uint8_t rate_algo);
+  sl_status_t (*set_tx_rates)(uint8_t rate_algo, uint32_t rates);
+  /// Set back the TX rates and rate algorithm in force before the tests
+  sl_status_t (*restore_tx_rates)(void);
+  sl_status_t (*get_statistics)(bench_stats_t *stats);
+  sl_status_t (*run_throughput)(const char *server,
+                                uint16_t port,
+                                const bench_throughput_params_t *params,
+                                bench_throughput_results_t *results);
+  sl_status_t (*run_latency)(const char *peer,
+                             uint16_t port,
+                             bool udp,
+                             uint16_t len,
+                             uint32_t duration_sec,
+                             bench_latency_results_t *results);
+  void (*sleep_ms)(uint32_t ms);
+} bench_ops_t;
+
+/// Operations on the WFx driver and the lwIP benchmarks (wifi_cli_bench_wfx.c)
+extern const bench_ops_t bench_wfx_ops;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Run every cell of the matrix and print one CSV row per test. The caller task
+ * is blocked meanwhile. The power mode is set back to ACTIVE and the TX rates
+ * in force before the tests are restored at the end.
+ *
+ * @param matrix benchmark matrix
+ * @param ops target operations
+ * @returns SL_STATUS_OK if every test succeeded, SL_STATUS_FAIL otherwise
+ ******************************************************************************/
+sl_status_t bench_run(const bench_matrix_t *matrix, const bench_ops_t *ops);
+
+/***************************************************************************//**
+ * Run a TCP upload for each rate set and rate algorithm of the sweep, then
+ * print the results ranked by throughput, the fewest failed frames first at
+ * equal throughput. The TX rates in force before the tests are restored
+ * at the end, the caller applies the best ones if wanted.
+ *
+ * @param sweep rate sweep
+ * @param ops target operations
+ * @param results BENCH_SWEEP_MAX_RESULTS results, ranked, the best one first
+ * @param result_nb number of results
+ * @returns SL_STATUS_OK if the best test succeeded, SL_STATUS_FAIL otherwise
+ ******************************************************************************/
+sl_status_t bench_sweep(const bench_sweep_t *sweep,
+                        const bench_ops_t *ops,
+                        bench_sweep_result_t *results,
+                        uint8_t *result_nb);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
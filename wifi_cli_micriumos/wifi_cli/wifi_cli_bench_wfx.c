@@ -0,0 +1,201 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include "wifi_cli_bench.h"
+#include "wifi_cli_lwip.h"
+#include "wifi_cli_params.h"
+#include "sl_wfx_cmd_api.h"
+#include "lwiperf3.h"
+#include "lwiperf_rr.h"
+#include "lwip/sys.h"
+
+/***************************************************************************//**
+ * @brief
+ *    Set the power mode of the station interface.
+ ******************************************************************************/
+static sl_status_t bench_wfx_set_power_mode(uint8_t power_mode)
+{
+  switch (power_mode) {
+    case BENCH_PM_ACTIVE:
+      return sl_wfx_set_power_mode(WFM_PM_MODE_ACTIVE, WFM_PM_POLL_FAST_PS, 0, 0);
+    case BENCH_PM_PS:
+      /* Fast-PS with its default timeout, as "wifi powermode beacons fast_ps 1 0" */
+      return sl_wfx_set_power_mode(WFM_PM_MODE_PS, WFM_PM_POLL_FAST_PS, 1, 0);
+    case BENCH_PM_DTIM:
+      return sl_wfx_set_power_mode(WFM_PM_MODE_DTIM, WFM_PM_POLL_FAST_PS, 1, 0);
+    default:
+      return SL_STATUS_INVALID_PARAMETER;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Select the TX rate algorithm and the TX rates of the station interface.
+ ******************************************************************************/
+static sl_status_t bench_wfx_set_tx_rates(uint8_t rate_algo, uint32_t rates)
+{
+  sl_wfx_rate_set_bitmask_t bitmask;
+
+  memcpy(&bitmask, &rates, sizeof(sl_wfx_rate_set_bitmask_t));
+  return sl_wfx_set_tx_rate_parameters(bitmask,
+                                       (rate_algo == BENCH_RATE_MINSTREL) ? 1 : 0,
+                                       SL_WFX_STA_INTERFACE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Select the TX rate algorithm of the station interface, all rates enabled.
+ ******************************************************************************/
+static sl_status_t bench_wfx_set_rate_algo(uint8_t rate_algo)
+{
+  return bench_wfx_set_tx_rates(rate_algo, 0xFFFFFFFF);
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Set back the TX parameters of the station, the ones applied at each
+ *    connection if set, the firmware defaults (all rates, AARF) otherwise.
+ ******************************************************************************/
+static sl_status_t bench_wfx_restore_tx_rates(void)
+{
+  if (wlan_tx_params.set) {
+    return bench_wfx_set_tx_rates(wlan_tx_params.rate_algo ? BENCH_RATE_MINSTREL : BENCH_RATE_AARF,
+                                  wlan_tx_params.rates);
+  }
+  return bench_wfx_set_tx_rates(BENCH_RATE_AARF, 0xFFFFFFFF);
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Get the statistics of the station interface.
+ ******************************************************************************/
+static sl_status_t bench_wfx_get_statistics(bench_stats_t *stats)
+{
+  sl_wfx_statistics_t wfx_stats;
+  sl_status_t status;
+
+  status = sl_wfx_get_statistics(&wfx_stats);
+  if (status == SL_STATUS_OK) {
+    stats->tx_success = wfx_stats.unicast_tx_success_count;
+    stats->tx_failure = wfx_stats.unicast_tx_failure_count;
+    stats->beacon_missed = wfx_stats.beacon_rx_missed_count;
+  }
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Run an iPerf3 client test in foreground and get its results.
+ ******************************************************************************/
+static sl_status_t bench_wfx_run_throughput(const char *server,
+                                            uint16_t port,
+                                            const bench_throughput_params_t *params,
+                                            bench_throughput_results_t *results)
+{
+  lwiperf3_params_t iperf3_params;
+  lwiperf3_results_t iperf3_results;
+  sl_status_t status;
+
+  memset(&iperf3_params, 0, sizeof(iperf3_params));
+  iperf3_params.udp = params->udp ? 1 : 0;
+  iperf3_params.reverse = params->reverse ? 1 : 0;
+  iperf3_params.num_streams = 1;
+  iperf3_params.duration_sec = params->duration_sec;
+  iperf3_params.bandwidth_bps = params->bandwidth_bps;
+  iperf3_params.len = params->len;
+
+  iperf_client_set_quiet_mode(true);
+  iperf3_client((char *)server, port, &iperf3_params, true);
+  status = iperf3_client_get_results(&iperf3_results);
+  if (status == SL_STATUS_OK) {
+    results->ms_duration = iperf3_results.ms_duration;
+    results->bytes = iperf3_results.bytes_transferred;
+    results->kbps = iperf3_results.bandwidth_kbitpsec;
+    results->jitter_us = iperf3_results.udp_stats.jitter_us;
+    results->lost = iperf3_results.udp_stats.lost;
+    results->datagrams = iperf3_results.udp_stats.datagrams;
+  } else {
+    /* Do not leave a late test running into the next one */
+    stop_iperf_client();
+  }
+  iperf_client_set_quiet_mode(false);
+
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Run a request/response benchmark in foreground and get its results.
+ ******************************************************************************/
+static sl_status_t bench_wfx_run_latency(const char *peer,
+                                         uint16_t port,
+                                         bool udp,
+                                         uint16_t len,
+                                         uint32_t duration_sec,
+                                         bench_latency_results_t *results)
+{
+  lwiperf_rr_results_t rr_results;
+  sl_status_t status;
+
+  /* Requests and responses of the packet size, within the RR limits */
+  if (len < LWIPERF_RR_MIN_REQUEST_LEN) {
+    len = LWIPERF_RR_MIN_REQUEST_LEN;
+  } else if (len > LWIPERF_RR_MAX_LEN) {
+    len = LWIPERF_RR_MAX_LEN;
+  }
+
+  iperf_client_set_quiet_mode(true);
+  rr_client((char *)peer, port, udp, len, len, duration_sec, true);
+  status = rr_client_get_results(&rr_results);
+  if (status == SL_STATUS_OK) {
+    results->ms_duration = rr_results.ms_duration;
+    results->transactions = rr_results.transactions;
+    results->timeouts = rr_results.timeouts;
+    results->min_us = rr_results.min_us;
+    results->avg_us = rr_results.avg_us;
+    results->p50_us = rr_results.p50_us;
+    results->p99_us = rr_results.p99_us;
+    results->max_us = rr_results.max_us;
+  } else {
+    stop_iperf_client();
+  }
+  iperf_client_set_quiet_mode(false);
+
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Let the peer close the previous test, the caller task sleeping.
+ ******************************************************************************/
+static void bench_wfx_sleep_ms(uint32_t ms)
+{
+  sys_msleep(ms);
+}
+
+const bench_ops_t bench_wfx_ops = {
+  .set_power_mode   = bench_wfx_set_power_mode,
+  .set_rate_algo    = bench_wfx_set_rate_algo,
+  .set_tx_rates     = bench_wfx_set_tx_rates,
+  .restore_tx_rates = bench_wfx_restore_tx_rates,
+  .get_statistics   = bench_wfx_get_statistics,
+  .run_throughput   = bench_wfx_run_throughput,
+  .run_latency      = bench_wfx_run_latency,
+  .sleep_ms         = bench_wfx_sleep_ms,
+};
@@ -142,6 +142,12 @@ static const sl_cli_command_info_t cli_cmd_get_statistics = \
                    "station.stats" SL_CLI_UNIT_SEPARATOR,
                    {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
 
+static const sl_cli_command_info_t cli_cmd_get_station_connect_times = \
+    SL_CLI_COMMAND(get_station_connect_times,
+                   "Get the time-to-connect of each join path",
+                   "station.connect_times" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
 static const sl_cli_command_info_t cli_cmd_get_softap_passkey = \
    SL_CLI_COMMAND(get_softap_passkey,
                   "Get SoftAP passkey",
@@ -160,6 +166,24 @@ static const sl_cli_command_info_t cli_cmd_get_softap_channel = \
                   "softap.channel" SL_CLI_UNIT_SEPARATOR,
                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
 
+static const sl_cli_command_info_t cli_cmd_get_softap_dhcp_pool_start = \
+   SL_CLI_COMMAND(get_softap_dhcp_param,
+                  "Get SoftAP DHCP pool first address, last octet (decimal)",
+                  "softap.dhcp_pool_start" SL_CLI_UNIT_SEPARATOR,
+                  {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_get_softap_dhcp_pool_end = \
+   SL_CLI_COMMAND(get_softap_dhcp_param,
+                  "Get SoftAP DHCP pool last address, last octet (decimal)",
+                  "softap.dhcp_pool_end" SL_CLI_UNIT_SEPARATOR,
+                  {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_get_softap_dhcp_lease_time = \
+   SL_CLI_COMMAND(get_softap_dhcp_param,
+                  "Get SoftAP DHCP lease time (seconds)",
+                  "softap.dhcp_lease_time" SL_CLI_UNIT_SEPARATOR,
+                  {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
 static const sl_cli_command_info_t cli_cmd_get_softap_netmask = \
    SL_CLI_COMMAND(get_softap_netmask,
                   "Get SoftAP netmask (IPv4 format)",
@@ -220,10 +244,14 @@ static const sl_cli_command_entry_t cmd_get_grp_table[] = {
     {"station.pmk", &cli_cmd_get_station_pmk, false},
     {"station.mac", &cli_cmd_get_station_mac, false},
     {"station.stats", &cli_cmd_get_statistics, false},
+    {"station.connect_times", &cli_cmd_get_station_connect_times, false},
     {"softap.ssid", &cli_cmd_get_softap_ssid, false},
     {"softap.passkey", &cli_cmd_get_softap_passkey, false},
     {"softap.security", &cli_cmd_get_softap_security, false},
     {"softap.channel", &cli_cmd_get_softap_channel, false},
+    {"softap.dhcp_pool_start", &cli_cmd_get_softap_dhcp_pool_start, false},
+    {"softap.dhcp_pool_end", &cli_cmd_get_softap_dhcp_pool_end, false},
+    {"softap.dhcp_lease_time", &cli_cmd_get_softap_dhcp_lease_time, false},
     {"softap.netmask", &cli_cmd_get_softap_netmask, false},
     {"softap.gateway", &cli_cmd_get_softap_gateway, false},
     {"softap.ip", &cli_cmd_get_softap_ip, false},
@@ -320,6 +348,24 @@ static const sl_cli_command_info_t cli_cmd_set_softap_channel = \
                   "softap.channel" SL_CLI_UNIT_SEPARATOR,
                   {SL_CLI_ARG_STRING, SL_CLI_ARG_END, });
 
+static const sl_cli_command_info_t cli_cmd_set_softap_dhcp_pool_start = \
+   SL_CLI_COMMAND(set_softap_dhcp_param,
+                  "Set SoftAP DHCP pool first address, last octet (1..254)",
+                  "softap.dhcp_pool_start" SL_CLI_UNIT_SEPARATOR,
+                  {SL_CLI_ARG_STRING, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_set_softap_dhcp_pool_end = \
+   SL_CLI_COMMAND(set_softap_dhcp_param,
+                  "Set SoftAP DHCP pool last address, last octet (1..254)",
+                  "softap.dhcp_pool_end" SL_CLI_UNIT_SEPARATOR,
+                  {SL_CLI_ARG_STRING, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_set_softap_dhcp_lease_time = \
+   SL_CLI_COMMAND(set_softap_dhcp_param,
+                  "Set SoftAP DHCP lease time (seconds)",
+                  "softap.dhcp_lease_time" SL_CLI_UNIT_SEPARATOR,
+                  {SL_CLI_ARG_STRING, SL_CLI_ARG_END, });
+
 static const sl_cli_command_info_t cli_cmd_set_softap_netmask = \
    SL_CLI_COMMAND(set_softap_netmask,
                   "Set SoftAP netmask (IPv4 format)",
@@ -387,6 +433,9 @@ static const sl_cli_command_entry_t cmd_set_grp_table[] = {
     {"softap.passkey", &cli_cmd_set_softap_passkey, false},
     {"softap.security", &cli_cmd_set_softap_security, false},
     {"softap.channel", &cli_cmd_set_softap_channel, false},
+    {"softap.dhcp_pool_start", &cli_cmd_set_softap_dhcp_pool_start, false},
+    {"softap.dhcp_pool_end", &cli_cmd_set_softap_dhcp_pool_end, false},
+    {"softap.dhcp_lease_time", &cli_cmd_set_softap_dhcp_lease_time, false},
     {"softap.netmask", &cli_cmd_set_softap_netmask, false},
     {"softap.gateway", &cli_cmd_set_softap_gateway, false},
     {"softap.ip", &cli_cmd_set_softap_ip, false},
@@ -440,8 +489,16 @@ static const sl_cli_command_info_t cli_cmd_wifi_sta_disconnect = \
 
 static const sl_cli_command_info_t cli_cmd_wifi_sta_scan = \
     SL_CLI_COMMAND(wifi_station_scan,
-                   "Perform a Wi-Fi scan",
-                   "Wi-Fi Scan" SL_CLI_UNIT_SEPARATOR,
+                   "Perform a Wi-Fi scan and list the access points by RSSI",
+                   "[ssid] [OPEN|WEP|WPA|WPA2|WPA3] [full|learned|directed]" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_wifi_scan_profile = \
+    SL_CLI_COMMAND(wifi_scan_profile,
+                   "Display the scan profiles and durations, select the"
+                   " regulatory domain or set the dwell settings of a profile",
+                   "[region WORLD|ETSI|FCC|MKK] |"
+                   " [full|learned|directed active_tu passive_tu probes]" SL_CLI_UNIT_SEPARATOR,
                    {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
 
 static const sl_cli_command_info_t cli_cmd_wifi_sta_rssi = \
@@ -450,6 +507,26 @@ static const sl_cli_command_info_t cli_cmd_wifi_sta_rssi = \
                    "Station RSSI" SL_CLI_UNIT_SEPARATOR,
                    {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
 
+static const sl_cli_command_info_t cli_cmd_wifi_event_pool = \
+    SL_CLI_COMMAND(wifi_event_pool,
+                   "Display or reset the statistics of the Wi-Fi event slots",
+                   "[reset]" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_wifi_event_bus = \
+    SL_CLI_COMMAND(wifi_event_bus,
+                   "Display the Wi-Fi event subscribers and their wake-up"
+                   " latency, or reset their statistics",
+                   "[reset]" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_wifi_sta_roam = \
+    SL_CLI_COMMAND(wifi_station_roam,
+                   "Display the roaming statistics, or enable/disable the"
+                   " roaming on the station RSSI",
+                   "[on|off [threshold_dbm [hysteresis_db]]]" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
 /**************************************************************************//**
  * @brief: Construct start/stop softAP & get softAP RSSI commands
  ******************************************************************************/
@@ -473,6 +550,13 @@ static const sl_cli_command_info_t cli_cmd_wifi_softap_rssi = \
                    "(MAC format: 00:00:00:00:00:00)" SL_CLI_UNIT_SEPARATOR,
                    {SL_CLI_ARG_STRING, SL_CLI_ARG_END, });
 
+static const sl_cli_command_info_t cli_cmd_wifi_softap_clients = \
+    SL_CLI_COMMAND(wifi_softap_clients,
+                   "Display the traffic and RSSI of the SoftAP clients, the busiest"
+                   " first, or set the idle time before disconnecting a client",
+                   "[json | reset | idle <timeout_s>]" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
 /**************************************************************************//**
  * @brief: Construct wifi powermode, powersave commands
  ******************************************************************************/
@@ -493,6 +577,28 @@ static const sl_cli_command_info_t cli_cmd_wifi_station_power_save = \
                    "wifi powersave <state>" SL_CLI_UNIT_SEPARATOR,
                    {SL_CLI_ARG_STRING, SL_CLI_ARG_END, });
 
+static const sl_cli_command_info_t cli_cmd_wifi_station_power_auto = \
+    SL_CLI_COMMAND(wifi_station_power_auto,
+                   "Display the power-save controller statistics, or"
+                   " enable/disable the power mode following the traffic",
+                   "[reset | on|off [active_bps [fast_ps_bps [hold_ms [dtim_interval]]]]]"
+                   SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_wifi_conn_timing = \
+    SL_CLI_COMMAND(wifi_conn_timing,
+                   "Display the min/avg/p50/p90/max of each connection phase,"
+                   " dump the last connections as CSV or clear them",
+                   "[dump | reset]" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_wifi_stats_history = \
+    SL_CLI_COMMAND(wifi_stats_history,
+                   "Display the min/avg/max of the statistics history, dump it"
+                   " as CSV, or enable/disable the periodic sampling",
+                   "[dump | reset | on [period_ms] | off]" SL_CLI_UNIT_SEPARATOR,
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
 /**************************************************************************//**
  * @brief: Construct the wifi RF test command
  ******************************************************************************/
@@ -541,12 +647,20 @@ static const sl_cli_command_entry_t wifi_cli_cmds_table[] = {
     {"connect", &cli_cmd_wifi_sta_connect, false},
     {"disconnect", &cli_cmd_wifi_sta_disconnect, false},
     {"scan", &cli_cmd_wifi_sta_scan, false},
+    {"scan_profile", &cli_cmd_wifi_scan_profile, false},
     {"station_rssi", &cli_cmd_wifi_sta_rssi, false},
+    {"roam", &cli_cmd_wifi_sta_roam, false},
+    {"conn_timing", &cli_cmd_wifi_conn_timing, false},
+    {"event_pool", &cli_cmd_wifi_event_pool, false},
+    {"event_bus", &cli_cmd_wifi_event_bus, false},
     {"start_softap", &cli_cmd_wifi_start_softap, false},
     {"stop_softap", &cli_cmd_wifi_stop_softap, false},
     {"softap_rssi", &cli_cmd_wifi_softap_rssi, false},
+    {"softap_clients", &cli_cmd_wifi_softap_clients, false},
     {"powermode", &cli_cmd_wifi_power_mode, false},
     {"powersave", &cli_cmd_wifi_station_power_save, false},
+    {"ps_auto", &cli_cmd_wifi_station_power_auto, false},
+    {"stats_history", &cli_cmd_wifi_stats_history, false},
     {"test", &cli_cmd_wifi_test_agent, false},
     {"slk_renegotiate", &cli_cmd_wifi_slk_rekey, false},
     {"slk_add", &cli_cmd_wifi_slk_add, false},
@@ -576,11 +690,41 @@ static const sl_cli_command_info_t cli_cmd_lwip_ip_stats = \
                    "lwip-stats",
                    {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
 
+/**************************************************************************//**
+* @brief: Construct the TX flow control statistic command
+******************************************************************************/
+static const sl_cli_command_info_t cli_cmd_lwip_tx_stats = \
+    SL_CLI_COMMAND(lwip_tx_stats,
+                   "Display or reset the TX flow control statistics",
+                   "[reset]",
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+/**************************************************************************//**
+* @brief: Construct the host stack latency command
+******************************************************************************/
+static const sl_cli_command_info_t cli_cmd_lwip_latency = \
+    SL_CLI_COMMAND(lwip_latency,
+                   "Display or reset the host stack latency histograms",
+                   "[reset]",
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+/**************************************************************************//**
+* @brief: Construct the TCP window & buffer tuning command
+******************************************************************************/
+static const sl_cli_command_info_t cli_cmd_lwip_tcp_tune = \
+    SL_CLI_COMMAND(lwip_tcp_tune,
+                   "Display or switch the TCP window & buffer tuning",
+                   "[on|off]",
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
 /**************************************************************************//**
 * @brief: Create the lwip_table
 ******************************************************************************/
 static const sl_cli_command_entry_t lwip_cli_cmds_table[] = {
     {"stats", &cli_cmd_lwip_ip_stats, false},
+    {"tx_stats", &cli_cmd_lwip_tx_stats, false},
+    {"latency", &cli_cmd_lwip_latency, false},
+    {"tcp_tune", &cli_cmd_lwip_tcp_tune, false},
     {NULL, NULL, false}
 };
 
@@ -597,8 +741,32 @@ static const sl_cli_command_entry_t lwip_table[] = {
 *****************************************************************************/
 static const sl_cli_command_info_t cli_cmd_iperf = \
     SL_CLI_COMMAND(iperf,
-                   "Start a TCP iPerf test as a client or a server",
-                   "iperf < -c ip [-t dur] [-p port] [-k] | -s >",
+                   "Start a TCP or UDP iPerf test as a client or a server",
+                   "iperf < -c ip [-t dur] [-p port] [-i sec] [-P n] [-d|-r] [-k] [-u] [-b bw] [-l len] | -s [-u] [-i sec] >",
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_iperf3 = \
+    SL_CLI_COMMAND(iperf3,
+                   "Start an iPerf3 test as a client or a server",
+                   "iperf3 < -c ip [-t dur] [-p port] [-P n] [-R] [-k] [-u] [-b bw] [-l len] | -s [-p port] >",
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_rr = \
+    SL_CLI_COMMAND(rr,
+                   "Measure the request/response latency with a peer (TCP_RR/UDP_RR)",
+                   "rr < -c ip [-t dur] [-p port] [-u] [-r req[,rsp]] [-k] >",
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_bench = \
+    SL_CLI_COMMAND(bench,
+                   "Run a throughput/latency benchmark matrix and print the results as CSV",
+                   "bench < -c ip [-t dur] [-p port] [-L rr_port] [-b bw] [-T tcp,udp] [-d tx,rx] [-l len[,len...]] [-m active,ps,dtim] [-a aarf,minstrel|current] >",
+                   {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
+
+static const sl_cli_command_info_t cli_cmd_rate_sweep = \
+    SL_CLI_COMMAND(rate_sweep,
+                   "Rank the TX rate sets and rate algorithms by upload throughput",
+                   "rate_sweep < -c ip [-t dur] [-p port] [-r all,b,g,bg,n,n_high,0xmask] [-a aarf,minstrel] [-w apply|save] >",
                    {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
 
 static const sl_cli_command_info_t cli_cmd_iperf_server_stop = \
@@ -619,7 +787,7 @@ static const sl_cli_command_info_t cli_cmd_iperf_client_stop = \
 static const sl_cli_command_info_t cli_cmd_ping = \
     SL_CLI_COMMAND(ping_cmd_cb,
                    "Send ICMP ECHO_REQUEST to network hosts",
-                   "[-n nb] <ip>",
+                   "[-n nb] [-i ms] [-f] [-s size|min:max:step] [-w window] [-W ms] <ip> [ip...]",
                    {SL_CLI_ARG_WILDCARD, SL_CLI_ARG_END, });
 
 /**************************************************************************//**
@@ -629,6 +797,10 @@ static const sl_cli_command_entry_t cmds_table[] = {
     {"reset", &cli_cmd_reset_cpu, false},
     {"ping", &cli_cmd_ping, false},
     {"iperf", &cli_cmd_iperf, false},
+    {"iperf3", &cli_cmd_iperf3, false},
+    {"rr", &cli_cmd_rr, false},
+    {"bench", &cli_cmd_bench, false},
+    {"rate_sweep", &cli_cmd_rate_sweep, false},
     {"iperf_server_stop", &cli_cmd_iperf_server_stop, false},
     {"iperf_client_stop", &cli_cmd_iperf_client_stop, false},
     {NULL, NULL, false}
@@ -16,12 +16,25 @@
  * limitations under the License.
  *****************************************************************************/
 #include "wifi_cli_get_set_cb_func.h"
+#include "lwip/sys.h"
 #include "dhcp_client.h"
 #include "dhcp_server.h"
 #include "ethernetif.h"
+#include "latency_trace.h"
+#include "tcp_autotune.h"
 #include "app_wifi_events.h"
+#include "scan_store.h"
+#include "scan_profile.h"
+#include "wifi_roaming.h"
+#include "wifi_event_pool.h"
+#include "wifi_event_bus.h"
+#include "wifi_power_ctrl.h"
+#include "wifi_stats_sampler.h"
+#include "softap_clients.h"
+#include "wifi_conn_timing.h"
 #include "wifi_cli_params.h"
 #include "wifi_cli_lwip.h"
+#include "wifi_cli_bench.h"
 #include "sl_wfx_sae.h"
 #include "ports/includes.h"
 #include "utils/common.h"
@@ -750,6 +763,90 @@ void set_softap_channel(sl_cli_command_arg_t *args)
   *(uint8_t *)wifi_params[param_idx].address = (uint8_t)channel;
 }
 
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: get a SoftAP DHCP server parameter (decimal).
+ *****************************************************************************/
+void get_softap_dhcp_param(sl_cli_command_arg_t *args)
+{
+  char *cmd = sl_cli_get_command_string(args, 2);
+  /* Retrieve the parameter index by its name */
+  int param_idx = param_search(cmd);
+  if (param_idx < 0) {
+      LOG_DEBUG("The %s parameter hasn't been registered", cmd);
+      printf("Command error\r\n");
+      return; /* failed */
+  }
+  if (wifi_params[param_idx].size == sizeof(uint32_t)) {
+    printf("%lu\r\n", (unsigned long)*(uint32_t *)wifi_params[param_idx].address);
+  } else {
+    printf("%d\r\n", *(uint8_t *)wifi_params[param_idx].address);
+  }
+}
+
+static const char *const dhcps_pool_check_names[] = {
+  [DHCPS_POOL_OK]            = "",
+  [DHCPS_POOL_INVERTED]      = "the first address is after the last one",
+  [DHCPS_POOL_NETWORK]       = "it holds the subnet network address",
+  [DHCPS_POOL_BROADCAST]     = "it holds the subnet broadcast address",
+  [DHCPS_POOL_OUT_OF_SUBNET] = "it is out of the SoftAP subnet",
+  [DHCPS_POOL_SERVER]        = "it holds the SoftAP address",
+};
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: set a SoftAP DHCP server parameter (decimal),
+ * applied at the next DHCP server start.
+ *****************************************************************************/
+void set_softap_dhcp_param(sl_cli_command_arg_t *args)
+{
+  dhcps_pool_check_t pool_check;
+  unsigned long value;
+  int param_idx;
+  char *value_str = NULL;
+  char *end = NULL;
+  char *cmd = NULL;
+
+  cmd = sl_cli_get_command_string(args, 2);
+  /* Retrieve the global param by its name */
+  param_idx = param_search(cmd);
+  if (param_idx < 0) {
+      LOG_DEBUG("The %s parameter hasn't been registered", cmd);
+      printf("Command error\r\n");
+      return; /* failed */
+  }
+
+  /* Get & validate input argument string */
+  value_str = sl_cli_get_argument_string(args, 0);
+  value = strtoul(value_str, &end, 10);
+  if ((end == value_str) || (*end != '\0')) {
+      printf("Invalid value\r\n");
+      return;
+  }
+
+  if (wifi_params[param_idx].size == sizeof(uint32_t)) {
+    if (value < DHCPS_LEASE_OFFER_TIME) {
+        printf("The lease time must be at least %d seconds\r\n", DHCPS_LEASE_OFFER_TIME);
+        return;
+    }
+    *(uint32_t *)wifi_params[param_idx].address = (uint32_t)value;
+  } else {
+    if (value > 255) {
+        printf("The address octet must be in 0..255\r\n");
+        return;
+    }
+    /* The pool must hold host addresses of the SoftAP subnet only */
+    if (wifi_params[param_idx].address == &ap_dhcp_pool_start) {
+      pool_check = dhcpserver_check_pool((uint8_t)value, ap_dhcp_pool_end);
+    } else {
+      pool_check = dhcpserver_check_pool(ap_dhcp_pool_start, (uint8_t)value);
+    }
+    if (pool_check != DHCPS_POOL_OK) {
+        printf("Invalid pool: %s\r\n", dhcps_pool_check_names[pool_check]);
+        return;
+    }
+    *(uint8_t *)wifi_params[param_idx].address = (uint8_t)value;
+  }
+}
+
 /**************************************************************************//**
  * @brief: Wi-Fi CLI's callback: get SoftAP network mask (IPv4 format).
  *****************************************************************************/
@@ -946,7 +1043,8 @@ void get_softap_client_list(sl_cli_command_arg_t *args)
 
   uint8_t add_separator = 0;
   char string_field[100];
-  char client_name[9] = { 'C', 'l', 'i', 'e', 'n', 't', ' ', ' ', '\0' };
+  char client_name[12];
+  uint8_t client_nb = 0;
   char *cmd = sl_cli_get_command_string(args, 2);
   if (strcmp(cmd, "softap.client_list") != 0) {
       printf("wrong command\r\n");
@@ -963,7 +1061,7 @@ void get_softap_client_list(sl_cli_command_arg_t *args)
       if (add_separator) {
         strcat(string_list, ",");
       }
-      client_name[7] = i + 49;
+      snprintf(client_name, sizeof(client_name), "Client %u", (unsigned)++client_nb);
       snprintf(string_field, 100,
                "{\"name\":\"%s\", \"ip\":\"%d.%d.%d.%d\", "
                "\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\"}",
@@ -1099,6 +1197,9 @@ void wifi_init(sl_cli_command_arg_t *args)
      This is especially useful for the SDIO */
   sl_wfx_host_deinit_bus();
 
+  /* Frames sent to the previous firmware instance will never be confirmed */
+  ethernetif_tx_flush();
+
   /* Initialize the Wi-Fi chip */
   status = sl_wfx_init(&wifi);
   switch (status) {
@@ -1136,24 +1237,262 @@ void wifi_init(sl_cli_command_arg_t *args)
   printf("%s%s\r\n", status_msg, error_msg);
 }
 
+/// Access point of the last successful connection, saved in NVM3.
+typedef struct {
+  char ssid[32 + 1];
+  uint8_t bssid[SL_WFX_BSSID_SIZE];
+  uint16_t channel;
+  sl_wfx_security_mode_t requested_mode;          ///< station.security used
+  sl_wfx_security_mode_bitmask_t security_mode;   ///< Advertised by the AP
+} wifi_sta_last_ap_t;
+
+/// Ways of finding the access point, tried in this order.
+typedef enum {
+  STA_JOIN_PATH_CACHED = 0,   ///< Directed join on the cached BSSID/channel
+  STA_JOIN_PATH_CHANNEL,      ///< Probe of the cached channel only
+  STA_JOIN_PATH_FULL_SCAN,    ///< Directed scan profile: known channels, then all
+  STA_JOIN_PATH_NB
+} sta_join_path_t;
+
+/// Time-to-connect of a join path, from the connect command.
+typedef struct {
+  uint32_t attempts;
+  uint32_t successes;
+  uint32_t last_ms;
+  uint32_t min_ms;
+  uint32_t max_ms;
+  uint32_t total_ms;
+} sta_join_path_stats_t;
+
+static const char *const sta_join_path_names[STA_JOIN_PATH_NB] = {
+  "cached BSSID", "channel probe", "full scan"
+};
+static sta_join_path_stats_t sta_join_path_stats[STA_JOIN_PATH_NB];
+
+/**************************************************************************//**
+ * @brief: Scan for the station's access point and retrieve its parameters.
+ *
+ * @param[in] ap_ssid: SSID to probe
+ * @param[in] security: SCAN_STORE_SECURITY_* flags of the APs accepted
+ * @param[in] channel: channel to probe, 0 for the directed scan profile
+ * @param[in] hint_channel: channel probed first by the scan profile, 0 for none
+ * @param[in] retry_max: number of scans retried if the AP is not found
+ * @param[out] ap: BSSID, channel and security mode of the strongest AP
+ *
+ * @return true if the AP was found
+ *****************************************************************************/
+static bool wifi_station_scan_ap(const sl_wfx_ssid_def_t *ap_ssid,
+                                 uint8_t security,
+                                 uint8_t channel,
+                                 uint8_t hint_channel,
+                                 uint8_t retry_max,
+                                 wifi_sta_last_ap_t *ap)
+{
+  bool ap_found = false;
+  sl_wfx_status_t status;
+  RTOS_ERR_CODE err_code;
+  uint8_t retry_cnt = 0;
+  uint8_t index;
+  uint32_t scan_start_ms;
+  scan_store_entry_t entry;
+  scan_store_filter_t filter = {
+    .ssid = ap_ssid,
+    .security = security,
+    .channel = channel,
+  };
+
+  do {
+      scan_start_ms = sys_now();
+      wifi_conn_timing_mark(WIFI_CONN_STAGE_SCAN_START);
+
+      if (channel == 0) {
+          /* Known channels of the SSID first, then the others */
+          status = scan_profile_run(SCAN_PROFILE_DIRECTED, ap_ssid, hint_channel);
+          if (status == SL_STATUS_TIMEOUT) {
+              printf("Command timeout! Retry %d time(s)\r\n", retry_cnt + 1);
+              continue;
+          } else if (status != SL_STATUS_OK) {
+              printf("Command error! Retry %d time(s)\r\n", retry_cnt + 1);
+              continue;
+          }
+      } else {
+          /* Send scan command to WF200 */
+          wifi_event_bus_request_begin(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_SCAN_COMPLETE));
+          status = sl_wfx_send_scan_command(WFM_SCAN_MODE_ACTIVE,
+                                            &channel,
+                                            1,
+                                            ap_ssid,
+                                            1,
+                                            NULL,
+                                            0,
+                                            NULL);
+          if ((status != SL_STATUS_OK) && (status != SL_STATUS_WIFI_WARNING)) {
+              wifi_event_bus_request_end(&g_cli_events);
+              continue;
+          }
+
+          /* Block CLI to wait for scan_complete indication */
+          err_code = wifi_event_bus_wait(&g_cli_events,
+                                         WIFI_EVENT_MASK(WIFI_EVENT_SCAN_COMPLETE),
+                                         SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS,
+                                         NULL);
+          wifi_event_bus_request_end(&g_cli_events);
+
+          if (err_code == RTOS_ERR_TIMEOUT) {
+              printf("Command timeout! Retry %d time(s)\r\n", retry_cnt + 1);
+              continue;
+          } else if (err_code != RTOS_ERR_NONE) {
+              printf("Command error! Retry %d time(s)\r\n", retry_cnt + 1);
+              continue;
+          }
+      }
+
+      wifi_conn_timing_mark(WIFI_CONN_STAGE_SCAN_END);
+
+      /* Strongest AP seen by this scan */
+      filter.max_age_ms = sys_now() - scan_start_ms + 1;
+      index = 0;
+      ap_found = scan_store_find(&filter, sys_now(), &index, &entry);
+      if (ap_found) {
+          memcpy(ap->bssid, entry.ap.mac, SL_WFX_BSSID_SIZE);
+          ap->channel = entry.ap.channel;
+          ap->security_mode = entry.ap.security_mode;
+      }
+
+  } while ((ap_found == false) && (retry_cnt++ < retry_max));
+
+  return ap_found;
+}
+
+/**************************************************************************//**
+ * @brief: Join an access point and wait for the result.
+ *
+ * @param[in] ssid, passkey: station settings
+ * @param[in] secur_mode: security mode selected by the user
+ * @param[in] ap: BSSID, channel and security mode of the AP
+ *
+ * @return SL_STATUS_OK if connected, SL_STATUS_FAIL if the join failed
+ *         (another path can be tried), an error otherwise
+ *****************************************************************************/
+static sl_status_t wifi_station_join(const char *ssid,
+                                     const char *passkey,
+                                     sl_wfx_security_mode_t secur_mode,
+                                     const wifi_sta_last_ap_t *ap)
+{
+  sl_wfx_status_t status;
+  RTOS_ERR_CODE err_code;
+
+  /* Serialized with the roaming joins, sharing the SAE state and the fallback */
+  wifi_event_bus_request_begin(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_CONNECT));
+  secur_mode_fallback = false;
+
+  /* If WPA2/WPA3 transition mode is selected, check whether the AP supports up to WPA3 security mode */
+  if ((secur_mode == WFM_SECURITY_MODE_WPA3_SAE_WPA2_PSK)
+      && (ap->security_mode.wpa3 == 0) && (ap->security_mode.wpa2 == 1)) {
+      secur_mode_fallback = true;
+      printf("The Access Point (AP) does not support WPA3 security mode\n");
+  }
+
+  /* WPA3 security mode configuration */
+  if ((secur_mode == WFM_SECURITY_MODE_WPA3_SAE) ||
+      ((secur_mode == WFM_SECURITY_MODE_WPA3_SAE_WPA2_PSK) && !secur_mode_fallback)) {
+      status = sl_wfx_sae_prepare(&wifi.mac_addr_0,
+                                  (sl_wfx_mac_address_t*) ap->bssid,
+                                  (uint8_t*) ssid,
+                                  strlen(ssid),
+                                  (uint8_t*)passkey,
+                                  strlen(passkey),
+                                  ap->security_mode.h2e);
+      printf("wlan preparing SAE...\r\n");
+      if (status != SL_STATUS_OK) {
+          printf("wlan: Could not prepare SAE\r\n");
+      }
+  }
+
+  /* Configure scan parameters & Connect to the AP */
+  sl_wfx_set_scan_parameters(0, 0, 1);
+
+  wifi_conn_timing_mark(WIFI_CONN_STAGE_JOIN);
+  status = sl_wfx_send_join_command((uint8_t *)ssid,
+                                    strlen(ssid),
+                                    (sl_wfx_mac_address_t *)ap->bssid,
+                                    ap->channel,
+                                    secur_mode_fallback ?
+                                    WFM_SECURITY_MODE_WPA2_PSK :
+                                    secur_mode,
+                                    1,
+                                    0,
+                                    (uint8_t *)passkey,
+                                    strlen(passkey),
+                                    NULL,
+                                    0);
+  if (status != SL_STATUS_OK) {
+      wifi_event_bus_request_end(&g_cli_events);
+      LOG_DEBUG("Failed to send join command\r\n");
+      return status;
+  }
+
+  /* Block to wait for the connection result */
+  err_code = wifi_event_bus_wait(&g_cli_events,
+                                 WIFI_EVENT_MASK(WIFI_EVENT_CONNECT),
+                                 SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS,
+                                 NULL);
+  wifi_event_bus_request_end(&g_cli_events);
+  if (err_code == RTOS_ERR_TIMEOUT) {
+      LOG_DEBUG("wifi_event_bus_wait() timeout\r\n");
+      return SL_STATUS_TIMEOUT;
+  } else if (err_code != RTOS_ERR_NONE) {
+      LOG_DEBUG("wifi_event_bus_wait() failed: err_code = %d\r\n", err_code);
+      return SL_STATUS_FAIL;
+  }
+
+  return (wifi.state & SL_WFX_STA_INTERFACE_CONNECTED) ? SL_STATUS_OK : SL_STATUS_FAIL;
+}
+
+/**************************************************************************//**
+ * @brief: Record the time-to-connect of a join path.
+ *****************************************************************************/
+static void wifi_station_record_join(sta_join_path_t path, uint32_t elapsed_ms)
+{
+  sta_join_path_stats_t *stats = &sta_join_path_stats[path];
+
+  if ((stats->successes == 0) || (elapsed_ms < stats->min_ms)) {
+    stats->min_ms = elapsed_ms;
+  }
+  if (elapsed_ms > stats->max_ms) {
+    stats->max_ms = elapsed_ms;
+  }
+  stats->successes++;
+  stats->last_ms = elapsed_ms;
+  stats->total_ms += elapsed_ms;
+
+  printf("Connected via %s in %lu ms\r\n",
+         sta_join_path_names[path], (unsigned long)elapsed_ms);
+}
+
 /**************************************************************************//**
  * @brief:
  * Wi-Fi CLI's callback: Connect to the Wi-Fi access point with
  *                       the information stored in station (wlan) parameters.
+ *
+ * The access point of the last successful connection is kept in NVM3: if the
+ * SSID and security setting did not change, it is joined directly on its
+ * BSSID and channel, then searched on its channel only, before a full scan.
  *****************************************************************************/
 void wifi_station_connect(sl_cli_command_arg_t *args)
 {
   (void)args;
-  bool ap_found = false;
-  sl_wfx_status_t status;
-  RTOS_ERR_CODE err_code;
+  sl_status_t status = SL_STATUS_FAIL;
+  Ecode_t ecode;
   sl_wfx_ssid_def_t ap_ssid = {0};
-  uint8_t wlan_bssid[SL_WFX_BSSID_SIZE]; /*!< Save AP's MAC */
-  uint8_t retry_cnt;
-  uint16_t channel;
+  wifi_sta_last_ap_t last_ap = {0};
+  wifi_sta_last_ap_t ap = {0};
+  sta_join_path_t path = STA_JOIN_PATH_FULL_SCAN;
+  bool cached = false;
+  uint8_t security;
+  uint32_t start_ms;
   char *p_wlan_ssid = NULL;
   char *p_wlan_passkey = NULL;
-  sl_wfx_security_mode_bitmask_t security_mode;
   /* The security mode option selected by users */
   sl_wfx_security_mode_t *p_wlan_secur_mode = NULL;
 
@@ -1170,7 +1509,6 @@ void wifi_station_connect(sl_cli_command_arg_t *args)
   p_wlan_passkey = (char *)wifi_cli_get_param_addr("station.passkey");
   p_wlan_secur_mode = (sl_wfx_security_mode_t *)wifi_cli_get_param_addr("station.security");
 
-  /* Step 2: Scan to seach for an AP with given settings */
   if ((p_wlan_ssid == NULL)
       || (p_wlan_passkey == NULL)
       || (p_wlan_secur_mode == NULL)) {
@@ -1179,130 +1517,156 @@ void wifi_station_connect(sl_cli_command_arg_t *args)
       goto error;
   }
 
-  retry_cnt = 0;
-  channel = 0;
-
+  start_ms = sys_now();
+  wifi_conn_timing_begin();
+  security = scan_store_security_filter(*p_wlan_secur_mode);
   ap_ssid.ssid_length = strlen(p_wlan_ssid);
   strncpy((char *)ap_ssid.ssid, p_wlan_ssid, ap_ssid.ssid_length);
 
-  /* Scan with retry */
-  do {
-      /* Reset scan list & count */
-      scan_count_web = 0;
-      scan_verbose = false;
-      memset(scan_list,
-             0,
-             sizeof(scan_result_list_t) * SL_WFX_MAX_SCAN_RESULTS);
-
-      /* Send scan command to WF200 */
-      status = sl_wfx_send_scan_command(WFM_SCAN_MODE_ACTIVE,
-                                        NULL,
-                                        0,
-                                        &ap_ssid,
-                                        1,
-                                        NULL,
-                                        0,
-                                        NULL);
-
-      if ((status == SL_STATUS_OK) || (status == SL_STATUS_WIFI_WARNING)) {
-          /* Block CLI to wait for scan_complete indication */
-          err_code = wifi_cli_wait(&g_cli_sem,
-                                   SL_WFX_SCAN_COMPLETE_IND_ID,
-                                   SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS);
-
-          if (err_code == RTOS_ERR_TIMEOUT) {
-              printf("Command timeout! Retry %d time(s)\r\n", retry_cnt + 1);
-
-          } else if (err_code == RTOS_ERR_NONE) {
-              /* Retrieve AP information from the scan_list */
-              for (uint8_t i = 0; i < scan_count_web; i++) {
-                  if (strcmp((char *)scan_list[i].ssid_def.ssid,
-                             p_wlan_ssid) == 0) {
-                      /* If matched, obtain MAC address */
-                      memcpy(&wlan_bssid, scan_list[i].mac,
-                             SL_WFX_BSSID_SIZE);
-                      channel = scan_list[i].channel;
-                      security_mode = scan_list[i].security_mode;
-                      ap_found = true;
-                  }
-              }
-
-          } else {
-              printf("Command error! Retry %d time(s)\r\n", retry_cnt + 1);
+  ecode = nvm3_readData(nvm3_defaultHandle,
+                        NVM3_KEY_STA_LAST_AP,
+                        &last_ap,
+                        sizeof(last_ap));
+  cached = (ecode == ECODE_NVM3_OK)
+           && (strcmp(last_ap.ssid, p_wlan_ssid) == 0)
+           && (last_ap.requested_mode == *p_wlan_secur_mode);
+
+  /* Step 2: Join the AP, from the cheapest path to the full scan */
+  for (path = cached ? STA_JOIN_PATH_CACHED : STA_JOIN_PATH_FULL_SCAN;
+       path < STA_JOIN_PATH_NB;
+       path++) {
+      if (path == STA_JOIN_PATH_CACHED) {
+          ap = last_ap;
+      } else if (path == STA_JOIN_PATH_CHANNEL) {
+          if (!wifi_station_scan_ap(&ap_ssid, security, (uint8_t)last_ap.channel, 0, 0, &ap)) {
+              continue;
           }
+      } else if (!wifi_station_scan_ap(&ap_ssid,
+                                       security,
+                                       0,
+                                       cached ? (uint8_t)last_ap.channel : 0,
+                                       3,
+                                       &ap)) {
+          break;
       }
 
-  } while((ap_found == false) && (retry_cnt++ < 3));
-
-  scan_verbose = true;
+      sta_join_path_stats[path].attempts++;
+      status = wifi_station_join(p_wlan_ssid, p_wlan_passkey, *p_wlan_secur_mode, &ap);
+      if (status != SL_STATUS_FAIL) {
+          /* Connected, or no answer from the WFx: nothing else to try */
+          break;
+      }
+      printf("Join via %s failed\r\n", sta_join_path_names[path]);
+  }
 
-  if (ap_found == false) {
+  if (path == STA_JOIN_PATH_NB) {
+      /* Every path tried */
+      goto error;
+  } else if (status == SL_STATUS_FAIL) {
       printf("Access point's name: \"%s\" not found\r\n", p_wlan_ssid);
       return;
+  } else if (status != SL_STATUS_OK) {
+      goto error;
   }
 
-  /* If WPA2/WPA3 transition mode is selected, check whether the AP supports up to WPA3 security mode */
-  if ((*p_wlan_secur_mode == WFM_SECURITY_MODE_WPA3_SAE_WPA2_PSK) 
-      && (security_mode.wpa3 == 0) && (security_mode.wpa2 == 1)) {
-      secur_mode_fallback = true;
-      printf("The Access Point (AP) does not support WPA3 security mode\n");
+  wifi_station_record_join(path, sys_now() - start_ms);
+
+  /* Step 3: Keep the AP for the next connection, writing NVM3 on changes only */
+  strncpy(ap.ssid, p_wlan_ssid, sizeof(ap.ssid) - 1);
+  ap.requested_mode = *p_wlan_secur_mode;
+  if (!cached || (memcmp(&ap, &last_ap, sizeof(ap)) != 0)) {
+      nvm3_writeData(nvm3_defaultHandle,
+                     NVM3_KEY_STA_LAST_AP,
+                     &ap,
+                     sizeof(ap));
   }
+  return;
 
-  /* WPA3 security mode configuration */
-  if ((*p_wlan_secur_mode == WFM_SECURITY_MODE_WPA3_SAE) ||
-      ((*p_wlan_secur_mode == WFM_SECURITY_MODE_WPA3_SAE_WPA2_PSK) && !secur_mode_fallback)) {
-      status = sl_wfx_sae_prepare(&wifi.mac_addr_0,
-                                  (sl_wfx_mac_address_t*) wlan_bssid,
-                                  (uint8_t*) p_wlan_ssid,
-                                  strlen(p_wlan_ssid),
-                                  (uint8_t*)p_wlan_passkey,
-                                  strlen(p_wlan_passkey),
-                                  security_mode.h2e);
-      printf("wlan preparing SAE...\r\n");
-      if (status != SL_STATUS_OK) {
-          printf("wlan: Could not prepare SAE\r\n");
-      }
+error:
+  printf("Command error\r\n");
+  return; /* Failed */
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display the time-to-connect of each join path.
+ *****************************************************************************/
+void get_station_connect_times(sl_cli_command_arg_t *args)
+{
+  (void)args;
+
+  printf("%-14s %8s %9s %8s %8s %8s %8s\r\n",
+         "path", "attempts", "successes", "last_ms", "min_ms", "avg_ms", "max_ms");
+  for (uint8_t i = 0; i < STA_JOIN_PATH_NB; i++) {
+    const sta_join_path_stats_t *stats = &sta_join_path_stats[i];
+
+    printf("%-14s %8lu %9lu %8lu %8lu %8lu %8lu\r\n",
+           sta_join_path_names[i],
+           (unsigned long)stats->attempts,
+           (unsigned long)stats->successes,
+           (unsigned long)stats->last_ms,
+           (unsigned long)stats->min_ms,
+           (unsigned long)(stats->successes ? stats->total_ms / stats->successes : 0),
+           (unsigned long)stats->max_ms);
   }
-  
-  /* Step 3: Configure scan parameters & Connect to the found AP */
-  sl_wfx_set_scan_parameters(0, 0, 1);
+}
 
-  /* Connect to a Wi-Fi access point */
-  status = sl_wfx_send_join_command((uint8_t *)p_wlan_ssid,
-                                    strlen(p_wlan_ssid),
-                                    (sl_wfx_mac_address_t *)wlan_bssid,
-                                    channel,
-                                    secur_mode_fallback ? 
-                                    WFM_SECURITY_MODE_WPA2_PSK : 
-                                    *p_wlan_secur_mode,
-                                    1,
-                                    0,
-                                    (uint8_t *)p_wlan_passkey,
-                                    strlen(p_wlan_passkey),
-                                    NULL,
-                                    0);
-  if (status == SL_STATUS_OK) {
-      /* Block to wait for a connected confirmation */
-      err_code = wifi_cli_wait(&g_cli_sem,
-                               SL_WFX_CONNECT_IND_ID,
-                               SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS);
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display the distribution of the connection
+ *         phases, dump them as CSV or clear their history.
+ *****************************************************************************/
+void wifi_conn_timing(sl_cli_command_arg_t *args)
+{
+  int argc = sl_cli_get_argument_count(args);
+  wifi_conn_timing_summary_t summary;
+  wifi_conn_timing_record_t record;
+  uint16_t index;
+  uint8_t phase;
+  char *p_arg;
+
+  if (argc == 0) {
+      printf("%-12s %6s %8s %8s %8s %8s %8s\r\n",
+             "phase (ms)", "count", "min", "avg", "p50", "p90", "max");
+      for (phase = 0; phase < WIFI_CONN_PHASE_NB; phase++) {
+          wifi_conn_timing_summary((wifi_conn_phase_t)phase, &summary);
+          printf("%-12s %6u %8lu %8lu %8lu %8lu %8lu\r\n",
+                 wifi_conn_timing_phase_name((wifi_conn_phase_t)phase),
+                 summary.count,
+                 (unsigned long)summary.min_ms,
+                 (unsigned long)summary.avg_ms,
+                 (unsigned long)summary.p50_ms,
+                 (unsigned long)summary.p90_ms,
+                 (unsigned long)summary.max_ms);
+      }
+      return;
+  }
 
-      if (err_code == RTOS_ERR_TIMEOUT) {
-          LOG_DEBUG("wifi_cli_wait() timeout\r\n");
-          goto error;
-      } else if (err_code != RTOS_ERR_NONE) {
-          LOG_DEBUG("wifi_cli_wait() failed: err_code = %d\r\n", err_code);
-          goto error;
+  p_arg = sl_cli_get_argument_string(args, 0);
+  convert_to_lower_case_string(p_arg);
+  if (!strcmp(p_arg, "dump") && (argc == 1)) {
+      /* Oldest connection first, phases not gone through left empty */
+      printf("index");
+      for (phase = 0; phase < WIFI_CONN_PHASE_NB; phase++) {
+          printf(",%s_ms", wifi_conn_timing_phase_name((wifi_conn_phase_t)phase));
+      }
+      printf("\r\n");
+      for (index = 0; wifi_conn_timing_get(index, &record); index++) {
+          printf("%u", index);
+          for (phase = 0; phase < WIFI_CONN_PHASE_NB; phase++) {
+              if (record.valid & (1u << phase)) {
+                  printf(",%lu", (unsigned long)record.ms[phase]);
+              } else {
+                  printf(",");
+              }
+          }
+          printf("\r\n");
       }
       return;
-  } else {
-      LOG_DEBUG("Failed to send join command\r\n");
-      /* go to error */
+  } else if (!strcmp(p_arg, "reset") && (argc == 1)) {
+      wifi_conn_timing_reset();
+      return;
   }
 
-error:
-  printf("Command error\r\n");
-  return; /* Failed */
+  printf("Usage: wifi conn_timing [dump | reset]\r\n");
 }
 
 /**************************************************************************//**
@@ -1322,22 +1686,26 @@ void wifi_station_disconnect(sl_cli_command_arg_t *args)
   }
 
   /* Disconnect from a Wi-Fi access point */
+  wifi_event_bus_request_begin(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_DISCONNECT));
   status = sl_wfx_send_disconnect_command();
   if (status == SL_STATUS_OK) {
       /* Block to wait for a confirmation */
-      err_code = wifi_cli_wait(&g_cli_sem,
-                               SL_WFX_DISCONNECT_IND_ID,
-                               SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS);
+      err_code = wifi_event_bus_wait(&g_cli_events,
+                                     WIFI_EVENT_MASK(WIFI_EVENT_DISCONNECT),
+                                     SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS,
+                                     NULL);
+      wifi_event_bus_request_end(&g_cli_events);
 
       if (err_code == RTOS_ERR_TIMEOUT) {
-          LOG_DEBUG("wifi_cli_wait() timeout\r\n");
+          LOG_DEBUG("wifi_event_bus_wait() timeout\r\n");
           goto error;
       } else if (err_code != RTOS_ERR_NONE) {
-          LOG_DEBUG("wifi_cli_wait() failed: err_code = %d\r\n", err_code);
+          LOG_DEBUG("wifi_event_bus_wait() failed: err_code = %d\r\n", err_code);
           goto error;
       }
       return;
   }
+  wifi_event_bus_request_end(&g_cli_events);
 
 error:
   printf("Command error\r\n");
@@ -1366,36 +1734,112 @@ void wifi_station_rssi(sl_cli_command_arg_t *args)
 }
 
 /**************************************************************************//**
- * @brief: Wi-Fi CLI's callback: Perform a Wi-Fi scan.
+ * @brief: Security filter flags of the scan command, by name.
+ *****************************************************************************/
+static const struct {
+  const char *name;
+  uint8_t flag;
+} scan_security_names[] = {
+  { "OPEN", SCAN_STORE_SECURITY_OPEN },
+  { "WEP",  SCAN_STORE_SECURITY_WEP },
+  { "WPA",  SCAN_STORE_SECURITY_WPA },
+  { "WPA2", SCAN_STORE_SECURITY_WPA2 },
+  { "WPA3", SCAN_STORE_SECURITY_WPA3 },
+};
+
+/**************************************************************************//**
+ * @brief: Name of the strongest security mode of an AP.
+ *****************************************************************************/
+static const char *scan_security_name(sl_wfx_security_mode_bitmask_t security_mode)
+{
+  uint8_t flags = scan_store_security_flags(security_mode);
+
+  if ((flags & SCAN_STORE_SECURITY_WPA3) && (flags & SCAN_STORE_SECURITY_WPA2)) {
+    return "WPA2/WPA3";
+  }
+  for (int i = sizeof(scan_security_names) / sizeof(scan_security_names[0]) - 1; i > 0; i--) {
+    if (flags & scan_security_names[i].flag) {
+      return scan_security_names[i].name;
+    }
+  }
+  return scan_security_names[0].name;
+}
+
+/**************************************************************************//**
+ * @brief:
+ * Wi-Fi CLI's callback: Scan, then display the access points seen so far by
+ *                       decreasing RSSI, optionally filtered by SSID and
+ *                       security: wifi scan [ssid] [OPEN|WEP|WPA|WPA2|WPA3]
  *****************************************************************************/
 void wifi_station_scan(sl_cli_command_arg_t *args)
 {
-  (void)args;
-  RTOS_ERR_CODE err_code;
+  sl_status_t status;
+  sl_wfx_ssid_def_t ssid = {0};
+  scan_store_filter_t filter = {0};
+  scan_store_entry_t entry;
+  scan_profile_id_t profile = SCAN_PROFILE_FULL;
+  uint8_t argc = sl_cli_get_argument_count(args);
+  uint8_t index = 0;
+  uint8_t nb = 0;
+  uint32_t now_ms;
+
+  if (argc > 0) {
+      char *ssid_str = sl_cli_get_argument_string(args, 0);
+
+      ssid.ssid_length = strlen(ssid_str);
+      if (ssid.ssid_length > sizeof(ssid.ssid)) {
+          printf("SSID too long\r\n");
+          return;
+      }
+      memcpy(ssid.ssid, ssid_str, ssid.ssid_length);
+      filter.ssid = &ssid;
+  }
+  for (uint8_t arg = 1; arg < argc; arg++) {
+      char *arg_str = sl_cli_get_argument_string(args, arg);
+      uint8_t security = 0;
 
-  printf("!  # Ch RSSI MAC (BSSID)        Network (SSID) \n");
-  /* Start a scan*/
-  sl_wfx_send_scan_command(WFM_SCAN_MODE_ACTIVE,
-                           NULL,
-                           0,
-                           NULL,
-                           0,
-                           NULL,
-                           0,
-                           NULL);
-
-  /* Block to wait indication messages */
-  err_code = wifi_cli_wait(&g_cli_sem,
-                           SL_WFX_SCAN_COMPLETE_IND_ID,
-                           SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS);
+      if (scan_profile_find(arg_str) != SCAN_PROFILE_NB) {
+          profile = scan_profile_find(arg_str);
+          continue;
+      }
+      for (uint8_t i = 0; i < sizeof(scan_security_names) / sizeof(scan_security_names[0]); i++) {
+          if (strcmp(arg_str, scan_security_names[i].name) == 0) {
+              security = scan_security_names[i].flag;
+          }
+      }
+      filter.security = security;
+      if (security == 0) {
+          printf("Unknown security mode: [OPEN, WEP, WPA, WPA2, WPA3]"
+                 " or scan profile: [full, learned, directed]\r\n");
+          return;
+      }
+  }
 
-  if (err_code == RTOS_ERR_TIMEOUT) {
-      LOG_DEBUG("wifi_cli_wait() timeout\r\n");
+  /* Start a scan with the profile, blocking until its completion */
+  status = scan_profile_run(profile, filter.ssid, 0);
+  if (status == SL_STATUS_TIMEOUT) {
+      LOG_DEBUG("wifi_event_bus_wait() timeout\r\n");
       goto error;
-  } else if (err_code != RTOS_ERR_NONE) {
-      LOG_DEBUG("wifi_cli_wait() failed: err_code = %d\r\n", err_code);
+  } else if (status != SL_STATUS_OK) {
+      LOG_DEBUG("scan_profile_run() failed: status = 0x%lx\r\n", (unsigned long)status);
       goto error;
   }
+
+  printf("!  # Ch RSSI MAC (BSSID)        Age(s) Security  Network (SSID) \n");
+  now_ms = sys_now();
+  while (scan_store_find(&filter, now_ms, &index, &entry)) {
+      printf("# %2d %2d  %03d %02X:%02X:%02X:%02X:%02X:%02X  %6lu %-9s %.*s\r\n",
+             ++nb,
+             entry.ap.channel,
+             ((int16_t)(entry.ap.rcpi - 220) / 2),
+             entry.ap.mac[0], entry.ap.mac[1],
+             entry.ap.mac[2], entry.ap.mac[3],
+             entry.ap.mac[4], entry.ap.mac[5],
+             (unsigned long)((now_ms - entry.seen_ms) / 1000),
+             scan_security_name(entry.ap.security_mode),
+             (int)entry.ap.ssid_def.ssid_length,
+             entry.ap.ssid_def.ssid);
+  }
   return;
 
 error:
@@ -1405,42 +1849,282 @@ error:
 
 /**************************************************************************//**
  * @brief:
- *    Wi-Fi CLI's callback: Start the SoftAP interface using
- *    the information stored in softap parameters.
+ *    Wi-Fi CLI's callback: Display the roaming statistics, or enable/disable
+ *    the roaming with an optional RSSI threshold (dBm) and hysteresis (dB).
  *****************************************************************************/
-void wifi_start_softap(sl_cli_command_arg_t *args)
+void wifi_station_roam(sl_cli_command_arg_t *args)
 {
-  (void)args;
-
-  char *p_softap_ssid = NULL;
-  char *p_softap_passkey = NULL;
-  uint8_t *p_softap_channel = NULL;
-  sl_wfx_security_mode_t *p_softap_secur_mode = NULL;
-
-  sl_wfx_status_t status;
-  RTOS_ERR_CODE err_code;
-
-  /* Check whether softAP is already started */
-  if (wifi.state & SL_WFX_AP_INTERFACE_UP) {
-      printf("softAP is already started\r\n");
+  int argc = sl_cli_get_argument_count(args);
+  wifi_roaming_config_t config;
+  wifi_roaming_stats_t stats;
+  char *p_arg, *end;
+  long value;
+
+  wifi_roaming_get(&config, &stats);
+
+  if (argc == 0) {
+      printf("Roaming: %s, threshold %d dBm, hysteresis %u dB\r\n",
+             config.enabled ? "on" : "off",
+             config.rssi_threshold,
+             config.hysteresis);
+      printf("Average RSSI: %d dBm, background scans: %lu\r\n",
+             stats.rssi,
+             (unsigned long)stats.scan_slices);
+      printf("Roams: %lu (PMKSA reused: %lu), failures: %lu\r\n",
+             (unsigned long)stats.roams,
+             (unsigned long)stats.pmksa_reuses,
+             (unsigned long)stats.failures);
+      if (stats.roams > 0) {
+          printf("Outage (ms): last %lu, min %lu, avg %lu, max %lu\r\n",
+                 (unsigned long)stats.last_outage_ms,
+                 (unsigned long)stats.min_outage_ms,
+                 (unsigned long)(stats.total_outage_ms / stats.roams),
+                 (unsigned long)stats.max_outage_ms);
+      }
       return;
   }
 
-  /* Retrieve required parameters */
-  p_softap_ssid = (char *)wifi_cli_get_param_addr("softap.ssid");
-  p_softap_passkey = (char *)wifi_cli_get_param_addr("softap.passkey");
-  p_softap_channel = (uint8_t *)wifi_cli_get_param_addr("softap.channel");
-  p_softap_secur_mode = (sl_wfx_security_mode_t *)wifi_cli_get_param_addr("softap.security");
+  if (argc > 3) {
+      goto arg_error;
+  }
 
-  if ((p_softap_ssid == NULL)
-      || (p_softap_passkey == NULL)
-      || (p_softap_channel == NULL)
-      || (p_softap_secur_mode == NULL)) {
-      LOG_DEBUG("SoftAP's ssid, passkey, channel or security mode not found");
-      goto error;
+  p_arg = sl_cli_get_argument_string(args, 0);
+  convert_to_lower_case_string(p_arg);
+  if (!strcmp(p_arg, "on")) {
+      config.enabled = true;
+  } else if (!strcmp(p_arg, "off")) {
+      config.enabled = false;
+  } else {
+      goto arg_error;
+  }
+
+  if (argc > 1) {
+      value = strtol(sl_cli_get_argument_string(args, 1), &end, 10);
+      if ((*end != '\0') || (value > 0) || (value < -100)) {
+          goto arg_error;
+      }
+      config.rssi_threshold = (int16_t)value;
+  }
+
+  if (argc > 2) {
+      value = strtol(sl_cli_get_argument_string(args, 2), &end, 10);
+      if ((*end != '\0') || (value < 0) || (value > 40)) {
+          goto arg_error;
+      }
+      config.hysteresis = (uint8_t)value;
+  }
+
+  wifi_roaming_configure(&config);
+  return;
+
+arg_error:
+  printf("Usage: wifi roam [on|off [threshold_dbm [hysteresis_db]]]\r\n");
+}
+
+/**************************************************************************//**
+ * @brief: Print the channels of a mask.
+ *****************************************************************************/
+static void print_channel_mask(const char *label, uint16_t channel_mask)
+{
+  printf("%s:", label);
+  for (uint8_t ch = 1; ch <= SCAN_PROFILE_CHANNEL_MAX; ch++) {
+      if (channel_mask & (1u << ch)) {
+          printf(" %u", ch);
+      }
+  }
+  printf("\r\n");
+}
+
+/**************************************************************************//**
+ * @brief:
+ *    Wi-Fi CLI's callback: Display the scan profiles and their durations,
+ *    select the regulatory domain or set the dwell settings of a profile.
+ *****************************************************************************/
+void wifi_scan_profile(sl_cli_command_arg_t *args)
+{
+  int argc = sl_cli_get_argument_count(args);
+  scan_profile_dwell_t dwell;
+  scan_profile_stats_t stats;
+  scan_profile_id_t id;
+  uint16_t active_mask, passive_mask;
+  scan_region_t region;
+  long value[3];
+  char *end;
+
+  if (argc == 0) {
+      region = scan_region_get(&active_mask, &passive_mask);
+      printf("Region: %s\r\n", scan_region_name(region));
+      print_channel_mask("Active channels", active_mask);
+      print_channel_mask("Passive channels", passive_mask);
+      print_channel_mask("Learned channels", scan_profile_learned_channels(NULL));
+      printf("%-9s %6s %7s %6s %5s %8s %7s %6s %6s %6s\r\n",
+             "profile", "active", "passive", "probes",
+             "runs", "channels", "last_ms", "min_ms", "avg_ms", "max_ms");
+      for (id = 0; id < SCAN_PROFILE_NB; id++) {
+          scan_profile_get(id, &dwell, &stats);
+          printf("%-9s %6u %7u %6u %5lu %8u %7lu %6lu %6lu %6lu\r\n",
+                 scan_profile_name(id),
+                 dwell.active_time,
+                 dwell.passive_time,
+                 dwell.probe_nb,
+                 (unsigned long)stats.runs,
+                 stats.last_channels,
+                 (unsigned long)stats.last_ms,
+                 (unsigned long)stats.min_ms,
+                 (unsigned long)(stats.runs ? stats.total_ms / stats.runs : 0),
+                 (unsigned long)stats.max_ms);
+      }
+      return;
+  }
+
+  if ((argc == 2) && !strcmp(sl_cli_get_argument_string(args, 0), "region")) {
+      if (!scan_region_set(sl_cli_get_argument_string(args, 1))) {
+          printf("Unknown region: [WORLD, ETSI, FCC, MKK]\r\n");
+      }
+      return;
+  }
+
+  id = scan_profile_find(sl_cli_get_argument_string(args, 0));
+  if ((argc != 4) || (id == SCAN_PROFILE_NB)) {
+      goto arg_error;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+      value[i] = strtol(sl_cli_get_argument_string(args, i + 1), &end, 0);
+      if ((*end != '\0') || (value[i] < 0) || (value[i] > UINT16_MAX)) {
+          goto arg_error;
+      }
+  }
+  if (value[2] > UINT8_MAX) {
+      goto arg_error;
+  }
+  dwell.active_time = (uint16_t)value[0];
+  dwell.passive_time = (uint16_t)value[1];
+  dwell.probe_nb = (uint8_t)value[2];
+  scan_profile_set_dwell(id, &dwell);
+  return;
+
+arg_error:
+  printf("Usage: wifi scan_profile [region WORLD|ETSI|FCC|MKK]"
+         " | [full|learned|directed active_tu passive_tu probes]\r\n");
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display or reset the event pool statistics.
+ *****************************************************************************/
+void wifi_event_pool(sl_cli_command_arg_t *args)
+{
+  static const char *const class_names[WIFI_EVENT_POOL_CLASS_NB] = { "small", "large" };
+  wifi_event_pool_stats_t stats;
+  char *argv_str = NULL;
+
+  if (sl_cli_get_argument_count(args) > 0) {
+    argv_str = sl_cli_get_argument_string(args, 0);
+    if (strncmp(argv_str, "reset", 5) != 0) {
+      printf("Command error\r\n");
+      return;
+    }
+    wifi_event_pool_reset_stats();
+    return;
+  }
+
+  wifi_event_pool_get_stats(&stats);
+  printf("%-6s %5s %6s %6s %7s %10s %9s\r\n",
+         "class", "size", "slots", "in_use", "max_use", "posts", "exhausted");
+  for (uint8_t c = 0; c < WIFI_EVENT_POOL_CLASS_NB; c++) {
+    printf("%-6s %5u %6u %6u %7u %10lu %9lu\r\n",
+           class_names[c],
+           stats.classes[c].size,
+           stats.classes[c].slot_nb,
+           stats.classes[c].in_use,
+           stats.classes[c].in_use_max,
+           (unsigned long)stats.classes[c].posts,
+           (unsigned long)stats.classes[c].exhausted);
+  }
+  printf("oversized:  %lu\r\n", (unsigned long)stats.oversized);
+  printf("queue_full: %lu\r\n", (unsigned long)stats.queue_full);
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display the event bus subscribers and their
+ *         wake-up latency, or reset their statistics.
+ *****************************************************************************/
+void wifi_event_bus(sl_cli_command_arg_t *args)
+{
+  wifi_event_subscriber_t sub;
+  const wifi_event_latency_t *latency = &sub.latency;
+  char *argv_str = NULL;
+
+  if (sl_cli_get_argument_count(args) > 0) {
+    argv_str = sl_cli_get_argument_string(args, 0);
+    if (strncmp(argv_str, "reset", 5) != 0) {
+      printf("Command error\r\n");
+      return;
+    }
+    wifi_event_bus_reset_stats();
+    return;
+  }
+
+  printf("%-12s %6s %6s %7s %7s %8s %8s %8s %8s\r\n",
+         "subscriber", "filter", "queued", "dropped", "wakeups",
+         "last_us", "min_us", "avg_us", "max_us");
+  for (uint8_t i = 0; wifi_event_bus_get_subscriber(i, &sub); i++) {
+    printf("%-12s %6lx %6u %7lu %7lu %8lu %8lu %8lu %8lu\r\n",
+           sub.name,
+           (unsigned long)sub.filter,
+           sub.count,
+           (unsigned long)sub.dropped,
+           (unsigned long)latency->wakeups,
+           (unsigned long)latency->last_us,
+           (unsigned long)latency->min_us,
+           (unsigned long)(latency->wakeups ? latency->total_us / latency->wakeups : 0),
+           (unsigned long)latency->max_us);
+  }
+  printf("filter bits:");
+  for (uint8_t id = 0; id < WIFI_EVENT_NB; id++) {
+    printf(" %u=%s", id, wifi_event_bus_event_name((wifi_event_id_t)id));
+  }
+  printf("\r\n");
+}
+
+/**************************************************************************//**
+ * @brief:
+ *    Wi-Fi CLI's callback: Start the SoftAP interface using
+ *    the information stored in softap parameters.
+ *****************************************************************************/
+void wifi_start_softap(sl_cli_command_arg_t *args)
+{
+  (void)args;
+
+  char *p_softap_ssid = NULL;
+  char *p_softap_passkey = NULL;
+  uint8_t *p_softap_channel = NULL;
+  sl_wfx_security_mode_t *p_softap_secur_mode = NULL;
+
+  sl_wfx_status_t status;
+  RTOS_ERR_CODE err_code;
+
+  /* Check whether softAP is already started */
+  if (wifi.state & SL_WFX_AP_INTERFACE_UP) {
+      printf("softAP is already started\r\n");
+      return;
+  }
+
+  /* Retrieve required parameters */
+  p_softap_ssid = (char *)wifi_cli_get_param_addr("softap.ssid");
+  p_softap_passkey = (char *)wifi_cli_get_param_addr("softap.passkey");
+  p_softap_channel = (uint8_t *)wifi_cli_get_param_addr("softap.channel");
+  p_softap_secur_mode = (sl_wfx_security_mode_t *)wifi_cli_get_param_addr("softap.security");
+
+  if ((p_softap_ssid == NULL)
+      || (p_softap_passkey == NULL)
+      || (p_softap_channel == NULL)
+      || (p_softap_secur_mode == NULL)) {
+      LOG_DEBUG("SoftAP's ssid, passkey, channel or security mode not found");
+      goto error;
   }
 
   /* Send start the SoftAP command to the wifi device */
+  wifi_event_bus_request_begin(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_START_AP));
   status = sl_wfx_start_ap_command(*p_softap_channel,
                                    (uint8_t *)p_softap_ssid,
                                    strlen(p_softap_ssid),
@@ -1456,19 +2140,22 @@ void wifi_start_softap(sl_cli_command_arg_t *args)
                                    0);
   if (status == SL_STATUS_OK) {
       /* Block CLI to wait the indication message */
-      err_code = wifi_cli_wait(&g_cli_sem,
-                               SL_WFX_START_AP_IND_ID,
-                               SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS);
+      err_code = wifi_event_bus_wait(&g_cli_events,
+                                     WIFI_EVENT_MASK(WIFI_EVENT_START_AP),
+                                     SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS,
+                                     NULL);
+      wifi_event_bus_request_end(&g_cli_events);
 
       if (err_code == RTOS_ERR_TIMEOUT) {
-          LOG_DEBUG("wifi_cli_wait() timeout\r\n");
+          LOG_DEBUG("wifi_event_bus_wait() timeout\r\n");
           goto error;
       } else if (err_code != RTOS_ERR_NONE) {
-          LOG_DEBUG("wifi_cli_wait() failed: err_code = %d\r\n", err_code);
+          LOG_DEBUG("wifi_event_bus_wait() failed: err_code = %d\r\n", err_code);
           goto error;
       }
       return;
   }
+  wifi_event_bus_request_end(&g_cli_events);
   LOG_DEBUG("Failed to send sl_wfx_start_ap_command");
 
 error:
@@ -1492,23 +2179,27 @@ void wifi_stop_softap(sl_cli_command_arg_t *args)
   }
 
   /* Send stop command SoftAP */
+  wifi_event_bus_request_begin(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_STOP_AP));
   status = sl_wfx_stop_ap_command();
 
   if (status == SL_STATUS_OK) {
       /* Block to wait for the confirmation */
-      err_code = wifi_cli_wait(&g_cli_sem,
-                              SL_WFX_STOP_AP_IND_ID,
-                              SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS);
+      err_code = wifi_event_bus_wait(&g_cli_events,
+                                     WIFI_EVENT_MASK(WIFI_EVENT_STOP_AP),
+                                     SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS,
+                                     NULL);
+      wifi_event_bus_request_end(&g_cli_events);
 
       if (err_code == RTOS_ERR_TIMEOUT) {
-          LOG_DEBUG("wifi_cli_wait() timeout\r\n");
+          LOG_DEBUG("wifi_event_bus_wait() timeout\r\n");
           goto error;
       } else if (err_code != RTOS_ERR_NONE) {
-          LOG_DEBUG("wifi_cli_wait() failed: err_code = %d\r\n", err_code);
+          LOG_DEBUG("wifi_event_bus_wait() failed: err_code = %d\r\n", err_code);
           goto error;
       }
       return;
   }
+  wifi_event_bus_request_end(&g_cli_events);
   LOG_DEBUG("Failed to send sl_wfx_stop_ap_command()");
 
 error:
@@ -1546,6 +2237,102 @@ void wifi_softap_rssi(sl_cli_command_arg_t *args)
   }
 }
 
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display the traffic and signal of the SoftAP
+ *         clients, as a table or JSON, reset their counters or set the idle
+ *         timeout.
+ *****************************************************************************/
+void wifi_softap_clients(sl_cli_command_arg_t *args)
+{
+  static softap_client_t clients[SOFTAP_CLIENTS_MAX];
+  int argc = sl_cli_get_argument_count(args);
+  softap_clients_stats_t stats;
+  uint32_t idle_timeout_s;
+  uint32_t now_ms;
+  uint16_t nb;
+  uint16_t i;
+  bool json = false;
+  char *p_arg, *end;
+  long value;
+
+  if (argc > 0) {
+      p_arg = sl_cli_get_argument_string(args, 0);
+      convert_to_lower_case_string(p_arg);
+      if (!strcmp(p_arg, "reset") && (argc == 1)) {
+          softap_clients_reset_stats();
+          return;
+      } else if (!strcmp(p_arg, "idle") && (argc == 2)) {
+          value = strtol(sl_cli_get_argument_string(args, 1), &end, 10);
+          if ((*end != '\0') || (value < 0)) {
+              goto arg_error;
+          }
+          softap_clients_set_idle_timeout((uint32_t)value);
+          return;
+      } else if (!strcmp(p_arg, "json") && (argc == 1)) {
+          json = true;
+      } else {
+          goto arg_error;
+      }
+  }
+
+  nb = softap_clients_get(clients);
+  now_ms = sys_now();
+
+  if (json) {
+      printf("[");
+      for (i = 0; i < nb; i++) {
+          printf("%s{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\", \"rssi\":%d, "
+                 "\"assoc_s\":%lu, \"idle_s\":%lu, \"tx_bytes\":%lu, \"tx_packets\":%lu, "
+                 "\"rx_bytes\":%lu, \"rx_packets\":%lu}",
+                 (i > 0) ? "," : "",
+                 clients[i].mac[0], clients[i].mac[1], clients[i].mac[2],
+                 clients[i].mac[3], clients[i].mac[4], clients[i].mac[5],
+                 clients[i].rssi,
+                 (unsigned long)((now_ms - clients[i].assoc_ms) / 1000),
+                 (unsigned long)((now_ms - clients[i].last_rx_ms) / 1000),
+                 (unsigned long)clients[i].tx_bytes,
+                 (unsigned long)clients[i].tx_packets,
+                 (unsigned long)clients[i].rx_bytes,
+                 (unsigned long)clients[i].rx_packets);
+      }
+      printf("]\r\n");
+      return;
+  }
+
+  softap_clients_get_stats(&idle_timeout_s, &stats);
+  printf("Clients: %u/%u, idle timeout %lu s%s, evictions %lu, not tracked %lu,"
+         " unknown frames %lu, max probes %u\r\n",
+         stats.clients,
+         SOFTAP_CLIENTS_MAX,
+         (unsigned long)idle_timeout_s,
+         idle_timeout_s ? "" : " (off)",
+         (unsigned long)stats.evictions,
+         (unsigned long)stats.table_full,
+         (unsigned long)stats.unknown_frames,
+         stats.max_probes);
+  if (nb == 0) {
+      return;
+  }
+  printf("%-17s %5s %8s %7s %10s %8s %10s %8s\r\n",
+         "mac", "rssi", "assoc_s", "idle_s", "tx_bytes", "tx_pkts", "rx_bytes", "rx_pkts");
+  for (i = 0; i < nb; i++) {
+      printf("%02X:%02X:%02X:%02X:%02X:%02X %5d %8lu %7lu %10lu %8lu %10lu %8lu\r\n",
+             clients[i].mac[0], clients[i].mac[1], clients[i].mac[2],
+             clients[i].mac[3], clients[i].mac[4], clients[i].mac[5],
+             clients[i].rssi,
+             (unsigned long)((now_ms - clients[i].assoc_ms) / 1000),
+             (unsigned long)((now_ms - clients[i].last_rx_ms) / 1000),
+             (unsigned long)clients[i].tx_bytes,
+             (unsigned long)clients[i].tx_packets,
+             (unsigned long)clients[i].rx_bytes,
+             (unsigned long)clients[i].rx_packets);
+  }
+  return;
+
+arg_error:
+  printf("Usage: wifi softap_clients [json | reset | idle <timeout_s>]\r\n");
+}
+
 /**************************************************************************//**
  * @brief:
  * Wi-Fi CLI's callback: Set the Power Mode on the WLAN interface
@@ -1562,6 +2349,8 @@ void wifi_station_power_mode(sl_cli_command_arg_t *args)
   uint8_t uapsd = 0, fast_ps = 0;
   char *cmd_err = "Command Error";
   char *invalid_arg_err = "Invalid argument";
+  wifi_power_ctrl_config_t ps_config;
+  wifi_power_ctrl_stats_t ps_stats;
   char *help_text = "Examples: wifi powermode ACTIVE\r\n"
                      "          wifi powermode BEACONS UAPSD 2"
                      "          wifi powermode DTIM FAST_PS 3 20";
@@ -1570,6 +2359,11 @@ void wifi_station_power_mode(sl_cli_command_arg_t *args)
       printf("Station is not connected to AP! Network up first!\r\n");
       return;
   }
+  wifi_power_ctrl_get(&ps_config, &ps_stats);
+  if (ps_config.enabled) {
+      printf("Power mode set by the controller, 'wifi ps_auto off' first\r\n");
+      return;
+  }
   /* Number of arguments */
   argc = sl_cli_get_argument_count(args);
 
@@ -1690,6 +2484,201 @@ arg_error:
      printf("%s\r\n%s\r\n", invalid_arg_err, help_text);
 }
 
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display the power-save controller statistics,
+ *         enable/disable it or reset its statistics.
+ *****************************************************************************/
+void wifi_station_power_auto(sl_cli_command_arg_t *args)
+{
+  int argc = sl_cli_get_argument_count(args);
+  wifi_power_ctrl_config_t config;
+  wifi_power_ctrl_stats_t stats;
+  char *p_arg, *end;
+  long value;
+
+  wifi_power_ctrl_get(&config, &stats);
+
+  if (argc == 0) {
+      printf("Power-save controller: %s, active above %lu B/s, fast_ps above %lu B/s,"
+             " hold %lu ms, DTIM interval %u\r\n",
+             config.enabled ? "on" : "off",
+             (unsigned long)config.active_bps,
+             (unsigned long)config.fast_ps_bps,
+             (unsigned long)config.hold_ms,
+             config.dtim_interval);
+      printf("Mode: %s, traffic %lu B/s, TCP segments queued %u, failures %lu\r\n",
+             wifi_power_ctrl_mode_name(stats.mode),
+             (unsigned long)stats.rate_bps,
+             stats.tcp_queued,
+             (unsigned long)stats.failures);
+      printf("%-8s %11s %10s %14s\r\n", "mode", "transitions", "time_ms", "wake_period_ms");
+      for (uint8_t mode = 0; mode < WIFI_POWER_CTRL_MODE_NB; mode++) {
+          printf("%-8s %11lu %10lu %14lu\r\n",
+                 wifi_power_ctrl_mode_name((wifi_power_ctrl_mode_t)mode),
+                 (unsigned long)stats.transitions[mode],
+                 (unsigned long)stats.time_ms[mode],
+                 (unsigned long)stats.wake_period_ms[mode]);
+      }
+      if (stats.boosts > 0) {
+          printf("Boosts to active: %lu, mode request (us): last %lu, avg %lu, max %lu\r\n",
+                 (unsigned long)stats.boosts,
+                 (unsigned long)stats.last_boost_us,
+                 (unsigned long)(stats.total_boost_us / stats.boosts),
+                 (unsigned long)stats.max_boost_us);
+      }
+      return;
+  }
+
+  if (argc > 5) {
+      goto arg_error;
+  }
+
+  p_arg = sl_cli_get_argument_string(args, 0);
+  convert_to_lower_case_string(p_arg);
+  if (!strcmp(p_arg, "reset") && (argc == 1)) {
+      wifi_power_ctrl_reset_stats();
+      return;
+  } else if (!strcmp(p_arg, "on")) {
+      config.enabled = true;
+  } else if (!strcmp(p_arg, "off")) {
+      config.enabled = false;
+  } else {
+      goto arg_error;
+  }
+
+  if (argc > 1) {
+      value = strtol(sl_cli_get_argument_string(args, 1), &end, 10);
+      if ((*end != '\0') || (value <= 0)) {
+          goto arg_error;
+      }
+      config.active_bps = (uint32_t)value;
+  }
+
+  if (argc > 2) {
+      value = strtol(sl_cli_get_argument_string(args, 2), &end, 10);
+      if ((*end != '\0') || (value <= 0) || ((uint32_t)value > config.active_bps)) {
+          goto arg_error;
+      }
+      config.fast_ps_bps = (uint32_t)value;
+  }
+
+  if (argc > 3) {
+      value = strtol(sl_cli_get_argument_string(args, 3), &end, 10);
+      if ((*end != '\0') || (value < 0)) {
+          goto arg_error;
+      }
+      config.hold_ms = (uint32_t)value;
+  }
+
+  if (argc > 4) {
+      value = strtol(sl_cli_get_argument_string(args, 4), &end, 10);
+      if ((*end != '\0') || (value < 1) || (value > 255)) {
+          goto arg_error;
+      }
+      config.dtim_interval = (uint8_t)value;
+  }
+
+  wifi_power_ctrl_configure(&config);
+  return;
+
+arg_error:
+  printf("Usage: wifi ps_auto [reset | on|off [active_bps [fast_ps_bps [hold_ms [dtim_interval]]]]]\r\n");
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display the statistics history summary, dump
+ *         it as CSV, enable/disable the sampler or clear the history.
+ *****************************************************************************/
+void wifi_stats_history(sl_cli_command_arg_t *args)
+{
+  int argc = sl_cli_get_argument_count(args);
+  wifi_stats_sampler_config_t config;
+  wifi_stats_summary_t summary;
+  wifi_stats_sample_t sample;
+  uint32_t failures;
+  uint16_t count;
+  uint16_t index;
+  uint8_t field;
+  char *p_arg, *end;
+  long value;
+
+  wifi_stats_sampler_get(&config, &count, &failures);
+
+  if (argc == 0) {
+      printf("Statistics sampler: %s, period %lu ms, %u/%u samples, %lu read failures\r\n",
+             config.enabled ? "on" : "off",
+             (unsigned long)config.period_ms,
+             count,
+             WIFI_STATS_SAMPLER_DEPTH,
+             (unsigned long)failures);
+      wifi_stats_sampler_summary(&summary);
+      if (summary.count == 0) {
+          return;
+      }
+      printf("%-18s %10s %10s %10s\r\n", "per second", "min", "avg", "max");
+      printf("%-18s %10d %10d %10d\r\n", "rssi (dBm)",
+             summary.rssi_min, summary.rssi_avg, summary.rssi_max);
+      for (field = 0; field < WIFI_STATS_FIELD_NB; field++) {
+          printf("%-18s %10lu %10lu %10lu\r\n",
+                 wifi_stats_sampler_field_name((wifi_stats_field_t)field),
+                 (unsigned long)summary.rate_min[field],
+                 (unsigned long)summary.rate_avg[field],
+                 (unsigned long)summary.rate_max[field]);
+      }
+      return;
+  }
+
+  p_arg = sl_cli_get_argument_string(args, 0);
+  convert_to_lower_case_string(p_arg);
+  if (!strcmp(p_arg, "dump") && (argc == 1)) {
+      /* Each counter increment then its rate per second */
+      printf("seq,timestamp_ms,interval_ms,rssi");
+      for (field = 0; field < WIFI_STATS_FIELD_NB; field++) {
+          printf(",%s,%s_ps",
+                 wifi_stats_sampler_field_name((wifi_stats_field_t)field),
+                 wifi_stats_sampler_field_name((wifi_stats_field_t)field));
+      }
+      printf("\r\n");
+      for (index = 0; wifi_stats_sampler_get_sample(index, &sample); index++) {
+          printf("%lu,%lu,%lu,%d",
+                 (unsigned long)sample.seq,
+                 (unsigned long)sample.timestamp_ms,
+                 (unsigned long)sample.interval_ms,
+                 sample.rssi);
+          for (field = 0; field < WIFI_STATS_FIELD_NB; field++) {
+              printf(",%lu,%lu",
+                     (unsigned long)sample.delta[field],
+                     (unsigned long)sample.rate[field]);
+          }
+          printf("\r\n");
+      }
+      return;
+  } else if (!strcmp(p_arg, "reset") && (argc == 1)) {
+      wifi_stats_sampler_reset();
+      return;
+  } else if (!strcmp(p_arg, "on") && (argc <= 2)) {
+      config.enabled = true;
+  } else if (!strcmp(p_arg, "off") && (argc == 1)) {
+      config.enabled = false;
+  } else {
+      goto arg_error;
+  }
+
+  if (argc > 1) {
+      value = strtol(sl_cli_get_argument_string(args, 1), &end, 10);
+      if ((*end != '\0') || (value < WIFI_STATS_SAMPLER_PERIOD_MS_MIN)) {
+          goto arg_error;
+      }
+      config.period_ms = (uint32_t)value;
+  }
+
+  wifi_stats_sampler_configure(&config);
+  return;
+
+arg_error:
+  printf("Usage: wifi stats_history [dump | reset | on [period_ms] | off]\r\n");
+}
+
 /**************************************************************************//**
  * @brief:
  * Wi-Fi CLI's callback: Enable/disable the Power Save on
@@ -1736,43 +2725,100 @@ error:
 void ping_cmd_cb(sl_cli_command_arg_t *args)
 {
   int argc;
-  int req_number;
-  char *ip_str = NULL;
+  int i;
+  int value;
+  char *argv_str = NULL;
+  char *end = NULL;
   char *err_msg = "Command error\r\n";
   char *invalid_arg = "Invalid argument";
   char *help_text = "Examples: ping 192.168.0.1\r\n"
-                       "         ping -n 100 192.168.0.1";
+                       "         ping -n 100 192.168.0.1\r\n"
+                       "         ping -n 1000 -f 192.168.0.1 192.168.0.2\r\n"
+                       "         ping -n 100 -i 10 -w 4 -s 32:1472:160 192.168.0.1";
+  ping_engine_config_t config;
+  bool window_set = false;
+
+  memset(&config, 0, sizeof(config));
+  config.count = PING_DEFAULT_REQ_NB;
+  config.interval_ms = PING_DEFAULT_INTERVAL_SEC * 1000;
+  config.size_min = PING_DEFAULT_DATA_SIZE;
+  config.size_max = PING_DEFAULT_DATA_SIZE;
+  config.window = PING_DEFAULT_WINDOW;
+  config.timeout_ms = PING_DEFAULT_RCV_TMO_SEC * 1000;
 
   argc = sl_cli_get_argument_count(args);
-  switch (argc) {
-    case 1:
-      /* No request msg number: ping ip_addr */ 
-      ip_str = sl_cli_get_argument_string(args, 0);
-      if (ping_cmd(PING_DEFAULT_REQ_NB, ip_str) != SL_STATUS_OK) {
-          printf("%s", err_msg);
+  for (i = 0; i < argc; ) {
+    argv_str = sl_cli_get_argument_string(args, i);
+
+    if (strcmp(argv_str, "-f") == 0) {
+      /* Flood mode: next request as soon as the reply is received */
+      config.interval_ms = 0;
+      config.quiet = true;
+      i++;
+
+    } else if (argv_str[0] == '-') {
+      /* Options below need a value */
+      if (i + 1 >= argc) {
+        goto invalid_arg_err;
       }
-      break;
-
-    case 3:
-      /* Full options: ping -n nb ip_addr */ 
-      ip_str = sl_cli_get_argument_string(args, 2);
-      if (strcmp(sl_cli_get_argument_string(args, 0), "-n")) {
+      value = (int)strtol(sl_cli_get_argument_string(args, i + 1), &end, 10);
+
+      if (strcmp(argv_str, "-s") == 0) {
+        /* Payload size, or sweep min:max:step */
+        if (value < 0) {
+          goto invalid_arg_err;
+        }
+        config.size_min = (uint16_t)value;
+        config.size_max = (uint16_t)value;
+        if (*end == ':') {
+          config.size_max = (uint16_t)strtol(end + 1, &end, 10);
+          if (*end != ':') {
+            goto invalid_arg_err;
+          }
+          config.size_step = (uint16_t)strtol(end + 1, &end, 10);
+          if (config.size_step == 0) {
+            goto invalid_arg_err;
+          }
+        }
+      } else if ((strcmp(argv_str, "-i") == 0) && (value >= 0)) {
+        config.interval_ms = (uint32_t)value;
+      } else if (value <= 0) {
+        goto invalid_arg_err;
+      } else if (strcmp(argv_str, "-n") == 0) {
+        config.count = (uint32_t)value;
+      } else if ((strcmp(argv_str, "-w") == 0) && (value <= PING_ENGINE_MAX_OUTSTANDING)) {
+        config.window = (uint8_t)value;
+        window_set = true;
+      } else if (strcmp(argv_str, "-W") == 0) {
+        config.timeout_ms = (uint32_t)value;
+      } else {
         goto invalid_arg_err;
       }
-
-      req_number = atoi(sl_cli_get_argument_string(args, 1));
-      if (req_number <= 0) {
-        goto  invalid_arg_err;
+      if (*end != '\0') {
+        goto invalid_arg_err;
       }
+      i += 2;
 
-      if (ping_cmd((uint32_t)req_number, ip_str) != SL_STATUS_OK) {
-          printf("%s", err_msg);
+    } else {
+      /* Target */
+      if ((config.target_nb >= PING_ENGINE_MAX_TARGETS)
+          || (ipaddr_aton(argv_str, &config.targets[config.target_nb]) == 0)) {
+        goto invalid_arg_err;
       }
-      break;
+      config.target_nb++;
+      i++;
+    }
+  }
 
-    default:
-      goto invalid_arg_err;
-      break;
+  if (config.target_nb == 0) {
+    goto invalid_arg_err;
+  }
+  if ((config.interval_ms == 0) && !window_set) {
+    config.window = PING_FLOOD_WINDOW;
+  }
+
+  if (ping_cmd(&config) != SL_STATUS_OK) {
+      printf("%s", err_msg);
   }
   return;
 
@@ -1790,7 +2836,160 @@ void lwip_ip_stats(sl_cli_command_arg_t *args)
 }
 
 /**************************************************************************//**
- * @brief: Wi-Fi CLI's callback: Start a TCP iPerf test as a client or a server.
+ * @brief: Wi-Fi CLI's callback: Display or reset the TX flow control statistics.
+ *****************************************************************************/
+void lwip_tx_stats(sl_cli_command_arg_t *args)
+{
+  ethernetif_tx_stats_t stats;
+  char *argv_str = NULL;
+
+  if (sl_cli_get_argument_count(args) > 0) {
+    argv_str = sl_cli_get_argument_string(args, 0);
+    if (strncmp(argv_str, "reset", 5) != 0) {
+      printf("Command error\r\n");
+      return;
+    }
+    ethernetif_reset_tx_stats();
+    return;
+  }
+
+  ethernetif_get_tx_stats(&stats);
+  printf("TX flow control (limit %u, resume %u)\r\n",
+         stats.window,
+         stats.resume_threshold);
+  printf("frames_queued:      %lu\r\n", stats.frames_queued);
+  printf("frames_confirmed:   %lu\r\n", stats.frames_confirmed);
+  printf("frames_failed:      %lu\r\n", stats.frames_failed);
+  printf("alloc_failures:     %lu\r\n", stats.alloc_failures);
+  printf("queue_full_events:  %lu\r\n", stats.queue_full_events);
+  printf("pause_count:        %lu\r\n", stats.pause_count);
+  printf("resyncs:            %lu\r\n", stats.resyncs);
+  printf("outstanding:        %u\r\n", stats.outstanding);
+  printf("outstanding_max:    %u\r\n", stats.outstanding_max);
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display or reset the host stack latency histograms.
+ *****************************************************************************/
+void lwip_latency(sl_cli_command_arg_t *args)
+{
+  char *argv_str = NULL;
+
+  if (sl_cli_get_argument_count(args) > 0) {
+    argv_str = sl_cli_get_argument_string(args, 0);
+    if (strncmp(argv_str, "reset", 5) != 0) {
+      printf("Command error\r\n");
+      return;
+    }
+    latency_trace_reset();
+    return;
+  }
+
+  if (latency_trace_display() < 0) {
+    printf("Latency tracing disabled (LATENCY_TRACE_ENABLED)\r\n");
+  }
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display or switch the TCP window & buffer tuning.
+ *****************************************************************************/
+void lwip_tcp_tune(sl_cli_command_arg_t *args)
+{
+  uint8_t state;
+
+  if (sl_cli_get_argument_count(args) > 0) {
+    if (get_on_off_state(sl_cli_get_argument_string(args, 0), &state) < 0) {
+      printf("Invalid argument.\n"
+             "Please input OFF for Disable; ON for Enable\r\n");
+      return;
+    }
+    if (state) {
+      tcp_autotune_start();
+    } else {
+      tcp_autotune_stop();
+    }
+    return;
+  }
+
+  tcp_autotune_display();
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Parse a bandwidth with an optional K/M/G suffix (iperf units, 1000-based)
+ *    and up to 9 decimals, e.g. "1.5M"
+ *
+ * @param[in]
+ *    + str: the input string
+ *
+ * @param[out]
+ *    + bandwidth: bandwidth in bits per second
+ *
+ * @return
+ *    0 if success
+ *    -1 if failed
+ ******************************************************************************/
+static int parse_bandwidth(char *str, uint32_t *bandwidth)
+{
+  char *end = str;
+  uint64_t value = 0;
+  uint64_t fraction = 0;
+  uint64_t fraction_scale = 1;
+  uint64_t multiplier = 1;
+
+  if ((*str < '0') || (*str > '9')) {
+    return -1;
+  }
+  while ((*end >= '0') && (*end <= '9')) {
+    value = value * 10 + (uint64_t)(*end++ - '0');
+    if (value > UINT32_MAX) {
+      return -1;
+    }
+  }
+  if (*end == '.') {
+    end++;
+    while ((*end >= '0') && (*end <= '9')) {
+      if (fraction_scale < 1000000000) {
+        fraction = fraction * 10 + (uint64_t)(*end - '0');
+        fraction_scale *= 10;
+      }
+      end++;
+    }
+  }
+  switch (*end) {
+    case '\0':
+      break;
+    case 'k':
+    case 'K':
+      multiplier = 1000;
+      end++;
+      break;
+    case 'm':
+    case 'M':
+      multiplier = 1000000;
+      end++;
+      break;
+    case 'g':
+    case 'G':
+      multiplier = 1000000000;
+      end++;
+      break;
+    default:
+      return -1;
+  }
+  if (*end != '\0') {
+    return -1;
+  }
+  value = value * multiplier + (fraction * multiplier) / fraction_scale;
+  if ((value == 0) || (value > UINT32_MAX)) {
+    return -1;
+  }
+  *bandwidth = (uint32_t)value;
+  return 0;
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Start a TCP or UDP iPerf test as a client or a server.
  *****************************************************************************/
 void iperf(sl_cli_command_arg_t *args)
 {
@@ -1798,14 +2997,23 @@ void iperf(sl_cli_command_arg_t *args)
   uint8_t argc;
   char *ip_str = NULL;
   char *argv_str = NULL;
+  char *end = NULL;
   char *invalid_msg = "Invalid argument!";
-  char *help_text = "Examples: iperf -s\r\n"
+  char *help_text = "Examples: iperf -s [-u] [-i 1]\r\n"
                     "          iperf -c 192.168.0.1\r\n"
-                    "          iperf -c 192.168.0.1 -t 5 -p 5001 -k";
+                    "          iperf -c 192.168.0.1 -t 5 -p 5001 -i 1 -k\r\n"
+                    "          iperf -c 192.168.0.1 -P 4 -d\r\n"
+                    "          iperf -c 192.168.0.1 -u -b 10M -l 1470";
 
   int duration = IPERF_DEFAULT_DURATION_SEC;
   int srv_port = IPERF_DEFAULT_PORT;
+  int datagram_len = 0;
+  int interval = 0;
+  int streams = 1;
+  enum lwiperf_client_type client_type = LWIPERF_CLIENT;
+  uint32_t bandwidth = IPERF_DEFAULT_UDP_BANDWIDTH;
   bool iperf_client_foreground_mode = false;
+  bool udp_mode = false;
 
   /* Number of arguments only excluding commands */
   argc = sl_cli_get_argument_count(args);
@@ -1815,11 +3023,34 @@ void iperf(sl_cli_command_arg_t *args)
 
       /* Checking server or client options */
       if (strncmp(argv_str, "-s", 2) == 0) { /*!< In iperf server mode */
-          if (argc != 1) {
-              goto error;
+          for (i = 1; i < argc; ) {
+              argv_str = sl_cli_get_argument_string(args, i);
+
+              if (strncmp(argv_str, "-u", 2) == 0) {
+                udp_mode = true;
+                i++;
+
+              } else if (strncmp(argv_str, "-i", 2) == 0) {
+                if (i + 1 >= argc) {
+                    goto error;
+                }
+                interval = atoi(sl_cli_get_argument_string(args, i + 1));
+                if (interval <= 0) {
+                    goto error;
+                }
+                i += 2;
+
+              } else {
+                /* Unknown option! */
+                goto error;
+              }
+          }
+          if (udp_mode) {
+              /* Start iperf UDP server */
+              return iperf_udp_server((uint32_t)interval);
           }
           /* Start iperf server*/
-          return iperf_server();
+          return iperf_server((uint32_t)interval);
 
       } else if (strncmp(argv_str, "-c", 2) == 0) { /*!< In iperf client mode */
           /* Parsing client arguments with fall-through */
@@ -1833,6 +3064,9 @@ void iperf(sl_cli_command_arg_t *args)
                     argv_str = sl_cli_get_argument_string(args, i);
 
                     if (strncmp(argv_str, "-t", 2) == 0) {
+                      if (i + 1 >= argc) {
+                          goto error;
+                      }
                       duration = atoi(sl_cli_get_argument_string(args, i + 1));
                       if (duration <= 0) {
                           goto error;
@@ -1840,26 +3074,101 @@ void iperf(sl_cli_command_arg_t *args)
                       i += 2;
 
                     } else if (strncmp(argv_str, "-p", 2) == 0) {
+                      if (i + 1 >= argc) {
+                          goto error;
+                      }
                       srv_port = atoi(sl_cli_get_argument_string(args, i + 1));
                       if (srv_port <= 0) {
                           goto error;
                       }
                       i += 2;
 
+                    } else if (strncmp(argv_str, "-i", 2) == 0) {
+                      if (i + 1 >= argc) {
+                          goto error;
+                      }
+                      interval = atoi(sl_cli_get_argument_string(args, i + 1));
+                      if (interval <= 0) {
+                          goto error;
+                      }
+                      i += 2;
+
+                    } else if (strncmp(argv_str, "-P", 2) == 0) {
+                      if (i + 1 >= argc) {
+                          goto error;
+                      }
+                      streams = atoi(sl_cli_get_argument_string(args, i + 1));
+                      if ((streams <= 0) || (streams > LWIPERF_TCP_MAX_STREAMS)) {
+                          goto error;
+                      }
+                      i += 2;
+
+                    } else if (strncmp(argv_str, "-d", 2) == 0) {
+                      client_type = LWIPERF_DUAL;
+                      i++;
+
+                    } else if (strncmp(argv_str, "-r", 2) == 0) {
+                      client_type = LWIPERF_TRADEOFF;
+                      i++;
+
                     } else if (strncmp(argv_str, "-k", 2) == 0) {
                       iperf_client_foreground_mode = true;
                       i++;
 
+                    } else if (strncmp(argv_str, "-u", 2) == 0) {
+                      udp_mode = true;
+                      i++;
+
+                    } else if (strncmp(argv_str, "-b", 2) == 0) {
+                      if ((i + 1 >= argc)
+                          || (parse_bandwidth(sl_cli_get_argument_string(args, i + 1), &bandwidth) < 0)) {
+                          goto error;
+                      }
+                      /* A bandwidth implies an UDP test as in iperf2 */
+                      udp_mode = true;
+                      i += 2;
+
+                    } else if (strncmp(argv_str, "-l", 2) == 0) {
+                      if (i + 1 >= argc) {
+                          goto error;
+                      }
+                      datagram_len = (int)strtol(sl_cli_get_argument_string(args, i + 1), &end, 10);
+                      if ((*end != '\0') || (datagram_len <= 0) || (datagram_len > (int)LWIPERF_UDP_MAX_LEN)) {
+                          goto error;
+                      }
+                      i += 2;
+
                     } else {
                       /* Unknown option! */
                       goto error;
                     }
                   }
               }
+              if (!udp_mode && (datagram_len != 0)) {
+                  /* The datagram length applies to the UDP tests only */
+                  goto error;
+              }
+              if (udp_mode) {
+                  if ((streams != 1) || (client_type != LWIPERF_CLIENT)) {
+                      /* Parallel and bidirectional tests are TCP only */
+                      goto error;
+                  }
+                  /* Start iperf UDP client mode */
+                  return iperf_udp_client(ip_str,
+                                          (uint32_t)duration,
+                                          (uint32_t)srv_port,
+                                          bandwidth,
+                                          (uint16_t)datagram_len,
+                                          (uint32_t)interval,
+                                          iperf_client_foreground_mode);
+              }
               /* Start iperf client mode */
               return iperf_client(ip_str,
                                   (uint32_t)duration,
                                   (uint32_t)srv_port,
+                                  (uint32_t)interval,
+                                  (uint8_t)streams,
+                                  client_type,
                                   iperf_client_foreground_mode);
           }
       }
@@ -1870,6 +3179,515 @@ error:
     printf("%s\r\n%s\r\n", invalid_msg, help_text);
 }
 
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Start an iPerf3 test as a client or a server.
+ *****************************************************************************/
+void iperf3(sl_cli_command_arg_t *args)
+{
+  uint8_t i;
+  uint8_t argc;
+  char *ip_str = NULL;
+  char *argv_str = NULL;
+  char *invalid_msg = "Invalid argument!";
+  char *help_text = "Examples: iperf3 -s [-p 5201]\r\n"
+                    "          iperf3 -c 192.168.0.1\r\n"
+                    "          iperf3 -c 192.168.0.1 -t 5 -P 2 -R -k\r\n"
+                    "          iperf3 -c 192.168.0.1 -u -b 10M -l 1400";
+
+  int duration = IPERF_DEFAULT_DURATION_SEC;
+  int srv_port = LWIPERF3_PORT_DEFAULT;
+  int value;
+  lwiperf3_params_t params;
+  bool iperf_client_foreground_mode = false;
+
+  memset(&params, 0, sizeof(params));
+  params.num_streams = 1;
+
+  /* Number of arguments only excluding commands */
+  argc = sl_cli_get_argument_count(args);
+  if (argc >= 1) {
+      /* Obtain the first argument */
+      argv_str = sl_cli_get_argument_string(args, 0);
+
+      if (strncmp(argv_str, "-s", 2) == 0) { /*!< In iperf3 server mode */
+          for (i = 1; i < argc; ) {
+              argv_str = sl_cli_get_argument_string(args, i);
+
+              if ((strncmp(argv_str, "-p", 2) == 0) && (i + 1 < argc)) {
+                srv_port = atoi(sl_cli_get_argument_string(args, i + 1));
+                if ((srv_port <= 0) || (srv_port > 0xFFFF)) {
+                    goto error;
+                }
+                i += 2;
+
+              } else {
+                /* Unknown option! */
+                goto error;
+              }
+          }
+          /* Start iperf3 server */
+          return iperf3_server((uint32_t)srv_port);
+
+      } else if ((strncmp(argv_str, "-c", 2) == 0) && (argc >= 2)) { /*!< In iperf3 client mode */
+          /*< Obtain the remote IP address string */
+          ip_str = sl_cli_get_argument_string(args, 1);
+
+          for (i = 2; i < argc; ) {
+              /* Obtain the corresponding option */
+              argv_str = sl_cli_get_argument_string(args, i);
+
+              if (strncmp(argv_str, "-R", 2) == 0) {
+                params.reverse = 1;
+                i++;
+
+              } else if (strncmp(argv_str, "-k", 2) == 0) {
+                iperf_client_foreground_mode = true;
+                i++;
+
+              } else if (strncmp(argv_str, "-u", 2) == 0) {
+                params.udp = 1;
+                i++;
+
+              } else if (i + 1 >= argc) {
+                /* Options below need a value */
+                goto error;
+
+              } else if (strncmp(argv_str, "-b", 2) == 0) {
+                if (parse_bandwidth(sl_cli_get_argument_string(args, i + 1), &params.bandwidth_bps) < 0) {
+                    goto error;
+                }
+                i += 2;
+
+              } else {
+                value = atoi(sl_cli_get_argument_string(args, i + 1));
+                if (value <= 0) {
+                    goto error;
+                }
+                if (strncmp(argv_str, "-t", 2) == 0) {
+                  duration = value;
+                } else if (strncmp(argv_str, "-p", 2) == 0) {
+                  srv_port = value;
+                } else if ((strncmp(argv_str, "-P", 2) == 0) && (value <= LWIPERF_TCP_MAX_STREAMS)) {
+                  params.num_streams = (uint8_t)value;
+                } else if (strncmp(argv_str, "-l", 2) == 0) {
+                  params.len = (uint32_t)value;
+                } else {
+                  /* Unknown option! */
+                  goto error;
+                }
+                i += 2;
+              }
+          }
+          if ((params.bandwidth_bps != 0) && !params.udp) {
+              /* iperf3 paces the UDP tests only */
+              goto error;
+          }
+          params.duration_sec = (uint32_t)duration;
+          /* Start iperf3 client */
+          return iperf3_client(ip_str,
+                               (uint32_t)srv_port,
+                               &params,
+                               iperf_client_foreground_mode);
+      }
+      /* go to error */
+  }
+
+error:
+    printf("%s\r\n%s\r\n", invalid_msg, help_text);
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Start a request/response latency benchmark.
+ *****************************************************************************/
+void rr(sl_cli_command_arg_t *args)
+{
+  uint8_t i;
+  uint8_t argc;
+  char *ip_str = NULL;
+  char *argv_str = NULL;
+  char *end = NULL;
+  char *invalid_msg = "Invalid argument!";
+  char *help_text = "Examples: rr -c 192.168.0.1\r\n"
+                    "          rr -c 192.168.0.1 -t 5 -r 64,1024 -k\r\n"
+                    "          rr -c 192.168.0.1 -u -p 5003";
+
+  int duration = IPERF_DEFAULT_DURATION_SEC;
+  int srv_port = LWIPERF_RR_PORT_DEFAULT;
+  long request_len = RR_DEFAULT_REQUEST_LEN;
+  long response_len = RR_DEFAULT_RESPONSE_LEN;
+  bool foreground_mode = false;
+  bool udp_mode = false;
+
+  argc = sl_cli_get_argument_count(args);
+  if ((argc < 2) || (strncmp(sl_cli_get_argument_string(args, 0), "-c", 2) != 0)) {
+      goto error;
+  }
+  /*< Obtain the peer IP address string */
+  ip_str = sl_cli_get_argument_string(args, 1);
+
+  for (i = 2; i < argc; ) {
+      argv_str = sl_cli_get_argument_string(args, i);
+
+      if (strncmp(argv_str, "-u", 2) == 0) {
+        udp_mode = true;
+        i++;
+
+      } else if (strncmp(argv_str, "-k", 2) == 0) {
+        foreground_mode = true;
+        i++;
+
+      } else if (i + 1 >= argc) {
+        /* Options below need a value */
+        goto error;
+
+      } else if (strncmp(argv_str, "-t", 2) == 0) {
+        duration = atoi(sl_cli_get_argument_string(args, i + 1));
+        if (duration <= 0) {
+            goto error;
+        }
+        i += 2;
+
+      } else if (strncmp(argv_str, "-p", 2) == 0) {
+        srv_port = atoi(sl_cli_get_argument_string(args, i + 1));
+        if ((srv_port <= 0) || (srv_port > 0xFFFF)) {
+            goto error;
+        }
+        i += 2;
+
+      } else if (strncmp(argv_str, "-r", 2) == 0) {
+        /* Request and response sizes as netperf: req[,rsp] */
+        request_len = strtol(sl_cli_get_argument_string(args, i + 1), &end, 10);
+        response_len = request_len;
+        if (*end == ',') {
+            response_len = strtol(end + 1, &end, 10);
+        }
+        if ((*end != '\0')
+            || (request_len < (long)LWIPERF_RR_MIN_REQUEST_LEN) || (request_len > LWIPERF_RR_MAX_LEN)
+            || (response_len < (long)LWIPERF_RR_MIN_RESPONSE_LEN) || (response_len > LWIPERF_RR_MAX_LEN)) {
+            goto error;
+        }
+        i += 2;
+
+      } else {
+        /* Unknown option! */
+        goto error;
+      }
+  }
+
+  return rr_client(ip_str,
+                   (uint32_t)srv_port,
+                   udp_mode,
+                   (uint16_t)request_len,
+                   (uint16_t)response_len,
+                   (uint32_t)duration,
+                   foreground_mode);
+
+error:
+    printf("%s\r\n%s\r\n", invalid_msg, help_text);
+}
+
+/**************************************************************************//**
+ * @brief: Parse a comma-separated list of names into a bitmask, the n-th name
+ *         of the table setting the n-th bit.
+ *
+ * @return 0 if success, -1 if a name is unknown
+ *****************************************************************************/
+static int parse_bench_list(char *str, const char *const names[], uint8_t name_nb, uint8_t *mask)
+{
+  char *token;
+  uint8_t i;
+
+  *mask = 0;
+  for (token = strtok(str, ","); token != NULL; token = strtok(NULL, ",")) {
+      convert_to_lower_case_string(token);
+      for (i = 0; i < name_nb; i++) {
+          if (strcmp(token, names[i]) == 0) {
+              *mask |= (uint8_t)(1 << i);
+              break;
+          }
+      }
+      if (i == name_nb) {
+          return -1;
+      }
+  }
+  return (*mask != 0) ? 0 : -1;
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Run a throughput/latency benchmark matrix
+ *         and print its results as CSV.
+ *****************************************************************************/
+void bench(sl_cli_command_arg_t *args)
+{
+  static const char *const proto_names[] = { "tcp", "udp" };
+  static const char *const dir_names[] = { "tx", "rx" };
+  static const char *const power_mode_names[] = { "active", "ps", "dtim" };
+  static const char *const rate_algo_names[] = { "aarf", "minstrel" };
+  uint8_t i;
+  uint8_t argc;
+  char *argv_str = NULL;
+  char *value_str = NULL;
+  char *end = NULL;
+  long len;
+  int value;
+  char *invalid_msg = "Invalid argument!";
+  char *help_text = "Examples: bench -c 192.168.0.1\r\n"
+                    "          bench -c 192.168.0.1 -T udp -d tx -l 512,1400 -b 20M\r\n"
+                    "          bench -c 192.168.0.1 -m active,dtim -a current -L 5003";
+  bench_matrix_t matrix;
+
+  memset(&matrix, 0, sizeof(matrix));
+  matrix.iperf3_port = LWIPERF3_PORT_DEFAULT;
+  matrix.duration_sec = BENCH_DEFAULT_DURATION_SEC;
+  matrix.protos = BENCH_PROTO_TCP | BENCH_PROTO_UDP;
+  matrix.dirs = BENCH_DIR_TX | BENCH_DIR_RX;
+  matrix.power_modes = BENCH_PM_ACTIVE | BENCH_PM_PS | BENCH_PM_DTIM;
+  matrix.rate_algos = BENCH_RATE_AARF | BENCH_RATE_MINSTREL;
+
+  argc = sl_cli_get_argument_count(args);
+  if ((argc < 2) || (strncmp(sl_cli_get_argument_string(args, 0), "-c", 2) != 0)) {
+      goto error;
+  }
+  /*< Obtain the server IP address string */
+  matrix.server = sl_cli_get_argument_string(args, 1);
+
+  /* Every option takes a value */
+  for (i = 2; i + 1 < argc; i += 2) {
+      argv_str = sl_cli_get_argument_string(args, i);
+      value_str = sl_cli_get_argument_string(args, i + 1);
+
+      if (strncmp(argv_str, "-T", 2) == 0) {
+        if (parse_bench_list(value_str, proto_names, 2, &matrix.protos) < 0) {
+            goto error;
+        }
+
+      } else if (strncmp(argv_str, "-d", 2) == 0) {
+        if (parse_bench_list(value_str, dir_names, 2, &matrix.dirs) < 0) {
+            goto error;
+        }
+
+      } else if (strncmp(argv_str, "-m", 2) == 0) {
+        if (parse_bench_list(value_str, power_mode_names, 3, &matrix.power_modes) < 0) {
+            goto error;
+        }
+
+      } else if (strncmp(argv_str, "-a", 2) == 0) {
+        if (strcmp(value_str, "current") == 0) {
+            /* Keep the rate algorithm in use */
+            matrix.rate_algos = 0;
+        } else if (parse_bench_list(value_str, rate_algo_names, 2, &matrix.rate_algos) < 0) {
+            goto error;
+        }
+
+      } else if (strncmp(argv_str, "-l", 2) == 0) {
+        /* Packet sizes: len[,len...] */
+        matrix.len_nb = 0;
+        end = value_str;
+        do {
+            len = strtol((*end == ',') ? end + 1 : end, &end, 10);
+            if ((len <= 0) || (len > 0xFFFF) || (matrix.len_nb == BENCH_MAX_LENS)) {
+                goto error;
+            }
+            matrix.lens[matrix.len_nb++] = (uint16_t)len;
+        } while (*end == ',');
+        if (*end != '\0') {
+            goto error;
+        }
+
+      } else if (strncmp(argv_str, "-b", 2) == 0) {
+        if (parse_bandwidth(value_str, &matrix.udp_bandwidth_bps) < 0) {
+            goto error;
+        }
+
+      } else {
+        value = atoi(value_str);
+        if (value <= 0) {
+            goto error;
+        }
+        if (strncmp(argv_str, "-t", 2) == 0) {
+          matrix.duration_sec = (uint32_t)value;
+        } else if ((strncmp(argv_str, "-p", 2) == 0) && (value <= 0xFFFF)) {
+          matrix.iperf3_port = (uint16_t)value;
+        } else if ((strncmp(argv_str, "-L", 2) == 0) && (value <= 0xFFFF)) {
+          matrix.rr_port = (uint16_t)value;
+        } else {
+          /* Unknown option! */
+          goto error;
+        }
+      }
+  }
+  if (i != argc) {
+      /* An option without its value */
+      goto error;
+  }
+
+  if (!(wifi.state & SL_WFX_STA_INTERFACE_CONNECTED)) {
+      printf("Station is not connected to AP! Network up first!\r\n");
+      return;
+  }
+
+  if (bench_run(&matrix, &bench_wfx_ops) != SL_STATUS_OK) {
+      printf("# some tests failed\r\n");
+  }
+  return;
+
+error:
+    printf("%s\r\n%s\r\n", invalid_msg, help_text);
+}
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Run an upload for each TX rate set and rate
+ *         algorithm, print the ranked results, optionally apply or save the
+ *         best one.
+ *****************************************************************************/
+void rate_sweep(sl_cli_command_arg_t *args)
+{
+  static const bench_rate_set_t rate_set_names[] = {
+    { "all",    BENCH_RATES_ALL },
+    { "b",      BENCH_RATES_B },
+    { "g",      BENCH_RATES_G },
+    { "bg",     BENCH_RATES_B | BENCH_RATES_G },
+    { "n",      BENCH_RATES_N },
+    { "n_high", BENCH_RATES_N_HIGH },
+  };
+  static const char *const rate_algo_names[] = { "aarf", "minstrel" };
+  static bench_sweep_result_t results[BENCH_SWEEP_MAX_RESULTS];
+  uint8_t result_nb;
+  uint8_t i;
+  uint8_t j;
+  uint8_t argc;
+  char *argv_str = NULL;
+  char *value_str = NULL;
+  char *end = NULL;
+  char *name = NULL;
+  size_t name_len;
+  int value;
+  bool apply = false;
+  bool save = false;
+  char *invalid_msg = "Invalid argument!";
+  char *help_text = "Examples: rate_sweep -c 192.168.0.1\r\n"
+                    "          rate_sweep -c 192.168.0.1 -r bg,n,0x00300000 -a minstrel -w save";
+  bench_sweep_t sweep;
+
+  memset(&sweep, 0, sizeof(sweep));
+  sweep.iperf3_port = LWIPERF3_PORT_DEFAULT;
+  sweep.duration_sec = BENCH_DEFAULT_DURATION_SEC;
+  sweep.rate_sets[0] = rate_set_names[0];
+  sweep.rate_sets[1] = rate_set_names[3];
+  sweep.rate_sets[2] = rate_set_names[4];
+  sweep.rate_sets[3] = rate_set_names[5];
+  sweep.rate_set_nb = 4;
+  sweep.rate_algos = BENCH_RATE_AARF | BENCH_RATE_MINSTREL;
+
+  argc = sl_cli_get_argument_count(args);
+  if ((argc < 2) || (strncmp(sl_cli_get_argument_string(args, 0), "-c", 2) != 0)) {
+      goto error;
+  }
+  /*< Obtain the server IP address string */
+  sweep.server = sl_cli_get_argument_string(args, 1);
+
+  /* Every option takes a value */
+  for (i = 2; i + 1 < argc; i += 2) {
+      argv_str = sl_cli_get_argument_string(args, i);
+      value_str = sl_cli_get_argument_string(args, i + 1);
+
+      if (strncmp(argv_str, "-r", 2) == 0) {
+        /* Rate sets: name|bitmask[,name|bitmask...] */
+        sweep.rate_set_nb = 0;
+        name = value_str;
+        do {
+            if (sweep.rate_set_nb == BENCH_SWEEP_MAX_RATE_SETS) {
+                goto error;
+            }
+            end = strchr(name, ',');
+            name_len = (end != NULL) ? (size_t)(end - name) : strlen(name);
+            for (j = 0; j < sizeof(rate_set_names) / sizeof(rate_set_names[0]); j++) {
+                if ((strlen(rate_set_names[j].name) == name_len)
+                    && (strncmp(name, rate_set_names[j].name, name_len) == 0)) {
+                    break;
+                }
+            }
+            if (j < sizeof(rate_set_names) / sizeof(rate_set_names[0])) {
+                sweep.rate_sets[sweep.rate_set_nb] = rate_set_names[j];
+            } else {
+                sweep.rate_sets[sweep.rate_set_nb].name = NULL;
+                sweep.rate_sets[sweep.rate_set_nb].rates = (uint32_t)strtoul(name, &end, 0);
+                if ((end != name + name_len) || (sweep.rate_sets[sweep.rate_set_nb].rates == 0)) {
+                    goto error;
+                }
+            }
+            sweep.rate_set_nb++;
+            name += name_len;
+        } while (*name++ == ',');
+
+      } else if (strncmp(argv_str, "-a", 2) == 0) {
+        if (parse_bench_list(value_str, rate_algo_names, 2, &sweep.rate_algos) < 0) {
+            goto error;
+        }
+
+      } else if (strncmp(argv_str, "-w", 2) == 0) {
+        if (strcmp(value_str, "apply") == 0) {
+            apply = true;
+        } else if (strcmp(value_str, "save") == 0) {
+            apply = true;
+            save = true;
+        } else {
+            goto error;
+        }
+
+      } else {
+        value = atoi(value_str);
+        if (value <= 0) {
+            goto error;
+        }
+        if (strncmp(argv_str, "-t", 2) == 0) {
+          sweep.duration_sec = (uint32_t)value;
+        } else if ((strncmp(argv_str, "-p", 2) == 0) && (value <= 0xFFFF)) {
+          sweep.iperf3_port = (uint16_t)value;
+        } else {
+          /* Unknown option! */
+          goto error;
+        }
+      }
+  }
+  if (i != argc) {
+      /* An option without its value */
+      goto error;
+  }
+
+  if (!(wifi.state & SL_WFX_STA_INTERFACE_CONNECTED)) {
+      printf("Station is not connected to AP! Network up first!\r\n");
+      return;
+  }
+
+  if (bench_sweep(&sweep, &bench_wfx_ops, results, &result_nb) != SL_STATUS_OK) {
+      printf("# no rate set succeeded\r\n");
+      return;
+  }
+
+  if (!apply) {
+      return;
+  }
+  if (bench_wfx_ops.set_tx_rates(results[0].rate_algo, results[0].rate_set.rates) != SL_STATUS_OK) {
+      printf("Failed to apply the TX rates 0x%08lX\r\n", (unsigned long)results[0].rate_set.rates);
+      return;
+  }
+  wlan_tx_params.rates = results[0].rate_set.rates;
+  wlan_tx_params.rate_algo = (results[0].rate_algo == BENCH_RATE_MINSTREL) ? 1 : 0;
+  wlan_tx_params.set = true;
+  printf("TX rates 0x%08lX with %s applied\r\n",
+         (unsigned long)wlan_tx_params.rates,
+         wlan_tx_params.rate_algo ? "Minstrel" : "AARF");
+  if (save) {
+      wifi_save(NULL);
+      printf("Station settings saved\r\n");
+  }
+  return;
+
+error:
+    printf("%s\r\n%s\r\n", invalid_msg, help_text);
+}
+
 /**************************************************************************//**
  * @brief: Wi-Fi CLI's callback: Stop the running iPerf server.
  *****************************************************************************/
@@ -2032,6 +3850,14 @@ void wifi_save(sl_cli_command_arg_t *args)
                 NVM3_KEY_AP_SECURITY_WPA3_PMKSA,
                 (void *)&wlan_security_wpa3_pmksa,
                 sizeof(wlan_security_wpa3_pmksa));
+
+  if (wlan_tx_params.set)
+  {
+    nvm3_writeData(nvm3_defaultHandle,
+                   NVM3_KEY_STA_TX_PARAMS,
+                   (void *)&wlan_tx_params,
+                   sizeof(wlan_tx_params));
+  }
 }
 
 
@@ -2059,6 +3885,11 @@ void wifi_set_rate_algo(sl_cli_command_arg_t *args)
                                                               SL_WFX_STA_INTERFACE);  
   
   if (SL_STATUS_OK == status) {
+    if (!intf) {
+      wlan_tx_params.rates = 0xFFFFFFFF;
+      wlan_tx_params.rate_algo = rate_algo;
+      wlan_tx_params.set = true;
+    }
     printf("rate_algo set to %s for %s interface\r\n", rate_algo ? "Minstrel": "AARF",
                                                       intf ? "softap" : "station");
     return;
@@ -2137,6 +3968,11 @@ void wifi_set_tx_params(sl_cli_command_arg_t *args)
                                                               SL_WFX_STA_INTERFACE);  
   
   if (SL_STATUS_OK == status) {
+    if (!intf) {
+      wlan_tx_params.rates = tx_rates.rate;
+      wlan_tx_params.rate_algo = rate_algo;
+      wlan_tx_params.set = true;
+    }
     printf("rate_algo set to %s for %s interface\r\n", rate_algo ? "Minstrel": "AARF",
                                                       intf ? "softap" : "station");
     return;
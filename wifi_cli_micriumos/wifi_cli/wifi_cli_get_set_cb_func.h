@@ -71,11 +71,13 @@ void get_station_ip(sl_cli_command_arg_t *args);
 void get_station_pmk(sl_cli_command_arg_t *args);
 void get_station_mac(sl_cli_command_arg_t *args);
 void get_statistics(sl_cli_command_arg_t *args);
+void get_station_connect_times(sl_cli_command_arg_t *args);
 
 void get_softap_ssid(sl_cli_command_arg_t *args);
 void get_softap_passkey(sl_cli_command_arg_t *args);
 void get_softap_security(sl_cli_command_arg_t *args);
 void get_softap_channel(sl_cli_command_arg_t *args);
+void get_softap_dhcp_param(sl_cli_command_arg_t *args);
 void get_softap_netmask(sl_cli_command_arg_t *args);
 void get_softap_gateway(sl_cli_command_arg_t *args);
 void get_softap_ip(sl_cli_command_arg_t *args);
@@ -100,6 +102,7 @@ void set_softap_ssid(sl_cli_command_arg_t *args);
 void set_softap_passkey(sl_cli_command_arg_t *args);
 void set_softap_security(sl_cli_command_arg_t *args);
 void set_softap_channel(sl_cli_command_arg_t *args);
+void set_softap_dhcp_param(sl_cli_command_arg_t *args);
 void set_softap_netmask(sl_cli_command_arg_t *args);
 void set_softap_gateway(sl_cli_command_arg_t *args);
 void set_softap_ip(sl_cli_command_arg_t *args);
@@ -114,10 +117,17 @@ void wifi_station_connect(sl_cli_command_arg_t *args);
 void wifi_station_disconnect(sl_cli_command_arg_t *args);
 void wifi_station_disconnect(sl_cli_command_arg_t *args);
 void wifi_station_scan(sl_cli_command_arg_t *args);
+void wifi_scan_profile(sl_cli_command_arg_t *args);
 void wifi_station_rssi(sl_cli_command_arg_t *args);
+void wifi_station_roam(sl_cli_command_arg_t *args);
+void wifi_conn_timing(sl_cli_command_arg_t *args);
+void wifi_event_pool(sl_cli_command_arg_t *args);
+void wifi_event_bus(sl_cli_command_arg_t *args);
 
 void wifi_station_power_mode(sl_cli_command_arg_t *args);
 void wifi_station_power_save(sl_cli_command_arg_t *args);
+void wifi_station_power_auto(sl_cli_command_arg_t *args);
+void wifi_stats_history(sl_cli_command_arg_t *args);
 
 /*******************************************************************************
  **************   WI-FI CLI's SOFTAP COMMAND PROTOTYPES   ********************
@@ -125,12 +135,28 @@ void wifi_station_power_save(sl_cli_command_arg_t *args);
 void wifi_start_softap(sl_cli_command_arg_t *args);
 void wifi_stop_softap(sl_cli_command_arg_t *args);
 void wifi_softap_rssi(sl_cli_command_arg_t *args);
+void wifi_softap_clients(sl_cli_command_arg_t *args);
 
 /**************************************************************************//**
  * @brief: Wi-Fi CLI's callback: Display the IP stack statistics.
  *****************************************************************************/
 void lwip_ip_stats(sl_cli_command_arg_t *args);
 
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display or reset the TX flow control statistics.
+ *****************************************************************************/
+void lwip_tx_stats(sl_cli_command_arg_t *args);
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display or reset the host stack latency histograms.
+ *****************************************************************************/
+void lwip_latency(sl_cli_command_arg_t *args);
+
+/**************************************************************************//**
+ * @brief: Wi-Fi CLI's callback: Display or switch the TCP window & buffer tuning.
+ *****************************************************************************/
+void lwip_tcp_tune(sl_cli_command_arg_t *args);
+
 /**************************************************************************//**
  * @brief: Wi-Fi CLI's callback: Send ICMP ECHO_REQUEST to network hosts.
  *****************************************************************************/
@@ -140,6 +166,10 @@ void ping_cmd_cb(sl_cli_command_arg_t *args);
  **************   WI-FI CLI's IPERF COMMANDS PROTOTYPES   **********************
  ******************************************************************************/
 void iperf(sl_cli_command_arg_t *args);
+void iperf3(sl_cli_command_arg_t *args);
+void rr(sl_cli_command_arg_t *args);
+void bench(sl_cli_command_arg_t *args);
+void rate_sweep(sl_cli_command_arg_t *args);
 void iperf_server_stop(sl_cli_command_arg_t *args);
 void iperf_client_stop(sl_cli_command_arg_t *args);
 
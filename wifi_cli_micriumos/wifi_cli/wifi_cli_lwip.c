@@ -20,6 +20,9 @@
 #include <string.h>
 #include "wifi_cli_lwip.h"
 #include "ethernetif.h"
+#include "tcp_autotune.h"
+#include "ping_engine.h"
+#include "latency_trace.h"
 #include "lwip/netif.h"
 #include "lwip/tcpip.h"
 #include "lwip/apps/httpd.h"
@@ -28,6 +31,7 @@
 #include "dhcp_server.h"
 #include "sl_wfx_task.h"
 #include "sl_wfx_host.h"
+#include "wifi_conn_timing.h"
 
 /*******************************************************************************
  ******************   Wi-Fi CLI lwIP App Task Configuration   *****************
@@ -45,19 +49,38 @@ static OS_TCB   wfx_cli_lwip_task_tcb;
 /************************ Private variables ***********************************/
 static void *iperf_server_session = NULL;
 static void *iperf_client_session = NULL;
+static void *iperf_udp_server_session = NULL;
+static void *iperf_udp_client_session = NULL;
+static void *iperf3_server_session = NULL;
+static void *iperf3_client_session = NULL;
+static void *rr_client_session = NULL;
 static bool iperf_client_is_foreground_mode = false;
+static bool iperf_client_is_quiet_mode = false;
+
+/* Results of the last iPerf3 and RR clients, valid if the test completed */
+static lwiperf3_results_t iperf3_client_last_results;
+static bool iperf3_client_last_results_valid = false;
+static lwiperf_rr_results_t rr_client_last_results;
+static bool rr_client_last_results_valid = false;
 
 static uint32_t last_client_bytes_transferred = 0;
 static uint32_t last_client_ms_duration = 0;
 static uint32_t last_client_bandwidth_kbitpsec = 0;
 
-static uint16_t ping_nb_packet_received = 0;
-static uint16_t ping_nb_packet_sent = 0;
-static uint32_t ping_echo_total_time = 0;
-static uint32_t ping_echo_min_time = 0xFFFFFFFF;
-static uint32_t ping_echo_max_time = 0;
-static uint16_t ping_seq_num = 0;
-static uint32_t ping_time = 0;
+/* Streams of the running client and their aggregate results */
+static uint8_t iperf_client_streams = 0;
+static uint8_t iperf_client_streams_done = 0;
+static uint32_t iperf_client_sum_bytes = 0;
+static uint32_t iperf_client_sum_ms_duration = 0;
+
+/* Streams displaying interval reports, identified by their ports */
+typedef struct {
+  uint16_t local_port;
+  uint16_t remote_port;
+  uint32_t elapsed_ms;
+} iperf_interval_stream_t;
+
+static iperf_interval_stream_t iperf_interval_streams[IPERF_MAX_INTERVAL_STREAMS];
 
 /**************************************************************************//**
  * Set station link status to up.
@@ -65,10 +88,17 @@ static uint32_t ping_time = 0;
 sl_status_t set_sta_link_up(void)
 {
   netifapi_netif_set_up(&sta_netif);
-  netifapi_netif_set_link_up(&sta_netif);
+  /* Before the link up, for the DHCP client to reboot with its last lease */
   if (use_dhcp_client) {
     dhcpclient_set_link_state(1);
   }
+  netifapi_netif_set_link_up(&sta_netif);
+  wifi_conn_timing_mark(WIFI_CONN_STAGE_LINK_UP);
+  if (!use_dhcp_client) {
+    /* Static address: the connection is complete */
+    wifi_conn_timing_end();
+    wifi_event_bus_publish(WIFI_EVENT_IP_BOUND, 0, latency_trace_timestamp());
+  }
   return SL_STATUS_OK;
 }
 /**************************************************************************//**
@@ -81,6 +111,8 @@ sl_status_t set_sta_link_down(void)
   }
   netifapi_netif_set_link_down(&sta_netif);
   netifapi_netif_set_down(&sta_netif);
+  /* The frames left in the WFX for this link may never be confirmed */
+  ethernetif_tx_flush();
   return SL_STATUS_OK;
 }
 /**************************************************************************//**
@@ -106,208 +138,133 @@ sl_status_t set_ap_link_down(void)
   }
   netifapi_netif_set_link_down(&ap_netif);
   netifapi_netif_set_down(&ap_netif);
+  ethernetif_tx_flush();
   return SL_STATUS_OK;
 }
 
 #if LWIP_RAW  /*!< LWIP_RAW is configured in lwipopts.h */
-/***************************************************************************//**
- * @brief
- *    This callback function handles received messages
+/**************************************************************************//**
+ * @brief: Implementation of the ping command.
  *
  * @param[in]
+ *         + config: targets, number of requests, interval, sizes...
  *
- * @param[out] None
+ * @param[out]  None
  *
- * @return  None
- ******************************************************************************/
-static u8_t ping_recv_fnp(void *arg,
-                         struct raw_pcb *pcb,
-                         struct pbuf *p,
-                         const ip_addr_t *addr)
+ * @return
+ *        SL_STATUS_OK if success
+ *        SL_STATUS_FAIL if error
+ *****************************************************************************/
+sl_status_t ping_cmd(const ping_engine_config_t *config)
 {
-  (void) arg;
-  (void) pcb;
-
-  LWIP_ASSERT("p != NULL", p != NULL);
-
-  struct icmp_echo_hdr *iecho_hdr_ptr = NULL;
-
-  /** Filter out the received messages by length, only receive ICMP messages.
-   * ICMP message size = sizeof(struct icmp_echo_hdr) + data_size.
-   * Thus, tot_len >= PBUF_IP_HLEN + sizeof(struct icmp_echo_hdr)
-   * Additionally, remove/peel the IP header.
-   * */
-  if ((p->tot_len >= (PBUF_IP_HLEN + sizeof(struct icmp_echo_hdr)))
-      && (pbuf_remove_header(p, PBUF_IP_HLEN) == 0)) {
-
-      iecho_hdr_ptr = (struct icmp_echo_hdr *) p->payload; /*!< ICMP header */
-
-      if ((iecho_hdr_ptr->id == PING_ID)
-          && (iecho_hdr_ptr->seqno == lwip_htons(ping_seq_num))) {
-
-          /* Update statistic variables */
-          ping_nb_packet_received++;
-
-          uint32_t duration = sys_now() - ping_time;
-          ping_echo_total_time += duration;
-
-          if (duration < ping_echo_min_time) {
-              ping_echo_min_time = duration;
-          }
-
-          if (duration > ping_echo_max_time) {
-              ping_echo_max_time = duration;
-          }
-
-          printf("Reply from %s: bytes=%d, time=%lums\r\n", ipaddr_ntoa(addr),
-                                                            p->len,
-                                                            duration);
-          pbuf_free(p);
-
-          /* Eat the packet (received ICMP) */
-          return 1; /*!< Be careful with '1'. Because it would be deleted */
-      }
-
-      /* Packet not eaten, restore the original one */
-      pbuf_add_header(p, PBUF_IP_HLEN);
+  printf("Pinging %u target(s) with %u", config->target_nb, config->size_min);
+  if (config->size_max != config->size_min) {
+    printf(" to %u", config->size_max);
   }
+  printf(" bytes of data:\r\n");
 
-  /* Packet has not eaten */
-  return 0;
+  if (ping_engine_run(config) != 0) {
+    LOG_DEBUG("Failed to start the ping engine\r\n");
+    return SL_STATUS_FAIL;
+  }
+  return SL_STATUS_OK;
 }
-
+#endif /* LWIP_RAW */
 
 /***************************************************************************//**
  * @brief
- *    This function sends ping ICMP request message
+ *    Display an interval report as iperf does with the -i option
  *
  * @param[in]
+ *    + local_port, remote_port: ports identifying the stream
+ *    + bytes_transferred: bytes transferred during the interval
+ *    + ms_duration: interval duration
+ *    + bandwidth_kbitpsec: interval bandwidth
  *
  * @param[out] None
  *
  * @return  None
  ******************************************************************************/
-static int ping_send(struct raw_pcb *ping_raw_pcb,
-                     const ip_addr_t *dest_ip_addr,
-                     uint16_t data_size)
+static void lwip_iperf_interval_report(uint16_t local_port,
+                                       uint16_t remote_port,
+                                       uint32_t bytes_transferred,
+                                       uint32_t ms_duration,
+                                       uint32_t bandwidth_kbitpsec)
 {
-
-  struct pbuf *pbf = NULL;  /*!< packet buffer pointer (layer 3) */
-  struct icmp_echo_hdr *iecho;
-  size_t ping_msg_size, i;
-  int res = -1;
-
-  /* ping message size */
-  ping_msg_size = sizeof(struct icmp_echo_hdr) + data_size;
-
-  /* Allocate a packet buffer memory with ping msg size and IPv4 layer header size */
-  pbf = pbuf_alloc(PBUF_IP, ping_msg_size, PBUF_RAM);
-  if (pbf != NULL) {
-      iecho = (struct icmp_echo_hdr *) pbf->payload;
-
-      ICMPH_TYPE_SET(iecho, ICMP_ECHO);
-      ICMPH_CODE_SET(iecho, 0);
-      iecho->chksum = 0;
-      iecho->id = PING_ID;     /*!< MSB = LSB (0xAFAF) - no need to convert */
-      iecho->seqno = lwip_htons(++ping_seq_num);
-
-      /* Fill the additional data buffer with some data */
-      for (i = 0; i < data_size; i++) {
-          ((char *)iecho)[sizeof(struct icmp_echo_hdr) + i] = (char)i;
-      }
-
-      iecho->chksum = inet_chksum(iecho, ping_msg_size);
-
-      res = raw_sendto(ping_raw_pcb, pbf, dest_ip_addr);
-      if (res == 0) {
-          ping_time = sys_now();
-          ping_nb_packet_sent++;
+  iperf_interval_stream_t *stream = NULL;
+  uint32_t start_ms;
+  uint8_t id;
+
+  for (id = 0; id < IPERF_MAX_INTERVAL_STREAMS; id++) {
+    if ((iperf_interval_streams[id].local_port == local_port)
+        && (iperf_interval_streams[id].remote_port == remote_port)) {
+      stream = &iperf_interval_streams[id];
+      break;
+    }
+  }
+  if (stream == NULL) {
+    /* New stream */
+    for (id = 0; id < IPERF_MAX_INTERVAL_STREAMS; id++) {
+      if (iperf_interval_streams[id].local_port == 0) {
+        stream = &iperf_interval_streams[id];
+        stream->local_port = local_port;
+        stream->remote_port = remote_port;
+        stream->elapsed_ms = 0;
+        printf("[ ID] Interval        Transfer       Bandwidth\r\n");
+        break;
       }
-      pbuf_free(pbf);
+    }
+    if (stream == NULL) {
+      return;
+    }
   }
-  return res;
+
+  start_ms = stream->elapsed_ms;
+  stream->elapsed_ms += ms_duration;
+  printf("[%3u] %3lu.%lu-%3lu.%lu sec  %4lu.%02lu MBytes  %4lu.%02lu Mbits/sec\r\n",
+         id + 1,
+         start_ms / 1000, (start_ms % 1000) / 100,
+         stream->elapsed_ms / 1000, (stream->elapsed_ms % 1000) / 100,
+         bytes_transferred / (1024 * 1024),
+         ((bytes_transferred % (1024 * 1024)) * 100) / (1024 * 1024),
+         bandwidth_kbitpsec / 1000,
+         (bandwidth_kbitpsec % 1000) / 10);
 }
 
-/**************************************************************************//**
- * @brief: Implementation of the ping command.
+/***************************************************************************//**
+ * @brief
+ *    Forget the interval reports of a finished stream
  *
  * @param[in]
- *         + req_num: Number of request messages (ICMP)
- *         + ip_str: Remote IP's address
+ *    + local_port, remote_port: ports identifying the stream
  *
- * @param[out]  None
+ * @param[out] None
  *
- * @return
- *        SL_STATUS_OK if success
- *        SL_STATUS_FAIL if error
- *****************************************************************************/
-sl_status_t ping_cmd(uint32_t req_num, char *ip_str)
+ * @return  None
+ ******************************************************************************/
+static void lwip_iperf_interval_release(uint16_t local_port, uint16_t remote_port)
 {
-
-  int res = -1;
-
-  struct raw_pcb *ping_pcb = NULL; /*!< protocol control block */
-  ip_addr_t ping_addr;
-
-  /* Parsing IP address */
-  res = ipaddr_aton(ip_str, &ping_addr);
-  if (res == 0) {
-      printf("Failed to convert string (%s) to IP\r\n", ip_str);
-      return SL_STATUS_FAIL;
-  }
-
-  /* Allocate a new resource raw_pcb */
-  ping_pcb = raw_new(IP_PROTO_ICMP);
-  if (ping_pcb == NULL) {
-      LOG_DEBUG("Failed to allocate resource for ping_pcb\r\n");
-      return SL_STATUS_ALLOCATION_FAILED;
-  }
-
-  /* Configure the IP stack */
-  raw_recv(ping_pcb, ping_recv_fnp, NULL);
-  raw_bind(ping_pcb, IP_ADDR_ANY);
-
-  printf("Pinging %s with %d bytes of data:\r\n",
-           ip_str, PING_DEFAULT_DATA_SIZE);
-
-  /* Reset internal variables */
-  ping_seq_num = 0;
-  ping_nb_packet_sent = 0;
-  ping_nb_packet_received = 0;
-  ping_echo_total_time = 0;
-  ping_echo_min_time = 0xFFFFFFFF;
-  ping_echo_max_time = 0;
-
-  while(req_num-- > 0) {
-      /* Send ping request to IP destination */
-      res = ping_send(ping_pcb, &ping_addr, PING_DEFAULT_DATA_SIZE);
-      if (res != 0) {
-          printf("Send ping request to IP (%s) failed\r\n", ip_str);
-          raw_remove(ping_pcb); /*!< release ping_pcb */
-          return SL_STATUS_FAIL;
-      }
-      /* Wait for receiving ICMP responses from the destination IP */
-      sys_msleep(PING_DEFAULT_INTERVAL_SEC * 1000);
+  for (uint8_t id = 0; id < IPERF_MAX_INTERVAL_STREAMS; id++) {
+    if ((iperf_interval_streams[id].local_port == local_port)
+        && (iperf_interval_streams[id].remote_port == remote_port)) {
+      iperf_interval_streams[id].local_port = 0;
+      iperf_interval_streams[id].remote_port = 0;
+    }
   }
+}
 
-  if (res == 0) {
-    /* Display statistics */
-    printf("\r\nPing statistics for %s:\r\n", ip_str);
-    printf("\tPackets: Sent = %u, Received = %u, Lost = %u (%u%% loss),\r\n",
-           ping_nb_packet_sent,
-           ping_nb_packet_received,
-           ping_nb_packet_sent-ping_nb_packet_received,
-           ((ping_nb_packet_sent-ping_nb_packet_received)*100)/ping_nb_packet_sent);
-    printf("Approximate round trip times in milli-seconds:\r\n");
-    printf("\tMinimum = %lums, Maximum = %lums, Average = %lums\r\n",
-           ping_echo_min_time,
-           ping_echo_max_time,
-           ping_echo_total_time/ping_nb_packet_received);
-  }
-  raw_remove(ping_pcb); /*!< release ping_pcb */
-  return SL_STATUS_OK;
+/***************************************************************************//**
+ * @brief
+ *    Forget the TCP client session once its last stream, listener or
+ *    connection back from the remote host is freed.
+ *    Called with the TCP/IP core locked.
+ ******************************************************************************/
+static void lwip_iperf_client_release(void)
+{
+  if ((iperf_client_session != NULL) && !lwiperf_is_running(iperf_client_session)) {
+    iperf_client_session = NULL;
+  }
 }
-#endif /* LWIP_RAW */
 
 /***************************************************************************//**
  * @brief
@@ -329,20 +286,44 @@ static void lwip_iperf_results (void *arg,
                                 uint32_t ms_duration,
                                 uint32_t bandwidth_kbitpsec)
 {
-  (void)report_type;
   (void)local_addr;
-  (void)local_port;
   (void)remote_addr;
-  (void)remote_port;
 
   int mode = (int) arg;
 
+  if (report_type == LWIPERF_INTERVAL) {
+    lwip_iperf_interval_report(local_port, remote_port,
+                               bytes_transferred, ms_duration, bandwidth_kbitpsec);
+    return;
+  }
+  lwip_iperf_interval_release(local_port, remote_port);
+
   if (mode == IPERF_CLIENT_MODE) {
-    last_client_bytes_transferred = bytes_transferred;
-    last_client_ms_duration = ms_duration;
-    last_client_bandwidth_kbitpsec = bandwidth_kbitpsec;
+    /* A stream of the client is done, report once all of them are */
+    iperf_client_streams_done++;
+    iperf_client_sum_bytes += bytes_transferred;
+    if (ms_duration > iperf_client_sum_ms_duration) {
+      iperf_client_sum_ms_duration = ms_duration;
+    }
+    if (iperf_client_streams > 1) {
+      printf("Stream %u: %lu.%03lus, %lu bytes, %lu kbps%s\r\n",
+             iperf_client_streams_done,
+             ms_duration / 1000,
+             ms_duration % 1000,
+             bytes_transferred,
+             bandwidth_kbitpsec,
+             (report_type == LWIPERF_TCP_DONE_CLIENT) ? "" : " (aborted)");
+    }
+    if (iperf_client_streams_done < iperf_client_streams) {
+      return;
+    }
 
-    printf("\r\nIperf Client Report:\r\n" );
+    ms_duration = iperf_client_sum_ms_duration;
+    bytes_transferred = iperf_client_sum_bytes;
+    bandwidth_kbitpsec = (ms_duration == 0) ? 0 : (uint32_t)(((uint64_t)bytes_transferred * 8) / ms_duration);
+
+    printf("\r\nIperf Client Report%s:\r\n",
+           (iperf_client_streams > 1) ? " (sum of the streams)" : "");
     printf("Interval %d.%ds\r\n",
            (int)(ms_duration/1000),
            (int)(ms_duration%1000));
@@ -353,10 +334,29 @@ static void lwip_iperf_results (void *arg,
            (int)(bandwidth_kbitpsec/1024),
            (int)(((bandwidth_kbitpsec*1000)/1024)%1000));
 
+    /* The connections back from a dual/tradeoff test may still run */
+    lwip_iperf_client_release();
     if (iperf_client_is_foreground_mode) {
       /* Give back the hand to the shell */
-      wifi_cli_resume(&g_cli_sem, 0); /*!< "sem_event_type" is 0, a general event */
+      wifi_event_bus_publish(WIFI_EVENT_IPERF_DONE, 0, latency_trace_timestamp());
     }
+  } else if (mode != IPERF_SERVER_MODE) {
+    /* Connection accepted by a server (or back from a dual/tradeoff test) is done */
+    last_client_bytes_transferred = bytes_transferred;
+    last_client_ms_duration = ms_duration;
+    last_client_bandwidth_kbitpsec = bandwidth_kbitpsec;
+
+    printf("\r\nIperf Client Report:\r\n" );
+    printf("Interval %d.%ds\r\n",
+           (int)(ms_duration/1000),
+           (int)(ms_duration%1000));
+    printf("Bytes transferred %d.%dM\r\n",
+           (int)(bytes_transferred/1024/1024),
+           (int)((((bytes_transferred/1024)*1000)/1024)%1000));
+    printf("Bandwidth %d.%d Mbps\r\n\r\n",
+           (int)(bandwidth_kbitpsec/1024),
+           (int)(((bandwidth_kbitpsec*1000)/1024)%1000));
+    lwip_iperf_client_release();
   } else {
     /* Server stopped, display the last client report */
     printf("\r\nIperf Last Client Report:\r\n" );
@@ -372,17 +372,280 @@ static void lwip_iperf_results (void *arg,
   }
 }
 
+/***************************************************************************//**
+ * @brief
+ *    Display the results of an UDP iperf test
+ *
+ * @param[in]
+ *    + arg: IPERF_CLIENT_MODE or IPERF_SERVER_MODE
+ *    + others: see lwiperf_udp_report_fn
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+static void lwip_iperf_udp_results(void *arg,
+                                   enum lwiperf_report_type report_type,
+                                   const ip_addr_t* local_addr,
+                                   uint16_t local_port,
+                                   const ip_addr_t* remote_addr,
+                                   uint16_t remote_port,
+                                   uint32_t bytes_transferred,
+                                   uint32_t ms_duration,
+                                   uint32_t bandwidth_kbitpsec,
+                                   const lwiperf_udp_stats_t *udp_stats)
+{
+  (void)local_addr;
+
+  int mode = (int) arg;
+
+  if (report_type == LWIPERF_INTERVAL) {
+    lwip_iperf_interval_report(local_port, remote_port,
+                               bytes_transferred, ms_duration, bandwidth_kbitpsec);
+    return;
+  }
+  lwip_iperf_interval_release(local_port, remote_port);
+
+  if (mode == IPERF_CLIENT_MODE) {
+    printf("\r\nIperf UDP Client Report:\r\n");
+  } else {
+    printf("\r\nIperf UDP Server Report (%s):\r\n", ipaddr_ntoa(remote_addr));
+  }
+  if (report_type == LWIPERF_UDP_ABORTED_IDLE) {
+    printf("Test aborted: the client stopped sending\r\n");
+  } else if ((report_type != LWIPERF_UDP_DONE_CLIENT) && (report_type != LWIPERF_UDP_DONE_SERVER)) {
+    printf("Test aborted\r\n");
+  }
+  printf("Interval %d.%ds\r\n",
+         (int)(ms_duration/1000),
+         (int)(ms_duration%1000));
+  printf("Bytes transferred %d.%dM\r\n",
+         (int)(bytes_transferred/1024/1024),
+         (int)((((bytes_transferred/1024)*1000)/1024)%1000));
+  printf("Bandwidth %d.%d Mbps\r\n",
+         (int)(bandwidth_kbitpsec/1024),
+         (int)(((bandwidth_kbitpsec*1000)/1024)%1000));
+  if (udp_stats != NULL) {
+    printf("Jitter %lu.%03lu ms\r\n",
+           udp_stats->jitter_us / 1000,
+           udp_stats->jitter_us % 1000);
+    printf("Lost/Total datagrams %lu/%lu (%lu%%)\r\n",
+           udp_stats->lost,
+           udp_stats->datagrams,
+           (udp_stats->datagrams > 0) ? ((udp_stats->lost * 100) / udp_stats->datagrams) : 0);
+    printf("Out-of-order datagrams %lu\r\n\r\n", udp_stats->out_of_order);
+  } else {
+    printf("No server report\r\n\r\n");
+  }
+
+  if (mode == IPERF_CLIENT_MODE) {
+    /* The session is freed once reported */
+    iperf_udp_client_session = NULL;
+    if (iperf_client_is_foreground_mode) {
+      /* Give back the hand to the shell */
+      wifi_event_bus_publish(WIFI_EVENT_IPERF_DONE, 0, latency_trace_timestamp());
+    }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Display the report of an iPerf3 test.
+ *
+ * @param[in]
+ *    + mode: IPERF_CLIENT_MODE or IPERF_SERVER_MODE
+ *    + others: see lwiperf3_report_fn
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+static void lwip_iperf3_display(int mode,
+                                enum lwiperf_report_type report_type,
+                                const ip_addr_t* remote_addr,
+                                const lwiperf3_params_t *params,
+                                const lwiperf3_results_t *results)
+{
+  if (mode == IPERF_CLIENT_MODE) {
+    printf("\r\niPerf3 %s Client Report (%s):\r\n",
+           params->udp ? "UDP" : "TCP",
+           params->reverse ? "receiver" : "sender");
+  } else {
+    printf("\r\niPerf3 %s Server Report (%s, %s):\r\n",
+           params->udp ? "UDP" : "TCP",
+           ipaddr_ntoa(remote_addr),
+           params->reverse ? "sender" : "receiver");
+  }
+  if ((report_type != LWIPERF_TCP_DONE_CLIENT) && (report_type != LWIPERF_TCP_DONE_SERVER)
+      && (report_type != LWIPERF_UDP_DONE_CLIENT) && (report_type != LWIPERF_UDP_DONE_SERVER)) {
+    printf("Test aborted\r\n");
+  }
+  printf("Streams %u\r\n", params->num_streams);
+  printf("Interval %d.%ds\r\n",
+         (int)(results->ms_duration/1000),
+         (int)(results->ms_duration%1000));
+  printf("Bytes transferred %d.%dM (peer %d.%dM)\r\n",
+         (int)(results->bytes_transferred/1024/1024),
+         (int)((((results->bytes_transferred/1024)*1000)/1024)%1000),
+         (int)(results->peer_bytes_transferred/1024/1024),
+         (int)((((results->peer_bytes_transferred/1024)*1000)/1024)%1000));
+  printf("Bandwidth %d.%d Mbps\r\n",
+         (int)(results->bandwidth_kbitpsec/1024),
+         (int)(((results->bandwidth_kbitpsec*1000)/1024)%1000));
+  if (params->udp) {
+    printf("Jitter %lu.%03lu ms\r\n",
+           results->udp_stats.jitter_us / 1000,
+           results->udp_stats.jitter_us % 1000);
+    printf("Lost/Total datagrams %lu/%lu (%lu%%)\r\n",
+           results->udp_stats.lost,
+           results->udp_stats.datagrams,
+           (results->udp_stats.datagrams > 0)
+           ? ((results->udp_stats.lost * 100) / results->udp_stats.datagrams) : 0);
+  }
+  if (results->local_json != NULL) {
+    printf("Local results: %s\r\n", results->local_json);
+  }
+  if (results->peer_json != NULL) {
+    printf("Peer results: %s\r\n", results->peer_json);
+  }
+  printf("\r\n");
+}
+
+/***************************************************************************//**
+ * @brief
+ *    This function is called when an iPerf3 test is finished.
+ *
+ * @param[in]
+ *    + arg: IPERF_CLIENT_MODE or IPERF_SERVER_MODE
+ *    + others: see lwiperf3_report_fn
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+static void lwip_iperf3_results(void *arg,
+                                enum lwiperf_report_type report_type,
+                                const ip_addr_t* remote_addr,
+                                const lwiperf3_params_t *params,
+                                const lwiperf3_results_t *results)
+{
+  int mode = (int) arg;
+
+  if ((mode != IPERF_CLIENT_MODE) || !iperf_client_is_quiet_mode) {
+    lwip_iperf3_display(mode, report_type, remote_addr, params, results);
+  }
+
+  if (mode == IPERF_CLIENT_MODE) {
+    iperf3_client_last_results = *results;
+    /* The JSON strings are freed with the session */
+    iperf3_client_last_results.local_json = NULL;
+    iperf3_client_last_results.peer_json = NULL;
+    iperf3_client_last_results_valid = (report_type == LWIPERF_TCP_DONE_CLIENT)
+                                       || (report_type == LWIPERF_UDP_DONE_CLIENT);
+
+    /* The session is freed once reported */
+    iperf3_client_session = NULL;
+    if (iperf_client_is_foreground_mode) {
+      /* Give back the hand to the shell */
+      wifi_event_bus_publish(WIFI_EVENT_IPERF_DONE, 0, latency_trace_timestamp());
+    }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Display the report of a request/response benchmark.
+ *
+ * @param[in]
+ *    + see lwiperf_rr_report_fn
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+static void lwip_rr_display(enum lwiperf_report_type report_type,
+                            const ip_addr_t* remote_addr,
+                            u16_t remote_port,
+                            const lwiperf_rr_results_t *results)
+{
+  printf("\r\n%s RR Report (%s:%u):\r\n",
+         ((report_type == LWIPERF_UDP_DONE_CLIENT) || (report_type == LWIPERF_UDP_ABORTED_LOCAL))
+         ? "UDP" : "TCP",
+         ipaddr_ntoa(remote_addr),
+         remote_port);
+  if ((report_type != LWIPERF_TCP_DONE_CLIENT) && (report_type != LWIPERF_UDP_DONE_CLIENT)) {
+    printf("Test aborted\r\n");
+  }
+  printf("Interval %d.%ds\r\n",
+         (int)(results->ms_duration/1000),
+         (int)(results->ms_duration%1000));
+  printf("Transactions %lu (%lu.%02lu/s), lost %lu\r\n",
+         results->transactions,
+         results->rate_x100 / 100,
+         results->rate_x100 % 100,
+         results->timeouts);
+  if (results->transactions > 0) {
+    printf("Latency min/avg/max = %lu.%03lu/%lu.%03lu/%lu.%03lu ms\r\n",
+           results->min_us / 1000, results->min_us % 1000,
+           results->avg_us / 1000, results->avg_us % 1000,
+           results->max_us / 1000, results->max_us % 1000);
+    printf("Latency p50/p90/p99/p99.9 = %lu.%03lu/%lu.%03lu/%lu.%03lu/%lu.%03lu ms\r\n",
+           results->p50_us / 1000, results->p50_us % 1000,
+           results->p90_us / 1000, results->p90_us % 1000,
+           results->p99_us / 1000, results->p99_us % 1000,
+           results->p999_us / 1000, results->p999_us % 1000);
+  }
+  printf("\r\n");
+}
+
+/***************************************************************************//**
+ * @brief
+ *    This function is called when a request/response benchmark is finished.
+ *
+ * @param[in]
+ *    + arg: unused
+ *    + others: see lwiperf_rr_report_fn
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+static void lwip_rr_results(void *arg,
+                            enum lwiperf_report_type report_type,
+                            const ip_addr_t* remote_addr,
+                            u16_t remote_port,
+                            const lwiperf_rr_results_t *results)
+{
+  (void)arg;
+
+  if (!iperf_client_is_quiet_mode) {
+    lwip_rr_display(report_type, remote_addr, remote_port, results);
+  }
+
+  rr_client_last_results = *results;
+  rr_client_last_results_valid = (report_type == LWIPERF_TCP_DONE_CLIENT)
+                                 || (report_type == LWIPERF_UDP_DONE_CLIENT);
+
+  /* The session is freed once reported */
+  rr_client_session = NULL;
+  if (iperf_client_is_foreground_mode) {
+    /* Give back the hand to the shell */
+    wifi_event_bus_publish(WIFI_EVENT_IPERF_DONE, 0, latency_trace_timestamp());
+  }
+}
+
 /***************************************************************************//**
  * @brief
  *    Start iperf as server mode.
  *
  * @param[in]
+ *    + interval: report interval in seconds, 0 for the final report only
  *
  * @param[out] None
  *
  * @return  None
  ******************************************************************************/
-void iperf_server(void)
+void iperf_server(uint32_t interval)
 {
   if (iperf_server_session != NULL) {
     /* An iPerf server is already running, kill it first */
@@ -396,6 +659,9 @@ void iperf_server(void)
     LOCK_TCPIP_CORE();
     iperf_server_session = lwiperf_start_tcp_server_default(lwip_iperf_results,
                                                             (void *)IPERF_SERVER_MODE);
+    if (iperf_server_session != NULL) {
+      lwiperf_set_report_interval(iperf_server_session, interval * 1000);
+    }
     UNLOCK_TCPIP_CORE();
 
     if (iperf_server_session != NULL) {
@@ -413,6 +679,9 @@ void iperf_server(void)
  *         + ip_str: IP address string of remote iperf server
  *         + duration: duration in seconds
  *         + remote_port: Port of remote iperf server
+ *         + interval: report interval in seconds, 0 for the final report only
+ *         + streams: number of parallel streams
+ *         + type: unidirectional, dual or tradeoff test
  *         + is_foreground_mode: enable/disable foreground mode
  *
  * @param[out] None
@@ -422,12 +691,24 @@ void iperf_server(void)
 void iperf_client(char *ip_str,
                   uint32_t duration,
                   uint32_t remote_port,
+                  uint32_t interval,
+                  uint8_t streams,
+                  enum lwiperf_client_type type,
                   bool is_foreground_mode)
 {
   int res;
   ip_addr_t srv_addr;
   RTOS_ERR_CODE err_code;
 
+  LOCK_TCPIP_CORE();
+  /* The listener of a tradeoff test may have timed out without report */
+  lwip_iperf_client_release();
+  UNLOCK_TCPIP_CORE();
+  if (iperf_client_session != NULL) {
+      printf("A client is running, stop it first\r\n");
+      return;
+  }
+
   /* parse the remote server IP address */
   res = ipaddr_aton(ip_str, &srv_addr);
   if (res == 0) {
@@ -437,14 +718,26 @@ void iperf_client(char *ip_str,
   }
 
   iperf_client_is_foreground_mode = is_foreground_mode;
+  if (is_foreground_mode) {
+      /* Armed before the start, a short test can report before the wait */
+      wifi_event_bus_arm(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE));
+  }
 
   LOCK_TCPIP_CORE();
-  iperf_client_session = lwiperf_start_tcp_client(&srv_addr,
-                                                 remote_port,
-                                                 LWIPERF_CLIENT,
-                                                 (uint32_t)duration,
-                                                 lwip_iperf_results,
-                                                 (void *)IPERF_CLIENT_MODE);
+  iperf_client_streams = streams;
+  iperf_client_streams_done = 0;
+  iperf_client_sum_bytes = 0;
+  iperf_client_sum_ms_duration = 0;
+  iperf_client_session = lwiperf_start_tcp_client_streams(&srv_addr,
+                                                         remote_port,
+                                                         type,
+                                                         (uint32_t)duration,
+                                                         streams,
+                                                         lwip_iperf_results,
+                                                         (void *)IPERF_CLIENT_MODE);
+  if (iperf_client_session != NULL) {
+    lwiperf_set_report_interval(iperf_client_session, interval * 1000);
+  }
   UNLOCK_TCPIP_CORE();
 
   if (iperf_client_session != NULL) {
@@ -453,9 +746,10 @@ void iperf_client(char *ip_str,
 
       if (iperf_client_is_foreground_mode == true) {
          /*  Wait at least 1 second until the test is done */
-          err_code = wifi_cli_wait(&g_cli_sem,
-                                   0,
-                                   ((uint32_t)duration + 1) * 1000);
+          err_code = wifi_event_bus_wait(&g_cli_events,
+                                         WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE),
+                                         ((uint32_t)duration + 1) * 1000,
+                                         NULL);
 
           if (err_code == RTOS_ERR_TIMEOUT) {
               LOG_DEBUG("Wait timeout!\r\n");
@@ -470,6 +764,375 @@ void iperf_client(char *ip_str,
 
 }
 
+/***************************************************************************//**
+ * @brief
+ *    Start iperf as UDP server mode.
+ *
+ * @param[in]
+ *    + interval: report interval in seconds, 0 for the final report only
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+void iperf_udp_server(uint32_t interval)
+{
+  if (iperf_udp_server_session != NULL) {
+    /* An iPerf server is already running, kill it first */
+    printf("A server is running, stop it first\r\n");
+  } else {
+    LOCK_TCPIP_CORE();
+    iperf_udp_server_session = lwiperf_start_udp_server(IP_ADDR_ANY,
+                                                        LWIPERF_UDP_PORT_DEFAULT,
+                                                        lwip_iperf_udp_results,
+                                                        (void *)IPERF_SERVER_MODE);
+    if (iperf_udp_server_session != NULL) {
+      lwiperf_set_report_interval(iperf_udp_server_session, interval * 1000);
+    }
+    UNLOCK_TCPIP_CORE();
+
+    if (iperf_udp_server_session != NULL) {
+      printf("iPerf UDP server started\r\n");
+    } else {
+      printf("iPerf UDP server error\r\n");
+    }
+  }
+}
+
+/**************************************************************************//**
+ * @brief: Start iperf as UDP client mode.
+ *
+ * @param[in]
+ *         + ip_str: IP address string of remote iperf server
+ *         + duration: duration in seconds
+ *         + remote_port: Port of remote iperf server
+ *         + bandwidth: target bandwidth in bits per second
+ *         + datagram_len: UDP payload length, 0 for the default one
+ *         + interval: report interval in seconds, 0 for the final report only
+ *         + is_foreground_mode: enable/disable foreground mode
+ *
+ * @param[out] None
+ *
+ * @return     None
+ *****************************************************************************/
+void iperf_udp_client(char *ip_str,
+                      uint32_t duration,
+                      uint32_t remote_port,
+                      uint32_t bandwidth,
+                      uint16_t datagram_len,
+                      uint32_t interval,
+                      bool is_foreground_mode)
+{
+  int res;
+  ip_addr_t srv_addr;
+  RTOS_ERR_CODE err_code;
+
+  if (iperf_udp_client_session != NULL) {
+      printf("A client is running, stop it first\r\n");
+      return;
+  }
+
+  /* parse the remote server IP address */
+  res = ipaddr_aton(ip_str, &srv_addr);
+  if (res == 0) {
+      /* Parsing error */
+      printf("Failed to parse the remote server IP address\r\n");
+      return;
+  }
+
+  iperf_client_is_foreground_mode = is_foreground_mode;
+  if (is_foreground_mode) {
+      wifi_event_bus_arm(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE));
+  }
+
+  LOCK_TCPIP_CORE();
+  iperf_udp_client_session = lwiperf_start_udp_client(&srv_addr,
+                                                      remote_port,
+                                                      duration,
+                                                      bandwidth,
+                                                      datagram_len,
+                                                      lwip_iperf_udp_results,
+                                                      (void *)IPERF_CLIENT_MODE);
+  if (iperf_udp_client_session != NULL) {
+    lwiperf_set_report_interval(iperf_udp_client_session, interval * 1000);
+  }
+  UNLOCK_TCPIP_CORE();
+
+  if (iperf_udp_client_session != NULL) {
+
+      printf("iPerf UDP client started on server %s\r\n", ip_str);
+
+      if (iperf_client_is_foreground_mode == true) {
+         /* Wait for the test and the server report exchange */
+          err_code = wifi_event_bus_wait(&g_cli_events,
+                                         WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE),
+                                         ((uint32_t)duration + IPERF_UDP_REPORT_WAIT_SEC) * 1000,
+                                         NULL);
+
+          if (err_code == RTOS_ERR_TIMEOUT) {
+              LOG_DEBUG("Wait timeout!\r\n");
+          }
+
+         /* Reset to the default client mode */
+         iperf_client_is_foreground_mode = false;
+      }
+  } else {
+      printf("start iPerf UDP client error\r\n");
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Start an iPerf3 server.
+ *
+ * @param[in]
+ *    + port: listening port of the control connection and the streams
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+void iperf3_server(uint32_t port)
+{
+  if (iperf3_server_session != NULL) {
+    /* An iPerf3 server is already running, kill it first */
+    printf("A server is running, stop it first\r\n");
+  } else {
+    LOCK_TCPIP_CORE();
+    iperf3_server_session = lwiperf3_start_server(IP_ADDR_ANY,
+                                                  (u16_t)port,
+                                                  lwip_iperf3_results,
+                                                  (void *)IPERF_SERVER_MODE);
+    UNLOCK_TCPIP_CORE();
+
+    if (iperf3_server_session != NULL) {
+      printf("iPerf3 server started\r\n");
+    } else {
+      printf("iPerf3 server error\r\n");
+    }
+  }
+}
+
+/**************************************************************************//**
+ * @brief: Start an iPerf3 client test.
+ *
+ * @param[in]
+ *         + ip_str: IP address string of remote iperf3 server
+ *         + remote_port: Port of remote iperf3 server
+ *         + params: test parameters
+ *         + is_foreground_mode: enable/disable foreground mode
+ *
+ * @param[out] None
+ *
+ * @return     None
+ *****************************************************************************/
+void iperf3_client(char *ip_str,
+                   uint32_t remote_port,
+                   const lwiperf3_params_t *params,
+                   bool is_foreground_mode)
+{
+  int res;
+  ip_addr_t srv_addr;
+  RTOS_ERR_CODE err_code;
+
+  if (iperf3_client_session != NULL) {
+      printf("A client is running, stop it first\r\n");
+      return;
+  }
+
+  /* parse the remote server IP address */
+  res = ipaddr_aton(ip_str, &srv_addr);
+  if (res == 0) {
+      /* Parsing error */
+      printf("Failed to parse the remote server IP address\r\n");
+      return;
+  }
+
+  iperf_client_is_foreground_mode = is_foreground_mode;
+  if (is_foreground_mode) {
+      wifi_event_bus_arm(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE));
+  }
+
+  iperf3_client_last_results_valid = false;
+
+  LOCK_TCPIP_CORE();
+  iperf3_client_session = lwiperf3_start_client(&srv_addr,
+                                                (u16_t)remote_port,
+                                                params,
+                                                lwip_iperf3_results,
+                                                (void *)IPERF_CLIENT_MODE);
+  UNLOCK_TCPIP_CORE();
+
+  if (iperf3_client_session != NULL) {
+
+      if (!iperf_client_is_quiet_mode) {
+          printf("iPerf3 client started on server %s\r\n", ip_str);
+      }
+
+      if (iperf_client_is_foreground_mode == true) {
+         /* Wait for the test and the results exchange */
+          err_code = wifi_event_bus_wait(&g_cli_events,
+                                         WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE),
+                                         (params->duration_sec + IPERF_UDP_REPORT_WAIT_SEC) * 1000,
+                                         NULL);
+
+          if (err_code == RTOS_ERR_TIMEOUT) {
+              LOG_DEBUG("Wait timeout!\r\n");
+          }
+
+         /* Reset to the default client mode */
+         iperf_client_is_foreground_mode = false;
+      }
+  } else {
+      printf("start iPerf3 client error\r\n");
+  }
+}
+
+/**************************************************************************//**
+ * @brief: Start a request/response latency benchmark.
+ *
+ * @param[in]
+ *         + ip_str: IP address string of the peer
+ *         + remote_port: Port of the peer
+ *         + udp: UDP transactions if true, TCP otherwise
+ *         + request_len: request length in bytes
+ *         + response_len: response length in bytes
+ *         + duration: duration in seconds
+ *         + is_foreground_mode: enable/disable foreground mode
+ *
+ * @param[out] None
+ *
+ * @return     None
+ *****************************************************************************/
+void rr_client(char *ip_str,
+               uint32_t remote_port,
+               bool udp,
+               uint16_t request_len,
+               uint16_t response_len,
+               uint32_t duration,
+               bool is_foreground_mode)
+{
+  int res;
+  ip_addr_t srv_addr;
+  RTOS_ERR_CODE err_code;
+
+  if (rr_client_session != NULL) {
+      printf("A client is running, stop it first\r\n");
+      return;
+  }
+
+  /* parse the peer IP address */
+  res = ipaddr_aton(ip_str, &srv_addr);
+  if (res == 0) {
+      /* Parsing error */
+      printf("Failed to parse the peer IP address\r\n");
+      return;
+  }
+
+  iperf_client_is_foreground_mode = is_foreground_mode;
+  if (is_foreground_mode) {
+      wifi_event_bus_arm(&g_cli_events, WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE));
+  }
+
+  rr_client_last_results_valid = false;
+
+  LOCK_TCPIP_CORE();
+  rr_client_session = lwiperf_rr_start_client(&srv_addr,
+                                              (u16_t)remote_port,
+                                              udp ? 1 : 0,
+                                              request_len,
+                                              response_len,
+                                              duration,
+                                              lwip_rr_results,
+                                              NULL);
+  UNLOCK_TCPIP_CORE();
+
+  if (rr_client_session != NULL) {
+
+      if (!iperf_client_is_quiet_mode) {
+          printf("%s RR benchmark started with %s\r\n", udp ? "UDP" : "TCP", ip_str);
+      }
+
+      if (iperf_client_is_foreground_mode == true) {
+         /* Wait for the test, with some margin for the last transaction */
+          err_code = wifi_event_bus_wait(&g_cli_events,
+                                         WIFI_EVENT_MASK(WIFI_EVENT_IPERF_DONE),
+                                         (duration + IPERF_UDP_REPORT_WAIT_SEC) * 1000,
+                                         NULL);
+
+          if (err_code == RTOS_ERR_TIMEOUT) {
+              LOG_DEBUG("Wait timeout!\r\n");
+          }
+
+         /* Reset to the default client mode */
+         iperf_client_is_foreground_mode = false;
+      }
+  } else {
+      printf("start RR benchmark error\r\n");
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Enable/disable the quiet mode of the iPerf3 and RR clients: the reports
+ *    are not displayed, the results are only kept for *_get_results().
+ *
+ * @param[in]
+ *    + quiet: true to enable the quiet mode
+ *
+ * @param[out] None
+ *
+ * @return  None
+ ******************************************************************************/
+void iperf_client_set_quiet_mode(bool quiet)
+{
+  iperf_client_is_quiet_mode = quiet;
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Get the results of the last iPerf3 client test.
+ *
+ * @param[in] None
+ *
+ * @param[out]
+ *    + results: results of the test, without the JSON strings
+ *
+ * @return
+ *    SL_STATUS_OK if the test completed
+ *    SL_STATUS_FAIL if it failed, was aborted or is still running
+ ******************************************************************************/
+sl_status_t iperf3_client_get_results(lwiperf3_results_t *results)
+{
+  if (!iperf3_client_last_results_valid || (iperf3_client_session != NULL)) {
+    return SL_STATUS_FAIL;
+  }
+  *results = iperf3_client_last_results;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *    Get the results of the last request/response benchmark.
+ *
+ * @param[in] None
+ *
+ * @param[out]
+ *    + results: results of the benchmark
+ *
+ * @return
+ *    SL_STATUS_OK if the benchmark completed
+ *    SL_STATUS_FAIL if it failed, was aborted or is still running
+ ******************************************************************************/
+sl_status_t rr_client_get_results(lwiperf_rr_results_t *results)
+{
+  if (!rr_client_last_results_valid || (rr_client_session != NULL)) {
+    return SL_STATUS_FAIL;
+  }
+  *results = rr_client_last_results;
+  return SL_STATUS_OK;
+}
+
 /***************************************************************************//**
  * @brief
  *    Stop iperf server mode
@@ -491,6 +1154,26 @@ void stop_iperf_server(void)
 
       iperf_server_session = NULL;
     }
+
+  if (iperf_udp_server_session != NULL) {
+      printf("Stop UDP server\r\n");
+
+      LOCK_TCPIP_CORE();
+      lwiperf_abort(iperf_udp_server_session);
+      UNLOCK_TCPIP_CORE();
+
+      iperf_udp_server_session = NULL;
+    }
+
+  if (iperf3_server_session != NULL) {
+      printf("Stop iPerf3 server\r\n");
+
+      LOCK_TCPIP_CORE();
+      lwiperf3_abort(iperf3_server_session);
+      UNLOCK_TCPIP_CORE();
+
+      iperf3_server_session = NULL;
+    }
 }
 
 /***************************************************************************//**
@@ -505,15 +1188,33 @@ void stop_iperf_server(void)
  ******************************************************************************/
 void stop_iperf_client(void)
 {
+  LOCK_TCPIP_CORE();
   if (iperf_client_session != NULL) {
       printf("Stop client\r\n");
-
-      LOCK_TCPIP_CORE();
+      /* Abort every stream of the client, its listener and the
+         connections back from the remote host */
       lwiperf_abort(iperf_client_session);
-      UNLOCK_TCPIP_CORE();
-
       iperf_client_session = NULL;
     }
+
+  if (iperf_udp_client_session != NULL) {
+      printf("Stop UDP client\r\n");
+      /* The report callback clears the session */
+      lwiperf_abort(iperf_udp_client_session);
+    }
+
+  if (iperf3_client_session != NULL) {
+      printf("Stop iPerf3 client\r\n");
+      /* The report callback clears the session */
+      lwiperf3_abort(iperf3_client_session);
+    }
+
+  if (rr_client_session != NULL) {
+      printf("Stop RR benchmark\r\n");
+      /* The report callback clears the session */
+      lwiperf_rr_abort(rr_client_session);
+    }
+  UNLOCK_TCPIP_CORE();
 }
 
 /***************************************************************************//**
@@ -619,6 +1320,9 @@ void lwip_init_start_task(void *p_arg)
   /* Initialize Wifi network interfaces */
   netif_config();
 
+  /* Share the TCP window and send buffer according to the memory usage */
+  tcp_autotune_start();
+
   /* Start DHCP Client*/
   if (use_dhcp_client) {
       dhcpclient_start();
@@ -29,21 +29,29 @@
 #include "lwip/inet_chksum.h"
 #include "lwip/ip.h"
 #include "lwiperf.h"
+#include "lwiperf3.h"
+#include "lwiperf_rr.h"
+#include "ping_engine.h"
 
 #define IPERF_DEFAULT_DURATION_SEC          10
 #define IPERF_DEFAULT_PORT                  5001
+#define IPERF_DEFAULT_UDP_BANDWIDTH         1000000     /*!< bits/s, iperf default */
+#define IPERF_UDP_REPORT_WAIT_SEC           4           /*!< time to get the server report */
+#define IPERF_MAX_INTERVAL_STREAMS          4           /*!< streams displaying interval reports */
 
-#define IPERF_CLIENT_MODE                   0
-#define IPERF_SERVER_MODE                   1
+/* The connections accepted by a server report with a NULL argument */
+#define IPERF_CLIENT_MODE                   1
+#define IPERF_SERVER_MODE                   2
+
+#define RR_DEFAULT_REQUEST_LEN              LWIPERF_RR_MIN_REQUEST_LEN
+#define RR_DEFAULT_RESPONSE_LEN             LWIPERF_RR_MIN_RESPONSE_LEN
 
 #define PING_DEFAULT_REQ_NB                 3
 #define PING_DEFAULT_INTERVAL_SEC           1
 #define PING_DEFAULT_RCV_TMO_SEC            1
 #define PING_DEFAULT_DATA_SIZE              32
-
-#ifndef PING_ID
-#define PING_ID                             0xAFAF      /*!< LSB = MSB */
-#endif
+#define PING_DEFAULT_WINDOW                 8           /*!< outstanding requests per target */
+#define PING_FLOOD_WINDOW                   1           /*!< one request at a time as ping -f */
 
 #ifdef __cplusplus
 extern "C" {
@@ -73,8 +81,7 @@ sl_status_t set_ap_link_down(void);
  * @brief: Implementation of ping command.
  *
  * @param[in]
- *         + req_num: Number of request messages (ICMP)
- *         + ip_str: Remote IP's address
+ *         + config: targets, number of requests, interval, sizes...
  *
  * @param[out]  None
  *
@@ -82,12 +89,15 @@ sl_status_t set_ap_link_down(void);
  *        SL_STATUS_OK if success
  *        SL_STATUS_FAIL if error
  *****************************************************************************/
-sl_status_t ping_cmd(uint32_t req_num, char *ip_str);
+sl_status_t ping_cmd(const ping_engine_config_t *config);
 
 /**************************************************************************//**
  * @brief: Start iperf server mode.
+ *
+ * @param[in]
+ *         + interval: report interval in seconds, 0 for the final report only
  *****************************************************************************/
-void iperf_server(void);
+void iperf_server(uint32_t interval);
 
 /**************************************************************************//**
  * @brief: Start iperf client mode.
@@ -96,6 +106,9 @@ void iperf_server(void);
  *         + ip_str: IP address string of remote iperf server
  *         + duration: duration in seconds
  *         + remote_port: Port of remote iperf server
+ *         + interval: report interval in seconds, 0 for the final report only
+ *         + streams: number of parallel streams
+ *         + type: unidirectional, dual or tradeoff test
  *         + is_foreground_mode: enable/disable foreground mode
  *
  * @param[out] None
@@ -105,8 +118,125 @@ void iperf_server(void);
 void iperf_client(char *ip_str,
                   uint32_t duration,
                   uint32_t remote_port,
+                  uint32_t interval,
+                  uint8_t streams,
+                  enum lwiperf_client_type type,
                   bool is_foreground_mode);
 
+/**************************************************************************//**
+ * @brief: Start iperf UDP server mode.
+ *
+ * @param[in]
+ *         + interval: report interval in seconds, 0 for the final report only
+ *****************************************************************************/
+void iperf_udp_server(uint32_t interval);
+
+/**************************************************************************//**
+ * @brief: Start iperf UDP client mode.
+ *
+ * @param[in]
+ *         + ip_str: IP address string of remote iperf server
+ *         + duration: duration in seconds
+ *         + remote_port: Port of remote iperf server
+ *         + bandwidth: target bandwidth in bits per second
+ *         + datagram_len: UDP payload length, 0 for the default one
+ *         + interval: report interval in seconds, 0 for the final report only
+ *         + is_foreground_mode: enable/disable foreground mode
+ *
+ * @param[out] None
+ *
+ * @return     None
+ *****************************************************************************/
+void iperf_udp_client(char *ip_str,
+                      uint32_t duration,
+                      uint32_t remote_port,
+                      uint32_t bandwidth,
+                      uint16_t datagram_len,
+                      uint32_t interval,
+                      bool is_foreground_mode);
+
+/**************************************************************************//**
+ * @brief: Start an iPerf3 server.
+ *
+ * @param[in]
+ *         + port: listening port of the control connection and the streams
+ *****************************************************************************/
+void iperf3_server(uint32_t port);
+
+/**************************************************************************//**
+ * @brief: Start an iPerf3 client test.
+ *
+ * @param[in]
+ *         + ip_str: IP address string of remote iperf3 server
+ *         + remote_port: Port of remote iperf3 server
+ *         + params: test parameters
+ *         + is_foreground_mode: enable/disable foreground mode
+ *
+ * @param[out] None
+ *
+ * @return     None
+ *****************************************************************************/
+void iperf3_client(char *ip_str,
+                   uint32_t remote_port,
+                   const lwiperf3_params_t *params,
+                   bool is_foreground_mode);
+
+/**************************************************************************//**
+ * @brief: Start a request/response latency benchmark.
+ *
+ * @param[in]
+ *         + ip_str: IP address string of the peer
+ *         + remote_port: Port of the peer
+ *         + udp: UDP transactions if true, TCP otherwise
+ *         + request_len: request length in bytes
+ *         + response_len: response length in bytes
+ *         + duration: duration in seconds
+ *         + is_foreground_mode: enable/disable foreground mode
+ *
+ * @param[out] None
+ *
+ * @return     None
+ *****************************************************************************/
+void rr_client(char *ip_str,
+               uint32_t remote_port,
+               bool udp,
+               uint16_t request_len,
+               uint16_t response_len,
+               uint32_t duration,
+               bool is_foreground_mode);
+
+/**************************************************************************//**
+ * @brief: Enable/disable the quiet mode of the iPerf3 and RR clients.
+ *
+ * @param[in]
+ *         + quiet: true to keep the results without displaying the reports
+ *****************************************************************************/
+void iperf_client_set_quiet_mode(bool quiet);
+
+/**************************************************************************//**
+ * @brief: Get the results of the last iPerf3 client test.
+ *
+ * @param[out]
+ *         + results: results of the test, without the JSON strings
+ *
+ * @return
+ *        SL_STATUS_OK if the test completed
+ *        SL_STATUS_FAIL otherwise
+ *****************************************************************************/
+sl_status_t iperf3_client_get_results(lwiperf3_results_t *results);
+
+/**************************************************************************//**
+ * @brief: Get the results of the last request/response benchmark.
+ *
+ * @param[out]
+ *         + results: results of the benchmark
+ *
+ * @return
+ *        SL_STATUS_OK if the benchmark completed
+ *        SL_STATUS_FAIL otherwise
+ *****************************************************************************/
+sl_status_t rr_client_get_results(lwiperf_rr_results_t *results);
+
 /**************************************************************************//**
  * @brief: Stop iperf server mode.
  *****************************************************************************/
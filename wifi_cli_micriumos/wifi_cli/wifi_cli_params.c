@@ -43,8 +43,8 @@ static void wfx_cli_params_task(void *p_arg);
 /* global wifi context */
 extern sl_wfx_context_t   wifi;
 
-/* User-defined sem type is used to force CLI to wait */
-sem_type_t g_cli_sem;
+/* Wi-Fi events awaited by the CLI commands */
+wifi_event_subscriber_t g_cli_events;
 /* rx_stats */
 sl_wfx_rx_stats_t rx_stats;
 
@@ -118,6 +118,7 @@ char wlan_passkey[64 + 1]                   = WLAN_PASSKEY_DEFAULT;
 sl_wfx_security_mode_t wlan_security        = WLAN_SECURITY_DEFAULT;
 bool wlan_security_wpa3_pmksa               = false;
 char wlan_pmk[64 + 3]                       = "0";
+wlan_tx_params_t wlan_tx_params             = { 0 };
 
 /* Wi-Fi SoftAP connection parameters */
 char softap_ssid[32 + 1]                    = SOFTAP_SSID_DEFAULT;
@@ -125,6 +126,9 @@ char softap_passkey[64 + 1]                 = SOFTAP_PASSKEY_DEFAULT;
 sl_wfx_security_mode_t softap_security      = SOFTAP_SECURITY_DEFAULT;
 char softap_pmk[64 + 3]                     = "0";
 uint8_t softap_channel                      = SOFTAP_CHANNEL_DEFAULT;
+uint8_t ap_dhcp_pool_start                  = AP_DHCP_POOL_START_DEFAULT;
+uint8_t ap_dhcp_pool_end                    = AP_DHCP_POOL_END_DEFAULT;
+uint32_t ap_dhcp_lease_time                 = AP_DHCP_LEASE_TIME_DEFAULT;
 sl_wfx_mac_address_t client_mac_address     = { { 0, 0, 0, 0, 0, 0 } };
 
 /* Memory to store WiFi scan results from web server */
@@ -292,135 +296,6 @@ void *wifi_cli_get_param_addr(char *param_name)
   return NULL;
 }
 
-/***************************************************************************//**
- * @brief
- *    Initializes CLI's event-based binary semaphore.
- *
- * @param[in]
- *    + p_cli_sem:  Pointer to CLI's semaphore
- *
- * @param[out] None
- *
- * @return  None
- ******************************************************************************/
-void wifi_cli_sem_init(sem_type_t *p_cli_sem, RTOS_ERR *err)
-{
-  if (p_cli_sem == NULL) {
-      err->Code = RTOS_ERR_FAIL;
-      return;
-  }
-
-  /* Initially, set CLI's state to free */
-  p_cli_sem->cli_state = FREE_CLI;
-
-  /* CLI's binary semaphore initialization */
-  OSSemCreate(&(p_cli_sem->cli_sem),
-              "cli_sem",
-              0,    /*!< Initial counter is 0 */
-              err);
-}
-
-/***************************************************************************//**
- * @brief
- *    This function forces CLI to wait for an event with given timeout in ms
- *
- * @param[in]
- *    + p_cli_sem: Pointer to initialized CLI's binary semaphore
- *    + sem_evet_type: The waiting event
- *    + timeoutms: timeout in milliseconds
- *
- * @param[out] None
- *
- * @return
- *    RTOS_ERR_CODE
- *
- * @note: This function is called by CLI task
- ******************************************************************************/
-RTOS_ERR_CODE wifi_cli_wait(sem_type_t *p_cli_sem,
-                            sl_wfx_indications_ids_t sem_event_type,
-                            uint32_t timeoutms)
-{
-  RTOS_ERR err;
-  OS_TICK tmo_ticks; /*!< Timeout in OS ticks */
-
-  err.Code = RTOS_ERR_NONE;
-  /* Convert timeout in ms to OS ticks */
-  tmo_ticks = (OS_TICK)(((uint64_t)timeoutms * OSCfg_TickRate_Hz) / 1000);
-
-  if ((p_cli_sem == NULL) || (p_cli_sem->cli_state == PENDING_CLI)) {
-      LOG_DEBUG("CLI's semaphore has not been initialized "
-             "or being used by other\r\n");
-      return RTOS_ERR_FAIL;
-  }
-  /* If CLI's state is free, forces CLI to wait & set state to PENDING_CLI */
-  if (p_cli_sem->cli_state == FREE_CLI) {
-
-      p_cli_sem->cli_state = PENDING_CLI;
-      p_cli_sem->event_type = sem_event_type; /*!< specific waiting event */
-
-      /* Block to wait for a confirmation with timeout */
-      OSSemPend(&(p_cli_sem->cli_sem),
-                tmo_ticks,
-                OS_OPT_PEND_BLOCKING,
-                NULL,
-                &err);
-  }
-  /* After waiting or timeout or already posted by another task */
-  p_cli_sem->cli_state = FREE_CLI;
-  return err.Code;
-}
-
-/***************************************************************************//**
- * @brief
- *    This function releases CLI's event-based binary semaphore
- *
- * @param[in]
- *    + p_cli_sem: Pointer to initialized CLI's binary semaphore
- *    + sem_evet_type: The waiting event
- *
- * @param[out] None
- *
- * @return
- *    0 if success
- *    -1 if failed
- ******************************************************************************/
-int wifi_cli_resume(sem_type_t *p_cli_sem,
-                    sl_wfx_indications_ids_t sem_event_type)
-{
-  RTOS_ERR err;
-
-  if (p_cli_sem == NULL) {
-      LOG_DEBUG("CLI's binary semaphore has not been initialized!\r\n");
-      return -1;
-  }
-
-  if ((p_cli_sem->cli_state == PENDING_CLI) &&
-      (p_cli_sem->event_type == sem_event_type)) {
-
-      /* Release CLI's semaphore */
-      OSSemPost(&(p_cli_sem->cli_sem),
-                OS_OPT_POST_ALL,
-                &err);
-
-      if (err.Code != RTOS_ERR_NONE) {
-          LOG_DEBUG("Failed to release CLI's semaphore\r\n");
-          return -1;
-      }
-
-  } else if (p_cli_sem->cli_state == FREE_CLI) {
-      /**
-       * Another task has finished this job before CLI task.
-       * @note CLI does not need to block to wait for this event anymore.
-       * */
-      p_cli_sem->cli_state = POSTED_CLI;
-
-  } else {
-      LOG_DEBUG("Cannot post/release CLI's semaphore without using tasks\r\n");
-      return -1;
-  }
-  return 0;
-}
-
 /***************************************************************************//**
  * @brief
  *    This callback function gets (displays) the string type parameter in the
@@ -1155,6 +1030,38 @@ int register_wifi_params(void)
                                         SL_WFX_CLI_PARAM_GET_RIGHT | \
                                         SL_WFX_CLI_PARAM_SET_RIGHT);
 
+  /* Add softap DHCP server address pool to global params struct */
+  ret |= sl_wfx_cli_register_wifi_param("softap.dhcp_pool_start",
+                                        (void *)&ap_dhcp_pool_start,
+                                        "SoftAP DHCP pool first address, last octet (decimal)",
+                                        NULL,
+                                        NULL,
+                                        SL_WFX_CLI_PARAM_TYPE_UNSIGNED_INTEGER,
+                                        sizeof(ap_dhcp_pool_start),
+                                        SL_WFX_CLI_PARAM_GET_RIGHT | \
+                                        SL_WFX_CLI_PARAM_SET_RIGHT);
+
+  ret |= sl_wfx_cli_register_wifi_param("softap.dhcp_pool_end",
+                                        (void *)&ap_dhcp_pool_end,
+                                        "SoftAP DHCP pool last address, last octet (decimal)",
+                                        NULL,
+                                        NULL,
+                                        SL_WFX_CLI_PARAM_TYPE_UNSIGNED_INTEGER,
+                                        sizeof(ap_dhcp_pool_end),
+                                        SL_WFX_CLI_PARAM_GET_RIGHT | \
+                                        SL_WFX_CLI_PARAM_SET_RIGHT);
+
+  /* Add softap DHCP server lease time to global params struct */
+  ret |= sl_wfx_cli_register_wifi_param("softap.dhcp_lease_time",
+                                        (void *)&ap_dhcp_lease_time,
+                                        "SoftAP DHCP lease time in seconds (decimal)",
+                                        NULL,
+                                        NULL,
+                                        SL_WFX_CLI_PARAM_TYPE_UNSIGNED_INTEGER,
+                                        sizeof(ap_dhcp_lease_time),
+                                        SL_WFX_CLI_PARAM_GET_RIGHT | \
+                                        SL_WFX_CLI_PARAM_SET_RIGHT);
+
   /* Add softap network interface to global params struct */
   ret |= sl_wfx_cli_register_wifi_param("softap.netmask",
                                         (void *)&ap_netif,
@@ -1241,6 +1148,11 @@ int register_wifi_params(void)
                 (void *)&wlan_security_wpa3_pmksa,
                 sizeof(wlan_security_wpa3_pmksa));
 
+  nvm3_readData(nvm3_defaultHandle,
+                NVM3_KEY_STA_TX_PARAMS,
+                (void *)&wlan_tx_params,
+                sizeof(wlan_tx_params));
+
   return ret;
 }
 
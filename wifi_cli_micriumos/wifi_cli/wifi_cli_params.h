@@ -24,6 +24,7 @@
 #include "lwip/ip_addr.h"
 #include "nvm3_default.h"
 #include "sl_wfx_constants.h"
+#include "wifi_event_bus.h"
 
 #if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
 #error "Power Save must be enabled through the CLI not the Power manager component"
@@ -114,6 +115,18 @@
 #ifndef NVM3_KEY_AP_SECURITY_WPA3_PMKSA
 #define NVM3_KEY_AP_SECURITY_WPA3_PMKSA 4
 #endif
+#ifndef NVM3_KEY_DHCPS_LEASES
+#define NVM3_KEY_DHCPS_LEASES 5
+#endif
+#ifndef NVM3_KEY_DHCPC_LEASE
+#define NVM3_KEY_DHCPC_LEASE 6
+#endif
+#ifndef NVM3_KEY_STA_LAST_AP
+#define NVM3_KEY_STA_LAST_AP 7
+#endif
+#ifndef NVM3_KEY_STA_TX_PARAMS
+#define NVM3_KEY_STA_TX_PARAMS 8
+#endif
 #define IPERF_SERVER                    ///< If defined, iperf server is enabled
 #define HTTP_SERVER                     ///< If defined, http server is enabled
 
@@ -132,6 +145,9 @@
  * */
 #define SOFTAP_SECURITY_DEFAULT WFM_SECURITY_MODE_WPA2_PSK
 #define SOFTAP_CHANNEL_DEFAULT  6                  ///< wifi channel for soft ap
+#define AP_DHCP_POOL_START_DEFAULT  (uint8_t) 2    ///< DHCP server: last octet of the first address
+#define AP_DHCP_POOL_END_DEFAULT    (uint8_t) 33   ///< DHCP server: last octet of the last address
+#define AP_DHCP_LEASE_TIME_DEFAULT  86400          ///< DHCP server: lease time (seconds)
 
 extern char wlan_ssid[32 + 1];
 extern char wlan_passkey[64 + 1];
@@ -143,6 +159,9 @@ extern char softap_ssid[32 + 1];
 extern char softap_passkey[64 + 1];
 extern char softap_pmk[64 + 3];
 extern uint8_t softap_channel;
+extern uint8_t ap_dhcp_pool_start;
+extern uint8_t ap_dhcp_pool_end;
+extern uint32_t ap_dhcp_lease_time;
 extern sl_wfx_security_mode_t softap_security;
 
 extern uint8_t sta_ip_addr0;
@@ -211,6 +230,17 @@ typedef union {
     uint32_t rate;
 } tx_rates_u;
 
+/**************************************************************************//**
+ * @brief: station TX parameters, applied at each connection once set
+ *****************************************************************************/
+typedef struct {
+    uint32_t rates;     ///< sl_wfx_rate_set_bitmask_t as 32 bits
+    uint8_t rate_algo;  ///< 0: AARF, 1: Minstrel
+    bool set;           ///< false: keep the firmware defaults
+} wlan_tx_params_t;
+
+extern wlan_tx_params_t wlan_tx_params;
+
 /**************************************************************************//**
  * @brief: get/set function pointers.
  *****************************************************************************/
@@ -256,27 +286,10 @@ typedef struct param_s {
 } param_t;
 
 /**************************************************************************//**
- * @brief: Wi-Fi CLI's states type
- *****************************************************************************/
-typedef enum cli_state_s {
-  POSTED_CLI, /*!< Another task has done the job, CLI doesn't need to wait */
-  FREE_CLI,   /*!< CLI is free & ready for wait */
-  PENDING_CLI /*!< CLI is being blocked to wait */
-} cli_state_e;
-
-/**************************************************************************//**
- * @brief: Wi-Fi CLI's event-based semaphore type
+ * @brief: Wi-Fi CLI's subscriber of the Wi-Fi events bus, armed by the
+ *         commands before sending their request and waited for its event
  *****************************************************************************/
-typedef struct sem_type_s {
-  sl_wfx_indications_ids_t event_type;
-  OS_SEM cli_sem;           /*!< Binary semaphore */
-  cli_state_e cli_state;    /*!< Wi-Fi CLI's current states */
-} sem_type_t;
-
-/**************************************************************************//**
- * @brief: Wi-Fi CLI's semaphore instance used for blocking to wait for events
- *****************************************************************************/
-extern sem_type_t g_cli_sem;
+extern wifi_event_subscriber_t g_cli_events;
 
 /**************************************************************************//**
  * @brief: Wi-Fi CLI's the global wifi param instance used for managing all
@@ -337,24 +350,6 @@ int convert_mac_key_string_to_array(char *mackey_str,
                                     uint8_t *mackey_arr,
                                     uint8_t arrLen);
 
-/**************************************************************************//**
- * @brief: Wi-Fi CLI's event-based semaphore initialization
- *****************************************************************************/
-void wifi_cli_sem_init(sem_type_t *p_cli_sem, RTOS_ERR *err);
-
-/**************************************************************************//**
- * @brief: Block Wi-Fi CLI wait for desired events with timeout in ms
- *****************************************************************************/
-RTOS_ERR_CODE wifi_cli_wait(sem_type_t *p_cli_sem,
-                            sl_wfx_indications_ids_t sem_event_type,
-                            uint32_t timeoutms);
-
-/**************************************************************************//**
- * @brief: Release (post) Wi-Fi CLI's semaphore
- *****************************************************************************/
-int wifi_cli_resume(sem_type_t *p_cli_sem,
-                    sl_wfx_indications_ids_t sem_event_type);
-
 /**************************************************************************//**
  * @brief: Registering Wi-Fi's get/set parameters to the wifi_param array
  *****************************************************************************/
@@ -0,0 +1,248 @@
+/***************************************************************************//**
+ * @file
+ * @brief Duration of the phases of the station connections
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * The steps are marked from the CLI task (scans, join), the Wi-Fi events
+ * task (SAE, connect indication, link up) and the lwIP thread (address).
+ * The association and the 4-way handshake run in the WFx firmware, which
+ * only reports their end: they are timed as one phase, the SAE exchange
+ * driven by the host being taken out of it.
+ ******************************************************************************/
+#include <string.h>
+#include <kernel/include/os.h>
+#include "lwip/sys.h"
+#include "wifi_conn_timing.h"
+
+/// Connection being timed.
+typedef struct {
+  bool active;
+  uint32_t start_ms;
+  uint32_t scan_ms;             ///< Scans, summed
+  bool scan_open;               ///< Scan started, not completed yet
+  uint16_t marked;              ///< Bit per step marked
+  uint32_t mark_ms[WIFI_CONN_STAGE_NB];
+} wifi_conn_timing_state_t;
+
+static const char *const wifi_conn_phase_names[WIFI_CONN_PHASE_NB] = {
+  [WIFI_CONN_PHASE_SCAN]    = "scan",
+  [WIFI_CONN_PHASE_SAE]     = "sae",
+  [WIFI_CONN_PHASE_ASSOC]   = "assoc_4way",
+  [WIFI_CONN_PHASE_LINK_UP] = "link_up",
+  [WIFI_CONN_PHASE_DHCP]    = "dhcp",
+  [WIFI_CONN_PHASE_TOTAL]   = "total",
+};
+
+static wifi_conn_timing_state_t conn;
+static wifi_conn_timing_record_t conn_history[WIFI_CONN_TIMING_DEPTH];
+static uint16_t conn_head;
+static uint16_t conn_count;
+
+/***************************************************************************//**
+ * Tell whether two steps are marked, the second one not before the first.
+ ******************************************************************************/
+static bool wifi_conn_timing_span(wifi_conn_stage_t from, wifi_conn_stage_t to, uint32_t *ms)
+{
+  if (!(conn.marked & (1u << from)) || !(conn.marked & (1u << to))) {
+    return false;
+  }
+  *ms = conn.mark_ms[to] - conn.mark_ms[from];
+  /* A step of a failed join attempt, older than the next one */
+  return (*ms < 0x80000000u);
+}
+
+/***************************************************************************//**
+ * Start timing a connection.
+ ******************************************************************************/
+void wifi_conn_timing_begin(void)
+{
+  uint32_t now_ms = sys_now();
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  memset(&conn, 0, sizeof(conn));
+  conn.active = true;
+  conn.start_ms = now_ms;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Record a step of the connection being timed.
+ ******************************************************************************/
+void wifi_conn_timing_mark(wifi_conn_stage_t stage)
+{
+  uint32_t now_ms = sys_now();
+  CPU_SR_ALLOC();
+
+  if (stage >= WIFI_CONN_STAGE_NB) {
+    return;
+  }
+  CPU_CRITICAL_ENTER();
+  if (conn.active) {
+    /* A scan retried after a timeout is counted up to the retry */
+    if (((stage == WIFI_CONN_STAGE_SCAN_START) || (stage == WIFI_CONN_STAGE_SCAN_END))
+        && conn.scan_open) {
+      conn.scan_ms += now_ms - conn.mark_ms[WIFI_CONN_STAGE_SCAN_START];
+      conn.scan_open = false;
+    }
+    if (stage == WIFI_CONN_STAGE_SCAN_START) {
+      conn.scan_open = true;
+    }
+    /* The last occurrence, of the join attempt that succeeds */
+    conn.mark_ms[stage] = now_ms;
+    conn.marked |= (uint16_t)(1u << stage);
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Complete the connection being timed.
+ ******************************************************************************/
+void wifi_conn_timing_end(void)
+{
+  wifi_conn_timing_record_t record;
+  uint32_t now_ms = sys_now();
+  uint32_t ms;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if (!conn.active) {
+    CPU_CRITICAL_EXIT();
+    return;
+  }
+  conn.active = false;
+
+  memset(&record, 0, sizeof(record));
+  if (conn.marked & (1u << WIFI_CONN_STAGE_SCAN_START)) {
+    record.ms[WIFI_CONN_PHASE_SCAN] = conn.scan_ms;
+    record.valid |= 1u << WIFI_CONN_PHASE_SCAN;
+  }
+  if (wifi_conn_timing_span(WIFI_CONN_STAGE_SAE_COMMIT, WIFI_CONN_STAGE_SAE_CONFIRM, &ms)) {
+    record.ms[WIFI_CONN_PHASE_SAE] = ms;
+    record.valid |= 1u << WIFI_CONN_PHASE_SAE;
+  }
+  if (wifi_conn_timing_span(WIFI_CONN_STAGE_JOIN, WIFI_CONN_STAGE_CONNECTED, &ms)) {
+    if ((record.valid & (1u << WIFI_CONN_PHASE_SAE)) && (ms >= record.ms[WIFI_CONN_PHASE_SAE])) {
+      ms -= record.ms[WIFI_CONN_PHASE_SAE];
+    }
+    record.ms[WIFI_CONN_PHASE_ASSOC] = ms;
+    record.valid |= 1u << WIFI_CONN_PHASE_ASSOC;
+  }
+  if (wifi_conn_timing_span(WIFI_CONN_STAGE_CONNECTED, WIFI_CONN_STAGE_LINK_UP, &ms)) {
+    record.ms[WIFI_CONN_PHASE_LINK_UP] = ms;
+    record.valid |= 1u << WIFI_CONN_PHASE_LINK_UP;
+  }
+  if (wifi_conn_timing_span(WIFI_CONN_STAGE_LINK_UP, WIFI_CONN_STAGE_DHCP_BOUND, &ms)) {
+    record.ms[WIFI_CONN_PHASE_DHCP] = ms;
+    record.valid |= 1u << WIFI_CONN_PHASE_DHCP;
+  }
+  record.ms[WIFI_CONN_PHASE_TOTAL] = now_ms - conn.start_ms;
+  record.valid |= 1u << WIFI_CONN_PHASE_TOTAL;
+
+  if (conn_count < WIFI_CONN_TIMING_DEPTH) {
+    conn_history[(conn_head + conn_count) % WIFI_CONN_TIMING_DEPTH] = record;
+    conn_count++;
+  } else {
+    conn_history[conn_head] = record;
+    conn_head = (conn_head + 1) % WIFI_CONN_TIMING_DEPTH;
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Get a connection of the history, the oldest first.
+ ******************************************************************************/
+bool wifi_conn_timing_get(uint16_t index, wifi_conn_timing_record_t *record)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if (index >= conn_count) {
+    CPU_CRITICAL_EXIT();
+    return false;
+  }
+  *record = conn_history[(conn_head + index) % WIFI_CONN_TIMING_DEPTH];
+  CPU_CRITICAL_EXIT();
+  return true;
+}
+
+/***************************************************************************//**
+ * Compute the distribution of a phase over the history, the percentiles
+ * being the nearest rank ones.
+ ******************************************************************************/
+void wifi_conn_timing_summary(wifi_conn_phase_t phase, wifi_conn_timing_summary_t *summary)
+{
+  wifi_conn_timing_record_t record;
+  uint32_t sorted[WIFI_CONN_TIMING_DEPTH];
+  uint64_t total_ms = 0;
+  uint32_t ms;
+  uint16_t nb = 0;
+  uint16_t index;
+  uint16_t i;
+
+  memset(summary, 0, sizeof(*summary));
+  if (phase >= WIFI_CONN_PHASE_NB) {
+    return;
+  }
+
+  /* Insertion sort of the durations, a few dozens at most */
+  for (index = 0; wifi_conn_timing_get(index, &record) && (nb < WIFI_CONN_TIMING_DEPTH); index++) {
+    if (!(record.valid & (1u << phase))) {
+      continue;
+    }
+    ms = record.ms[phase];
+    total_ms += ms;
+    for (i = nb; (i > 0) && (sorted[i - 1] > ms); i--) {
+      sorted[i] = sorted[i - 1];
+    }
+    sorted[i] = ms;
+    nb++;
+  }
+
+  summary->count = nb;
+  if (nb == 0) {
+    return;
+  }
+  summary->min_ms = sorted[0];
+  summary->avg_ms = (uint32_t)(total_ms / nb);
+  summary->p50_ms = sorted[((nb * 50) + 99) / 100 - 1];
+  summary->p90_ms = sorted[((nb * 90) + 99) / 100 - 1];
+  summary->max_ms = sorted[nb - 1];
+}
+
+/***************************************************************************//**
+ * Clear the history.
+ ******************************************************************************/
+void wifi_conn_timing_reset(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  conn_head = 0;
+  conn_count = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Get the name of a phase.
+ ******************************************************************************/
+const char *wifi_conn_timing_phase_name(wifi_conn_phase_t phase)
+{
+  return (phase < WIFI_CONN_PHASE_NB) ? wifi_conn_phase_names[phase] : "";
+}
@@ -0,0 +1,113 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef WIFI_CONN_TIMING_H
+#define WIFI_CONN_TIMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WIFI_CONN_TIMING_DEPTH        32    ///< Connections kept, the oldest overwritten
+
+/// Steps of a station connection, in their order.
+typedef enum {
+  WIFI_CONN_STAGE_SCAN_START = 0, ///< Scan for the AP sent
+  WIFI_CONN_STAGE_SCAN_END,       ///< Scan for the AP completed
+  WIFI_CONN_STAGE_JOIN,           ///< Join request sent
+  WIFI_CONN_STAGE_SAE_COMMIT,     ///< SAE commit sent
+  WIFI_CONN_STAGE_SAE_CONFIRM,    ///< SAE confirm of the AP checked
+  WIFI_CONN_STAGE_CONNECTED,      ///< Connect indication
+  WIFI_CONN_STAGE_LINK_UP,        ///< Station netif link up
+  WIFI_CONN_STAGE_DHCP_BOUND,     ///< Address leased, or the static one used
+  WIFI_CONN_STAGE_NB
+} wifi_conn_stage_t;
+
+/// Phases of a connection, between two steps.
+typedef enum {
+  WIFI_CONN_PHASE_SCAN = 0,       ///< Scans, summed
+  WIFI_CONN_PHASE_SAE,            ///< SAE commit to confirm
+  WIFI_CONN_PHASE_ASSOC,          ///< Join to connect indication, SAE excluded
+  WIFI_CONN_PHASE_LINK_UP,        ///< Connect indication to link up
+  WIFI_CONN_PHASE_DHCP,           ///< Link up to address
+  WIFI_CONN_PHASE_TOTAL,          ///< Connection start to address
+  WIFI_CONN_PHASE_NB
+} wifi_conn_phase_t;
+
+/// Phase durations of a connection.
+typedef struct {
+  uint32_t ms[WIFI_CONN_PHASE_NB];
+  uint8_t valid;                  ///< Bit per phase gone through
+} wifi_conn_timing_record_t;
+
+/// Distribution of a phase duration over the history.
+typedef struct {
+  uint16_t count;                 ///< Connections going through the phase
+  uint32_t min_ms;
+  uint32_t avg_ms;
+  uint32_t p50_ms;
+  uint32_t p90_ms;
+  uint32_t max_ms;
+} wifi_conn_timing_summary_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Start timing a connection, the steps of the previous one being dropped if
+ * it did not complete.
+ ******************************************************************************/
+void wifi_conn_timing_begin(void);
+
+/***************************************************************************//**
+ * Record a step of the connection being timed. Ignored out of a connection.
+ ******************************************************************************/
+void wifi_conn_timing_mark(wifi_conn_stage_t stage);
+
+/***************************************************************************//**
+ * Complete the connection being timed and add its phases to the history.
+ ******************************************************************************/
+void wifi_conn_timing_end(void);
+
+/***************************************************************************//**
+ * Get a connection of the history.
+ *
+ * @param index 0 for the oldest connection
+ * @param record copy of the connection phases
+ * @returns false if there is no such connection
+ ******************************************************************************/
+bool wifi_conn_timing_get(uint16_t index, wifi_conn_timing_record_t *record);
+
+/***************************************************************************//**
+ * Compute the distribution of a phase over the history.
+ ******************************************************************************/
+void wifi_conn_timing_summary(wifi_conn_phase_t phase, wifi_conn_timing_summary_t *summary);
+
+/***************************************************************************//**
+ * Clear the history.
+ ******************************************************************************/
+void wifi_conn_timing_reset(void);
+
+/***************************************************************************//**
+ * Get the name of a phase.
+ ******************************************************************************/
+const char *wifi_conn_timing_phase_name(wifi_conn_phase_t phase);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,301 @@
+/***************************************************************************//**
+ * @file
+ * @brief Publish/subscribe bus of the Wi-Fi events
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * Each subscriber has its own filter, event queue and counting semaphore.
+ * An event is queued as soon as it is published if the subscriber filters
+ * it, whether the subscriber already waits or not: arming the filter before
+ * sending a request is enough to not lose its indication. The semaphore
+ * counts the events queued, a wait finding the queue empty (events dropped by
+ * a new arming) simply pends again.
+ *
+ * The WFx indications do not tell which task sent the request. The requests
+ * are serialized by a mutex and the events answering the request in progress
+ * are stamped with its owner, for another subscriber arming the same events
+ * to not complete its wait on them.
+ ******************************************************************************/
+#include <string.h>
+#include "latency_trace.h"
+#include "wifi_event_bus.h"
+
+static const char *const wifi_event_names[WIFI_EVENT_NB] = {
+  [WIFI_EVENT_CONNECT]       = "connect",
+  [WIFI_EVENT_DISCONNECT]    = "disconnect",
+  [WIFI_EVENT_START_AP]      = "start_ap",
+  [WIFI_EVENT_STOP_AP]       = "stop_ap",
+  [WIFI_EVENT_SCAN_COMPLETE] = "scan_complete",
+  [WIFI_EVENT_IPERF_DONE]    = "iperf_done",
+  [WIFI_EVENT_IP_BOUND]      = "ip_bound",
+};
+
+static wifi_event_subscriber_t *subscribers[WIFI_EVENT_BUS_SUBSCRIBER_MAX];
+static uint8_t subscriber_nb;
+/// Request in progress, held by its owner.
+static OS_MUTEX request_mutex;
+static wifi_event_subscriber_t *request_owner;
+static wifi_event_mask_t request_mask;
+
+/***************************************************************************//**
+ * Record the wake-up latency of an event.
+ ******************************************************************************/
+static void wifi_event_bus_record_latency(wifi_event_subscriber_t *sub,
+                                          const wifi_event_t *event)
+{
+  wifi_event_latency_t *latency = &sub->latency;
+  uint32_t latency_us;
+
+  latency_us = latency_trace_cycles_to_us(latency_trace_timestamp() - event->timestamp);
+  if ((latency->wakeups == 0) || (latency_us < latency->min_us)) {
+    latency->min_us = latency_us;
+  }
+  if (latency_us > latency->max_us) {
+    latency->max_us = latency_us;
+  }
+  latency->wakeups++;
+  latency->last_us = latency_us;
+  latency->total_us += latency_us;
+}
+
+/***************************************************************************//**
+ * Initialize the bus.
+ ******************************************************************************/
+void wifi_event_bus_init(void)
+{
+  RTOS_ERR err;
+
+  OSMutexCreate(&request_mutex, "wifi event request", &err);
+  request_owner = NULL;
+  request_mask = 0;
+}
+
+/***************************************************************************//**
+ * Register a subscriber.
+ ******************************************************************************/
+int wifi_event_bus_subscribe(wifi_event_subscriber_t *sub, const char *name)
+{
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  memset(sub, 0, sizeof(*sub));
+  sub->name = name;
+  OSSemCreate(&sub->sem, (CPU_CHAR *)name, 0, &err);
+  if (RTOS_ERR_CODE_GET(err) != RTOS_ERR_NONE) {
+    return -1;
+  }
+
+  CPU_CRITICAL_ENTER();
+  if (subscriber_nb == WIFI_EVENT_BUS_SUBSCRIBER_MAX) {
+    CPU_CRITICAL_EXIT();
+    OSSemDel(&sub->sem, OS_OPT_DEL_ALWAYS, &err);
+    return -1;
+  }
+  subscribers[subscriber_nb++] = sub;
+  CPU_CRITICAL_EXIT();
+  return 0;
+}
+
+/***************************************************************************//**
+ * Set the filter of a subscriber and drop its queued events.
+ ******************************************************************************/
+void wifi_event_bus_arm(wifi_event_subscriber_t *sub, wifi_event_mask_t filter)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  sub->filter = filter;
+  sub->head = 0;
+  sub->count = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Start a request of a subscriber, the events answering it owned by it.
+ ******************************************************************************/
+void wifi_event_bus_request_begin(wifi_event_subscriber_t *sub, wifi_event_mask_t mask)
+{
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  /* Bounded by the request timeouts of the owner */
+  OSMutexPend(&request_mutex, 0, OS_OPT_PEND_BLOCKING, NULL, &err);
+  CPU_CRITICAL_ENTER();
+  request_owner = sub;
+  request_mask = mask;
+  sub->filter = mask;
+  sub->head = 0;
+  sub->count = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * End the request of a subscriber.
+ ******************************************************************************/
+void wifi_event_bus_request_end(wifi_event_subscriber_t *sub)
+{
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if (request_owner != sub) {
+    CPU_CRITICAL_EXIT();
+    return;
+  }
+  request_owner = NULL;
+  request_mask = 0;
+  CPU_CRITICAL_EXIT();
+  OSMutexPost(&request_mutex, OS_OPT_POST_NONE, &err);
+}
+
+/***************************************************************************//**
+ * Wait for an event of a mask.
+ ******************************************************************************/
+RTOS_ERR_CODE wifi_event_bus_wait(wifi_event_subscriber_t *sub,
+                                  wifi_event_mask_t mask,
+                                  uint32_t timeout_ms,
+                                  wifi_event_t *event)
+{
+  wifi_event_t queued;
+  OS_TICK tmo_ticks;
+  OS_TICK start;
+  OS_TICK elapsed;
+  bool found = false;
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  tmo_ticks = (OS_TICK)(((uint64_t)timeout_ms * OSCfg_TickRate_Hz) / 1000);
+  if ((timeout_ms != 0) && (tmo_ticks == 0)) {
+    tmo_ticks = 1;
+  }
+  start = OSTimeGet(&err);
+
+  while (1) {
+    CPU_CRITICAL_ENTER();
+    while ((sub->count > 0) && !found) {
+      queued = sub->queue[sub->head];
+      sub->head = (sub->head + 1) % WIFI_EVENT_BUS_QUEUE_SIZE;
+      sub->count--;
+      found = ((WIFI_EVENT_MASK(queued.id) & mask) != 0)
+              && ((queued.owner == NULL) || (queued.owner == sub));
+    }
+    CPU_CRITICAL_EXIT();
+
+    if (found) {
+      wifi_event_bus_record_latency(sub, &queued);
+      if (event != NULL) {
+        *event = queued;
+      }
+      return RTOS_ERR_NONE;
+    }
+
+    elapsed = 0;
+    if (tmo_ticks != 0) {
+      elapsed = OSTimeGet(&err) - start;
+      if (elapsed >= tmo_ticks) {
+        return RTOS_ERR_TIMEOUT;
+      }
+    }
+    OSSemPend(&sub->sem,
+              (tmo_ticks != 0) ? (tmo_ticks - elapsed) : 0,
+              OS_OPT_PEND_BLOCKING,
+              NULL,
+              &err);
+    if (RTOS_ERR_CODE_GET(err) != RTOS_ERR_NONE) {
+      return RTOS_ERR_CODE_GET(err);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Publish an event to the subscribers.
+ ******************************************************************************/
+void wifi_event_bus_publish(wifi_event_id_t id, uint32_t status, uint32_t timestamp)
+{
+  wifi_event_subscriber_t *sub;
+  wifi_event_t event = { id, status, timestamp, NULL };
+  bool queued;
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if (request_mask & WIFI_EVENT_MASK(id)) {
+    event.owner = request_owner;
+  }
+  CPU_CRITICAL_EXIT();
+
+  for (uint8_t i = 0; i < subscriber_nb; i++) {
+    sub = subscribers[i];
+    queued = false;
+
+    CPU_CRITICAL_ENTER();
+    if (sub->filter & WIFI_EVENT_MASK(id)) {
+      if (sub->count < WIFI_EVENT_BUS_QUEUE_SIZE) {
+        sub->queue[(sub->head + sub->count) % WIFI_EVENT_BUS_QUEUE_SIZE] = event;
+        sub->count++;
+        queued = true;
+      } else {
+        sub->dropped++;
+      }
+    }
+    CPU_CRITICAL_EXIT();
+
+    if (queued) {
+      OSSemPost(&sub->sem, OS_OPT_POST_1, &err);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Get the name of an event.
+ ******************************************************************************/
+const char *wifi_event_bus_event_name(wifi_event_id_t id)
+{
+  return (id < WIFI_EVENT_NB) ? wifi_event_names[id] : "";
+}
+
+/***************************************************************************//**
+ * Get a copy of a subscriber state.
+ ******************************************************************************/
+bool wifi_event_bus_get_subscriber(uint8_t index, wifi_event_subscriber_t *sub)
+{
+  CPU_SR_ALLOC();
+
+  if (index >= subscriber_nb) {
+    return false;
+  }
+  CPU_CRITICAL_ENTER();
+  *sub = *subscribers[index];
+  CPU_CRITICAL_EXIT();
+  return true;
+}
+
+/***************************************************************************//**
+ * Reset the drop and latency counters of the subscribers.
+ ******************************************************************************/
+void wifi_event_bus_reset_stats(void)
+{
+  CPU_SR_ALLOC();
+
+  for (uint8_t i = 0; i < subscriber_nb; i++) {
+    CPU_CRITICAL_ENTER();
+    subscribers[i]->dropped = 0;
+    memset(&subscribers[i]->latency, 0, sizeof(subscribers[i]->latency));
+    CPU_CRITICAL_EXIT();
+  }
+}
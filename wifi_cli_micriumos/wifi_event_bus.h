@@ -0,0 +1,177 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef WIFI_EVENT_BUS_H
+#define WIFI_EVENT_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/include/os.h>
+
+/// Subscribers of the bus (CLI, roaming, web server, MQTT, BLE...).
+#ifndef WIFI_EVENT_BUS_SUBSCRIBER_MAX
+#define WIFI_EVENT_BUS_SUBSCRIBER_MAX     6
+#endif
+/// Events queued per subscriber.
+#ifndef WIFI_EVENT_BUS_QUEUE_SIZE
+#define WIFI_EVENT_BUS_QUEUE_SIZE         8
+#endif
+
+/// Events published on the bus.
+typedef enum {
+  WIFI_EVENT_CONNECT = 0,       ///< Station connection, status 0 if connected
+  WIFI_EVENT_DISCONNECT,        ///< Station disconnection
+  WIFI_EVENT_START_AP,          ///< SoftAP started
+  WIFI_EVENT_STOP_AP,           ///< SoftAP stopped
+  WIFI_EVENT_SCAN_COMPLETE,     ///< Scan completed, status of the scan
+  WIFI_EVENT_IPERF_DONE,        ///< Foreground iPerf test reported
+  WIFI_EVENT_IP_BOUND,          ///< Station address leased, or the static one used
+  WIFI_EVENT_NB
+} wifi_event_id_t;
+
+/// Mask of events, bit n for event n.
+typedef uint32_t wifi_event_mask_t;
+
+#define WIFI_EVENT_MASK(id)             ((wifi_event_mask_t)1u << (id))
+#define WIFI_EVENT_MASK_ALL             (WIFI_EVENT_MASK(WIFI_EVENT_NB) - 1)
+
+/// Event delivered to the subscribers.
+typedef struct {
+  wifi_event_id_t id;
+  uint32_t status;              ///< Indication status, 0 on success
+  uint32_t timestamp;           ///< CPU cycles when the indication was received
+  const void *owner;            ///< Subscriber whose request the event answers,
+                                ///  NULL if none
+} wifi_event_t;
+
+/// Wake-up latency statistics of a subscriber, from the indication reception
+/// to the return of its wait.
+typedef struct {
+  uint32_t wakeups;
+  uint32_t last_us;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t total_us;
+} wifi_event_latency_t;
+
+/// Subscriber, owned by its task and registered once.
+typedef struct {
+  const char *name;
+  wifi_event_mask_t filter;     ///< Events queued for the subscriber
+  OS_SEM sem;                   ///< Counts the events queued
+  wifi_event_t queue[WIFI_EVENT_BUS_QUEUE_SIZE];
+  uint8_t head;
+  uint8_t count;
+  uint32_t dropped;             ///< Events lost, queue full
+  wifi_event_latency_t latency;
+} wifi_event_subscriber_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Initialize the bus, before the first subscriber registers.
+ ******************************************************************************/
+void wifi_event_bus_init(void);
+
+/***************************************************************************//**
+ * Register a subscriber, with an empty filter.
+ *
+ * @param sub subscriber storage
+ * @param name subscriber name
+ * @returns 0 on success, -1 if the bus is full or the semaphore not created
+ ******************************************************************************/
+int wifi_event_bus_subscribe(wifi_event_subscriber_t *sub, const char *name);
+
+/***************************************************************************//**
+ * Set the filter of a subscriber and drop its queued events. To not miss an
+ * event, call it before sending the request triggering the event: the event
+ * is queued even if published before wifi_event_bus_wait() is called.
+ *
+ * @param sub subscriber
+ * @param filter events to queue
+ ******************************************************************************/
+void wifi_event_bus_arm(wifi_event_subscriber_t *sub, wifi_event_mask_t filter);
+
+/***************************************************************************//**
+ * Start a request to the WFx: wait for the request of another subscriber to
+ * end, then arm the filter with the events answering the request. These
+ * events are owned by the subscriber until wifi_event_bus_request_end():
+ * the other subscribers filtering them receive them too, but their waits
+ * skip them. Scan, join, disconnect and SoftAP requests go through it, the
+ * CLI and the roaming task sending them.
+ *
+ * @param sub subscriber
+ * @param mask events answering the request
+ ******************************************************************************/
+void wifi_event_bus_request_begin(wifi_event_subscriber_t *sub, wifi_event_mask_t mask);
+
+/***************************************************************************//**
+ * End the request of a subscriber, its filter staying armed.
+ *
+ * @param sub subscriber
+ ******************************************************************************/
+void wifi_event_bus_request_end(wifi_event_subscriber_t *sub);
+
+/***************************************************************************//**
+ * Wait for an event, the queued events outside the mask or answering the
+ * request of another subscriber being dropped.
+ *
+ * @param sub subscriber
+ * @param mask events awaited
+ * @param timeout_ms timeout in milliseconds, 0 to wait forever
+ * @param event event received, can be NULL
+ * @returns RTOS_ERR_NONE, RTOS_ERR_TIMEOUT or the pend error
+ ******************************************************************************/
+RTOS_ERR_CODE wifi_event_bus_wait(wifi_event_subscriber_t *sub,
+                                  wifi_event_mask_t mask,
+                                  uint32_t timeout_ms,
+                                  wifi_event_t *event);
+
+/***************************************************************************//**
+ * Publish an event to all the subscribers filtering it.
+ *
+ * @param id event
+ * @param status indication status
+ * @param timestamp CPU cycles when the indication was received
+ ******************************************************************************/
+void wifi_event_bus_publish(wifi_event_id_t id, uint32_t status, uint32_t timestamp);
+
+/***************************************************************************//**
+ * Get the name of an event.
+ ******************************************************************************/
+const char *wifi_event_bus_event_name(wifi_event_id_t id);
+
+/***************************************************************************//**
+ * Get a copy of a subscriber state.
+ *
+ * @param index subscriber index
+ * @param sub copy of the subscriber
+ * @returns false if no subscriber at this index
+ ******************************************************************************/
+bool wifi_event_bus_get_subscriber(uint8_t index, wifi_event_subscriber_t *sub);
+
+/***************************************************************************//**
+ * Reset the drop and latency counters of all the subscribers.
+ ******************************************************************************/
+void wifi_event_bus_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,193 @@
+/***************************************************************************//**
+ * @file
+ * @brief Preallocated slots of the indications deferred to the events task
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * The WFx driver reuses its receive buffer once the indication callback
+ * returns, so the indications processed by the events task are copied into a
+ * slot, taken by the bus task and given back by the events task. The slots of
+ * a class are tracked by a bitmap under a critical section: no allocator is
+ * involved and a slot is never copied again.
+ ******************************************************************************/
+#include <string.h>
+#include "latency_trace.h"
+#include "wifi_event_pool.h"
+
+#define SLOT_WORDS(size)    (((size) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+
+/// Slot class.
+typedef struct {
+  uint32_t *storage;
+  uint32_t *timestamps;       ///< Reception time of the slot indications
+  uint16_t size;
+  uint8_t slot_nb;
+  uint32_t free_mask;         ///< Bit n set if slot n is free
+} event_slot_class_t;
+
+static uint32_t small_slots[WIFI_EVENT_POOL_SMALL_NB][SLOT_WORDS(WIFI_EVENT_POOL_SMALL_SIZE)];
+static uint32_t large_slots[WIFI_EVENT_POOL_LARGE_NB][SLOT_WORDS(WIFI_EVENT_POOL_LARGE_SIZE)];
+static uint32_t small_timestamps[WIFI_EVENT_POOL_SMALL_NB];
+static uint32_t large_timestamps[WIFI_EVENT_POOL_LARGE_NB];
+
+static event_slot_class_t pool[WIFI_EVENT_POOL_CLASS_NB] = {
+  [WIFI_EVENT_POOL_SMALL] = { &small_slots[0][0], small_timestamps, WIFI_EVENT_POOL_SMALL_SIZE, WIFI_EVENT_POOL_SMALL_NB, 0 },
+  [WIFI_EVENT_POOL_LARGE] = { &large_slots[0][0], large_timestamps, WIFI_EVENT_POOL_LARGE_SIZE, WIFI_EVENT_POOL_LARGE_NB, 0 },
+};
+static wifi_event_pool_stats_t pool_stats;
+
+#if (WIFI_EVENT_POOL_SMALL_NB > 32) || (WIFI_EVENT_POOL_LARGE_NB > 32)
+#error "The slots of a class are limited to 32"
+#endif
+
+/***************************************************************************//**
+ * Initialize the pool.
+ ******************************************************************************/
+void wifi_event_pool_init(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  for (uint8_t c = 0; c < WIFI_EVENT_POOL_CLASS_NB; c++) {
+    pool[c].free_mask = (pool[c].slot_nb == 32) ? 0xFFFFFFFFu : ((1u << pool[c].slot_nb) - 1);
+    pool_stats.classes[c].size = pool[c].size;
+    pool_stats.classes[c].slot_nb = pool[c].slot_nb;
+    pool_stats.classes[c].in_use = 0;
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Copy an indication into a slot and post it to the events task.
+ ******************************************************************************/
+sl_status_t wifi_event_pool_post(OS_Q *queue, const void *msg, uint16_t length)
+{
+  wifi_event_pool_class_stats_t *stats;
+  uint32_t *slot = NULL;
+  uint8_t c, n;
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  /* Smallest class fitting the indication */
+  for (c = 0; (c < WIFI_EVENT_POOL_CLASS_NB) && (length > pool[c].size); c++) {
+  }
+  if (c == WIFI_EVENT_POOL_CLASS_NB) {
+    CPU_CRITICAL_ENTER();
+    pool_stats.oversized++;
+    CPU_CRITICAL_EXIT();
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  stats = &pool_stats.classes[c];
+
+  CPU_CRITICAL_ENTER();
+  if (pool[c].free_mask == 0) {
+    stats->exhausted++;
+    CPU_CRITICAL_EXIT();
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  n = (uint8_t)__builtin_ctz(pool[c].free_mask);
+  pool[c].free_mask &= ~(1u << n);
+  stats->posts++;
+  stats->in_use++;
+  if (stats->in_use > stats->in_use_max) {
+    stats->in_use_max = stats->in_use;
+  }
+  CPU_CRITICAL_EXIT();
+
+  slot = pool[c].storage + (uint32_t)n * SLOT_WORDS(pool[c].size);
+  pool[c].timestamps[n] = latency_trace_timestamp();
+  memcpy(slot, msg, length);
+
+  OSQPost(queue, slot, length, OS_OPT_POST_FIFO, &err);
+  if (RTOS_ERR_CODE_GET(err) != RTOS_ERR_NONE) {
+    wifi_event_pool_release(slot);
+    CPU_CRITICAL_ENTER();
+    pool_stats.queue_full++;
+    CPU_CRITICAL_EXIT();
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Give a slot back to the pool.
+ ******************************************************************************/
+void wifi_event_pool_release(void *msg)
+{
+  uint32_t *slot = (uint32_t *)msg;
+  uint32_t words;
+  CPU_SR_ALLOC();
+
+  for (uint8_t c = 0; c < WIFI_EVENT_POOL_CLASS_NB; c++) {
+    words = SLOT_WORDS(pool[c].size);
+    if ((slot >= pool[c].storage) && (slot < pool[c].storage + pool[c].slot_nb * words)) {
+      CPU_CRITICAL_ENTER();
+      pool[c].free_mask |= 1u << ((slot - pool[c].storage) / words);
+      pool_stats.classes[c].in_use--;
+      CPU_CRITICAL_EXIT();
+      return;
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Get the reception time of the indication of a slot.
+ ******************************************************************************/
+uint32_t wifi_event_pool_timestamp(const void *msg)
+{
+  const uint32_t *slot = (const uint32_t *)msg;
+  uint32_t words;
+
+  for (uint8_t c = 0; c < WIFI_EVENT_POOL_CLASS_NB; c++) {
+    words = SLOT_WORDS(pool[c].size);
+    if ((slot >= pool[c].storage) && (slot < pool[c].storage + pool[c].slot_nb * words)) {
+      return pool[c].timestamps[(slot - pool[c].storage) / words];
+    }
+  }
+  return latency_trace_timestamp();
+}
+
+/***************************************************************************//**
+ * Get the pool statistics.
+ ******************************************************************************/
+void wifi_event_pool_get_stats(wifi_event_pool_stats_t *stats)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  *stats = pool_stats;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Reset the pool statistics counters.
+ ******************************************************************************/
+void wifi_event_pool_reset_stats(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  for (uint8_t c = 0; c < WIFI_EVENT_POOL_CLASS_NB; c++) {
+    pool_stats.classes[c].posts = 0;
+    pool_stats.classes[c].exhausted = 0;
+    pool_stats.classes[c].in_use_max = pool_stats.classes[c].in_use;
+  }
+  pool_stats.oversized = 0;
+  pool_stats.queue_full = 0;
+  CPU_CRITICAL_EXIT();
+}
@@ -0,0 +1,111 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef WIFI_EVENT_POOL_H
+#define WIFI_EVENT_POOL_H
+
+#include <stdint.h>
+#include "sl_wfx_constants.h"
+#include <kernel/include/os.h>
+
+/// Indications without variable data: connect, disconnect, AP start/stop,
+/// scan complete.
+#ifndef WIFI_EVENT_POOL_SMALL_SIZE
+#define WIFI_EVENT_POOL_SMALL_SIZE      64
+#endif
+#ifndef WIFI_EVENT_POOL_SMALL_NB
+#define WIFI_EVENT_POOL_SMALL_NB        8
+#endif
+/// External authentication indications, carrying the SAE frames.
+#ifndef WIFI_EVENT_POOL_LARGE_SIZE
+#define WIFI_EVENT_POOL_LARGE_SIZE      512
+#endif
+#ifndef WIFI_EVENT_POOL_LARGE_NB
+#define WIFI_EVENT_POOL_LARGE_NB        3
+#endif
+
+/// Slot classes, by increasing size.
+typedef enum {
+  WIFI_EVENT_POOL_SMALL = 0,
+  WIFI_EVENT_POOL_LARGE,
+  WIFI_EVENT_POOL_CLASS_NB
+} wifi_event_pool_class_t;
+
+/// Statistics of a slot class.
+typedef struct {
+  uint16_t size;              ///< Slot size (bytes)
+  uint8_t slot_nb;
+  uint8_t in_use;             ///< Slots owned by the events task
+  uint8_t in_use_max;
+  uint32_t posts;             ///< Indications deferred to the events task
+  uint32_t exhausted;         ///< Indications dropped, no free slot
+} wifi_event_pool_class_stats_t;
+
+/// Event pool statistics.
+typedef struct {
+  wifi_event_pool_class_stats_t classes[WIFI_EVENT_POOL_CLASS_NB];
+  uint32_t oversized;         ///< Indications dropped, larger than any slot
+  uint32_t queue_full;        ///< Indications dropped, events queue full
+} wifi_event_pool_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Initialize the pool, before the first indication.
+ ******************************************************************************/
+void wifi_event_pool_init(void);
+
+/***************************************************************************//**
+ * Copy an indication into a slot of the smallest class fitting it, and hand
+ * the slot over to the events task through its queue.
+ *
+ * @param queue events queue
+ * @param msg indication, in the bus buffer
+ * @param length indication length
+ * @returns SL_STATUS_OK, or SL_STATUS_ALLOCATION_FAILED if dropped
+ ******************************************************************************/
+sl_status_t wifi_event_pool_post(OS_Q *queue, const void *msg, uint16_t length);
+
+/***************************************************************************//**
+ * Give a slot back to the pool, once the events task processed it.
+ ******************************************************************************/
+void wifi_event_pool_release(void *msg);
+
+/***************************************************************************//**
+ * Get the time an indication was received by the bus task.
+ *
+ * @param msg slot, as received by the events task
+ * @returns CPU cycle counter when the slot was posted
+ ******************************************************************************/
+uint32_t wifi_event_pool_timestamp(const void *msg);
+
+/***************************************************************************//**
+ * Get the pool statistics.
+ ******************************************************************************/
+void wifi_event_pool_get_stats(wifi_event_pool_stats_t *stats);
+
+/***************************************************************************//**
+ * Reset the pool statistics counters.
+ ******************************************************************************/
+void wifi_event_pool_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
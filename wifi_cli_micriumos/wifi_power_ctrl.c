@@ -0,0 +1,351 @@
+/***************************************************************************//**
+ * @file
+ * @brief Station power-save mode following the traffic
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * The controller task samples the bytes exchanged on the station interface
+ * and the TCP segments waiting for transmission. The mode matching the
+ * traffic is applied at once when more active than the current one, so that
+ * a transfer burst runs at full speed after one sampling period at most. It
+ * is applied only after the hold time when less active, the traffic having
+ * to stay under half the threshold of the current mode meanwhile: a pause
+ * between two requests does not put the station back to sleep.
+ *
+ * The statistics and settings are shared with the CLI task, their multi-field
+ * updates and copies being done in critical sections.
+ ******************************************************************************/
+#include <stdio.h>
+#include <kernel/include/os.h>
+#include "sl_wfx.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcp_priv.h"
+#include "ethernetif.h"
+#include "latency_trace.h"
+#include "app_wifi_events.h"
+#include "wifi_power_ctrl.h"
+
+#define WIFI_POWER_CTRL_TASK_PRIO           25u
+#define WIFI_POWER_CTRL_TASK_STK_SIZE       600u
+
+#define WIFI_POWER_CTRL_PERIOD_MS           200 ///< Traffic sampling period
+#define WIFI_POWER_CTRL_TCP_BUSY_SEGMENTS   4   ///< Bulk TCP transmission above
+
+/// Controller task state.
+typedef struct {
+  volatile bool connected_event;
+  bool apply;                 ///< Mode to apply whatever the current one
+  wifi_power_ctrl_mode_t mode;
+  uint32_t beacon_ms;
+  uint32_t dtim_ms;
+  uint32_t tx_bytes;
+  uint32_t rx_bytes;
+  uint32_t last_ms;
+  uint32_t below_since_ms;    ///< Traffic under the current mode since
+} wifi_power_ctrl_state_t;
+
+static const char *const wifi_power_ctrl_mode_names[WIFI_POWER_CTRL_MODE_NB] = {
+  [WIFI_POWER_CTRL_ACTIVE]  = "active",
+  [WIFI_POWER_CTRL_FAST_PS] = "fast_ps",
+  [WIFI_POWER_CTRL_DTIM]    = "dtim",
+};
+
+static wifi_power_ctrl_config_t ps_config = {
+  .enabled = false,
+  .active_bps = WIFI_POWER_CTRL_ACTIVE_BPS_DEFAULT,
+  .fast_ps_bps = WIFI_POWER_CTRL_FAST_PS_BPS_DEFAULT,
+  .hold_ms = WIFI_POWER_CTRL_HOLD_MS_DEFAULT,
+  .dtim_interval = WIFI_POWER_CTRL_DTIM_INTERVAL_DEFAULT,
+};
+static wifi_power_ctrl_stats_t ps_stats;
+static wifi_power_ctrl_state_t ps;
+
+static CPU_STK wifi_power_ctrl_task_stk[WIFI_POWER_CTRL_TASK_STK_SIZE];
+static OS_TCB wifi_power_ctrl_task_tcb;
+
+/***************************************************************************//**
+ * Get the TCP segments queued for transmission by all the connections.
+ ******************************************************************************/
+static uint16_t wifi_power_ctrl_tcp_queued(void)
+{
+  uint16_t queued = 0;
+#if LWIP_TCP
+  struct tcp_pcb *pcb;
+
+  LOCK_TCPIP_CORE();
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    queued += pcb->snd_queuelen;
+  }
+  UNLOCK_TCPIP_CORE();
+#endif
+  return queued;
+}
+
+/***************************************************************************//**
+ * Apply a power mode.
+ ******************************************************************************/
+static bool wifi_power_ctrl_apply(wifi_power_ctrl_mode_t mode)
+{
+  sl_status_t status;
+
+  switch (mode) {
+    case WIFI_POWER_CTRL_FAST_PS:
+      status = sl_wfx_set_power_mode(WFM_PM_MODE_PS, WFM_PM_POLL_FAST_PS, 1, 0);
+      break;
+    case WIFI_POWER_CTRL_DTIM:
+      status = sl_wfx_set_power_mode(WFM_PM_MODE_DTIM,
+                                     WFM_PM_POLL_FAST_PS,
+                                     ps_config.dtim_interval,
+                                     0);
+      break;
+    default:
+      status = sl_wfx_set_power_mode(WFM_PM_MODE_ACTIVE, WFM_PM_POLL_FAST_PS, 0, 0);
+      break;
+  }
+  if (status != SL_STATUS_OK) {
+    ps_stats.failures++;
+    return false;
+  }
+  ps_stats.transitions[mode]++;
+  ps.mode = mode;
+  ps_stats.mode = mode;
+  return true;
+}
+
+/***************************************************************************//**
+ * Get the mode matching a traffic rate, with the hysteresis of the current
+ * mode.
+ ******************************************************************************/
+static wifi_power_ctrl_mode_t wifi_power_ctrl_target(uint32_t rate_bps, uint16_t tcp_queued)
+{
+  uint32_t active_bps = ps_config.active_bps;
+  uint32_t fast_ps_bps = ps_config.fast_ps_bps;
+
+  /* Exit thresholds of the current mode and of the more active ones */
+  if (ps.mode <= WIFI_POWER_CTRL_FAST_PS) {
+    fast_ps_bps /= 2;
+  }
+  if (ps.mode == WIFI_POWER_CTRL_ACTIVE) {
+    active_bps /= 2;
+  }
+
+  if ((rate_bps >= active_bps) || (tcp_queued >= WIFI_POWER_CTRL_TCP_BUSY_SEGMENTS)) {
+    return WIFI_POWER_CTRL_ACTIVE;
+  }
+  if (rate_bps >= fast_ps_bps) {
+    return WIFI_POWER_CTRL_FAST_PS;
+  }
+  return WIFI_POWER_CTRL_DTIM;
+}
+
+/***************************************************************************//**
+ * Update the wake-up period of the power-save modes.
+ ******************************************************************************/
+static void wifi_power_ctrl_update_wake_periods(void)
+{
+  ps_stats.wake_period_ms[WIFI_POWER_CTRL_ACTIVE] = 0;
+  ps_stats.wake_period_ms[WIFI_POWER_CTRL_FAST_PS] = ps.beacon_ms;
+  ps_stats.wake_period_ms[WIFI_POWER_CTRL_DTIM] = ps.dtim_ms * ps_config.dtim_interval;
+}
+
+/***************************************************************************//**
+ * Power-save controller task.
+ ******************************************************************************/
+static void wifi_power_ctrl_task(void *p_arg)
+{
+  wifi_power_ctrl_mode_t target;
+  uint32_t tx_bytes, rx_bytes;
+  uint32_t now_ms, elapsed_ms;
+  uint32_t start_cycles;
+  uint32_t boost_us;
+  RTOS_ERR err;
+  CPU_SR_ALLOC();
+
+  (void)p_arg;
+
+  while (1) {
+    OSTimeDly((OS_TICK)(((uint64_t)WIFI_POWER_CTRL_PERIOD_MS * OSCfg_TickRate_Hz) / 1000),
+              OS_OPT_TIME_DLY,
+              &err);
+
+    now_ms = sys_now();
+    elapsed_ms = now_ms - ps.last_ms;
+    ethernetif_get_sta_traffic(&tx_bytes, &rx_bytes);
+
+    if (ps.connected_event) {
+      /* New association, in active mode */
+      ps.connected_event = false;
+      ps.mode = WIFI_POWER_CTRL_ACTIVE;
+      ps_stats.mode = WIFI_POWER_CTRL_ACTIVE;
+      ps.below_since_ms = now_ms;
+      CPU_CRITICAL_ENTER();
+      wifi_power_ctrl_update_wake_periods();
+      CPU_CRITICAL_EXIT();
+    } else if ((wifi.state & SL_WFX_STA_INTERFACE_CONNECTED) && (elapsed_ms > 0)) {
+      ps_stats.time_ms[ps.mode] += elapsed_ms;
+      ps_stats.rate_bps = (uint32_t)((((uint64_t)(tx_bytes - ps.tx_bytes)
+                                       + (rx_bytes - ps.rx_bytes)) * 1000) / elapsed_ms);
+    }
+    ps.tx_bytes = tx_bytes;
+    ps.rx_bytes = rx_bytes;
+    ps.last_ms = now_ms;
+
+    if (!(wifi.state & SL_WFX_STA_INTERFACE_CONNECTED)
+        || (wifi.state & SL_WFX_AP_INTERFACE_UP)) {
+      /* No power save with the SoftAP up */
+      continue;
+    }
+
+    if (!ps_config.enabled) {
+      if (ps.apply && (ps.mode != WIFI_POWER_CTRL_ACTIVE)) {
+        wifi_power_ctrl_apply(WIFI_POWER_CTRL_ACTIVE);
+      }
+      ps.apply = false;
+      continue;
+    }
+
+    ps_stats.tcp_queued = wifi_power_ctrl_tcp_queued();
+    target = wifi_power_ctrl_target(ps_stats.rate_bps, ps_stats.tcp_queued);
+
+    if (ps.apply) {
+      /* New settings */
+      ps.apply = false;
+      ps.below_since_ms = now_ms;
+      wifi_power_ctrl_apply(target);
+    } else if (target < ps.mode) {
+      /* Traffic burst, stepping up at once */
+      start_cycles = latency_trace_timestamp();
+      if (wifi_power_ctrl_apply(target) && (target == WIFI_POWER_CTRL_ACTIVE)) {
+        boost_us = latency_trace_cycles_to_us(latency_trace_timestamp() - start_cycles);
+        CPU_CRITICAL_ENTER();
+        if (boost_us > ps_stats.max_boost_us) {
+          ps_stats.max_boost_us = boost_us;
+        }
+        ps_stats.boosts++;
+        ps_stats.last_boost_us = boost_us;
+        ps_stats.total_boost_us += boost_us;
+        CPU_CRITICAL_EXIT();
+      }
+      ps.below_since_ms = now_ms;
+    } else if (target == ps.mode) {
+      ps.below_since_ms = now_ms;
+    } else if ((now_ms - ps.below_since_ms) >= ps_config.hold_ms) {
+      /* Traffic lower for the hold time, stepping down */
+      wifi_power_ctrl_apply(target);
+      ps.below_since_ms = now_ms;
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Create the controller task, disabled until configured.
+ ******************************************************************************/
+void wifi_power_ctrl_start(void)
+{
+  RTOS_ERR err;
+
+  ps.beacon_ms = 102;
+  ps.dtim_ms = 102;
+  ps.last_ms = sys_now();
+  wifi_power_ctrl_update_wake_periods();
+
+  OSTaskCreate(&wifi_power_ctrl_task_tcb,
+               "WFX power-save task",
+               wifi_power_ctrl_task,
+               DEF_NULL,
+               WIFI_POWER_CTRL_TASK_PRIO,
+               &wifi_power_ctrl_task_stk[0],
+               (WIFI_POWER_CTRL_TASK_STK_SIZE / 10u),
+               WIFI_POWER_CTRL_TASK_STK_SIZE,
+               0u,
+               0u,
+               DEF_NULL,
+               (OS_OPT_TASK_STK_CLR),
+               &err);
+  APP_RTOS_ASSERT_DBG((RTOS_ERR_CODE_GET(err) == RTOS_ERR_NONE), 1);
+}
+
+/***************************************************************************//**
+ * Apply new controller settings.
+ ******************************************************************************/
+void wifi_power_ctrl_configure(const wifi_power_ctrl_config_t *config)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  ps_config = *config;
+  wifi_power_ctrl_update_wake_periods();
+  CPU_CRITICAL_EXIT();
+  ps.apply = true;
+}
+
+/***************************************************************************//**
+ * Get the controller settings and statistics.
+ ******************************************************************************/
+void wifi_power_ctrl_get(wifi_power_ctrl_config_t *config, wifi_power_ctrl_stats_t *stats)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  *config = ps_config;
+  *stats = ps_stats;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Reset the transition, time and boost counters.
+ ******************************************************************************/
+void wifi_power_ctrl_reset_stats(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  for (uint8_t mode = 0; mode < WIFI_POWER_CTRL_MODE_NB; mode++) {
+    ps_stats.transitions[mode] = 0;
+    ps_stats.time_ms[mode] = 0;
+  }
+  ps_stats.failures = 0;
+  ps_stats.boosts = 0;
+  ps_stats.last_boost_us = 0;
+  ps_stats.max_boost_us = 0;
+  ps_stats.total_boost_us = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Get the name of a mode.
+ ******************************************************************************/
+const char *wifi_power_ctrl_mode_name(wifi_power_ctrl_mode_t mode)
+{
+  return (mode < WIFI_POWER_CTRL_MODE_NB) ? wifi_power_ctrl_mode_names[mode] : "";
+}
+
+/***************************************************************************//**
+ * Notify the station connection.
+ ******************************************************************************/
+void wifi_power_ctrl_connected(uint16_t beacon_interval, uint8_t dtim_period)
+{
+  if ((beacon_interval != 0) && (dtim_period != 0)) {
+    /* 1 TU = 1.024 ms */
+    ps.beacon_ms = ((uint32_t)beacon_interval * 1024) / 1000;
+    ps.dtim_ms = ps.beacon_ms * dtim_period;
+  }
+  ps.connected_event = true;
+  ps.apply = true;
+}
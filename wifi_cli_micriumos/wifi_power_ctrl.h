@@ -0,0 +1,109 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef WIFI_POWER_CTRL_H
+#define WIFI_POWER_CTRL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WIFI_POWER_CTRL_ACTIVE_BPS_DEFAULT    32768 ///< Active mode above (bytes/s)
+#define WIFI_POWER_CTRL_FAST_PS_BPS_DEFAULT   1024  ///< Fast PS mode above (bytes/s)
+#define WIFI_POWER_CTRL_HOLD_MS_DEFAULT       2000  ///< Lower traffic time before stepping down
+#define WIFI_POWER_CTRL_DTIM_INTERVAL_DEFAULT 1     ///< DTIMs between two wake-ups
+
+/// Station power modes, from the most to the least consuming.
+typedef enum {
+  WIFI_POWER_CTRL_ACTIVE = 0,   ///< Always awake
+  WIFI_POWER_CTRL_FAST_PS,      ///< Awake at each beacon, Fast-PS polling
+  WIFI_POWER_CTRL_DTIM,         ///< Awake every DTIM interval, Fast-PS polling
+  WIFI_POWER_CTRL_MODE_NB
+} wifi_power_ctrl_mode_t;
+
+/// Power-save controller settings. A mode is entered as soon as the traffic
+/// rate reaches its threshold, and left once the rate stayed under half the
+/// threshold for the hold time.
+typedef struct {
+  bool enabled;
+  uint32_t active_bps;        ///< TX+RX rate entering the active mode (bytes/s)
+  uint32_t fast_ps_bps;       ///< TX+RX rate entering the fast PS mode (bytes/s)
+  uint32_t hold_ms;           ///< Time under the exit threshold before stepping down
+  uint8_t dtim_interval;      ///< DTIM intervals between two wake-ups in DTIM mode
+} wifi_power_ctrl_config_t;
+
+/// Power-save controller statistics.
+typedef struct {
+  wifi_power_ctrl_mode_t mode;
+  uint32_t rate_bps;          ///< Last TX+RX rate (bytes/s)
+  uint16_t tcp_queued;        ///< Last TCP segments queued for transmission
+  uint32_t transitions[WIFI_POWER_CTRL_MODE_NB]; ///< Entries in each mode
+  uint32_t time_ms[WIFI_POWER_CTRL_MODE_NB];     ///< Time connected in each mode
+  uint32_t wake_period_ms[WIFI_POWER_CTRL_MODE_NB]; ///< Wake-up period of each mode,
+                                                   ///  from the AP beacon and DTIM intervals
+  uint32_t failures;          ///< Power mode requests failed
+  /* Boosts to the active mode: duration of the power mode request, measured
+     from its sending to its confirmation. The traffic itself is detected up
+     to one sampling period after it starts, not measured. */
+  uint32_t boosts;
+  uint32_t last_boost_us;
+  uint32_t max_boost_us;
+  uint64_t total_boost_us;
+} wifi_power_ctrl_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Create the power-save controller task, disabled until configured.
+ ******************************************************************************/
+void wifi_power_ctrl_start(void);
+
+/***************************************************************************//**
+ * Apply new controller settings. Once disabled, the station goes back to the
+ * active mode.
+ ******************************************************************************/
+void wifi_power_ctrl_configure(const wifi_power_ctrl_config_t *config);
+
+/***************************************************************************//**
+ * Get the controller settings and statistics.
+ ******************************************************************************/
+void wifi_power_ctrl_get(wifi_power_ctrl_config_t *config, wifi_power_ctrl_stats_t *stats);
+
+/***************************************************************************//**
+ * Reset the transition, time and boost counters.
+ ******************************************************************************/
+void wifi_power_ctrl_reset_stats(void);
+
+/***************************************************************************//**
+ * Get the name of a mode.
+ ******************************************************************************/
+const char *wifi_power_ctrl_mode_name(wifi_power_ctrl_mode_t mode);
+
+/***************************************************************************//**
+ * Notify the station connection, from the Wi-Fi events task. The firmware
+ * starts each association in active mode.
+ *
+ * @param beacon_interval beacon interval (TU)
+ * @param dtim_period DTIM period (beacons)
+ ******************************************************************************/
+void wifi_power_ctrl_connected(uint16_t beacon_interval, uint8_t dtim_period);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
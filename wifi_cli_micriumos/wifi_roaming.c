@@ -0,0 +1,502 @@
+/***************************************************************************//**
+ * @file
+ * @brief Station roaming between the access points of a network
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * While connected, the roaming task:
+ * - monitors the RSSI of the current AP. The FMAC API has no RSSI threshold
+ *   indication, the RSSI is polled and averaged instead,
+ * - below the threshold, runs background passive scans of one channel at a
+ *   time, spaced by a few DTIM intervals so that the buffered traffic is
+ *   still received between two channels,
+ * - scores the APs of the same network seen by these scans (scan store),
+ * - roams to the best one if it beats the current AP by the hysteresis: the
+ *   new AP is selected and its SAE exchange prepared (or its PMK found in the
+ *   PMKSA cache) while still connected, then the station leaves the current
+ *   AP and joins the new one directly on its channel. The WFx station having
+ *   a single association, this is the closest to make-before-break. If the
+ *   join fails, the station goes back to the previous AP.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <kernel/include/os.h>
+#include "sl_wfx.h"
+#include "sl_wfx_sae.h"
+#include "lwip/sys.h"
+#include "app_wifi_events.h"
+#include "scan_store.h"
+#include "scan_profile.h"
+#include "wifi_event_bus.h"
+#include "wifi_cli_params.h"
+#include "wifi_roaming.h"
+#include "wifi_conn_timing.h"
+
+extern bool secur_mode_fallback;
+
+#define WIFI_ROAMING_TASK_PRIO              25u
+#define WIFI_ROAMING_TASK_STK_SIZE          800u
+
+#define WIFI_ROAMING_RSSI_PERIOD_MS         500   ///< RSSI poll period
+#define WIFI_ROAMING_RSSI_RECOVERY          3     ///< Scans stop above threshold + this (dB)
+#define WIFI_ROAMING_CHANNEL_MAX            14    ///< Highest 2.4 GHz channel
+#define WIFI_ROAMING_SLICE_DTIMS            3     ///< DTIM intervals between two scanned channels
+#define WIFI_ROAMING_SLICE_MIN_MS           300
+#define WIFI_ROAMING_CANDIDATE_MAX_AGE_MS   10000 ///< Scan results considered
+#define WIFI_ROAMING_AGE_PENALTY_MS         2000  ///< 1 dB less per period of age
+#define WIFI_ROAMING_FAILED_HOLDOFF_MS      60000 ///< AP failing to join ignored for
+#define WIFI_ROAMING_HOLDOFF_MS             10000 ///< No roam again before
+#define WIFI_ROAMING_IP_TIMEOUT_MS          35000 ///< Address wait, beyond the DHCP client
+                                                  ///  fallback on the static one
+
+/// Roaming task state.
+typedef struct {
+  /* Current AP, written by the Wi-Fi events task */
+  uint8_t bssid[SL_WFX_BSSID_SIZE];
+  uint16_t channel;
+  uint32_t dtim_ms;
+  volatile bool connected_event;
+  /* RSSI average, x4 for precision */
+  int32_t rssi_x4;
+  bool rssi_valid;
+  bool scanning;
+  uint8_t last_channel;        ///< Last channel scanned, 0 if none
+  uint32_t last_slice_ms;
+  uint32_t last_roam_ms;
+  uint8_t failed_bssid[SL_WFX_BSSID_SIZE];
+  uint32_t failed_ms;
+} wifi_roaming_state_t;
+
+static wifi_roaming_config_t roam_config = {
+  .enabled = false,
+  .rssi_threshold = WIFI_ROAMING_RSSI_THRESHOLD_DEFAULT,
+  .hysteresis = WIFI_ROAMING_HYSTERESIS_DEFAULT,
+};
+static wifi_roaming_stats_t roam_stats;
+static wifi_roaming_state_t roam;
+static wifi_event_subscriber_t roam_events;
+
+static CPU_STK wifi_roaming_task_stk[WIFI_ROAMING_TASK_STK_SIZE];
+static OS_TCB wifi_roaming_task_tcb;
+
+/***************************************************************************//**
+ * Sleep for a number of milliseconds.
+ ******************************************************************************/
+static void wifi_roaming_sleep(uint32_t ms)
+{
+  RTOS_ERR err;
+
+  OSTimeDly((OS_TICK)(((uint64_t)ms * OSCfg_TickRate_Hz) / 1000),
+            OS_OPT_TIME_DLY,
+            &err);
+}
+
+/***************************************************************************//**
+ * Send a request and wait for its indication, the request staying in progress.
+ ******************************************************************************/
+static bool wifi_roaming_request(sl_status_t status, wifi_event_id_t event_id)
+{
+  RTOS_ERR_CODE err_code;
+
+  if ((status != SL_STATUS_OK) && (status != SL_STATUS_WIFI_WARNING)) {
+    return false;
+  }
+  err_code = wifi_event_bus_wait(&roam_events,
+                                 WIFI_EVENT_MASK(event_id),
+                                 SL_WFX_DEFAULT_REQUEST_TIMEOUT_MS,
+                                 NULL);
+  return err_code == RTOS_ERR_NONE;
+}
+
+/***************************************************************************//**
+ * Start a request, arming the indications awaited, once the CLI request in
+ * progress if any ends.
+ ******************************************************************************/
+static void wifi_roaming_expect(wifi_event_mask_t mask)
+{
+  wifi_event_bus_request_begin(&roam_events, mask);
+}
+
+/***************************************************************************//**
+ * End the request in progress, the indications still awaited staying armed.
+ ******************************************************************************/
+static void wifi_roaming_end(void)
+{
+  wifi_event_bus_request_end(&roam_events);
+}
+
+/***************************************************************************//**
+ * Disarm the indications: no event is queued while monitoring.
+ ******************************************************************************/
+static void wifi_roaming_disarm(void)
+{
+  wifi_event_bus_arm(&roam_events, 0);
+}
+
+/***************************************************************************//**
+ * Get the channel scanned after another one, among the channels of the
+ * scan_profile region.
+ ******************************************************************************/
+static uint8_t wifi_roaming_next_channel(uint8_t channel)
+{
+  uint16_t active_mask;
+  uint16_t passive_mask;
+
+  (void)scan_region_get(&active_mask, &passive_mask);
+  for (uint8_t i = 0; i < WIFI_ROAMING_CHANNEL_MAX; i++) {
+    channel = (channel % WIFI_ROAMING_CHANNEL_MAX) + 1;
+    if ((active_mask | passive_mask) & (1u << channel)) {
+      return channel;
+    }
+  }
+  return 1;
+}
+
+/***************************************************************************//**
+ * Scan the next channel passively, for about one beacon interval.
+ ******************************************************************************/
+static void wifi_roaming_scan_slice(void)
+{
+  uint8_t channel = wifi_roaming_next_channel(roam.last_channel);
+
+  roam.last_channel = channel;
+  roam.last_slice_ms = sys_now();
+  roam_stats.scan_slices++;
+
+  /* Passive channel time: one beacon interval and a margin (TU) */
+  wifi_roaming_expect(WIFI_EVENT_MASK(WIFI_EVENT_SCAN_COMPLETE));
+  sl_wfx_set_scan_parameters(0, 110, 0);
+  wifi_roaming_request(sl_wfx_send_scan_command(WFM_SCAN_MODE_PASSIVE,
+                                                &channel,
+                                                1,
+                                                NULL,
+                                                0,
+                                                NULL,
+                                                0,
+                                                NULL),
+                       WIFI_EVENT_SCAN_COMPLETE);
+  sl_wfx_set_scan_parameters(0, 0, 0);
+  wifi_roaming_end();
+  wifi_roaming_disarm();
+}
+
+/***************************************************************************//**
+ * Select the best AP of the network: the strongest recent result, 1 dB being
+ * taken off per WIFI_ROAMING_AGE_PENALTY_MS of age. The APs which failed to
+ * be joined recently are skipped.
+ *
+ * @returns the score of the candidate (dBm), INT16_MIN if none
+ ******************************************************************************/
+static int16_t wifi_roaming_select(scan_store_entry_t *candidate)
+{
+  sl_wfx_ssid_def_t ssid = { 0 };
+  scan_store_entry_t entry;
+  scan_store_filter_t filter = {
+    .ssid = &ssid,
+    .security = scan_store_security_filter(wlan_security),
+    .max_age_ms = WIFI_ROAMING_CANDIDATE_MAX_AGE_MS,
+  };
+  uint32_t now_ms = sys_now();
+  bool failed_recently = (now_ms - roam.failed_ms) < WIFI_ROAMING_FAILED_HOLDOFF_MS;
+  int16_t best = INT16_MIN;
+  uint8_t index = 0;
+
+  ssid.ssid_length = strlen(wlan_ssid);
+  memcpy(ssid.ssid, wlan_ssid, ssid.ssid_length);
+
+  while (scan_store_find(&filter, now_ms, &index, &entry)) {
+    int16_t score = (int16_t)(entry.ap.rcpi - 220) / 2
+                    - (int16_t)((now_ms - entry.seen_ms) / WIFI_ROAMING_AGE_PENALTY_MS);
+
+    if (!memcmp(entry.ap.mac, roam.bssid, SL_WFX_BSSID_SIZE)
+        || (failed_recently && !memcmp(entry.ap.mac, roam.failed_bssid, SL_WFX_BSSID_SIZE))) {
+      continue;
+    }
+    if (score > best) {
+      best = score;
+      *candidate = entry;
+    }
+  }
+  return best;
+}
+
+/***************************************************************************//**
+ * Join an AP directly on its channel and wait for the connection, the station
+ * address binding staying armed.
+ ******************************************************************************/
+static bool wifi_roaming_join(const uint8_t *bssid, uint16_t channel,
+                              sl_wfx_security_mode_bitmask_t security_mode)
+{
+  sl_wfx_security_mode_t secur_mode = wlan_security;
+  bool connected;
+
+  /* The SAE exchange and the fallback set are the ones of this join */
+  wifi_roaming_expect(WIFI_EVENT_MASK(WIFI_EVENT_CONNECT) | WIFI_EVENT_MASK(WIFI_EVENT_IP_BOUND));
+
+  /* Same choices as the connect command, secur_mode_fallback being read by
+   * the events task for the PMKSA caching */
+  secur_mode_fallback = (secur_mode == WFM_SECURITY_MODE_WPA3_SAE_WPA2_PSK)
+                        && (security_mode.wpa3 == 0) && (security_mode.wpa2 == 1);
+  if (secur_mode_fallback) {
+    secur_mode = WFM_SECURITY_MODE_WPA2_PSK;
+  }
+  if (((secur_mode == WFM_SECURITY_MODE_WPA3_SAE)
+       || (secur_mode == WFM_SECURITY_MODE_WPA3_SAE_WPA2_PSK))
+      && (sl_wfx_sae_prepare(&wifi.mac_addr_0,
+                             (const sl_wfx_mac_address_t *)bssid,
+                             (const uint8_t *)wlan_ssid,
+                             strlen(wlan_ssid),
+                             (const uint8_t *)wlan_passkey,
+                             strlen(wlan_passkey),
+                             security_mode.h2e) != SL_STATUS_OK)) {
+    wifi_roaming_end();
+    printf("roaming: could not prepare SAE\r\n");
+    return false;
+  }
+
+  sl_wfx_set_scan_parameters(0, 0, 1);
+  /* The candidate comes from the background scans: no scan phase */
+  wifi_conn_timing_begin();
+  wifi_conn_timing_mark(WIFI_CONN_STAGE_JOIN);
+  connected = wifi_roaming_request(sl_wfx_send_join_command((const uint8_t *)wlan_ssid,
+                                                            strlen(wlan_ssid),
+                                                            (const sl_wfx_mac_address_t *)bssid,
+                                                            channel,
+                                                            secur_mode,
+                                                            1,
+                                                            0,
+                                                            (const uint8_t *)wlan_passkey,
+                                                            strlen(wlan_passkey),
+                                                            NULL,
+                                                            0),
+                                   WIFI_EVENT_CONNECT)
+              && (wifi.state & SL_WFX_STA_INTERFACE_CONNECTED);
+  wifi_roaming_end();
+  return connected;
+}
+
+/***************************************************************************//**
+ * Roam to a candidate, or go back to the current AP on failure.
+ ******************************************************************************/
+static void wifi_roaming_roam(const scan_store_entry_t *candidate)
+{
+  uint8_t prev_bssid[SL_WFX_BSSID_SIZE];
+  uint16_t prev_channel = roam.channel;
+  sl_wfx_security_mode_bitmask_t prev_security = candidate->ap.security_mode;
+  scan_store_filter_t filter = { .bssid = roam.bssid };
+  scan_store_entry_t prev;
+  uint8_t index = 0;
+  bool pmksa = wlan_security_wpa3_pmksa
+               && sl_wfx_sae_has_pmksa((const sl_wfx_mac_address_t *)candidate->ap.mac);
+  uint32_t start_ms;
+  uint32_t outage_ms;
+  bool ip_bound;
+
+  memcpy(prev_bssid, roam.bssid, SL_WFX_BSSID_SIZE);
+  /* Security of the current AP, the same network being assumed otherwise */
+  if (scan_store_find(&filter, sys_now(), &index, &prev)) {
+    prev_security = prev.ap.security_mode;
+  }
+  printf("roaming: %02X:%02X:%02X:%02X:%02X:%02X (%d dBm) -> "
+         "%02X:%02X:%02X:%02X:%02X:%02X ch %u (%d dBm)%s\r\n",
+         prev_bssid[0], prev_bssid[1], prev_bssid[2],
+         prev_bssid[3], prev_bssid[4], prev_bssid[5],
+         (int)(roam.rssi_x4 / 4),
+         candidate->ap.mac[0], candidate->ap.mac[1], candidate->ap.mac[2],
+         candidate->ap.mac[3], candidate->ap.mac[4], candidate->ap.mac[5],
+         candidate->ap.channel,
+         (int16_t)(candidate->ap.rcpi - 220) / 2,
+         pmksa ? ", PMKSA cached" : "");
+
+  /* Break: leave the current AP */
+  start_ms = sys_now();
+  wifi_roaming_expect(WIFI_EVENT_MASK(WIFI_EVENT_DISCONNECT));
+  if (!wifi_roaming_request(sl_wfx_send_disconnect_command(), WIFI_EVENT_DISCONNECT)) {
+    wifi_roaming_end();
+    wifi_roaming_disarm();
+    printf("roaming: disconnection failed\r\n");
+    return;
+  }
+  wifi_roaming_end();
+
+  /* Make: join the new AP, the traffic resuming once the address is bound */
+  if (wifi_roaming_join(candidate->ap.mac, candidate->ap.channel, candidate->ap.security_mode)) {
+    ip_bound = (wifi_event_bus_wait(&roam_events,
+                                    WIFI_EVENT_MASK(WIFI_EVENT_IP_BOUND),
+                                    WIFI_ROAMING_IP_TIMEOUT_MS,
+                                    NULL) == RTOS_ERR_NONE);
+    outage_ms = sys_now() - start_ms;
+    wifi_roaming_disarm();
+    if ((roam_stats.roams == 0) || (outage_ms < roam_stats.min_outage_ms)) {
+      roam_stats.min_outage_ms = outage_ms;
+    }
+    if (outage_ms > roam_stats.max_outage_ms) {
+      roam_stats.max_outage_ms = outage_ms;
+    }
+    roam_stats.roams++;
+    roam_stats.pmksa_reuses += pmksa ? 1 : 0;
+    roam_stats.last_outage_ms = outage_ms;
+    roam_stats.total_outage_ms += outage_ms;
+    printf("roaming: roam %lu, outage %lu ms%s\r\n",
+           (unsigned long)roam_stats.roams, (unsigned long)outage_ms,
+           ip_bound ? "" : ", no address");
+    return;
+  }
+
+  roam_stats.failures++;
+  memcpy(roam.failed_bssid, candidate->ap.mac, SL_WFX_BSSID_SIZE);
+  roam.failed_ms = sys_now();
+  printf("roaming: join failed, back to the previous AP\r\n");
+  if (!wifi_roaming_join(prev_bssid, prev_channel, prev_security)) {
+    printf("roaming: previous AP lost\r\n");
+  }
+  wifi_roaming_disarm();
+}
+
+/***************************************************************************//**
+ * Roaming task.
+ ******************************************************************************/
+static void wifi_roaming_task(void *p_arg)
+{
+  scan_store_entry_t candidate;
+  uint32_t rcpi;
+  int32_t rssi;
+  int16_t score;
+  uint32_t slice_period_ms;
+
+  (void)p_arg;
+
+  while (1) {
+    wifi_roaming_sleep(WIFI_ROAMING_RSSI_PERIOD_MS);
+
+    if (roam.connected_event) {
+      /* New AP: restart the monitoring */
+      roam.connected_event = false;
+      roam.rssi_valid = false;
+      roam.scanning = false;
+    }
+    if (!roam_config.enabled
+        || !(wifi.state & SL_WFX_STA_INTERFACE_CONNECTED)
+        || (wifi.state & SL_WFX_AP_INTERFACE_UP)
+        || (sl_wfx_get_signal_strength(&rcpi) != SL_STATUS_OK)) {
+      roam.rssi_valid = false;
+      continue;
+    }
+
+    /* RSSI monitoring, exponential average */
+    rssi = ((int32_t)rcpi - 220) / 2;
+    if (!roam.rssi_valid) {
+      roam.rssi_x4 = rssi * 4;
+      roam.rssi_valid = true;
+    } else {
+      roam.rssi_x4 += rssi - roam.rssi_x4 / 4;
+    }
+    roam_stats.rssi = (int16_t)(roam.rssi_x4 / 4);
+
+    if (roam_stats.rssi < roam_config.rssi_threshold) {
+      roam.scanning = true;
+    } else if (roam_stats.rssi >= roam_config.rssi_threshold + WIFI_ROAMING_RSSI_RECOVERY) {
+      roam.scanning = false;
+    }
+    if (!roam.scanning) {
+      continue;
+    }
+
+    /* Background scan, one channel per slice */
+    slice_period_ms = WIFI_ROAMING_SLICE_DTIMS * roam.dtim_ms;
+    if (slice_period_ms < WIFI_ROAMING_SLICE_MIN_MS) {
+      slice_period_ms = WIFI_ROAMING_SLICE_MIN_MS;
+    }
+    if ((sys_now() - roam.last_slice_ms) >= slice_period_ms) {
+      wifi_roaming_scan_slice();
+    }
+
+    /* Candidate scoring */
+    if ((sys_now() - roam.last_roam_ms) < WIFI_ROAMING_HOLDOFF_MS) {
+      continue;
+    }
+    score = wifi_roaming_select(&candidate);
+    if ((score != INT16_MIN)
+        && (score >= roam_stats.rssi + roam_config.hysteresis)
+        && (wifi.state & SL_WFX_STA_INTERFACE_CONNECTED)) {
+      roam.last_roam_ms = sys_now();
+      wifi_roaming_roam(&candidate);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Create the roaming task, disabled until configured.
+ ******************************************************************************/
+void wifi_roaming_start(void)
+{
+  RTOS_ERR err;
+  int ret;
+
+  roam.dtim_ms = 100;
+  ret = wifi_event_bus_subscribe(&roam_events, "roaming");
+  APP_RTOS_ASSERT_DBG((ret == 0), 1);
+
+  OSTaskCreate(&wifi_roaming_task_tcb,
+               "WFX roaming task",
+               wifi_roaming_task,
+               DEF_NULL,
+               WIFI_ROAMING_TASK_PRIO,
+               &wifi_roaming_task_stk[0],
+               (WIFI_ROAMING_TASK_STK_SIZE / 10u),
+               WIFI_ROAMING_TASK_STK_SIZE,
+               0u,
+               0u,
+               DEF_NULL,
+               (OS_OPT_TASK_STK_CLR),
+               &err);
+  APP_RTOS_ASSERT_DBG((RTOS_ERR_CODE_GET(err) == RTOS_ERR_NONE), 1);
+}
+
+/***************************************************************************//**
+ * Apply new roaming settings.
+ ******************************************************************************/
+void wifi_roaming_configure(const wifi_roaming_config_t *config)
+{
+  roam_config = *config;
+  roam.scanning = false;
+}
+
+/***************************************************************************//**
+ * Get the roaming settings and statistics.
+ ******************************************************************************/
+void wifi_roaming_get(wifi_roaming_config_t *config, wifi_roaming_stats_t *stats)
+{
+  *config = roam_config;
+  *stats = roam_stats;
+}
+
+/***************************************************************************//**
+ * Notify the station connection.
+ ******************************************************************************/
+void wifi_roaming_connected(const uint8_t *bssid, uint16_t channel,
+                            uint16_t beacon_interval, uint8_t dtim_period)
+{
+  memcpy(roam.bssid, bssid, SL_WFX_BSSID_SIZE);
+  roam.channel = channel;
+  if ((beacon_interval != 0) && (dtim_period != 0)) {
+    /* 1 TU = 1.024 ms */
+    roam.dtim_ms = ((uint32_t)beacon_interval * dtim_period * 1024) / 1000;
+  }
+  roam.connected_event = true;
+}
@@ -0,0 +1,82 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef WIFI_ROAMING_H
+#define WIFI_ROAMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_wfx_constants.h"
+
+#define WIFI_ROAMING_RSSI_THRESHOLD_DEFAULT   -70 ///< Background scans below (dBm)
+#define WIFI_ROAMING_HYSTERESIS_DEFAULT       8   ///< Candidate margin (dB)
+
+/// Roaming settings.
+typedef struct {
+  bool enabled;
+  int16_t rssi_threshold;     ///< Average RSSI starting the background scans (dBm)
+  uint8_t hysteresis;         ///< RSSI gain required to roam (dB)
+} wifi_roaming_config_t;
+
+/// Roaming statistics, the outage going from the disconnection of the
+/// current AP to the station address binding on the new one.
+typedef struct {
+  int16_t rssi;               ///< Average RSSI of the current AP (dBm)
+  uint32_t scan_slices;       ///< Background scans
+  uint32_t roams;             ///< Successful roams
+  uint32_t pmksa_reuses;      ///< Roams reusing a cached PMK
+  uint32_t failures;          ///< Roams failed, back to the previous AP or not
+  uint32_t last_outage_ms;
+  uint32_t min_outage_ms;
+  uint32_t max_outage_ms;
+  uint32_t total_outage_ms;
+} wifi_roaming_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Create the roaming task, disabled until configured.
+ ******************************************************************************/
+void wifi_roaming_start(void);
+
+/***************************************************************************//**
+ * Apply new roaming settings.
+ ******************************************************************************/
+void wifi_roaming_configure(const wifi_roaming_config_t *config);
+
+/***************************************************************************//**
+ * Get the roaming settings and statistics.
+ ******************************************************************************/
+void wifi_roaming_get(wifi_roaming_config_t *config, wifi_roaming_stats_t *stats);
+
+/***************************************************************************//**
+ * Notify the station connection, from the Wi-Fi events task.
+ *
+ * @param bssid BSSID of the AP
+ * @param channel channel of the AP
+ * @param beacon_interval beacon interval (TU)
+ * @param dtim_period DTIM period (beacons)
+ ******************************************************************************/
+void wifi_roaming_connected(const uint8_t *bssid, uint16_t channel,
+                            uint16_t beacon_interval, uint8_t dtim_period);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
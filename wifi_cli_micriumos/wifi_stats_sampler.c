@@ -0,0 +1,315 @@
+/***************************************************************************//**
+ * @file
+ * @brief Periodic history of the station statistics
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************
+ *
+ * The sampler task reads the WFx counters, the RSSI, the station traffic and
+ * the lwIP counters each period while the station is connected. The
+ * increments since the previous read and their per-second rates are stored
+ * in a ring, so that a throughput drop can be matched afterwards with the
+ * retries and the beacon losses around it. The first read of a connection
+ * only sets the reference of the next one.
+ ******************************************************************************/
+#include <string.h>
+#include <kernel/include/os.h>
+#include "sl_wfx.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "lwip/stats.h"
+#include "ethernetif.h"
+#include "app_wifi_events.h"
+#include "wifi_stats_sampler.h"
+
+#define WIFI_STATS_SAMPLER_TASK_PRIO        25u
+#define WIFI_STATS_SAMPLER_TASK_STK_SIZE    600u
+
+/* The lwIP counters are 16 bits unless LWIP_STATS_LARGE */
+#define WIFI_STATS_LWIP_MASK                ((uint32_t)(STAT_COUNTER)~0)
+
+/// Sampler task state.
+typedef struct {
+  bool have_ref;              ///< Counters of the previous read valid
+  uint32_t ref_ms;
+  uint32_t ref[WIFI_STATS_FIELD_NB];
+  uint16_t head;              ///< Oldest sample
+  uint16_t count;
+  uint32_t seq;
+  uint32_t failures;          ///< Statistics reads failed
+} wifi_stats_sampler_state_t;
+
+static const char *const wifi_stats_field_names[WIFI_STATS_FIELD_NB] = {
+  [WIFI_STATS_BEACON_RX]         = "beacon_rx",
+  [WIFI_STATS_BEACON_MISSED]     = "beacon_missed",
+  [WIFI_STATS_UNICAST_RX]        = "unicast_rx",
+  [WIFI_STATS_UNICAST_TX_OK]     = "unicast_tx_ok",
+  [WIFI_STATS_UNICAST_TX_FAIL]   = "unicast_tx_fail",
+  [WIFI_STATS_MULTICAST_RX]      = "multicast_rx",
+  [WIFI_STATS_MULTICAST_TX_OK]   = "multicast_tx_ok",
+  [WIFI_STATS_MULTICAST_TX_FAIL] = "multicast_tx_fail",
+  [WIFI_STATS_TX_BYTES]          = "tx_bytes",
+  [WIFI_STATS_RX_BYTES]          = "rx_bytes",
+  [WIFI_STATS_LINK_XMIT]         = "link_xmit",
+  [WIFI_STATS_LINK_RECV]         = "link_recv",
+  [WIFI_STATS_LINK_DROP]         = "link_drop",
+  [WIFI_STATS_TCP_XMIT]          = "tcp_xmit",
+  [WIFI_STATS_TCP_RECV]          = "tcp_recv",
+  [WIFI_STATS_TCP_DROP]          = "tcp_drop",
+};
+
+static wifi_stats_sampler_config_t sampler_config = {
+  .enabled = false,
+  .period_ms = WIFI_STATS_SAMPLER_PERIOD_MS_DEFAULT,
+};
+static wifi_stats_sampler_state_t sampler;
+static wifi_stats_sample_t sampler_ring[WIFI_STATS_SAMPLER_DEPTH];
+
+static CPU_STK wifi_stats_sampler_task_stk[WIFI_STATS_SAMPLER_TASK_STK_SIZE];
+static OS_TCB wifi_stats_sampler_task_tcb;
+
+/***************************************************************************//**
+ * Read the counters and the RSSI.
+ ******************************************************************************/
+static bool wifi_stats_sampler_read(uint32_t *counters, int16_t *rssi)
+{
+  sl_wfx_statistics_t stats;
+  uint32_t rcpi;
+
+  if ((sl_wfx_get_statistics(&stats) != SL_STATUS_OK)
+      || (sl_wfx_get_signal_strength(&rcpi) != SL_STATUS_OK)) {
+    return false;
+  }
+  *rssi = (int16_t)(((int32_t)rcpi - 220) / 2);
+
+  counters[WIFI_STATS_BEACON_RX] = stats.beacon_rx_count;
+  counters[WIFI_STATS_BEACON_MISSED] = stats.beacon_rx_missed_count;
+  counters[WIFI_STATS_UNICAST_RX] = stats.unicast_rx_count;
+  counters[WIFI_STATS_UNICAST_TX_OK] = stats.unicast_tx_success_count;
+  counters[WIFI_STATS_UNICAST_TX_FAIL] = stats.unicast_tx_failure_count;
+  counters[WIFI_STATS_MULTICAST_RX] = stats.multicast_rx_count;
+  counters[WIFI_STATS_MULTICAST_TX_OK] = stats.multicast_tx_success_count;
+  counters[WIFI_STATS_MULTICAST_TX_FAIL] = stats.multicast_tx_failure_count;
+  ethernetif_get_sta_traffic(&counters[WIFI_STATS_TX_BYTES], &counters[WIFI_STATS_RX_BYTES]);
+
+  LOCK_TCPIP_CORE();
+  counters[WIFI_STATS_LINK_XMIT] = lwip_stats.link.xmit;
+  counters[WIFI_STATS_LINK_RECV] = lwip_stats.link.recv;
+  counters[WIFI_STATS_LINK_DROP] = lwip_stats.link.drop;
+  counters[WIFI_STATS_TCP_XMIT] = lwip_stats.tcp.xmit;
+  counters[WIFI_STATS_TCP_RECV] = lwip_stats.tcp.recv;
+  counters[WIFI_STATS_TCP_DROP] = lwip_stats.tcp.drop;
+  UNLOCK_TCPIP_CORE();
+
+  return true;
+}
+
+/***************************************************************************//**
+ * Compute a sample against the previous read and store it in the ring.
+ ******************************************************************************/
+static void wifi_stats_sampler_insert(const uint32_t *counters, int16_t rssi, uint32_t now_ms)
+{
+  wifi_stats_sample_t sample;
+  uint32_t mask;
+  uint8_t field;
+  CPU_SR_ALLOC();
+
+  sample.timestamp_ms = now_ms;
+  sample.interval_ms = now_ms - sampler.ref_ms;
+  sample.rssi = rssi;
+  for (field = 0; field < WIFI_STATS_FIELD_NB; field++) {
+    mask = (field >= WIFI_STATS_LINK_XMIT) ? WIFI_STATS_LWIP_MASK : 0xFFFFFFFF;
+    /* Unsigned differences stay right when a counter wraps */
+    sample.delta[field] = (counters[field] - sampler.ref[field]) & mask;
+    sample.rate[field] = (sample.interval_ms != 0)
+                         ? (uint32_t)(((uint64_t)sample.delta[field] * 1000) / sample.interval_ms)
+                         : 0;
+  }
+
+  CPU_CRITICAL_ENTER();
+  sample.seq = sampler.seq++;
+  if (sampler.count < WIFI_STATS_SAMPLER_DEPTH) {
+    sampler_ring[(sampler.head + sampler.count) % WIFI_STATS_SAMPLER_DEPTH] = sample;
+    sampler.count++;
+  } else {
+    sampler_ring[sampler.head] = sample;
+    sampler.head = (sampler.head + 1) % WIFI_STATS_SAMPLER_DEPTH;
+  }
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Statistics sampler task.
+ ******************************************************************************/
+static void wifi_stats_sampler_task(void *p_arg)
+{
+  uint32_t counters[WIFI_STATS_FIELD_NB];
+  uint32_t now_ms;
+  int16_t rssi;
+  RTOS_ERR err;
+
+  (void)p_arg;
+
+  while (1) {
+    OSTimeDly((OS_TICK)(((uint64_t)sampler_config.period_ms * OSCfg_TickRate_Hz) / 1000),
+              OS_OPT_TIME_DLY,
+              &err);
+
+    if (!sampler_config.enabled || !(wifi.state & SL_WFX_STA_INTERFACE_CONNECTED)) {
+      /* The next connection starts a new reference */
+      sampler.have_ref = false;
+      continue;
+    }
+
+    now_ms = sys_now();
+    if (!wifi_stats_sampler_read(counters, &rssi)) {
+      sampler.failures++;
+      continue;
+    }
+    if (sampler.have_ref) {
+      wifi_stats_sampler_insert(counters, rssi, now_ms);
+    }
+    memcpy(sampler.ref, counters, sizeof(sampler.ref));
+    sampler.ref_ms = now_ms;
+    sampler.have_ref = true;
+  }
+}
+
+/***************************************************************************//**
+ * Create the sampler task, disabled until configured.
+ ******************************************************************************/
+void wifi_stats_sampler_start(void)
+{
+  RTOS_ERR err;
+
+  OSTaskCreate(&wifi_stats_sampler_task_tcb,
+               "WFX stats sampler task",
+               wifi_stats_sampler_task,
+               DEF_NULL,
+               WIFI_STATS_SAMPLER_TASK_PRIO,
+               &wifi_stats_sampler_task_stk[0],
+               (WIFI_STATS_SAMPLER_TASK_STK_SIZE / 10u),
+               WIFI_STATS_SAMPLER_TASK_STK_SIZE,
+               0u,
+               0u,
+               DEF_NULL,
+               (OS_OPT_TASK_STK_CLR),
+               &err);
+  APP_RTOS_ASSERT_DBG((RTOS_ERR_CODE_GET(err) == RTOS_ERR_NONE), 1);
+}
+
+/***************************************************************************//**
+ * Apply new sampler settings.
+ ******************************************************************************/
+void wifi_stats_sampler_configure(const wifi_stats_sampler_config_t *config)
+{
+  sampler_config.period_ms = (config->period_ms < WIFI_STATS_SAMPLER_PERIOD_MS_MIN)
+                             ? WIFI_STATS_SAMPLER_PERIOD_MS_MIN : config->period_ms;
+  sampler_config.enabled = config->enabled;
+}
+
+/***************************************************************************//**
+ * Get the sampler settings and state.
+ ******************************************************************************/
+void wifi_stats_sampler_get(wifi_stats_sampler_config_t *config,
+                            uint16_t *count,
+                            uint32_t *failures)
+{
+  *config = sampler_config;
+  *count = sampler.count;
+  *failures = sampler.failures;
+}
+
+/***************************************************************************//**
+ * Get a sample of the history, the oldest first.
+ ******************************************************************************/
+bool wifi_stats_sampler_get_sample(uint16_t index, wifi_stats_sample_t *sample)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if (index >= sampler.count) {
+    CPU_CRITICAL_EXIT();
+    return false;
+  }
+  *sample = sampler_ring[(sampler.head + index) % WIFI_STATS_SAMPLER_DEPTH];
+  CPU_CRITICAL_EXIT();
+  return true;
+}
+
+/***************************************************************************//**
+ * Compute the minimum, average and maximum of the samples in the history.
+ ******************************************************************************/
+void wifi_stats_sampler_summary(wifi_stats_summary_t *summary)
+{
+  wifi_stats_sample_t sample;
+  uint64_t rate_total[WIFI_STATS_FIELD_NB] = { 0 };
+  int32_t rssi_total = 0;
+  uint16_t index;
+  uint8_t field;
+
+  memset(summary, 0, sizeof(*summary));
+  for (index = 0; wifi_stats_sampler_get_sample(index, &sample); index++) {
+    if ((index == 0) || (sample.rssi < summary->rssi_min)) {
+      summary->rssi_min = sample.rssi;
+    }
+    if ((index == 0) || (sample.rssi > summary->rssi_max)) {
+      summary->rssi_max = sample.rssi;
+    }
+    rssi_total += sample.rssi;
+    for (field = 0; field < WIFI_STATS_FIELD_NB; field++) {
+      if ((index == 0) || (sample.rate[field] < summary->rate_min[field])) {
+        summary->rate_min[field] = sample.rate[field];
+      }
+      if (sample.rate[field] > summary->rate_max[field]) {
+        summary->rate_max[field] = sample.rate[field];
+      }
+      rate_total[field] += sample.rate[field];
+    }
+  }
+
+  summary->count = index;
+  if (index > 0) {
+    summary->rssi_avg = (int16_t)(rssi_total / index);
+    for (field = 0; field < WIFI_STATS_FIELD_NB; field++) {
+      summary->rate_avg[field] = (uint32_t)(rate_total[field] / index);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Clear the history and the failure counter.
+ ******************************************************************************/
+void wifi_stats_sampler_reset(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  sampler.head = 0;
+  sampler.count = 0;
+  sampler.seq = 0;
+  sampler.failures = 0;
+  CPU_CRITICAL_EXIT();
+}
+
+/***************************************************************************//**
+ * Get the name of a field.
+ ******************************************************************************/
+const char *wifi_stats_sampler_field_name(wifi_stats_field_t field)
+{
+  return (field < WIFI_STATS_FIELD_NB) ? wifi_stats_field_names[field] : "";
+}
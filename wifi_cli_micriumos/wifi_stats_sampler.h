@@ -0,0 +1,125 @@
+/**************************************************************************//**
+ * # License
+ * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************/
+#ifndef WIFI_STATS_SAMPLER_H
+#define WIFI_STATS_SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WIFI_STATS_SAMPLER_DEPTH              60    ///< Samples kept, the oldest overwritten
+#define WIFI_STATS_SAMPLER_PERIOD_MS_DEFAULT  1000
+#define WIFI_STATS_SAMPLER_PERIOD_MS_MIN      100
+
+/// Sampled counters of the station.
+typedef enum {
+  WIFI_STATS_BEACON_RX = 0,
+  WIFI_STATS_BEACON_MISSED,
+  WIFI_STATS_UNICAST_RX,
+  WIFI_STATS_UNICAST_TX_OK,
+  WIFI_STATS_UNICAST_TX_FAIL,
+  WIFI_STATS_MULTICAST_RX,
+  WIFI_STATS_MULTICAST_TX_OK,
+  WIFI_STATS_MULTICAST_TX_FAIL,
+  WIFI_STATS_TX_BYTES,          ///< Bytes sent on the station interface
+  WIFI_STATS_RX_BYTES,          ///< Bytes received on the station interface
+  WIFI_STATS_LINK_XMIT,         ///< lwIP link frames sent, both interfaces
+  WIFI_STATS_LINK_RECV,
+  WIFI_STATS_LINK_DROP,
+  WIFI_STATS_TCP_XMIT,          ///< lwIP TCP segments sent
+  WIFI_STATS_TCP_RECV,
+  WIFI_STATS_TCP_DROP,
+  WIFI_STATS_FIELD_NB
+} wifi_stats_field_t;
+
+/// Statistics sampler settings.
+typedef struct {
+  bool enabled;
+  uint32_t period_ms;           ///< Sampling period, at least WIFI_STATS_SAMPLER_PERIOD_MS_MIN
+} wifi_stats_sampler_config_t;
+
+/// One sample: the counter increments since the previous sample.
+typedef struct {
+  uint32_t seq;                 ///< Sample number since the last reset
+  uint32_t timestamp_ms;
+  uint32_t interval_ms;         ///< Time since the previous sample
+  int16_t rssi;                 ///< dBm
+  uint32_t delta[WIFI_STATS_FIELD_NB];
+  uint32_t rate[WIFI_STATS_FIELD_NB];   ///< Increments per second
+} wifi_stats_sample_t;
+
+/// Minimum, average and maximum of the samples in the history.
+typedef struct {
+  uint16_t count;
+  int16_t rssi_min;
+  int16_t rssi_avg;
+  int16_t rssi_max;
+  uint32_t rate_min[WIFI_STATS_FIELD_NB];
+  uint32_t rate_avg[WIFI_STATS_FIELD_NB];
+  uint32_t rate_max[WIFI_STATS_FIELD_NB];
+} wifi_stats_summary_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***************************************************************************//**
+ * Create the sampler task, disabled until configured.
+ ******************************************************************************/
+void wifi_stats_sampler_start(void);
+
+/***************************************************************************//**
+ * Apply new sampler settings. The history is kept.
+ ******************************************************************************/
+void wifi_stats_sampler_configure(const wifi_stats_sampler_config_t *config);
+
+/***************************************************************************//**
+ * Get the sampler settings, the samples in the history and the sampling
+ * failures.
+ ******************************************************************************/
+void wifi_stats_sampler_get(wifi_stats_sampler_config_t *config,
+                            uint16_t *count,
+                            uint32_t *failures);
+
+/***************************************************************************//**
+ * Get a sample of the history.
+ *
+ * @param index 0 for the oldest sample
+ * @param sample copy of the sample
+ * @returns false if there is no such sample
+ ******************************************************************************/
+bool wifi_stats_sampler_get_sample(uint16_t index, wifi_stats_sample_t *sample);
+
+/***************************************************************************//**
+ * Compute the minimum, average and maximum of the samples in the history.
+ ******************************************************************************/
+void wifi_stats_sampler_summary(wifi_stats_summary_t *summary);
+
+/***************************************************************************//**
+ * Clear the history and the failure counter.
+ ******************************************************************************/
+void wifi_stats_sampler_reset(void);
+
+/***************************************************************************//**
+ * Get the name of a field.
+ ******************************************************************************/
+const char *wifi_stats_sampler_field_name(wifi_stats_field_t field);
+
+#ifdef __cplusplus
+}
+#endif
+#endif